@@ -0,0 +1,1328 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// Microbenchmarks of the client library hot paths, run against the simulated
+// bus so no driver is required. Results are written as JSON:
+//
+//   ViGEmBenchmark [--out <file>] [--filter <substring>]
+//
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+#include "ViGEm/Record.h"
+#include "ViGEm/Stats.h"
+#include "ViGEm/Util.h"
+#include "ViGEm/Remap.h"
+#include "ViGEm/Analog.h"
+#include "ViGEm/Motion.h"
+#include "ViGEm/Async.h"
+#if defined(__cpp_impl_coroutine)
+#include "ViGEm/Client.hpp"
+#endif
+
+//
+// STL
+//
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#if defined(_MSC_VER)
+// benchmarks the deprecated DS4 notification path too
+#pragma warning(disable: 4996)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+
+typedef struct _BENCH_RESULT
+{
+	std::string Name;
+	ULONGLONG Iterations;
+	DOUBLE NsPerOp;
+
+	//
+	// Per-operation latency percentiles, only for benchmarks timing every call
+	//
+	BOOLEAN HasLatency;
+	DOUBLE P50Ns;
+	DOUBLE P99Ns;
+	DOUBLE MaxNs;
+
+	//
+	// Heap allocations per operation, only for benchmarks counting them
+	//
+	BOOLEAN HasAllocations;
+	DOUBLE AllocationsPerOp;
+} BENCH_RESULT;
+
+static std::vector<BENCH_RESULT> g_Results;
+static const char* g_Filter = nullptr;
+static DOUBLE g_NsPerTick = 0.0;
+
+//
+// Keeps results of pure computations observable so they aren't optimized away
+//
+static volatile ULONGLONG g_Sink = 0;
+
+static FORCEINLINE LONGLONG bench_now()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+static bool bench_enabled(const char* Name)
+{
+	return !g_Filter || strstr(Name, g_Filter) != nullptr;
+}
+
+//
+// Times Iterations calls of Body as a whole, for operations too short to be
+// timed one by one. Ops is the amount of work one call performs.
+//
+template <typename TBody>
+static void bench_throughput(const std::string& Name, ULONGLONG Iterations, ULONGLONG Ops, TBody Body)
+{
+	if (!bench_enabled(Name.c_str()))
+		return;
+
+	// warm up caches and branch predictors
+	for (ULONGLONG i = 0; i < Iterations / 10 + 1; i++)
+		Body(i);
+
+	const LONGLONG start = bench_now();
+
+	for (ULONGLONG i = 0; i < Iterations; i++)
+		Body(i);
+
+	const LONGLONG stop = bench_now();
+
+	BENCH_RESULT result = {};
+	result.Name = Name;
+	result.Iterations = Iterations * Ops;
+	result.NsPerOp = (stop - start) * g_NsPerTick / static_cast<DOUBLE>(result.Iterations);
+
+	g_Results.push_back(result);
+}
+
+//
+// Times every call of Body on its own and reports latency percentiles.
+//
+template <typename TBody>
+static void bench_latency(const std::string& Name, ULONGLONG Iterations, TBody Body)
+{
+	if (!bench_enabled(Name.c_str()))
+		return;
+
+	std::vector<LONGLONG> samples(static_cast<size_t>(Iterations));
+
+	for (ULONGLONG i = 0; i < Iterations / 10 + 1; i++)
+		Body(i);
+
+	LONGLONG total = 0;
+
+	for (ULONGLONG i = 0; i < Iterations; i++)
+	{
+		const LONGLONG start = bench_now();
+		Body(i);
+		samples[static_cast<size_t>(i)] = bench_now() - start;
+		total += samples[static_cast<size_t>(i)];
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	BENCH_RESULT result = {};
+	result.Name = Name;
+	result.Iterations = Iterations;
+	result.NsPerOp = total * g_NsPerTick / static_cast<DOUBLE>(Iterations);
+	result.HasLatency = TRUE;
+	result.P50Ns = samples[samples.size() / 2] * g_NsPerTick;
+	result.P99Ns = samples[samples.size() * 99 / 100] * g_NsPerTick;
+	result.MaxNs = samples.back() * g_NsPerTick;
+
+	g_Results.push_back(result);
+}
+
+static void bench_fail(const char* What, VIGEM_ERROR Error)
+{
+	fprintf(stderr, "%s failed: 0x%X\n", What, static_cast<unsigned>(Error));
+	exit(1);
+}
+
+#define BENCH_CHECK(_call_) \
+	do { const VIGEM_ERROR _error_ = (_call_); if (_error_ != VIGEM_ERROR_NONE) bench_fail(#_call_, _error_); } while (0)
+
+static PVIGEM_CLIENT bench_connect()
+{
+	const auto client = vigem_alloc();
+
+	if (!client)
+		bench_fail("vigem_alloc", VIGEM_ERROR_BUS_ACCESS_FAILED);
+
+	BENCH_CHECK(vigem_connect_simulated(client));
+
+	return client;
+}
+
+static void bench_disconnect(PVIGEM_CLIENT Client)
+{
+	vigem_disconnect(Client);
+	vigem_free(Client);
+}
+
+//
+// Report update latency and throughput per target type
+//
+static void bench_update()
+{
+	const auto client = bench_connect();
+	const auto x360 = vigem_target_x360_alloc();
+	const auto ds4 = vigem_target_ds4_alloc();
+
+	BENCH_CHECK(vigem_target_add(client, x360));
+	BENCH_CHECK(vigem_target_add(client, ds4));
+
+	XUSB_REPORT xusb = {};
+	DS4_REPORT report;
+	DS4_REPORT_INIT(&report);
+	DS4_REPORT_EX reportEx = {};
+
+	bench_latency("update/x360", 200000, [&](ULONGLONG i)
+	{
+		xusb.sThumbLX = static_cast<SHORT>(i);
+		vigem_target_x360_update(client, x360, xusb);
+	});
+
+	bench_latency("update/ds4", 200000, [&](ULONGLONG i)
+	{
+		report.bThumbLX = static_cast<BYTE>(i);
+		vigem_target_ds4_update(client, ds4, report);
+	});
+
+	bench_latency("update/ds4_ex", 200000, [&](ULONGLONG i)
+	{
+		reportEx.Report.bThumbLX = static_cast<BYTE>(i);
+		vigem_target_ds4_update_ex(client, ds4, reportEx);
+	});
+
+	//
+	// Reports edited in the pinned submission buffer, compare against the
+	// update functions above
+	//
+	PXUSB_REPORT pinnedXusb;
+	PDS4_REPORT_EX pinnedEx;
+
+	BENCH_CHECK(vigem_target_x360_get_report_buffer(client, x360, &pinnedXusb));
+	BENCH_CHECK(vigem_target_ds4_get_report_ex_buffer(client, ds4, &pinnedEx));
+
+	bench_latency("update/x360/pinned", 200000, [&](ULONGLONG i)
+	{
+		pinnedXusb->sThumbLX = static_cast<SHORT>(i);
+		vigem_target_x360_commit_report(client, x360);
+	});
+
+	bench_latency("update/ds4_ex/pinned", 200000, [&](ULONGLONG i)
+	{
+		pinnedEx->Report.bThumbLX = static_cast<BYTE>(i);
+		vigem_target_ds4_commit_report_ex(client, ds4);
+	});
+
+	//
+	// Prepared targets skip the per-call validation and event creation, the
+	// simulated bus only copies the report so the difference is per-call
+	// overhead
+	//
+	PVIGEM_PREPARED_TARGET preparedX360;
+	PVIGEM_PREPARED_TARGET preparedDs4;
+
+	BENCH_CHECK(vigem_target_prepare(client, x360, &preparedX360));
+	BENCH_CHECK(vigem_target_prepare(client, ds4, &preparedDs4));
+
+	bench_latency("update/x360/prepared", 200000, [&](ULONGLONG i)
+	{
+		xusb.sThumbLX = static_cast<SHORT>(i);
+		vigem_target_x360_update_prepared(preparedX360, xusb);
+	});
+
+	bench_latency("update/ds4/prepared", 200000, [&](ULONGLONG i)
+	{
+		report.bThumbLX = static_cast<BYTE>(i);
+		vigem_target_ds4_update_prepared(preparedDs4, report);
+	});
+
+	bench_latency("update/ds4_ex/prepared", 200000, [&](ULONGLONG i)
+	{
+		reportEx.Report.bThumbLX = static_cast<BYTE>(i);
+		vigem_target_ds4_update_ex_prepared(preparedDs4, reportEx);
+	});
+
+	vigem_prepared_target_free(preparedX360);
+	vigem_prepared_target_free(preparedDs4);
+
+	// latency of a whole batch, compare against 16 single updates
+	XUSB_REPORT batch[16] = {};
+
+	bench_latency("update/x360/batch16", 20000, [&](ULONGLONG i)
+	{
+		batch[0].sThumbLX = static_cast<SHORT>(i);
+		vigem_target_x360_update_batch(client, x360, batch, 16);
+	});
+
+	bench_throughput("update/x360/throughput", 200000, 1, [&](ULONGLONG i)
+	{
+		xusb.sThumbLX = static_cast<SHORT>(i);
+		vigem_target_x360_update(client, x360, xusb);
+	});
+
+	//
+	// Same as update/x360 with statistics collection on
+	//
+	if (bench_enabled("update/x360/stats"))
+	{
+		BENCH_CHECK(vigem_stats_enable(client, TRUE));
+
+		bench_latency("update/x360/stats", 200000, [&](ULONGLONG i)
+		{
+			xusb.sThumbLX = static_cast<SHORT>(i);
+			vigem_target_x360_update(client, x360, xusb);
+		});
+
+		BENCH_CHECK(vigem_stats_enable(client, FALSE));
+	}
+
+	//
+	// Same as update/x360 with every report also written to a recording
+	//
+	if (bench_enabled("update/x360/recording"))
+	{
+		WCHAR path[MAX_PATH];
+		const DWORD length = GetTempPathW(MAX_PATH, path);
+
+		if (length && length < MAX_PATH - 24)
+		{
+			wcscat_s(path, MAX_PATH, L"ViGEmBenchmark.vgmr");
+			BENCH_CHECK(vigem_record_start(client, path));
+
+			bench_latency("update/x360/recording", 200000, [&](ULONGLONG i)
+			{
+				xusb.sThumbLX = static_cast<SHORT>(i);
+				vigem_target_x360_update(client, x360, xusb);
+			});
+
+			vigem_record_stop(client);
+			DeleteFileW(path);
+		}
+	}
+
+	vigem_target_remove(client, x360);
+	vigem_target_remove(client, ds4);
+	vigem_target_free(x360);
+	vigem_target_free(ds4);
+	bench_disconnect(client);
+}
+
+//
+// Report updates cycling through many targets, so every update touches a
+// target object that's no longer cached
+//
+static void bench_update_many()
+{
+	const ULONG targetCount = 10000;
+	const std::string name = "update/ds4/targets=" + std::to_string(targetCount);
+
+	if (!bench_enabled(name.c_str()))
+		return;
+
+	const auto client = bench_connect();
+	std::vector<PVIGEM_TARGET> targets(targetCount);
+
+	for (auto& target : targets)
+	{
+		target = vigem_target_ds4_alloc();
+		BENCH_CHECK(vigem_target_add(client, target));
+	}
+
+	DS4_REPORT report;
+	DS4_REPORT_INIT(&report);
+
+	bench_latency(name, 200000, [&](ULONGLONG i)
+	{
+		report.bThumbLX = static_cast<BYTE>(i);
+		vigem_target_ds4_update(client, targets[static_cast<size_t>(i % targetCount)], report);
+	});
+
+	for (const auto target : targets)
+	{
+		vigem_target_remove(client, target);
+		vigem_target_free(target);
+	}
+
+	bench_disconnect(client);
+}
+
+//
+// Report throughput of several threads feeding a target each, with the targets
+// sharing one simulated bus or spread across several
+//
+static void bench_multi_bus()
+{
+	static const ULONG busCounts[] = { 1, 4 };
+	const ULONG threadCount = 8;
+	const ULONGLONG iterations = 50000;
+
+	for (const ULONG busCount : busCounts)
+	{
+		const std::string name = "update/x360/threads=" + std::to_string(threadCount) + "/buses=" + std::to_string(busCount);
+
+		if (!bench_enabled(name.c_str()))
+			continue;
+
+		const auto client = vigem_alloc();
+
+		if (!client)
+			bench_fail("vigem_alloc", VIGEM_ERROR_BUS_ACCESS_FAILED);
+
+		BENCH_CHECK(vigem_connect_simulated_multi_bus(client, busCount));
+
+		std::vector<PVIGEM_TARGET> targets(threadCount);
+
+		for (auto& target : targets)
+		{
+			target = vigem_target_x360_alloc();
+			BENCH_CHECK(vigem_target_add(client, target));
+		}
+
+		std::vector<std::thread> threads;
+		volatile LONG ready = 0;
+
+		const LONGLONG start = bench_now();
+
+		for (const auto target : targets)
+		{
+			threads.emplace_back([&, target]
+			{
+				XUSB_REPORT report = {};
+
+				InterlockedIncrement(&ready);
+
+				// start together so the threads actually contend
+				while (ready != static_cast<LONG>(threadCount))
+					YieldProcessor();
+
+				for (ULONGLONG i = 0; i < iterations; i++)
+				{
+					report.sThumbLX = static_cast<SHORT>(i);
+					vigem_target_x360_update(client, target, report);
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		const LONGLONG stop = bench_now();
+
+		BENCH_RESULT result = {};
+		result.Name = name;
+		result.Iterations = iterations * threadCount;
+		result.NsPerOp = (stop - start) * g_NsPerTick / static_cast<DOUBLE>(result.Iterations);
+
+		g_Results.push_back(result);
+
+		for (const auto target : targets)
+		{
+			vigem_target_remove(client, target);
+			vigem_target_free(target);
+		}
+
+		bench_disconnect(client);
+	}
+}
+
+//
+// Client connect and disconnect latency, with a connection of its own or
+// attached to a shared session another client keeps open
+//
+static void bench_shared_session()
+{
+	const ULONGLONG iterations = 1000;
+
+	bench_latency("connect_disconnect/simulated", iterations, [](ULONGLONG)
+	{
+		bench_disconnect(bench_connect());
+	});
+
+	if (!bench_enabled("connect_disconnect/simulated/shared"))
+		return;
+
+	const auto holder = vigem_alloc();
+
+	if (!holder)
+		bench_fail("vigem_alloc", VIGEM_ERROR_BUS_ACCESS_FAILED);
+
+	BENCH_CHECK(vigem_connect_simulated_shared(holder));
+
+	bench_latency("connect_disconnect/simulated/shared", iterations, [](ULONGLONG)
+	{
+		const auto client = vigem_alloc();
+
+		if (!client)
+			bench_fail("vigem_alloc", VIGEM_ERROR_BUS_ACCESS_FAILED);
+
+		BENCH_CHECK(vigem_connect_simulated_shared(client));
+		bench_disconnect(client);
+	});
+
+	bench_disconnect(holder);
+}
+
+//
+// Plug-in and unplug latency with a number of targets already attached
+//
+static void bench_add_remove()
+{
+	static const ULONG occupancies[] = { 0, 16, 256, 1024 };
+
+	for (const ULONG occupancy : occupancies)
+	{
+		const std::string addName = "target_add/occupancy=" + std::to_string(occupancy);
+		const std::string removeName = "target_remove/occupancy=" + std::to_string(occupancy);
+
+		if (!bench_enabled(addName.c_str()) && !bench_enabled(removeName.c_str()))
+			continue;
+
+		const auto client = bench_connect();
+		std::vector<PVIGEM_TARGET> attached;
+
+		for (ULONG index = 0; index < occupancy; index++)
+		{
+			const auto target = vigem_target_x360_alloc();
+			BENCH_CHECK(vigem_target_add(client, target));
+			attached.push_back(target);
+		}
+
+		const auto target = vigem_target_x360_alloc();
+		std::vector<LONGLONG> addSamples, removeSamples;
+		LONGLONG addTotal = 0, removeTotal = 0;
+		const ULONG iterations = 1000;
+
+		for (ULONG i = 0; i < iterations; i++)
+		{
+			LONGLONG start = bench_now();
+			BENCH_CHECK(vigem_target_add(client, target));
+			addSamples.push_back(bench_now() - start);
+
+			start = bench_now();
+			BENCH_CHECK(vigem_target_remove(client, target));
+			removeSamples.push_back(bench_now() - start);
+
+			addTotal += addSamples.back();
+			removeTotal += removeSamples.back();
+		}
+
+		const auto report = [&](const std::string& Name, std::vector<LONGLONG>& Samples, LONGLONG Total)
+		{
+			if (!bench_enabled(Name.c_str()))
+				return;
+
+			std::sort(Samples.begin(), Samples.end());
+
+			BENCH_RESULT result = {};
+			result.Name = Name;
+			result.Iterations = iterations;
+			result.NsPerOp = Total * g_NsPerTick / iterations;
+			result.HasLatency = TRUE;
+			result.P50Ns = Samples[Samples.size() / 2] * g_NsPerTick;
+			result.P99Ns = Samples[Samples.size() * 99 / 100] * g_NsPerTick;
+			result.MaxNs = Samples.back() * g_NsPerTick;
+
+			g_Results.push_back(result);
+		};
+
+		report(addName, addSamples, addTotal);
+		report(removeName, removeSamples, removeTotal);
+
+		vigem_target_free(target);
+
+		for (const auto entry : attached)
+		{
+			vigem_target_remove(client, entry);
+			vigem_target_free(entry);
+		}
+
+		bench_disconnect(client);
+	}
+}
+
+//
+// Join/leave churn: a pad is allocated, plugged in, fed once, unplugged and
+// freed, from the heap or from a pool reserved up front
+//
+static void bench_target_churn()
+{
+	const ULONGLONG iterations = 20000;
+
+	if (!bench_enabled("target_churn/heap") && !bench_enabled("target_churn/pooled"))
+		return;
+
+	const auto client = bench_connect();
+
+	BENCH_CHECK(vigem_target_pool_reserve(client, 64));
+
+	const auto churn = [client](PVIGEM_TARGET target)
+	{
+		const XUSB_REPORT report = {};
+
+		BENCH_CHECK(vigem_target_add(client, target));
+		vigem_target_x360_update(client, target, report);
+		vigem_target_remove(client, target);
+		vigem_target_free(target);
+	};
+
+	bench_latency("target_churn/heap", iterations, [&](ULONGLONG)
+	{
+		churn(vigem_target_x360_alloc());
+	});
+
+	VIGEM_TARGET_POOL_STATS before;
+	VIGEM_TARGET_POOL_STATS_INIT(&before);
+	BENCH_CHECK(vigem_target_pool_get_stats(client, &before));
+
+	bench_latency("target_churn/pooled", iterations, [&](ULONGLONG)
+	{
+		churn(vigem_target_x360_alloc_pooled(client));
+	});
+
+	VIGEM_TARGET_POOL_STATS after;
+	VIGEM_TARGET_POOL_STATS_INIT(&after);
+	BENCH_CHECK(vigem_target_pool_get_stats(client, &after));
+
+	// slabs the pool had to add past the reservation, warm-up included
+	if (bench_enabled("target_churn/pooled"))
+	{
+		g_Results.back().HasAllocations = TRUE;
+		g_Results.back().AllocationsPerOp = (after.Slabs - before.Slabs) / static_cast<DOUBLE>(iterations);
+	}
+
+	bench_disconnect(client);
+}
+
+static volatile LONG g_Notifications = 0;
+
+static VOID CALLBACK bench_x360_notification(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	UCHAR LargeMotor,
+	UCHAR SmallMotor,
+	UCHAR LedNumber,
+	LPVOID UserData
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(LargeMotor);
+	UNREFERENCED_PARAMETER(SmallMotor);
+	UNREFERENCED_PARAMETER(LedNumber);
+	UNREFERENCED_PARAMETER(UserData);
+
+	InterlockedIncrement(&g_Notifications);
+}
+
+static VOID CALLBACK bench_ds4_notification(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	UCHAR LargeMotor,
+	UCHAR SmallMotor,
+	DS4_LIGHTBAR_COLOR LightbarColor,
+	LPVOID UserData
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(LargeMotor);
+	UNREFERENCED_PARAMETER(SmallMotor);
+	UNREFERENCED_PARAMETER(LightbarColor);
+	UNREFERENCED_PARAMETER(UserData);
+
+	InterlockedIncrement(&g_Notifications);
+}
+
+//
+// Waits until the notification callback ran Count times in total
+//
+static void bench_await_notifications(LONG Count)
+{
+	while (g_Notifications < Count)
+		YieldProcessor();
+}
+
+//
+// Time from the bus completing a notification request until the user
+// callback runs, and from an output report arriving until it's picked up
+//
+static void bench_notification()
+{
+	const auto client = bench_connect();
+	const auto x360 = vigem_target_x360_alloc();
+	const auto ds4 = vigem_target_ds4_alloc();
+
+	BENCH_CHECK(vigem_target_add(client, x360));
+	BENCH_CHECK(vigem_target_add(client, ds4));
+
+	if (bench_enabled("notification/x360"))
+	{
+		BENCH_CHECK(vigem_target_x360_register_notification(client, x360, bench_x360_notification, nullptr));
+
+		bench_latency("notification/x360", 20000, [&](ULONGLONG i)
+		{
+			const LONG expected = g_Notifications + 1;
+			vigem_sim_x360_notify(client, x360, static_cast<UCHAR>(i), 0, 0);
+			bench_await_notifications(expected);
+		});
+
+		vigem_target_x360_unregister_notification(x360);
+	}
+
+	DS4_OUTPUT_BUFFER output = {};
+	output.Buffer[0] = 0x05;
+
+	if (bench_enabled("notification/ds4"))
+	{
+		BENCH_CHECK(vigem_target_ds4_register_notification(client, ds4, bench_ds4_notification, nullptr));
+
+		bench_latency("notification/ds4", 20000, [&](ULONGLONG i)
+		{
+			const LONG expected = g_Notifications + 1;
+			output.Buffer[4] = static_cast<UCHAR>(i);
+			vigem_sim_ds4_output(client, ds4, &output);
+			bench_await_notifications(expected);
+		});
+
+		vigem_target_ds4_unregister_notification(ds4);
+	}
+
+	if (bench_enabled("output_pickup/ds4"))
+	{
+		DS4_OUTPUT_BUFFER received;
+
+		// drop output queued by the previous benchmark
+		vigem_target_ds4_await_output_report_timeout(client, ds4, 0, &received);
+
+		bench_latency("output_pickup/ds4", 20000, [&](ULONGLONG i)
+		{
+			output.Buffer[4] = static_cast<UCHAR>(i);
+			vigem_sim_ds4_output(client, ds4, &output);
+			vigem_target_ds4_await_output_report_timeout(client, ds4, 1000, &received);
+		});
+	}
+
+	vigem_target_remove(client, x360);
+	vigem_target_remove(client, ds4);
+	vigem_target_free(x360);
+	vigem_target_free(ds4);
+	bench_disconnect(client);
+}
+
+//
+// Notification dispatch latency while every processor is kept busy by
+// threads of normal priority, with the notification thread left alone and
+// with it pinned to a processor and raised to time critical
+//
+static void bench_thread_config()
+{
+	if (!bench_enabled("notification/x360/burn"))
+		return;
+
+	DWORD_PTR processMask, systemMask;
+
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) || !processMask)
+		return;
+
+	const auto client = bench_connect();
+
+	volatile BOOLEAN burning = TRUE;
+	std::vector<std::thread> burners;
+
+	for (unsigned index = 0; index < std::max(1u, std::thread::hardware_concurrency()); index++)
+	{
+		burners.emplace_back([&]
+		{
+			ULONGLONG spins = 0;
+
+			while (burning)
+				spins++;
+
+			g_Sink += spins;
+		});
+	}
+
+	// the measuring thread must not be what's starved
+	const HANDLE self = GetCurrentThread();
+	const INT priority = GetThreadPriority(self);
+	SetThreadPriority(self, THREAD_PRIORITY_HIGHEST);
+
+	VIGEM_THREAD_CONFIG pinned;
+	VIGEM_THREAD_CONFIG_INIT(&pinned);
+	pinned.TimeCritical = TRUE;
+
+	// the highest processor the process may use
+	pinned.AffinityMask = processMask;
+
+	while (pinned.AffinityMask & (pinned.AffinityMask - 1))
+		pinned.AffinityMask &= pinned.AffinityMask - 1;
+
+	const struct
+	{
+		const char* Name;
+		const VIGEM_THREAD_CONFIG* Config;
+	} cases[] =
+	{
+		{ "notification/x360/burn", nullptr },
+		{ "notification/x360/burn/time_critical", &pinned },
+	};
+
+	for (const auto& entry : cases)
+	{
+		BENCH_CHECK(vigem_set_thread_config(client, VIGEM_THREAD_NOTIFICATION, entry.Config));
+
+		// a fresh target each, so no notification thread of the last case is left
+		const auto x360 = vigem_target_x360_alloc();
+
+		BENCH_CHECK(vigem_target_add(client, x360));
+		BENCH_CHECK(vigem_target_x360_register_notification(client, x360, bench_x360_notification, nullptr));
+
+		bench_latency(entry.Name, 5000, [&](ULONGLONG i)
+		{
+			const LONG expected = g_Notifications + 1;
+			vigem_sim_x360_notify(client, x360, static_cast<UCHAR>(i), 0, 0);
+			bench_await_notifications(expected);
+		});
+
+		vigem_target_x360_unregister_notification(x360);
+		vigem_target_remove(client, x360);
+		vigem_target_free(x360);
+	}
+
+	SetThreadPriority(self, priority);
+
+	burning = FALSE;
+
+	for (auto& burner : burners)
+		burner.join();
+
+	bench_disconnect(client);
+}
+
+#if defined(__cpp_impl_coroutine)
+//
+// Coroutine started eagerly and destroyed once it finished, nothing awaits it
+//
+struct BENCH_TASK
+{
+	struct promise_type
+	{
+		BENCH_TASK get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { abort(); }
+	};
+};
+
+static volatile LONG g_AsyncResumed = 0;
+static volatile LONG g_AsyncFinished = 0;
+
+static BENCH_TASK bench_async_add(vigem::Client& Client, vigem::X360Target& Target)
+{
+	const VIGEM_ERROR error = co_await Client.add(Target);
+
+	if (error != VIGEM_ERROR_NONE)
+		bench_fail("co_await add", error);
+
+	InterlockedIncrement(&g_AsyncFinished);
+}
+
+static BENCH_TASK bench_async_output_awaiter(vigem::Ds4Target& Target)
+{
+	for (;;)
+	{
+		const auto report = co_await Target.next_output_report();
+
+		if (report.Error != VIGEM_ERROR_NONE)
+			break;
+
+		InterlockedIncrement(&g_AsyncResumed);
+	}
+
+	InterlockedIncrement(&g_AsyncFinished);
+}
+
+static BENCH_TASK bench_async_notification_awaiter(vigem::X360Target& Target)
+{
+	const auto notifications = Target.notifications();
+
+	for (;;)
+	{
+		const auto notification = co_await notifications.next();
+
+		if (notification.Error != VIGEM_ERROR_NONE)
+			break;
+
+		InterlockedIncrement(&g_AsyncResumed);
+	}
+
+	InterlockedIncrement(&g_AsyncFinished);
+}
+
+static void bench_await_async(volatile LONG* Counter, LONG Count)
+{
+	while (*Counter < Count)
+		YieldProcessor();
+}
+
+//
+// Coroutine awaiters of ViGEm/Client.hpp: concurrent plug-ins, an output
+// report resuming thousands of awaiters, and a notification resuming its
+// awaiter. Only timed here, the async/ tests check what the awaiters get.
+//
+static void bench_async()
+{
+	const ULONG targets = 256;
+	const LONG awaiters = 4096;
+
+	vigem::Client client;
+
+	if (!client)
+		bench_fail("vigem_alloc", VIGEM_ERROR_BUS_ACCESS_FAILED);
+
+	BENCH_CHECK(client.connect_simulated());
+
+	std::vector<vigem::X360Target> x360(targets);
+	vigem::Ds4Target ds4;
+
+	BENCH_CHECK(ds4.add(client));
+
+	if (bench_enabled("async/target_add/concurrent=256"))
+	{
+		g_AsyncFinished = 0;
+
+		const LONGLONG start = bench_now();
+
+		for (auto& target : x360)
+			bench_async_add(client, target);
+
+		bench_await_async(&g_AsyncFinished, targets);
+
+		const LONGLONG stop = bench_now();
+
+		BENCH_RESULT result = {};
+		result.Name = "async/target_add/concurrent=256";
+		result.Iterations = targets;
+		result.NsPerOp = (stop - start) * g_NsPerTick / targets;
+
+		g_Results.push_back(result);
+	}
+	else
+	{
+		for (auto& target : x360)
+			BENCH_CHECK(target.add(client));
+	}
+
+	if (bench_enabled("async/ds4_output/awaiters=4096"))
+	{
+		DS4_OUTPUT_BUFFER output = {};
+		output.Buffer[0] = 0x05;
+
+		g_AsyncFinished = 0;
+
+		for (LONG index = 0; index < awaiters; index++)
+			bench_async_output_awaiter(ds4);
+
+		bench_latency("async/ds4_output/awaiters=4096", 2000, [&](ULONGLONG i)
+		{
+			const LONG expected = g_AsyncResumed + awaiters;
+			output.Buffer[4] = static_cast<UCHAR>(i);
+			vigem_sim_ds4_output(client.get(), ds4.get(), &output);
+			bench_await_async(&g_AsyncResumed, expected);
+		});
+
+		ds4.remove();
+		bench_await_async(&g_AsyncFinished, awaiters);
+	}
+
+	if (bench_enabled("async/notification/x360"))
+	{
+		g_AsyncFinished = 0;
+
+		bench_async_notification_awaiter(x360[0]);
+
+		bench_latency("async/notification/x360", 20000, [&](ULONGLONG i)
+		{
+			const LONG expected = g_AsyncResumed + 1;
+			vigem_sim_x360_notify(client.get(), x360[0].get(), static_cast<UCHAR>(i), 0, 0);
+			bench_await_async(&g_AsyncResumed, expected);
+		});
+
+		// a notification request is still pending, the disconnect cancels it
+		client.disconnect();
+		bench_await_async(&g_AsyncFinished, 1);
+	}
+}
+#endif
+
+//
+// Remaps a button mask testing every rule in turn, the usual hand written
+// approach the lookup tables of ViGEm/Remap.h replace
+//
+static USHORT bench_remap_branchy(const VIGEM_BUTTON_MAPPING* Mappings, SIZE_T Count, USHORT Buttons)
+{
+	USHORT kept = Buttons;
+	USHORT pressed = 0;
+
+	for (SIZE_T i = 0; i < Count; i++)
+	{
+		kept &= ~Mappings[i].From;
+
+		if (Buttons & Mappings[i].From)
+			pressed |= Mappings[i].To;
+	}
+
+	return static_cast<USHORT>(kept | pressed);
+}
+
+//
+// Report conversion and remapping helpers, per report
+//
+static void bench_conversion()
+{
+	const ULONG count = 1024;
+	std::vector<XUSB_REPORT> xusb(count);
+	std::vector<DS4_REPORT> ds4(count);
+	std::vector<DS4_REPORT_EX> ds4Ex(count);
+
+	srand(1);
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		xusb[i].wButtons = static_cast<USHORT>(rand());
+		xusb[i].bLeftTrigger = static_cast<BYTE>(rand());
+		xusb[i].bRightTrigger = static_cast<BYTE>(rand());
+		xusb[i].sThumbLX = static_cast<SHORT>(rand() * 2);
+		xusb[i].sThumbLY = static_cast<SHORT>(rand() * 2);
+		xusb[i].sThumbRX = static_cast<SHORT>(rand() * 2);
+		xusb[i].sThumbRY = static_cast<SHORT>(rand() * 2);
+	}
+
+	bench_throughput("convert/xusb_to_ds4", 1000, count, [&](ULONGLONG)
+	{
+		for (ULONG i = 0; i < count; i++)
+		{
+			DS4_REPORT_INIT(&ds4[i]);
+			XUSB_TO_DS4_REPORT(&xusb[i], &ds4[i]);
+		}
+		g_Sink += ds4[count - 1].bThumbLX;
+	});
+
+	bench_throughput("convert/xusb_to_ds4_fast", 1000, count, [&](ULONGLONG)
+	{
+		for (ULONG i = 0; i < count; i++)
+			XUSB_TO_DS4_REPORT_FAST(&xusb[i], &ds4[i]);
+		g_Sink += ds4[count - 1].bThumbLX;
+	});
+
+	bench_throughput("convert/xusb_to_ds4_batch", 1000, count, [&](ULONGLONG)
+	{
+		XUSB_TO_DS4_REPORT_BATCH(xusb.data(), ds4.data(), count);
+		g_Sink += ds4[count - 1].bThumbLX;
+	});
+
+	bench_throughput("convert/ds4_to_xusb", 1000, count, [&](ULONGLONG)
+	{
+		for (ULONG i = 0; i < count; i++)
+			DS4_TO_XUSB_REPORT(&ds4[i], &xusb[i]);
+		g_Sink += xusb[count - 1].sThumbLX;
+	});
+
+	bench_throughput("convert/ds4_to_xusb_batch", 1000, count, [&](ULONGLONG)
+	{
+		DS4_TO_XUSB_REPORT_BATCH(ds4.data(), xusb.data(), count);
+		g_Sink += xusb[count - 1].sThumbLX;
+	});
+
+	bench_throughput("convert/ds4_ex_to_xusb_batch", 1000, count, [&](ULONGLONG)
+	{
+		DS4_REPORT_EX_TO_XUSB_REPORT_BATCH(ds4Ex.data(), xusb.data(), count);
+		g_Sink += xusb[count - 1].sThumbLX;
+	});
+
+	std::vector<DS4_TOUCH_POINT> touchPoints(count * 2);
+	std::vector<DS4_TOUCH> touches(count);
+
+	for (ULONG i = 0; i < count * 2; i++)
+	{
+		touchPoints[i].X = static_cast<USHORT>(rand() % 2048);
+		touchPoints[i].Y = static_cast<USHORT>(rand() % 1024);
+		touchPoints[i].TrackingNum = static_cast<BYTE>(i / 2);
+		touchPoints[i].IsDown = static_cast<BOOLEAN>(rand() & 1);
+	}
+
+	bench_throughput("touch/encode", 1000, count, [&](ULONGLONG)
+	{
+		for (ULONG i = 0; i < count; i++)
+			DS4_TOUCH_SET(&touches[i], static_cast<BYTE>(i), &touchPoints[i * 2], &touchPoints[i * 2 + 1]);
+		g_Sink += touches[count - 1].bTouchData1[0];
+	});
+
+	bench_throughput("touch/encode_batch", 1000, count, [&](ULONGLONG)
+	{
+		DS4_TOUCH_ENCODE_BATCH(touchPoints.data(), touches.data(), count, 0);
+		g_Sink += touches[count - 1].bTouchData1[0];
+	});
+
+	bench_throughput("touch/decode_batch", 1000, count, [&](ULONGLONG)
+	{
+		DS4_TOUCH_DECODE_BATCH(touches.data(), touchPoints.data(), count);
+		g_Sink += touchPoints[count * 2 - 1].X;
+	});
+
+	static const VIGEM_BUTTON_MAPPING swapFace[] =
+	{
+		{ XUSB_GAMEPAD_A, XUSB_GAMEPAD_B },
+		{ XUSB_GAMEPAD_B, XUSB_GAMEPAD_A },
+		{ XUSB_GAMEPAD_X, XUSB_GAMEPAD_Y },
+		{ XUSB_GAMEPAD_Y, XUSB_GAMEPAD_X },
+	};
+	const VIGEM_BUTTON_REMAP_TABLE table = VIGEM_XUSB_BUTTON_REMAP_TABLE(swapFace);
+
+	bench_throughput("remap/xusb", 1000, count, [&](ULONGLONG)
+	{
+		for (ULONG i = 0; i < count; i++)
+			xusb[i].wButtons = VIGEM_BUTTON_REMAP(table, xusb[i].wButtons);
+		g_Sink += xusb[count - 1].wButtons;
+	});
+
+	bench_throughput("remap/branchy", 1000, count, [&](ULONGLONG)
+	{
+		for (ULONG i = 0; i < count; i++)
+			xusb[i].wButtons = bench_remap_branchy(swapFace, sizeof(swapFace) / sizeof(swapFace[0]), xusb[i].wButtons);
+		g_Sink += xusb[count - 1].wButtons;
+	});
+
+	bench_throughput("remap/xusb_batch", 1000, count, [&](ULONGLONG)
+	{
+		XUSB_REPORT_REMAP_BATCH(table, xusb.data(), count);
+		g_Sink += xusb[count - 1].wButtons;
+	});
+}
+
+//
+// Analog pipeline, per axis (six per pad), for 1 to 4096 pads
+//
+static void bench_analog()
+{
+	for (ULONG pads = 1; pads <= 4096; pads *= 4)
+	{
+		std::vector<XUSB_REPORT> xusb(pads);
+
+		for (ULONG i = 0; i < pads; i++)
+		{
+			xusb[i].sThumbLX = static_cast<SHORT>(i * 1000);
+			xusb[i].sThumbLY = static_cast<SHORT>(-static_cast<LONG>(i) * 500);
+			xusb[i].bLeftTrigger = static_cast<BYTE>(i * 4);
+		}
+
+		const auto analog = vigem_analog_alloc(pads);
+
+		if (!analog)
+			continue;
+
+		// about the same number of axes for every pad count
+		const ULONGLONG iterations = 1000000 / pads + 10;
+		const std::string suffix = "/pads=" + std::to_string(pads);
+
+		VIGEM_ANALOG_CONFIG config;
+		VIGEM_ANALOG_CONFIG_INIT(&config);
+
+		bench_throughput("analog/process" + suffix, iterations, pads * 6ULL, [&](ULONGLONG)
+		{
+			vigem_analog_load_xusb(analog, xusb.data(), pads);
+			vigem_analog_process(analog, pads, 0.001f);
+			vigem_analog_store_xusb(analog, xusb.data(), pads);
+		});
+
+		config.Filter = VIGEM_ANALOG_FILTER_ONE_EURO;
+		BENCH_CHECK(vigem_analog_set_config(analog, &config));
+
+		bench_throughput("analog/process/one_euro" + suffix, iterations, pads * 6ULL, [&](ULONGLONG)
+		{
+			vigem_analog_load_xusb(analog, xusb.data(), pads);
+			vigem_analog_process(analog, pads, 0.001f);
+			vigem_analog_store_xusb(analog, xusb.data(), pads);
+		});
+
+		vigem_analog_free(analog);
+	}
+}
+
+//
+// Motion synthesis, per pad
+//
+static void bench_processing()
+{
+	const ULONG pads = 64;
+	std::vector<DS4_REPORT_EX> ds4Ex(pads);
+
+	const auto motion = vigem_motion_alloc(pads);
+
+	if (motion)
+	{
+		VIGEM_MOTION_SAMPLE sample = {};
+		sample.Orientation[0] = 1.0f;
+
+		for (ULONG i = 0; i < pads; i++)
+		{
+			sample.Timestamp = 0;
+			vigem_motion_push(motion, i, &sample);
+			sample.Timestamp = 10000;
+			sample.Orientation[0] = 0.7071f;
+			sample.Orientation[1] = 0.7071f;
+			vigem_motion_push(motion, i, &sample);
+		}
+
+		bench_throughput("motion/synthesize", 10000, pads, [&](ULONGLONG i)
+		{
+			vigem_motion_synthesize(motion, i % 10000, ds4Ex.data(), pads);
+			g_Sink += ds4Ex[pads - 1].Report.wGyroX;
+		});
+
+		vigem_motion_free(motion);
+	}
+}
+
+static void bench_write_json(FILE* Out)
+{
+	fprintf(Out, "{\n");
+	fprintf(Out, "  \"version\": 1,\n");
+	fprintf(Out, "  \"pointer_size\": %u,\n", static_cast<unsigned>(sizeof(PVOID)));
+#if defined(VIGEM_UTIL_SSE2)
+	fprintf(Out, "  \"cpu_features\": %lu,\n", static_cast<unsigned long>(VIGEM_UTIL_CPU_FEATURES()));
+#endif
+	fprintf(Out, "  \"results\": [\n");
+
+	for (size_t index = 0; index < g_Results.size(); index++)
+	{
+		const BENCH_RESULT& result = g_Results[index];
+
+		fprintf(Out, "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"ops_per_sec\": %.1f",
+			result.Name.c_str(),
+			result.Iterations,
+			result.NsPerOp,
+			result.NsPerOp > 0.0 ? 1e9 / result.NsPerOp : 0.0
+		);
+
+		if (result.HasLatency)
+		{
+			fprintf(Out, ", \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f",
+				result.P50Ns,
+				result.P99Ns,
+				result.MaxNs
+			);
+		}
+
+		if (result.HasAllocations)
+			fprintf(Out, ", \"allocs_per_op\": %.3f", result.AllocationsPerOp);
+
+		fprintf(Out, " }%s\n", (index + 1 < g_Results.size()) ? "," : "");
+	}
+
+	fprintf(Out, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[])
+{
+	const char* outPath = nullptr;
+
+	for (int index = 1; index < argc; index++)
+	{
+		if (strcmp(argv[index], "--out") == 0 && index + 1 < argc)
+			outPath = argv[++index];
+		else if (strcmp(argv[index], "--filter") == 0 && index + 1 < argc)
+			g_Filter = argv[++index];
+		else
+		{
+			fprintf(stderr, "usage: %s [--out <file>] [--filter <substring>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	g_NsPerTick = 1e9 / static_cast<DOUBLE>(frequency.QuadPart);
+
+	bench_update();
+	bench_update_many();
+	bench_multi_bus();
+	bench_shared_session();
+	bench_add_remove();
+	bench_target_churn();
+	bench_notification();
+	bench_thread_config();
+#if defined(__cpp_impl_coroutine)
+	bench_async();
+#endif
+	bench_conversion();
+	bench_analog();
+	bench_processing();
+
+	FILE* out = stdout;
+
+	if (outPath && fopen_s(&out, outPath, "w") != 0)
+	{
+		fprintf(stderr, "cannot open %s\n", outPath);
+		return 1;
+	}
+
+	bench_write_json(out);
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
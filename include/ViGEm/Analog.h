@@ -0,0 +1,272 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ViGEmAnalog_h__
+#define ViGEmAnalog_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// Number of points of a response curve lookup table.
+//
+#define VIGEM_ANALOG_CURVE_POINTS   64
+
+	/** Values that represent the smoothing filter applied after the response curve */
+	typedef enum _VIGEM_ANALOG_FILTER
+	{
+		//
+		// Values are passed through unfiltered.
+		//
+		VIGEM_ANALOG_FILTER_NONE = 0,
+		//
+		// Exponential moving average with a fixed smoothing factor.
+		//
+		VIGEM_ANALOG_FILTER_EMA,
+		//
+		// One Euro filter (speed-adaptive low-pass).
+		//
+		VIGEM_ANALOG_FILTER_ONE_EURO
+
+	} VIGEM_ANALOG_FILTER;
+
+	/** Configuration of an analog processing pipeline */
+	typedef struct _VIGEM_ANALOG_CONFIG
+	{
+		//
+		// sizeof(struct _VIGEM_ANALOG_CONFIG)
+		//
+		ULONG Size;
+
+		//
+		// Radial stick deadzone, normalized magnitudes (0.0 - 1.0). Magnitudes
+		// below the inner radius become 0, magnitudes above the outer one 1.
+		//
+		FLOAT StickInnerDeadzone;
+		FLOAT StickOuterDeadzone;
+
+		//
+		// Trigger deadzone, normalized values (0.0 - 1.0).
+		//
+		FLOAT TriggerInnerDeadzone;
+		FLOAT TriggerOuterDeadzone;
+
+		//
+		// Response curves, mapping the deadzone-rescaled input (0.0 - 1.0) to
+		// the output (0.0 - 1.0). Points are evenly spaced and linearly
+		// interpolated; results outside the output range are clamped.
+		//
+		FLOAT StickCurve[VIGEM_ANALOG_CURVE_POINTS];
+		FLOAT TriggerCurve[VIGEM_ANALOG_CURVE_POINTS];
+
+		//
+		// Smoothing filter and its parameters.
+		//
+		VIGEM_ANALOG_FILTER Filter;
+		FLOAT EmaAlpha;
+		FLOAT OneEuroMinCutoff;
+		FLOAT OneEuroBeta;
+		FLOAT OneEuroDerivativeCutoff;
+
+	} VIGEM_ANALOG_CONFIG, *PVIGEM_ANALOG_CONFIG;
+
+	/**
+	 * Initializes a VIGEM_ANALOG_CONFIG structure with no deadzones, linear curves and no
+	 * filtering.
+	 *
+	 * @param 	Config	The configuration to initialize.
+	 */
+	VOID FORCEINLINE VIGEM_ANALOG_CONFIG_INIT(
+		_Out_ PVIGEM_ANALOG_CONFIG Config
+	)
+	{
+		RtlZeroMemory(Config, sizeof(VIGEM_ANALOG_CONFIG));
+
+		Config->Size = sizeof(VIGEM_ANALOG_CONFIG);
+		Config->StickOuterDeadzone = 1.0f;
+		Config->TriggerOuterDeadzone = 1.0f;
+
+		for (int i = 0; i < VIGEM_ANALOG_CURVE_POINTS; i++)
+		{
+			Config->StickCurve[i] = (FLOAT)i / (VIGEM_ANALOG_CURVE_POINTS - 1);
+			Config->TriggerCurve[i] = (FLOAT)i / (VIGEM_ANALOG_CURVE_POINTS - 1);
+		}
+
+		Config->Filter = VIGEM_ANALOG_FILTER_NONE;
+		Config->EmaAlpha = 1.0f;
+		Config->OneEuroMinCutoff = 1.0f;
+		Config->OneEuroBeta = 0.0f;
+		Config->OneEuroDerivativeCutoff = 1.0f;
+	}
+
+	/** Structure-of-arrays view on the raw axis inputs of a pipeline, one element per pad */
+	typedef struct _VIGEM_ANALOG_INPUT
+	{
+		PSHORT ThumbLX;
+		PSHORT ThumbLY;
+		PSHORT ThumbRX;
+		PSHORT ThumbRY;
+		PBYTE LeftTrigger;
+		PBYTE RightTrigger;
+
+	} VIGEM_ANALOG_INPUT, *PVIGEM_ANALOG_INPUT;
+
+	/** Defines an alias representing an analog processing pipeline */
+	typedef struct _VIGEM_ANALOG_PIPELINE_T* PVIGEM_ANALOG_PIPELINE;
+
+	/**
+	 * Allocates an analog processing pipeline for up to the given number of pads. The
+	 * pipeline starts with the VIGEM_ANALOG_CONFIG_INIT defaults.
+	 *
+	 * @param 	capacity	The maximum number of pads processed per tick.
+	 *
+	 * @returns	A PVIGEM_ANALOG_PIPELINE object or NULL on failure.
+	 */
+	VIGEM_API PVIGEM_ANALOG_PIPELINE vigem_analog_alloc(
+		ULONG capacity
+	);
+
+	/**
+	 * Frees up memory used by the analog processing pipeline.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 */
+	VIGEM_API void vigem_analog_free(
+		PVIGEM_ANALOG_PIPELINE pipeline
+	);
+
+	/**
+	 * Applies a new configuration. Filter states are kept. A configuration holding a NaN or
+	 * infinite value is rejected with VIGEM_ERROR_INVALID_PARAMETER and the previous one
+	 * stays in effect.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	config  	The configuration, initialized with VIGEM_ANALOG_CONFIG_INIT.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_set_config(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		const VIGEM_ANALOG_CONFIG* config
+	);
+
+	/**
+	 * Returns pointers to the raw axis input arrays. Pads are written directly into these
+	 * arrays (one index per pad) before every vigem_analog_process call.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	input   	Receives the input array pointers.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_get_input(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		PVIGEM_ANALOG_INPUT input
+	);
+
+	/**
+	 * Copies the axes of an array of XUSB reports into the input arrays, starting at pad
+	 * index 0.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	reports 	The reports to load.
+	 * @param 	count   	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_load_xusb(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		const XUSB_REPORT* reports,
+		ULONG count
+	);
+
+	/**
+	 * Forgets the filter history of a pad, call when a pad (re-)joins.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	index   	The pad index.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_reset(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		ULONG index
+	);
+
+	/**
+	 * Runs deadzone, response curve, filter and clamping over the first count pads.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	count   	The number of pads to process.
+	 * @param 	seconds 	The time elapsed since the previous tick, used by the One Euro filter.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_process(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		ULONG count,
+		FLOAT seconds
+	);
+
+	/**
+	 * Writes the processed sticks and triggers into an array of XUSB reports. Buttons are
+	 * left untouched.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	reports 	The reports to write, one per pad starting at index 0.
+	 * @param 	count   	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_store_xusb(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		PXUSB_REPORT reports,
+		ULONG count
+	);
+
+	/**
+	 * Writes the processed sticks and triggers into an array of DS4 reports, including the
+	 * digital trigger buttons. Other buttons are left untouched.
+	 *
+	 * @param 	pipeline	The pipeline object.
+	 * @param 	reports 	The reports to write, one per pad starting at index 0.
+	 * @param 	count   	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_analog_store_ds4(
+		PVIGEM_ANALOG_PIPELINE pipeline,
+		PDS4_REPORT reports,
+		ULONG count
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmAnalog_h__
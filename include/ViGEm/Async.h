@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ViGEmAsync_h__
+#define ViGEmAsync_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Called exactly once when an asynchronous operation finished. Runs on a thread pool
+	 * thread, or on the DS4 output report thread for vigem_target_ds4_await_output_report_async,
+	 * so it should return quickly.
+	 *
+	 * @param 	Client 	The driver connection object.
+	 * @param 	Target 	The target device object.
+	 * @param 	Error  	The result of the operation, VIGEM_ERROR_IS_DISPOSING if it was cut
+	 * 					short by the target being removed or the client disconnecting.
+	 * @param 	Context	The context passed when the operation was started.
+	 */
+	using EVT_VIGEM_ASYNC_COMPLETION = _Function_class_(EVT_VIGEM_ASYNC_COMPLETION)
+		VOID CALLBACK(
+			PVIGEM_CLIENT Client,
+			PVIGEM_TARGET Target,
+			VIGEM_ERROR Error,
+			LPVOID Context
+		);
+
+	using PFN_VIGEM_ASYNC_COMPLETION = EVT_VIGEM_ASYNC_COMPLETION*;
+
+	/** A rumble and LED state change sent to an X360 target */
+	typedef struct _VIGEM_X360_NOTIFICATION
+	{
+		UCHAR LargeMotor;
+		UCHAR SmallMotor;
+		UCHAR LedNumber;
+
+	} VIGEM_X360_NOTIFICATION, *PVIGEM_X360_NOTIFICATION;
+
+	/**
+	 * Adds the provided target device to the bus without blocking the calling thread. The
+	 * plug-in and wait-for-ready requests are issued overlapped and continued from the thread
+	 * pool as they complete, the completion routine gets the result vigem_target_add would have
+	 * returned.
+	 *
+	 * @param 	vigem	  	The driver connection object.
+	 * @param 	target	  	The target device object.
+	 * @param 	completion	The completion routine.
+	 * @param 	context   	Passed to the completion routine.
+	 *
+	 * @returns	A VIGEM_ERROR. The completion routine is only called if the operation was
+	 * 			started, that is for VIGEM_ERROR_NONE.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_add_async_ex(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PFN_VIGEM_ASYNC_COMPLETION completion,
+		LPVOID context
+	);
+
+	/**
+	 * Waits for the next rumble or LED state change of an X360 target without blocking the
+	 * calling thread. A single notification request is kept pending until it completes.
+	 *
+	 * @param 	vigem		The driver connection object.
+	 * @param 	target		The target device object.
+	 * @param 	notification	Receives the notification, must stay valid until the completion
+	 * 						routine was called.
+	 * @param 	completion	The completion routine.
+	 * @param 	context   	Passed to the completion routine.
+	 *
+	 * @returns	A VIGEM_ERROR. The completion routine is only called for VIGEM_ERROR_NONE.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_x360_await_notification_async(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PVIGEM_X360_NOTIFICATION notification,
+		PFN_VIGEM_ASYNC_COMPLETION completion,
+		LPVOID context
+	);
+
+	/**
+	 * Waits for the next output report of a DS4 target without blocking the calling thread.
+	 * The report is handed over by the thread completing the output report requests of the
+	 * connection; every asynchronous waiter of the target receives it, waiters of
+	 * vigem_target_ds4_await_output_report keep working as before.
+	 *
+	 * @param 	vigem		The driver connection object.
+	 * @param 	target		The target device object.
+	 * @param 	buffer		Receives the report, must stay valid until the completion routine was
+	 * 						called.
+	 * @param 	completion	The completion routine.
+	 * @param 	context   	Passed to the completion routine.
+	 *
+	 * @returns	A VIGEM_ERROR. The completion routine is only called for VIGEM_ERROR_NONE.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_await_output_report_async(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PDS4_OUTPUT_BUFFER buffer,
+		PFN_VIGEM_ASYNC_COMPLETION completion,
+		LPVOID context
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmAsync_h__
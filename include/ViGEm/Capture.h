@@ -0,0 +1,142 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ViGEmCapture_h__
+#define ViGEmCapture_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bus traffic capture file format
+ *
+ * Captures are pcapng files with a single interface of link type
+ * VIGEM_CAPTURE_LINKTYPE and nanosecond timestamps (if_tsresol 9). Every
+ * transport request, completion and cancellation of a driver connection is
+ * one Enhanced Packet Block holding a VIGEM_CAPTURE_PACKET followed by up to
+ * VIGEM_CAPTURE_MAX_PAYLOAD bytes:
+ *
+ *   VIGEM_CAPTURE_REQUEST     the input buffer sent with the IOCTL
+ *   VIGEM_CAPTURE_COMPLETION  the output buffer as far as it was filled
+ *   VIGEM_CAPTURE_CANCEL      nothing
+ *
+ * A completion carries the RequestId of its request; requests issued before
+ * the capture started are left out along with their completions. The file
+ * ends with an Interface Statistics Block whose isb_ifdrop counts packets
+ * dropped because the writer fell behind. tools/vigem_capture.py dissects captures.
+ */
+
+#define VIGEM_CAPTURE_LINKTYPE      147     // LINKTYPE_USER0
+#define VIGEM_CAPTURE_MAX_PAYLOAD   256
+
+	/** Values that represent what a captured packet describes */
+	typedef enum _VIGEM_CAPTURE_EVENT
+	{
+		VIGEM_CAPTURE_REQUEST = 0,
+		VIGEM_CAPTURE_COMPLETION = 1,
+		VIGEM_CAPTURE_CANCEL = 2
+
+	} VIGEM_CAPTURE_EVENT;
+
+#include <pshpack1.h>
+
+	/** Header of every captured packet, little endian */
+	typedef struct _VIGEM_CAPTURE_PACKET
+	{
+		//
+		// A VIGEM_CAPTURE_EVENT
+		//
+		UCHAR Event;
+
+		//
+		// TRUE if the connection is served by the simulated bus
+		//
+		UCHAR Simulated;
+
+		USHORT Reserved;
+
+		//
+		// Numbers the requests of a capture, shared by a request and its
+		// completion or cancellation
+		//
+		ULONG RequestId;
+
+		ULONG IoControlCode;
+
+		//
+		// Serial number of the target the request is for, 0 if none
+		//
+		ULONG SerialNo;
+
+		//
+		// Win32 error code of a completion, 0 on success
+		//
+		ULONG Status;
+
+		//
+		// Size of the request's buffer or of the completed output, the captured
+		// payload is at most VIGEM_CAPTURE_MAX_PAYLOAD bytes of it
+		//
+		ULONG Length;
+
+	} VIGEM_CAPTURE_PACKET, *PVIGEM_CAPTURE_PACKET;
+
+#include <poppack.h>
+
+	/**
+	 * Starts capturing all bus traffic of this driver connection to a pcapng file,
+	 * replacing an existing file. Packets are appended to memory buffers and written
+	 * out by a background thread; without an active capture the transport only tests
+	 * a pointer.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 * @param 	path 	The file path.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_capture_start(
+		PVIGEM_CLIENT vigem,
+		LPCWSTR path
+	);
+
+	/**
+	 * Stops an active capture, writes out all buffered packets and closes the file.
+	 * Called implicitly by vigem_disconnect and vigem_free.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 */
+	VIGEM_API void vigem_capture_stop(
+		PVIGEM_CLIENT vigem
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmCapture_h__
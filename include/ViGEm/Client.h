@@ -122,6 +122,9 @@ extern "C" {
 	/** Defines an alias representing a target device object */
 	using PVIGEM_TARGET = struct _VIGEM_TARGET_T*;
 
+	/** Defines an alias representing a validated handle of an added target */
+	using PVIGEM_PREPARED_TARGET = struct _VIGEM_PREPARED_TARGET_T*;
+
 	using EVT_VIGEM_TARGET_ADD_RESULT = _Function_class_(EVT_VIGEM_TARGET_ADD_RESULT)
 		VOID CALLBACK(
 			PVIGEM_CLIENT Client,
@@ -155,6 +158,124 @@ extern "C" {
 
 	using PFN_VIGEM_DS4_NOTIFICATION = EVT_VIGEM_DS4_NOTIFICATION*;
 
+	/** The threads the library creates */
+	typedef enum _VIGEM_THREAD_KIND
+	{
+		//
+		// Picks up DS4 output reports, one per bus connection
+		// 
+		VIGEM_THREAD_OUTPUT_REPORT_PICKUP,
+		//
+		// Dispatches X360/DS4 notification callbacks, one per registration
+		// 
+		VIGEM_THREAD_NOTIFICATION,
+		//
+		// Writes the file of a running vigem_capture_start
+		// 
+		VIGEM_THREAD_CAPTURE_WRITER,
+		//
+		// Formats and writes log messages, one per process, see vigem_log_set_thread_config
+		// 
+		VIGEM_THREAD_LOG
+
+	} VIGEM_THREAD_KIND;
+
+	using EVT_VIGEM_THREAD_START = _Function_class_(EVT_VIGEM_THREAD_START)
+		VOID CALLBACK(
+			PVIGEM_CLIENT Client,
+			VIGEM_THREAD_KIND Kind,
+			LPVOID Context
+		);
+
+	using PFN_VIGEM_THREAD_START = EVT_VIGEM_THREAD_START*;
+
+	/** Scheduling of a kind of library thread */
+	typedef struct _VIGEM_THREAD_CONFIG
+	{
+		//
+		// sizeof(struct _VIGEM_THREAD_CONFIG)
+		// 
+		ULONG Size;
+
+		//
+		// Processors the thread may run on, 0 leaves it to the scheduler. Must be a
+		// subset of the process affinity mask.
+		// 
+		DWORD_PTR AffinityMask;
+
+		//
+		// A THREAD_PRIORITY_* value
+		// 
+		INT Priority;
+
+		//
+		// Runs the thread at THREAD_PRIORITY_TIME_CRITICAL, overriding Priority
+		// 
+		BOOLEAN TimeCritical;
+
+		//
+		// Called on the new thread once it's set up, before it does any work, with
+		// the driver object (NULL for the log thread) and Context
+		// 
+		PFN_VIGEM_THREAD_START OnStart;
+		LPVOID Context;
+
+	} VIGEM_THREAD_CONFIG, *PVIGEM_THREAD_CONFIG;
+
+	/**
+	 * Initializes a VIGEM_THREAD_CONFIG structure to the default scheduling.
+	 *
+	 * @param 	Config	The configuration to initialize.
+	 */
+	VOID FORCEINLINE VIGEM_THREAD_CONFIG_INIT(
+		_Out_ PVIGEM_THREAD_CONFIG Config
+	)
+	{
+		RtlZeroMemory(Config, sizeof(VIGEM_THREAD_CONFIG));
+
+		Config->Size = sizeof(VIGEM_THREAD_CONFIG);
+		Config->Priority = THREAD_PRIORITY_NORMAL;
+	}
+
+	/** Occupancy of a driver object's target pool */
+	typedef struct _VIGEM_TARGET_POOL_STATS
+	{
+		//
+		// sizeof(struct _VIGEM_TARGET_POOL_STATS)
+		// 
+		ULONG Size;
+
+		//
+		// Target objects the pool holds, handed out or not
+		// 
+		ULONG Capacity;
+
+		//
+		// Target objects ready to be handed out
+		// 
+		ULONG Available;
+
+		//
+		// Heap allocations the pool made, one per slab of targets
+		// 
+		ULONG Slabs;
+
+	} VIGEM_TARGET_POOL_STATS, *PVIGEM_TARGET_POOL_STATS;
+
+	/**
+	 * Initializes a VIGEM_TARGET_POOL_STATS structure.
+	 *
+	 * @param 	Stats	The structure to initialize.
+	 */
+	VOID FORCEINLINE VIGEM_TARGET_POOL_STATS_INIT(
+		_Out_ PVIGEM_TARGET_POOL_STATS Stats
+	)
+	{
+		RtlZeroMemory(Stats, sizeof(VIGEM_TARGET_POOL_STATS));
+
+		Stats->Size = sizeof(VIGEM_TARGET_POOL_STATS);
+	}
+
 	/**
 	 *  Allocates an object representing a driver connection
 	 *
@@ -197,6 +318,8 @@ extern "C" {
 	 *           may be reused again after calling this function. When called, all targets which may
 	 *           still be connected will be destroyed automatically. Be aware, that allocated target
 	 *           objects won't be automatically freed, this has to be taken care of by the caller.
+	 *           Thread configurations set with vigem_set_thread_config are kept for the next
+	 *           connection.
 	 *
 	 * @author	Benjamin "Nefarius" Hglinger-Stelzer
 	 * @date	28.08.2017
@@ -207,6 +330,81 @@ extern "C" {
 		PVIGEM_CLIENT vigem
 	);
 
+	/**
+	 * Connects to every compatible bus device instead of the first one. Each bus gets its own
+	 * connection and DS4 output report pickup thread; targets are added to the bus with the
+	 * fewest targets and stay on it until removed, so updates to targets of different buses
+	 * don't contend for the same device. All other functions are called with the driver object
+	 * as usual and vigem_disconnect closes every bus. Callbacks receive the driver object.
+	 * Serial numbers are assigned per bus, so targets of different buses may share one in
+	 * recordings and captures. Behaves like vigem_connect if there's only one bus.
+	 *
+	 * @param 	vigem	The PVIGEM_CLIENT object.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_connect_multi_bus(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Attaches the driver object to the process-wide bus session instead of opening a
+	 * connection of its own. The first driver object attaching connects the session like
+	 * vigem_connect does, later ones only take a reference, so they neither enumerate the
+	 * bus devices again nor start another DS4 output report pickup thread: the session's
+	 * single thread serves the targets of all of them. Targets, notifications, statistics
+	 * and recordings stay with the driver object that added the target, and callbacks
+	 * receive it. vigem_disconnect unplugs the targets the driver object left behind and
+	 * closes the session once no driver object is attached anymore. The session's pickup
+	 * thread is configured as the first driver object asked for, with a NULL driver object
+	 * passed to the start function. Bus traffic of a shared session can't be captured.
+	 *
+	 * @param 	vigem	The PVIGEM_CLIENT object.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_connect_shared(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Returns the number of bus devices the driver object is connected to.
+	 *
+	 * @param 	vigem	The PVIGEM_CLIENT object.
+	 *
+	 * @returns	The number of buses, 0 if not connected.
+	 */
+	VIGEM_API ULONG vigem_get_bus_count(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Sets the affinity and priority of a kind of thread the driver object creates, and a
+	 * function to run on them as they start. Applies to threads started afterwards: set it
+	 * up before vigem_connect for the output report pickup threads, before registering a
+	 * notification or before vigem_capture_start. It is kept by vigem_disconnect, so it also
+	 * applies to the threads of a later reconnect.
+	 *
+	 * Raising the priority of the pickup and notification threads keeps output reports and
+	 * rumble from queueing up behind busy application threads; they spend nearly all their
+	 * time blocked on the bus, so the raised priority costs little CPU time. A time
+	 * critical thread does preempt everything else of normal priority on its processor
+	 * whenever it runs, and a thread pinned to a processor waits for it even if others are
+	 * idle, so pin only to processors the application keeps free of long running work.
+	 *
+	 * @param 	vigem 	The PVIGEM_CLIENT object.
+	 * @param 	kind  	The kind of thread, any but VIGEM_THREAD_LOG.
+	 * @param 	config	The configuration, NULL to restore the default.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_INVALID_PARAMETER if the configuration is of the
+	 * 			wrong size or the affinity mask isn't part of the process affinity mask.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_set_thread_config(
+		PVIGEM_CLIENT vigem,
+		VIGEM_THREAD_KIND kind,
+		const VIGEM_THREAD_CONFIG* config
+	);
+
 	/**
 	 * A useful utility function to check if pre 1.17 driver, meant to be replaced in the future by
 	 *          more robust version checks, only able to be checked after at least one device has been
@@ -243,6 +441,62 @@ extern "C" {
 	 */
 	VIGEM_API PVIGEM_TARGET vigem_target_ds4_alloc(void);
 
+	/**
+	 * Grows the driver object's target pool to hold at least count target objects, in one
+	 * heap allocation. The vigem_target_*_alloc_pooled functions take targets from the pool
+	 * without allocating, vigem_target_free puts them back; the pool only grows on its own,
+	 * by a slab of 64, once it ran dry. Pooled targets are cache line aligned and keep their
+	 * pinned submission buffer's event across uses. The pool is released with the driver
+	 * object on vigem_disconnect or vigem_free, targets still handed out keep it alive until
+	 * they're freed.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 * @param 	count	The number of target objects, at most 65535.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_pool_reserve(
+		PVIGEM_CLIENT vigem,
+		ULONG count
+	);
+
+	/**
+	 * Takes an Xbox 360 Controller device object from the driver object's target pool, see
+	 * vigem_target_pool_reserve. Free it with vigem_target_free.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 *
+	 * @returns	A PVIGEM_TARGET, NULL if the pool couldn't grow.
+	 */
+	VIGEM_API PVIGEM_TARGET vigem_target_x360_alloc_pooled(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Takes a DualShock 4 Controller device object from the driver object's target pool, see
+	 * vigem_target_pool_reserve. Free it with vigem_target_free.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 *
+	 * @returns	A PVIGEM_TARGET, NULL if the pool couldn't grow.
+	 */
+	VIGEM_API PVIGEM_TARGET vigem_target_ds4_alloc_pooled(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Retrieves the occupancy of the driver object's target pool, all zero without one.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 * @param 	stats	Receives the occupancy, initialized with VIGEM_TARGET_POOL_STATS_INIT.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_pool_get_stats(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET_POOL_STATS stats
+	);
+
 	/**
 	 * Frees up memory used by the target device object. This does not automatically remove
 	 *          the associated device from the bus, if present. If the target device doesn't get
@@ -497,6 +751,193 @@ extern "C" {
 		DS4_REPORT_EX report
 	);
 
+	/**
+	 * Sends state reports to the provided target device in order, stopping at the first one
+	 * that fails. Reports are read in place and the submissions share one wait event, so
+	 * this is the cheaper way to send a report held in memory even if count is 1.
+	 *
+	 * @param 	vigem  	The driver connection object.
+	 * @param 	target 	The target device object.
+	 * @param 	reports	The reports to send to the target device.
+	 * @param 	count  	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_x360_update_batch(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		const XUSB_REPORT* reports,
+		ULONG count
+	);
+
+	/**
+	 * Sends state reports to the provided target device in order like
+	 * vigem_target_x360_update_batch.
+	 *
+	 * @param 	vigem  	The driver connection object.
+	 * @param 	target 	The target device object.
+	 * @param 	reports	The reports to send to the target device.
+	 * @param 	count  	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_update_batch(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		const DS4_REPORT* reports,
+		ULONG count
+	);
+
+	/**
+	 * Sends full size state reports to the provided target device in order like
+	 * vigem_target_x360_update_batch.
+	 *
+	 * @param 	vigem  	The driver connection object.
+	 * @param 	target 	The target device object.
+	 * @param 	reports	The report buffers.
+	 * @param 	count  	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_update_ex_batch(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		const DS4_REPORT_EX* reports,
+		ULONG count
+	);
+
+	/**
+	 * Returns the report of the target's pinned submission buffer. The buffer is allocated
+	 * with the target and set up on the first call; edit the report in place and send it with
+	 * vigem_target_x360_commit_report, which neither clears nor copies it. The report keeps
+	 * its contents between commits and stays valid until the target is freed.
+	 *
+	 * @param 	vigem 	The driver connection object.
+	 * @param 	target	The target device object.
+	 * @param 	report	Receives the report to edit.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_x360_get_report_buffer(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PXUSB_REPORT* report
+	);
+
+	/**
+	 * Sends the report of the target's pinned submission buffer. Commits of the same target
+	 * must not overlap and the report must not be edited while one is in progress.
+	 *
+	 * @param 	vigem 	The driver connection object.
+	 * @param 	target	The target device object.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_INVALID_PARAMETER if the buffer wasn't set up
+	 * 			with vigem_target_x360_get_report_buffer.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_x360_commit_report(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target
+	);
+
+	/**
+	 * Returns the full size report of the target's pinned submission buffer, see
+	 * vigem_target_x360_get_report_buffer.
+	 *
+	 * @param 	vigem 	The driver connection object.
+	 * @param 	target	The target device object.
+	 * @param 	report	Receives the report to edit.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_get_report_ex_buffer(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PDS4_REPORT_EX* report
+	);
+
+	/**
+	 * Sends the full size report of the target's pinned submission buffer, see
+	 * vigem_target_x360_commit_report.
+	 *
+	 * @param 	vigem 	The driver connection object.
+	 * @param 	target	The target device object.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_INVALID_PARAMETER if the buffer wasn't set up
+	 * 			with vigem_target_ds4_get_report_ex_buffer.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_commit_report_ex(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target
+	);
+
+	/**
+	 * Validates an added target once for the vigem_target_*_update_prepared functions, which
+	 * then skip checking the driver object and target on every call in release builds (debug
+	 * builds assert instead) and reuse the wait event created here. The handle stays valid
+	 * until the target is removed or the driver object disconnected, using it afterwards is
+	 * undefined. A handle must not be used by several threads at once, prepare one per thread.
+	 *
+	 * @param 	vigem   	The driver connection object.
+	 * @param 	target  	The target device object, added to vigem.
+	 * @param 	prepared	Receives the handle, free it with vigem_prepared_target_free.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_prepare(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PVIGEM_PREPARED_TARGET* prepared
+	);
+
+	/**
+	 * Frees a handle returned by vigem_target_prepare, before or after the target was removed.
+	 *
+	 * @param 	prepared	The handle, may be NULL.
+	 */
+	VIGEM_API void vigem_prepared_target_free(
+		PVIGEM_PREPARED_TARGET prepared
+	);
+
+	/**
+	 * Sends a report like vigem_target_x360_update, without validating the target again.
+	 *
+	 * @param 	prepared	The handle of an X360 target, see vigem_target_prepare.
+	 * @param 	report  	The report buffer.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_x360_update_prepared(
+		PVIGEM_PREPARED_TARGET prepared,
+		XUSB_REPORT report
+	);
+
+	/**
+	 * Sends a report like vigem_target_ds4_update, without validating the target again.
+	 *
+	 * @param 	prepared	The handle of a DS4 target, see vigem_target_prepare.
+	 * @param 	report  	The report buffer.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_update_prepared(
+		PVIGEM_PREPARED_TARGET prepared,
+		DS4_REPORT report
+	);
+
+	/**
+	 * Sends a full size report like vigem_target_ds4_update_ex, without validating the target
+	 * again.
+	 *
+	 * @param 	prepared	The handle of a DS4 target, see vigem_target_prepare.
+	 * @param 	report  	The report buffer.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_ds4_update_ex_prepared(
+		PVIGEM_PREPARED_TARGET prepared,
+		DS4_REPORT_EX report
+	);
+
 	/**
 	 * Returns the internal index (serial number) the bus driver assigned to the provided
 	 *               target device object. Note that this value is specific to the inner workings of
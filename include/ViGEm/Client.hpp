@@ -0,0 +1,699 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ViGEmClient_hpp__
+#define ViGEmClient_hpp__
+
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#if (defined(_MSVC_LANG) ? _MSVC_LANG : __cplusplus) < 201703L
+#error "ViGEm/Client.hpp requires C++17 or later"
+#endif
+
+#if defined(__cpp_impl_coroutine)
+#include "ViGEm/Async.h"
+
+#include <coroutine>
+#endif
+
+/*
+ * Header-only C++ layer over the C API
+ *
+ * vigem::Client owns a driver connection, vigem::X360Target and
+ * vigem::Ds4Target own a target and remember the client they were added to.
+ * All of them are move-only and release what they own on destruction;
+ * targets must go before their client. Every member is an inline call of
+ * the corresponding vigem_* function and returns its VIGEM_ERROR. They
+ * aren't noexcept, which would keep them from compiling to plain tail calls.
+ *
+ * update takes a report by reference, or a contiguous range of them (an
+ * array, std::array, std::vector, std::span...), and hands it to the
+ * vigem_target_*_update_batch functions, which read reports in place.
+ * Passing a report the target doesn't accept fails to compile.
+ * Target::prepare fills a PreparedTarget whose update skips revalidating
+ * the target on every call.
+ *
+ * With C++20 coroutines, Client::add, Ds4Target::next_output_report and
+ * X360Target::notifications return awaitables backed by the vigem_*_async
+ * functions of ViGEm/Async.h, no thread blocks while they're pending. The
+ * coroutine is handed to an executor once the operation completes, any
+ * callable taking a std::coroutine_handle<> will do; the default resumes it
+ * right on the completing thread pool or output report thread.
+ */
+
+namespace vigem
+{
+	template <VIGEM_TARGET_TYPE Type>
+	class Target;
+
+#if defined(__cpp_impl_coroutine)
+	/** Resumes the coroutine on the thread completing the operation */
+	struct InlineExecutor
+	{
+		void operator()(std::coroutine_handle<> handle) const { handle.resume(); }
+	};
+
+	/** The result of an awaited operation and the value it delivered */
+	template <typename T>
+	struct AsyncResult
+	{
+		VIGEM_ERROR Error;
+		T Value;
+	};
+#endif
+
+	namespace detail
+	{
+		/** Maps a report type to the target type accepting it and its batch update */
+		template <typename TReport>
+		struct ReportTraits
+		{
+			static constexpr bool IsReport = false;
+		};
+
+		template <>
+		struct ReportTraits<XUSB_REPORT>
+		{
+			static constexpr bool IsReport = true;
+			static constexpr VIGEM_TARGET_TYPE Type = Xbox360Wired;
+
+			static VIGEM_ERROR Update(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, const XUSB_REPORT* reports, ULONG count)
+			{
+				return vigem_target_x360_update_batch(vigem, target, reports, count);
+			}
+
+			static VIGEM_ERROR Update(PVIGEM_PREPARED_TARGET prepared, const XUSB_REPORT& report)
+			{
+				return vigem_target_x360_update_prepared(prepared, report);
+			}
+		};
+
+		template <>
+		struct ReportTraits<DS4_REPORT>
+		{
+			static constexpr bool IsReport = true;
+			static constexpr VIGEM_TARGET_TYPE Type = DualShock4Wired;
+
+			static VIGEM_ERROR Update(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, const DS4_REPORT* reports, ULONG count)
+			{
+				return vigem_target_ds4_update_batch(vigem, target, reports, count);
+			}
+
+			static VIGEM_ERROR Update(PVIGEM_PREPARED_TARGET prepared, const DS4_REPORT& report)
+			{
+				return vigem_target_ds4_update_prepared(prepared, report);
+			}
+		};
+
+		template <>
+		struct ReportTraits<DS4_REPORT_EX>
+		{
+			static constexpr bool IsReport = true;
+			static constexpr VIGEM_TARGET_TYPE Type = DualShock4Wired;
+
+			static VIGEM_ERROR Update(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, const DS4_REPORT_EX* reports, ULONG count)
+			{
+				return vigem_target_ds4_update_ex_batch(vigem, target, reports, count);
+			}
+
+			static VIGEM_ERROR Update(PVIGEM_PREPARED_TARGET prepared, const DS4_REPORT_EX& report)
+			{
+				return vigem_target_ds4_update_ex_prepared(prepared, report);
+			}
+		};
+
+		template <typename T, typename = void>
+		struct IsRange : std::false_type {};
+
+		template <typename T>
+		struct IsRange<T, std::void_t<decltype(std::data(std::declval<const T&>())), decltype(std::size(std::declval<const T&>()))>>
+			: std::true_type {};
+
+		template <typename TReport, VIGEM_TARGET_TYPE Type>
+		constexpr void CheckReport() noexcept
+		{
+			static_assert(ReportTraits<TReport>::IsReport,
+				"not a report type, expected XUSB_REPORT, DS4_REPORT or DS4_REPORT_EX");
+			static_assert(!ReportTraits<TReport>::IsReport || ReportTraits<TReport>::Type == Type,
+				"report type not accepted by this target type");
+		}
+
+#if defined(__cpp_impl_coroutine)
+		/**
+		 * Suspends until the completion routine of the operation started by TDerived::Start
+		 * ran. The routine may run before await_suspend returned, even on the awaiting
+		 * thread, so nothing is touched after the operation was started.
+		 */
+		template <typename TDerived, typename TExecutor>
+		struct Awaitable
+		{
+			TExecutor Executor;
+			std::coroutine_handle<> Handle;
+			VIGEM_ERROR Error = VIGEM_ERROR_NONE;
+
+			explicit Awaitable(TExecutor executor) : Executor(std::move(executor)) {}
+
+			Awaitable(const Awaitable&) = delete;
+			Awaitable& operator=(const Awaitable&) = delete;
+
+			static VOID CALLBACK Complete(PVIGEM_CLIENT, PVIGEM_TARGET, VIGEM_ERROR error, LPVOID context)
+			{
+				const auto self = static_cast<Awaitable*>(context);
+
+				// the awaitable is gone once the coroutine resumed
+				TExecutor executor = std::move(self->Executor);
+				const std::coroutine_handle<> handle = self->Handle;
+
+				self->Error = error;
+				executor(handle);
+			}
+
+			bool await_ready() const noexcept { return false; }
+
+			bool await_suspend(std::coroutine_handle<> handle)
+			{
+				Handle = handle;
+
+				const VIGEM_ERROR error = static_cast<TDerived*>(this)->Start(&Complete, this);
+
+				if (VIGEM_SUCCESS(error))
+					return true;
+
+				Error = error;
+				return false;
+			}
+		};
+
+		template <VIGEM_TARGET_TYPE Type, typename TExecutor>
+		struct AddAwaitable : Awaitable<AddAwaitable<Type, TExecutor>, TExecutor>
+		{
+			PVIGEM_CLIENT Client;
+			Target<Type>& Owned;
+
+			AddAwaitable(PVIGEM_CLIENT client, Target<Type>& target, TExecutor executor)
+				: Awaitable<AddAwaitable, TExecutor>(std::move(executor)), Client(client), Owned(target) {}
+
+			VIGEM_ERROR Start(PFN_VIGEM_ASYNC_COMPLETION completion, LPVOID context)
+			{
+				return vigem_target_add_async_ex(Client, Owned.get(), completion, context);
+			}
+
+			VIGEM_ERROR await_resume()
+			{
+				if (VIGEM_SUCCESS(this->Error))
+					Owned.Owner = Client;
+
+				return this->Error;
+			}
+		};
+
+		template <typename TExecutor>
+		struct OutputReportAwaitable : Awaitable<OutputReportAwaitable<TExecutor>, TExecutor>
+		{
+			PVIGEM_CLIENT Client;
+			PVIGEM_TARGET Handle;
+			DS4_OUTPUT_BUFFER Buffer;
+
+			OutputReportAwaitable(PVIGEM_CLIENT client, PVIGEM_TARGET target, TExecutor executor)
+				: Awaitable<OutputReportAwaitable, TExecutor>(std::move(executor)), Client(client), Handle(target), Buffer{} {}
+
+			VIGEM_ERROR Start(PFN_VIGEM_ASYNC_COMPLETION completion, LPVOID context)
+			{
+				return vigem_target_ds4_await_output_report_async(Client, Handle, &Buffer, completion, context);
+			}
+
+			AsyncResult<DS4_OUTPUT_BUFFER> await_resume() const { return { this->Error, Buffer }; }
+		};
+
+		template <typename TExecutor>
+		struct NotificationAwaitable : Awaitable<NotificationAwaitable<TExecutor>, TExecutor>
+		{
+			PVIGEM_CLIENT Client;
+			PVIGEM_TARGET Handle;
+			VIGEM_X360_NOTIFICATION Notification;
+
+			NotificationAwaitable(PVIGEM_CLIENT client, PVIGEM_TARGET target, TExecutor executor)
+				: Awaitable<NotificationAwaitable, TExecutor>(std::move(executor)), Client(client), Handle(target), Notification{} {}
+
+			VIGEM_ERROR Start(PFN_VIGEM_ASYNC_COMPLETION completion, LPVOID context)
+			{
+				return vigem_target_x360_await_notification_async(Client, Handle, &Notification, completion, context);
+			}
+
+			AsyncResult<VIGEM_X360_NOTIFICATION> await_resume() const { return { this->Error, Notification }; }
+		};
+#endif
+	}
+
+#if defined(__cpp_impl_coroutine)
+	/**
+	 * The rumble and LED state changes of an X360 target, each co_await of next() yields
+	 * the following one. Ends with an error once the target is removed or the client
+	 * disconnects. Changes sent while no next() is awaited are missed, like between
+	 * callbacks of vigem_target_x360_register_notification.
+	 */
+	template <typename TExecutor = InlineExecutor>
+	class NotificationStream
+	{
+		PVIGEM_CLIENT Client;
+		PVIGEM_TARGET Handle;
+		TExecutor Executor;
+
+	public:
+		NotificationStream(PVIGEM_CLIENT client, PVIGEM_TARGET target, TExecutor executor)
+			: Client(client), Handle(target), Executor(std::move(executor)) {}
+
+		[[nodiscard]] detail::NotificationAwaitable<TExecutor> next() const
+		{
+			return { Client, Handle, Executor };
+		}
+	};
+#endif
+
+	/** Owns a driver connection object */
+	class Client
+	{
+		PVIGEM_CLIENT Handle;
+		bool Connected;
+
+	public:
+		/** Allocates the connection object, check with operator bool */
+		Client() : Handle(vigem_alloc()), Connected(false) {}
+
+		Client(Client&& other) noexcept : Handle(other.Handle), Connected(other.Connected)
+		{
+			other.Handle = nullptr;
+			other.Connected = false;
+		}
+
+		Client& operator=(Client&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				Handle = std::exchange(other.Handle, nullptr);
+				Connected = std::exchange(other.Connected, false);
+			}
+
+			return *this;
+		}
+
+		Client(const Client&) = delete;
+		Client& operator=(const Client&) = delete;
+
+		~Client() { reset(); }
+
+		[[nodiscard]] VIGEM_ERROR connect()
+		{
+			const VIGEM_ERROR error = vigem_connect(Handle);
+			Connected = VIGEM_SUCCESS(error);
+			return error;
+		}
+
+		/** Connects to the in-process simulated bus, see ViGEm/Sim.h */
+		[[nodiscard]] VIGEM_ERROR connect_simulated()
+		{
+			const VIGEM_ERROR error = vigem_connect_simulated(Handle);
+			Connected = VIGEM_SUCCESS(error);
+			return error;
+		}
+
+		/** Connects to every compatible bus, see vigem_connect_multi_bus */
+		[[nodiscard]] VIGEM_ERROR connect_multi_bus()
+		{
+			const VIGEM_ERROR error = vigem_connect_multi_bus(Handle);
+			Connected = VIGEM_SUCCESS(error);
+			return error;
+		}
+
+		/** Attaches to the process-wide bus session, see vigem_connect_shared */
+		[[nodiscard]] VIGEM_ERROR connect_shared()
+		{
+			const VIGEM_ERROR error = vigem_connect_shared(Handle);
+			Connected = VIGEM_SUCCESS(error);
+			return error;
+		}
+
+		/** Attaches to the process-wide simulated bus session */
+		[[nodiscard]] VIGEM_ERROR connect_simulated_shared()
+		{
+			const VIGEM_ERROR error = vigem_connect_simulated_shared(Handle);
+			Connected = VIGEM_SUCCESS(error);
+			return error;
+		}
+
+		/** Connects to busCount in-process simulated buses */
+		[[nodiscard]] VIGEM_ERROR connect_simulated_multi_bus(ULONG busCount)
+		{
+			const VIGEM_ERROR error = vigem_connect_simulated_multi_bus(Handle, busCount);
+			Connected = VIGEM_SUCCESS(error);
+			return error;
+		}
+
+		ULONG bus_count() const noexcept { return vigem_get_bus_count(Handle); }
+
+		/** Grows the target pool, see vigem_target_pool_reserve */
+		[[nodiscard]] VIGEM_ERROR reserve_targets(ULONG count) { return vigem_target_pool_reserve(Handle, count); }
+
+		/** Schedules threads of a kind started afterwards, see vigem_set_thread_config */
+		[[nodiscard]] VIGEM_ERROR set_thread_config(VIGEM_THREAD_KIND kind, const VIGEM_THREAD_CONFIG& config)
+		{
+			return vigem_set_thread_config(Handle, kind, &config);
+		}
+
+		void disconnect()
+		{
+			if (Connected)
+				vigem_disconnect(Handle);
+
+			Connected = false;
+		}
+
+		/** Disconnects and frees the connection object */
+		void reset()
+		{
+			disconnect();
+
+			if (Handle)
+				vigem_free(Handle);
+
+			Handle = nullptr;
+		}
+
+		PVIGEM_CLIENT get() const noexcept { return Handle; }
+
+		bool connected() const noexcept { return Connected; }
+
+		explicit operator bool() const noexcept { return Handle != nullptr; }
+
+#if defined(__cpp_impl_coroutine)
+		/** Plugs the target into the bus, co_await yields the VIGEM_ERROR of vigem_target_add */
+		template <VIGEM_TARGET_TYPE Type, typename TExecutor = InlineExecutor>
+		[[nodiscard]] detail::AddAwaitable<Type, TExecutor> add(Target<Type>& target, TExecutor executor = {}) const
+		{
+			return { Handle, target, std::move(executor) };
+		}
+#endif
+	};
+
+	/** Owns a validated handle of an added target, see vigem_target_prepare */
+	template <VIGEM_TARGET_TYPE Type>
+	class PreparedTarget
+	{
+		PVIGEM_PREPARED_TARGET Handle;
+
+		friend class Target<Type>;
+
+	public:
+		PreparedTarget() noexcept : Handle(nullptr) {}
+
+		PreparedTarget(PreparedTarget&& other) noexcept : Handle(std::exchange(other.Handle, nullptr)) {}
+
+		PreparedTarget& operator=(PreparedTarget&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				Handle = std::exchange(other.Handle, nullptr);
+			}
+
+			return *this;
+		}
+
+		PreparedTarget(const PreparedTarget&) = delete;
+		PreparedTarget& operator=(const PreparedTarget&) = delete;
+
+		~PreparedTarget() { reset(); }
+
+		void reset() noexcept
+		{
+			vigem_prepared_target_free(std::exchange(Handle, nullptr));
+		}
+
+		/** Sends a report without validating the target again */
+		template <typename TReport>
+		VIGEM_ERROR update(const TReport& report)
+		{
+			detail::CheckReport<TReport, Type>();
+
+			return detail::ReportTraits<TReport>::Update(Handle, report);
+		}
+
+		PVIGEM_PREPARED_TARGET get() const noexcept { return Handle; }
+
+		explicit operator bool() const noexcept { return Handle != nullptr; }
+	};
+
+	/** Owns a target device object of the given type */
+	template <VIGEM_TARGET_TYPE Type>
+	class Target
+	{
+		PVIGEM_TARGET Handle;
+		//
+		// The client the target is added to, nullptr while it isn't
+		//
+		PVIGEM_CLIENT Owner;
+
+#if defined(__cpp_impl_coroutine)
+		template <VIGEM_TARGET_TYPE, typename>
+		friend struct detail::AddAwaitable;
+#endif
+
+		static PVIGEM_TARGET Alloc()
+		{
+			return (Type == Xbox360Wired) ? vigem_target_x360_alloc() : vigem_target_ds4_alloc();
+		}
+
+		static PVIGEM_TARGET Alloc(PVIGEM_CLIENT pool)
+		{
+			return (Type == Xbox360Wired) ? vigem_target_x360_alloc_pooled(pool) : vigem_target_ds4_alloc_pooled(pool);
+		}
+
+	public:
+		static constexpr VIGEM_TARGET_TYPE TargetType = Type;
+
+		/** Allocates the target object, check with operator bool */
+		Target() : Handle(Alloc()), Owner(nullptr) {}
+
+		/** Takes the target object from the client's pool, see vigem_target_pool_reserve */
+		explicit Target(const Client& pool) : Handle(Alloc(pool.get())), Owner(nullptr) {}
+
+		Target(Target&& other) noexcept : Handle(other.Handle), Owner(other.Owner)
+		{
+			other.Handle = nullptr;
+			other.Owner = nullptr;
+		}
+
+		Target& operator=(Target&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				Handle = std::exchange(other.Handle, nullptr);
+				Owner = std::exchange(other.Owner, nullptr);
+			}
+
+			return *this;
+		}
+
+		Target(const Target&) = delete;
+		Target& operator=(const Target&) = delete;
+
+		~Target() { reset(); }
+
+		/** Plugs the target into the bus of the client */
+		[[nodiscard]] VIGEM_ERROR add(const Client& client)
+		{
+			const VIGEM_ERROR error = vigem_target_add(client.get(), Handle);
+
+			if (VIGEM_SUCCESS(error))
+				Owner = client.get();
+
+			return error;
+		}
+
+		VIGEM_ERROR remove()
+		{
+			if (!Owner)
+				return VIGEM_ERROR_TARGET_NOT_PLUGGED_IN;
+
+			return vigem_target_remove(std::exchange(Owner, nullptr), Handle);
+		}
+
+		/** Removes the target if added and frees the target object */
+		void reset()
+		{
+			if (Owner)
+				remove();
+
+			if (Handle)
+				vigem_target_free(Handle);
+
+			Handle = nullptr;
+		}
+
+		/** Sends a report, or a range of reports in order up to the first that fails */
+		template <typename T>
+		VIGEM_ERROR update(const T& reports)
+		{
+			if constexpr (detail::ReportTraits<T>::IsReport)
+			{
+				return update(&reports, 1);
+			}
+			else
+			{
+				static_assert(detail::IsRange<T>::value,
+					"expected a report or a contiguous range of reports");
+
+				return update(std::data(reports), std::size(reports));
+			}
+		}
+
+		template <typename TReport>
+		VIGEM_ERROR update(const TReport* reports, std::size_t count)
+		{
+			detail::CheckReport<TReport, Type>();
+
+			if (count > MAXULONG)
+				return VIGEM_ERROR_INVALID_PARAMETER;
+
+			return detail::ReportTraits<TReport>::Update(Owner, Handle, reports, static_cast<ULONG>(count));
+		}
+
+		/** The report format of the pinned submission buffer */
+		using PinnedReport = std::conditional_t<Type == Xbox360Wired, XUSB_REPORT, DS4_REPORT_EX>;
+
+		/** The report of the pinned submission buffer once added, edit it in place and commit() */
+		[[nodiscard]] VIGEM_ERROR report_buffer(PinnedReport*& report)
+		{
+			if constexpr (Type == Xbox360Wired)
+				return vigem_target_x360_get_report_buffer(Owner, Handle, &report);
+			else
+				return vigem_target_ds4_get_report_ex_buffer(Owner, Handle, &report);
+		}
+
+		/** Validates the added target once for unchecked updates, see vigem_target_prepare */
+		[[nodiscard]] VIGEM_ERROR prepare(PreparedTarget<Type>& prepared)
+		{
+			prepared.reset();
+
+			return vigem_target_prepare(Owner, Handle, &prepared.Handle);
+		}
+
+		/** Sends the report of the pinned submission buffer */
+		VIGEM_ERROR commit()
+		{
+			if constexpr (Type == Xbox360Wired)
+				return vigem_target_x360_commit_report(Owner, Handle);
+			else
+				return vigem_target_ds4_commit_report_ex(Owner, Handle);
+		}
+
+		template <
+			typename T = void,
+			typename = std::enable_if_t<Type == Xbox360Wired, T>>
+		[[nodiscard]] VIGEM_ERROR register_notification(PFN_VIGEM_X360_NOTIFICATION notification, LPVOID userData)
+		{
+			return vigem_target_x360_register_notification(Owner, Handle, notification, userData);
+		}
+
+		template <
+			typename T = void,
+			typename = std::enable_if_t<Type == Xbox360Wired, T>>
+		void unregister_notification()
+		{
+			vigem_target_x360_unregister_notification(Handle);
+		}
+
+		template <
+			typename T = void,
+			typename = std::enable_if_t<Type == Xbox360Wired, T>>
+		[[nodiscard]] VIGEM_ERROR user_index(ULONG& index) const
+		{
+			return vigem_target_x360_get_user_index(Owner, Handle, &index);
+		}
+
+		/** Waits for the next output report, see vigem_target_ds4_await_output_report_timeout */
+		template <
+			typename T = void,
+			typename = std::enable_if_t<Type == DualShock4Wired, T>>
+		[[nodiscard]] VIGEM_ERROR await_output_report(DS4_OUTPUT_BUFFER& buffer, DWORD milliseconds = INFINITE)
+		{
+			return vigem_target_ds4_await_output_report_timeout(Owner, Handle, milliseconds, &buffer);
+		}
+
+#if defined(__cpp_impl_coroutine)
+		/** co_await yields the next output report, every pending awaiter receives it */
+		template <
+			typename TExecutor = InlineExecutor,
+			typename = std::enable_if_t<Type == DualShock4Wired, TExecutor>>
+		[[nodiscard]] detail::OutputReportAwaitable<TExecutor> next_output_report(TExecutor executor = {}) const
+		{
+			return { Owner, Handle, std::move(executor) };
+		}
+
+		template <
+			typename TExecutor = InlineExecutor,
+			typename = std::enable_if_t<Type == Xbox360Wired, TExecutor>>
+		[[nodiscard]] NotificationStream<TExecutor> notifications(TExecutor executor = {}) const
+		{
+			return { Owner, Handle, std::move(executor) };
+		}
+#endif
+
+		void set_vid(USHORT vid) { vigem_target_set_vid(Handle, vid); }
+
+		void set_pid(USHORT pid) { vigem_target_set_pid(Handle, pid); }
+
+		USHORT vid() const { return vigem_target_get_vid(Handle); }
+
+		USHORT pid() const { return vigem_target_get_pid(Handle); }
+
+		/** The serial number the bus assigned */
+		ULONG index() const { return vigem_target_get_index(Handle); }
+
+		bool attached() const { return Handle && vigem_target_is_attached(Handle); }
+
+		PVIGEM_TARGET get() const noexcept { return Handle; }
+
+		PVIGEM_CLIENT client() const noexcept { return Owner; }
+
+		explicit operator bool() const noexcept { return Handle != nullptr; }
+	};
+
+	using X360Target = Target<Xbox360Wired>;
+	using Ds4Target = Target<DualShock4Wired>;
+	using PreparedX360Target = PreparedTarget<Xbox360Wired>;
+	using PreparedDs4Target = PreparedTarget<DualShock4Wired>;
+}
+
+#endif // ViGEmClient_hpp__
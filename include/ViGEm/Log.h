@@ -0,0 +1,164 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ViGEmLog_h__
+#define ViGEmLog_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Diagnostic logging
+ *
+ * Log calls inside the library don't format anything: they copy the static
+ * format string, their call site and up to VIGEM_LOG_MAX_ARGS raw arguments
+ * into a ring owned by the calling thread and return. A background thread
+ * formats the records and hands them to the configured sinks. Records of
+ * a thread whose ring is full are dropped and reported as dropped. Messages
+ * above the current level cost a single comparison.
+ *
+ * Logging is process-wide and off (VIGEM_LOG_LEVEL_NONE) by default, unless
+ * the library was built with VIGEM_VERBOSE_LOGGING_ENABLED, in which case
+ * everything is logged to the debugger.
+ */
+
+#define VIGEM_LOG_MAX_ARGS      6
+#define VIGEM_LOG_RING_RECORDS  512
+
+	/** Values that represent the severity of a log message */
+	typedef enum _VIGEM_LOG_LEVEL
+	{
+		VIGEM_LOG_LEVEL_NONE = 0,
+		VIGEM_LOG_LEVEL_ERROR,
+		VIGEM_LOG_LEVEL_WARNING,
+		VIGEM_LOG_LEVEL_INFO,
+		VIGEM_LOG_LEVEL_VERBOSE
+
+	} VIGEM_LOG_LEVEL;
+
+	/**
+	 * Receives formatted log messages. Called on the logging thread, or on a thread calling
+	 * vigem_log_flush, without any lock of the library held: it may call vigem_log_flush and
+	 * the vigem_log_set_* functions, which then leave the messages still pending to the
+	 * flush already under way.
+	 *
+	 * @param 	Level   	The severity of the message.
+	 * @param 	Message 	The message, "[function:line] text", without line break.
+	 * @param 	UserData	The user data passed to vigem_log_set_callback.
+	 */
+	typedef VOID(CALLBACK* PFN_VIGEM_LOG)(
+		VIGEM_LOG_LEVEL Level,
+		LPCWSTR Message,
+		LPVOID UserData
+		);
+
+	/**
+	 * Sets the most verbose level of messages that are logged.
+	 *
+	 * @param 	level	The level, VIGEM_LOG_LEVEL_NONE turns logging off.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_set_level(
+		VIGEM_LOG_LEVEL level
+	);
+
+	/**
+	 * Turns passing log messages to OutputDebugString on or off.
+	 *
+	 * @param 	enable	TRUE to log to the debugger.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_set_debugger(
+		BOOLEAN enable
+	);
+
+	/**
+	 * Appends log messages to a UTF-8 text file, replacing an existing file.
+	 *
+	 * @param 	path	The file path, NULL closes the current file.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_set_file(
+		LPCWSTR path
+	);
+
+	/**
+	 * Sets the callback log messages are passed to.
+	 *
+	 * @param 	callback	The callback, NULL to remove it.
+	 * @param 	userData	User data passed to the callback.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_set_callback(
+		PFN_VIGEM_LOG callback,
+		LPVOID userData
+	);
+
+	/**
+	 * Sets the affinity and priority of the logging thread like vigem_set_thread_config.
+	 * The thread starts with the first message that gets logged and reads the configuration
+	 * once, so set it before turning logging on. The start function is called with a NULL
+	 * driver object.
+	 *
+	 * @param 	config	The configuration, NULL to restore the default.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_set_thread_config(
+		const VIGEM_THREAD_CONFIG* config
+	);
+
+	/**
+	 * Formats and sinks all records logged so far by any thread. The work is done on
+	 * the calling thread, which doesn't wait for the logging thread.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_flush(void);
+
+	/**
+	 * Stops the logging thread and waits for it to exit, then formats and sinks the records
+	 * still pending and closes the log file. Frees the buffers of the calling thread and of
+	 * threads that exited. Call it before unloading the library, e.g. with FreeLibrary, so
+	 * no thread is left running its code. A later log call starts the thread again.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_NOT_SUPPORTED if called from the log callback or the
+	 * 			logging thread's start function.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_log_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmLog_h__
@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ViGEmMemory_h__
+#define ViGEmMemory_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Memory allocation
+ *
+ * All heap memory the library uses comes from one process-wide allocator,
+ * the CRT heap unless the application supplies its own. Allocations happen
+ * while setting things up: connecting, allocating and adding targets,
+ * registering notifications and the first use of a feature on a target or
+ * thread (output reports, statistics, logging, asynchronous operations).
+ *
+ * Once set up, these paths don't allocate:
+ *
+ * - report updates, including batches, pinned buffers and prepared targets
+ * - the output report pickup thread and vigem_target_ds4_await_output_report
+ * - dispatching X360 and DS4 notifications to the registered callbacks
+ * - asynchronous notification and output report awaits, whose operations
+ *   are reused by the connection once completed
+ *
+ * Report updates don't create kernel objects either, each target keeps the
+ * wait event of its first update.
+ */
+
+	/**
+	 * Allocates memory for the library.
+	 *
+	 * @param 	Size     	The number of bytes, never 0.
+	 * @param 	Alignment	The required alignment, a power of two of at least MEMORY_ALLOCATION_ALIGNMENT.
+	 * @param 	Context  	The context of the allocator.
+	 *
+	 * @returns	The memory, NULL if out of memory.
+	 */
+	typedef PVOID(CALLBACK* PFN_VIGEM_ALLOC)(
+		SIZE_T Size,
+		SIZE_T Alignment,
+		LPVOID Context
+		);
+
+	/**
+	 * Frees memory returned by the allocation routine of the same allocator.
+	 *
+	 * @param 	Memory 	The memory, never NULL.
+	 * @param 	Context	The context of the allocator.
+	 */
+	typedef VOID(CALLBACK* PFN_VIGEM_FREE)(
+		PVOID Memory,
+		LPVOID Context
+		);
+
+	/** An allocator supplied by the application */
+	typedef struct _VIGEM_ALLOCATOR
+	{
+		//
+		// Size of the structure, set by VIGEM_ALLOCATOR_INIT
+		// 
+		ULONG Size;
+		PFN_VIGEM_ALLOC Alloc;
+		PFN_VIGEM_FREE Free;
+		LPVOID Context;
+
+	} VIGEM_ALLOCATOR, *PVIGEM_ALLOCATOR;
+
+	/**
+	 * Initializes an allocator structure.
+	 *
+	 * @param 	Allocator	The allocator structure.
+	 * @param 	Alloc    	The allocation routine.
+	 * @param 	Free     	The free routine.
+	 * @param 	Context  	The context passed to both.
+	 */
+	VOID FORCEINLINE VIGEM_ALLOCATOR_INIT(
+		PVIGEM_ALLOCATOR Allocator,
+		PFN_VIGEM_ALLOC Alloc,
+		PFN_VIGEM_FREE Free,
+		LPVOID Context
+	)
+	{
+		RtlZeroMemory(Allocator, sizeof(VIGEM_ALLOCATOR));
+
+		Allocator->Size = sizeof(VIGEM_ALLOCATOR);
+		Allocator->Alloc = Alloc;
+		Allocator->Free = Free;
+		Allocator->Context = Context;
+	}
+
+	/**
+	 * Sets the allocator all library memory comes from. Memory is returned to the allocator
+	 * it came from, so it can only be replaced while the library holds none: call it before
+	 * any other function of the library, or once everything was freed. Logging keeps the
+	 * buffer of every thread that used it until vigem_log_shutdown, tracing until the process
+	 * exits.
+	 *
+	 * @param 	allocator	The allocator, NULL to restore the CRT heap.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_NOT_SUPPORTED if library memory is still allocated.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_set_allocator(
+		const VIGEM_ALLOCATOR* allocator
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmMemory_h__
@@ -0,0 +1,144 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ViGEmMotion_h__
+#define ViGEmMotion_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// Raw DS4 motion sensor resolution: gyroscope LSB per degree per second and
+// accelerometer LSB per g.
+//
+#define VIGEM_MOTION_GYRO_RESOLUTION    16
+#define VIGEM_MOTION_ACCEL_RESOLUTION   8192
+
+	/** A timestamped orientation sample of the tracking system */
+	typedef struct _VIGEM_MOTION_SAMPLE
+	{
+		//
+		// Capture time in microseconds, on the same clock as the synthesis timestamps.
+		//
+		ULONGLONG Timestamp;
+
+		//
+		// Device orientation as unit quaternion (W, X, Y, Z). The identity is the pad
+		// lying flat with world up being +Y.
+		//
+		FLOAT Orientation[4];
+
+		//
+		// Angular velocity in the device frame, radians per second.
+		//
+		FLOAT AngularVelocity[3];
+
+		//
+		// Linear acceleration in the device frame excluding gravity, in g.
+		//
+		FLOAT Acceleration[3];
+
+	} VIGEM_MOTION_SAMPLE, *PVIGEM_MOTION_SAMPLE;
+
+	/** Defines an alias representing a motion synthesis engine */
+	typedef struct _VIGEM_MOTION_ENGINE_T* PVIGEM_MOTION_ENGINE;
+
+	/**
+	 * Allocates a motion synthesis engine for up to the given number of pads. Pads without
+	 * samples report a device lying flat at rest.
+	 *
+	 * @param 	capacity	The maximum number of pads synthesized per call.
+	 *
+	 * @returns	A PVIGEM_MOTION_ENGINE object or NULL on failure.
+	 */
+	VIGEM_API PVIGEM_MOTION_ENGINE vigem_motion_alloc(
+		ULONG capacity
+	);
+
+	/**
+	 * Frees up memory used by the motion synthesis engine.
+	 *
+	 * @param 	engine	The engine object.
+	 */
+	VIGEM_API void vigem_motion_free(
+		PVIGEM_MOTION_ENGINE engine
+	);
+
+	/**
+	 * Feeds a new tracking sample of a pad. Samples must arrive in timestamp order; the
+	 * engine interpolates between the two most recent ones.
+	 *
+	 * @param 	engine	The engine object.
+	 * @param 	index 	The pad index.
+	 * @param 	sample	The sample.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_motion_push(
+		PVIGEM_MOTION_ENGINE engine,
+		ULONG index,
+		const VIGEM_MOTION_SAMPLE* sample
+	);
+
+	/**
+	 * Drops the sample history of a pad, call when a pad (re-)joins.
+	 *
+	 * @param 	engine	The engine object.
+	 * @param 	index 	The pad index.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_motion_reset(
+		PVIGEM_MOTION_ENGINE engine,
+		ULONG index
+	);
+
+	/**
+	 * Synthesizes the motion sensor state at the given time and writes wGyroX/Y/Z,
+	 * wAccelX/Y/Z and wTimestamp of the first count reports. Orientations are blended by
+	 * normalized quaternion interpolation, times past the newest sample hold it.
+	 *
+	 * @param 	engine   	The engine object.
+	 * @param 	timestamp	The report time in microseconds.
+	 * @param 	reports  	The reports to write, one per pad starting at index 0.
+	 * @param 	count    	The number of reports.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_motion_synthesize(
+		PVIGEM_MOTION_ENGINE engine,
+		ULONGLONG timestamp,
+		PDS4_REPORT_EX reports,
+		ULONG count
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmMotion_h__
@@ -0,0 +1,263 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ViGEmRecord_h__
+#define ViGEmRecord_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Recording file format (little endian)
+ *
+ * The file is a sequence of VIGEM_RECORDING_SLAB_SIZE sized slabs. Slab 0 holds
+ * the VIGEM_RECORDING_HEADER, every other slab is owned by a single writing
+ * thread and holds 8-byte aligned records:
+ *
+ *   VIGEM_RECORD header (24 bytes) | report bytes | padding
+ *
+ * A record Size of zero, or a slab remainder too small for a record header,
+ * ends the slab and the next record is at the start of the following slab.
+ * Records are in submission order per thread; across threads they're ordered
+ * by Timestamp only.
+ *
+ * The file grows in chunks of VIGEM_RECORDING_CHUNK_SIZE while recording and is
+ * truncated to SlabCount slabs when the recording is stopped. If the process
+ * dies while recording SlabCount stays 0 and readers use the file size instead.
+ */
+
+#define VIGEM_RECORDING_MAGIC       0x524D4756  // 'VGMR'
+#define VIGEM_RECORDING_VERSION     1
+#define VIGEM_RECORDING_SLAB_SIZE   0x10000
+#define VIGEM_RECORDING_CHUNK_SIZE  0x1000000
+
+	/** Values that represent the report format of a record */
+	typedef enum _VIGEM_RECORD_TYPE
+	{
+		VIGEM_RECORD_XUSB_REPORT = 1,
+		VIGEM_RECORD_DS4_REPORT = 2,
+		VIGEM_RECORD_DS4_REPORT_EX = 3
+
+	} VIGEM_RECORD_TYPE;
+
+	/** The header at the start of a recording file */
+	typedef struct _VIGEM_RECORDING_HEADER
+	{
+		//
+		// VIGEM_RECORDING_MAGIC
+		//
+		ULONG Magic;
+
+		//
+		// VIGEM_RECORDING_VERSION
+		//
+		USHORT Version;
+
+		//
+		// sizeof(struct _VIGEM_RECORDING_HEADER)
+		//
+		USHORT HeaderSize;
+
+		//
+		// Size of a slab in bytes
+		//
+		ULONG SlabSize;
+
+		ULONG Reserved;
+
+		//
+		// Ticks per second of the record timestamps (QueryPerformanceFrequency)
+		//
+		LONGLONG TimestampFrequency;
+
+		//
+		// Timestamp the recording was started at
+		//
+		LONGLONG StartTimestamp;
+
+		//
+		// Number of slabs in use including the header slab, 0 if the recording
+		// wasn't stopped cleanly
+		//
+		ULONGLONG SlabCount;
+
+		//
+		// Number of records lost because the file reached its maximum size
+		//
+		ULONGLONG DroppedRecords;
+
+	} VIGEM_RECORDING_HEADER, *PVIGEM_RECORDING_HEADER;
+
+	/** A single submitted report, followed by ReportSize bytes of report data */
+	typedef struct _VIGEM_RECORD
+	{
+		//
+		// Total size of the record including header and padding, multiple of 8
+		//
+		ULONG Size;
+
+		//
+		// A VIGEM_RECORD_TYPE value
+		//
+		USHORT Type;
+
+		//
+		// Size of the report data following the header
+		//
+		USHORT ReportSize;
+
+		//
+		// Serial number of the target the report was submitted to
+		//
+		ULONG SerialNo;
+
+		ULONG Reserved;
+
+		//
+		// Submission time in VIGEM_RECORDING_HEADER.TimestampFrequency ticks
+		//
+		LONGLONG Timestamp;
+
+	} VIGEM_RECORD, *PVIGEM_RECORD;
+
+	/**
+	 * Returns the report data of a record.
+	 *
+	 * @param 	Record	The record.
+	 *
+	 * @returns	Pointer to Record->ReportSize bytes of report data.
+	 */
+	FORCEINLINE const VOID* VIGEM_RECORD_REPORT(
+		_In_ const VIGEM_RECORD* Record
+	)
+	{
+		return Record + 1;
+	}
+
+	/** Position of a reader in a recording */
+	typedef struct _VIGEM_RECORDING_ITERATOR
+	{
+		ULONGLONG Offset;
+
+	} VIGEM_RECORDING_ITERATOR, *PVIGEM_RECORDING_ITERATOR;
+
+	/**
+	 * Initializes an iterator to the first record of a recording.
+	 *
+	 * @param 	Iterator	The iterator to initialize.
+	 */
+	VOID FORCEINLINE VIGEM_RECORDING_ITERATOR_INIT(
+		_Out_ PVIGEM_RECORDING_ITERATOR Iterator
+	)
+	{
+		Iterator->Offset = VIGEM_RECORDING_SLAB_SIZE;
+	}
+
+	/** Defines an alias representing an opened recording */
+	typedef struct _VIGEM_RECORDING_T* PVIGEM_RECORDING;
+
+	/**
+	 * Starts recording every report successfully submitted through this driver
+	 * connection to the given file, replacing an existing file. Recording adds one
+	 * uncontended interlocked operation pair per report; nothing is recorded unless a
+	 * recording was started.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 * @param 	path 	The file path.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_record_start(
+		PVIGEM_CLIENT vigem,
+		LPCWSTR path
+	);
+
+	/**
+	 * Stops an active recording, waits for in-flight records and closes the file. Called
+	 * implicitly by vigem_disconnect and vigem_free.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 */
+	VIGEM_API void vigem_record_stop(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Opens a recording for reading by mapping it into memory.
+	 *
+	 * @param 	path     	The file path.
+	 * @param 	recording	Receives the recording object.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_recording_open(
+		LPCWSTR path,
+		PVIGEM_RECORDING* recording
+	);
+
+	/**
+	 * Unmaps and closes a recording. Records returned by it become invalid.
+	 *
+	 * @param 	recording	The recording object.
+	 */
+	VIGEM_API void vigem_recording_close(
+		PVIGEM_RECORDING recording
+	);
+
+	/**
+	 * Returns the header of a recording.
+	 *
+	 * @param 	recording	The recording object.
+	 *
+	 * @returns	The header, valid until the recording is closed.
+	 */
+	VIGEM_API const VIGEM_RECORDING_HEADER* vigem_recording_get_header(
+		PVIGEM_RECORDING recording
+	);
+
+	/**
+	 * Advances an iterator to the next record. The record points into the mapped file,
+	 * nothing is copied.
+	 *
+	 * @param 	recording	The recording object.
+	 * @param 	iterator 	The iterator, initialized with VIGEM_RECORDING_ITERATOR_INIT.
+	 * @param 	record   	Receives the record.
+	 *
+	 * @returns	TRUE if a record was returned, FALSE at the end of the recording.
+	 */
+	VIGEM_API BOOLEAN vigem_recording_next(
+		PVIGEM_RECORDING recording,
+		PVIGEM_RECORDING_ITERATOR iterator,
+		const VIGEM_RECORD** record
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmRecord_h__
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "ViGEm/Util.h"
+
+//
+// Single button remapping rule. Every bit set in From gets replaced by the bits
+// in To (zero disables the button, multiple bits press several buttons).
+//
+typedef struct _VIGEM_BUTTON_MAPPING
+{
+    USHORT From;
+    USHORT To;
+
+} VIGEM_BUTTON_MAPPING, *PVIGEM_BUTTON_MAPPING;
+
+//
+// Remapping lookup table for a 16-bit button mask (XUSB_BUTTON or DS4_BUTTONS).
+//
+// The mask is split into four nibbles, every nibble indexes its own 16 entry
+// table and the four results are OR-ed together. Low and High hold the same
+// table split into bytes, laid out for 16-byte shuffle (pshufb) lookups.
+//
+typedef struct alignas(16) _VIGEM_BUTTON_REMAP_TABLE
+{
+    USHORT Nibble[4][16];
+    UCHAR Low[4][16];
+    UCHAR High[4][16];
+
+} VIGEM_BUTTON_REMAP_TABLE, *PVIGEM_BUTTON_REMAP_TABLE;
+
+//
+// Builds a remapping table from a list of rules; buttons not mentioned keep
+// their bit. If several rules name the same button, the last one wins. If
+// PreserveDpad is TRUE, the low nibble is passed through unchanged and rules
+// touching it are ignored, which is required for DS4_BUTTONS where it holds
+// the HAT value. This is constexpr so compile-time profiles cost nothing and
+// profiles loaded at runtime produce the very same table.
+//
+constexpr VIGEM_BUTTON_REMAP_TABLE VIGEM_BUTTON_REMAP_TABLE_BUILD(
+    _In_reads_(Count) const VIGEM_BUTTON_MAPPING* Mappings,
+    _In_ SIZE_T Count,
+    _In_ BOOLEAN PreserveDpad
+)
+{
+    VIGEM_BUTTON_REMAP_TABLE table = {};
+    USHORT image[16] = {};
+
+    for (int bit = 0; bit < 16; bit++)
+        image[bit] = (USHORT)(1 << bit);
+
+    for (SIZE_T index = 0; index < Count; index++)
+    {
+        for (int bit = (PreserveDpad ? 4 : 0); bit < 16; bit++)
+        {
+            if (Mappings[index].From & (1 << bit))
+                image[bit] = (USHORT)(Mappings[index].To & (PreserveDpad ? 0xFFF0 : 0xFFFF));
+        }
+    }
+
+    for (int nibble = 0; nibble < 4; nibble++)
+    {
+        for (int value = 0; value < 16; value++)
+        {
+            USHORT result = 0;
+
+            if (nibble == 0 && PreserveDpad)
+            {
+                result = (USHORT)value;
+            }
+            else
+            {
+                for (int bit = 0; bit < 4; bit++)
+                {
+                    if (value & (1 << bit))
+                        result |= image[nibble * 4 + bit];
+                }
+            }
+
+            table.Nibble[nibble][value] = result;
+            table.Low[nibble][value] = (UCHAR)(result & 0xFF);
+            table.High[nibble][value] = (UCHAR)(result >> 8);
+        }
+    }
+
+    return table;
+}
+
+//
+// Builds a remapping table for XUSB_BUTTON masks.
+//
+template <SIZE_T Count>
+constexpr VIGEM_BUTTON_REMAP_TABLE VIGEM_XUSB_BUTTON_REMAP_TABLE(
+    _In_ const VIGEM_BUTTON_MAPPING (&Mappings)[Count]
+)
+{
+    return VIGEM_BUTTON_REMAP_TABLE_BUILD(Mappings, Count, FALSE);
+}
+
+//
+// Builds a remapping table for DS4_BUTTONS masks (HAT nibble passed through).
+//
+template <SIZE_T Count>
+constexpr VIGEM_BUTTON_REMAP_TABLE VIGEM_DS4_BUTTON_REMAP_TABLE(
+    _In_ const VIGEM_BUTTON_MAPPING (&Mappings)[Count]
+)
+{
+    return VIGEM_BUTTON_REMAP_TABLE_BUILD(Mappings, Count, TRUE);
+}
+
+//
+// Remaps a button mask in constant time with four table lookups.
+//
+constexpr USHORT VIGEM_BUTTON_REMAP(
+    _In_ const VIGEM_BUTTON_REMAP_TABLE& Table,
+    _In_ USHORT Buttons
+)
+{
+    return (USHORT)(Table.Nibble[0][Buttons & 0xF]
+        | Table.Nibble[1][(Buttons >> 4) & 0xF]
+        | Table.Nibble[2][(Buttons >> 8) & 0xF]
+        | Table.Nibble[3][(Buttons >> 12) & 0xF]);
+}
+
+#if defined(VIGEM_UTIL_SSSE3)
+
+//
+// Remaps eight button masks at once using byte shuffles (SSSE3).
+//
+VIGEM_UTIL_TARGET("ssse3")
+static FORCEINLINE __m128i VIGEM_BUTTON_REMAP_SSSE3(
+    _In_ const VIGEM_BUTTON_REMAP_TABLE& Table,
+    _In_ __m128i Buttons
+)
+{
+    const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+    const __m128i lowByteMask = _mm_set1_epi16(0x00FF);
+    // even bytes hold the low, odd bytes the high byte of each mask
+    const __m128i lowNibbles = _mm_and_si128(Buttons, nibbleMask);
+    const __m128i highNibbles = _mm_and_si128(_mm_srli_epi16(Buttons, 4), nibbleMask);
+    // every word gets its nibble index in both bytes, so one shuffle yields the
+    // table's low byte and another its high byte in place
+    const __m128i index[4] =
+    {
+        _mm_or_si128(_mm_and_si128(lowNibbles, lowByteMask), _mm_slli_epi16(lowNibbles, 8)),
+        _mm_or_si128(_mm_and_si128(highNibbles, lowByteMask), _mm_slli_epi16(highNibbles, 8)),
+        _mm_or_si128(_mm_srli_epi16(lowNibbles, 8), _mm_andnot_si128(lowByteMask, lowNibbles)),
+        _mm_or_si128(_mm_srli_epi16(highNibbles, 8), _mm_andnot_si128(lowByteMask, highNibbles)),
+    };
+    __m128i result = _mm_setzero_si128();
+
+    for (int nibble = 0; nibble < 4; nibble++)
+    {
+        const __m128i low = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)Table.Low[nibble]), index[nibble]);
+        const __m128i high = _mm_shuffle_epi8(_mm_load_si128((const __m128i*)Table.High[nibble]), index[nibble]);
+
+        result = _mm_or_si128(result, _mm_or_si128(
+            _mm_and_si128(low, lowByteMask),
+            _mm_andnot_si128(lowByteMask, high)
+        ));
+    }
+
+    return result;
+}
+
+//
+// Remaps the leading multiple of eight button masks, returns how many that was.
+//
+VIGEM_UTIL_TARGET("ssse3")
+static SIZE_T VIGEM_BUTTON_REMAP_BATCH_SSSE3(
+    _In_ const VIGEM_BUTTON_REMAP_TABLE& Table,
+    _Inout_updates_(Count) PUSHORT Buttons,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+    for (; i + 8 <= Count; i += 8)
+    {
+        _mm_storeu_si128(
+            (__m128i*)&Buttons[i],
+            VIGEM_BUTTON_REMAP_SSSE3(Table, _mm_loadu_si128((const __m128i*)&Buttons[i]))
+        );
+    }
+
+    return i;
+}
+
+//
+// Remaps the leading multiple of eight XUSB reports, returns how many that was.
+//
+VIGEM_UTIL_TARGET("ssse3")
+static SIZE_T XUSB_REPORT_REMAP_BATCH_SSSE3(
+    _In_ const VIGEM_BUTTON_REMAP_TABLE& Table,
+    _Inout_updates_(Count) PXUSB_REPORT Reports,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+    for (; i + 8 <= Count; i += 8)
+    {
+        const __m128i buttons = _mm_setr_epi16(
+            (SHORT)Reports[i + 0].wButtons, (SHORT)Reports[i + 1].wButtons,
+            (SHORT)Reports[i + 2].wButtons, (SHORT)Reports[i + 3].wButtons,
+            (SHORT)Reports[i + 4].wButtons, (SHORT)Reports[i + 5].wButtons,
+            (SHORT)Reports[i + 6].wButtons, (SHORT)Reports[i + 7].wButtons
+        );
+        USHORT remapped[8];
+
+        _mm_storeu_si128((__m128i*)remapped, VIGEM_BUTTON_REMAP_SSSE3(Table, buttons));
+
+        for (SIZE_T j = 0; j < 8; j++)
+            Reports[i + j].wButtons = remapped[j];
+    }
+
+    return i;
+}
+
+#endif
+
+//
+// Remaps an array of button masks in place. Uses SSSE3 shuffles if supported
+// by the CPU, the scalar four lookup path otherwise.
+//
+VOID FORCEINLINE VIGEM_BUTTON_REMAP_BATCH(
+    _In_ const VIGEM_BUTTON_REMAP_TABLE& Table,
+    _Inout_updates_(Count) PUSHORT Buttons,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+#if defined(VIGEM_UTIL_SSSE3)
+    if (VIGEM_UTIL_CPU_FEATURES() & VIGEM_UTIL_CPU_SSSE3)
+        i = VIGEM_BUTTON_REMAP_BATCH_SSSE3(Table, Buttons, Count);
+#endif
+
+    for (; i < Count; i++)
+    {
+        Buttons[i] = VIGEM_BUTTON_REMAP(Table, Buttons[i]);
+    }
+}
+
+//
+// Remaps the wButtons member of an array of XUSB reports in place.
+//
+VOID FORCEINLINE XUSB_REPORT_REMAP_BATCH(
+    _In_ const VIGEM_BUTTON_REMAP_TABLE& Table,
+    _Inout_updates_(Count) PXUSB_REPORT Reports,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+#if defined(VIGEM_UTIL_SSSE3)
+    if (VIGEM_UTIL_CPU_FEATURES() & VIGEM_UTIL_CPU_SSSE3)
+        i = XUSB_REPORT_REMAP_BATCH_SSSE3(Table, Reports, Count);
+#endif
+
+    for (; i < Count; i++)
+    {
+        Reports[i].wButtons = VIGEM_BUTTON_REMAP(Table, Reports[i].wButtons);
+    }
+}
@@ -0,0 +1,177 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ViGEmReplay_h__
+#define ViGEmReplay_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** Configuration of a replay run */
+	typedef struct _VIGEM_REPLAY_CONFIG
+	{
+		//
+		// sizeof(struct _VIGEM_REPLAY_CONFIG)
+		//
+		ULONG Size;
+
+		//
+		// Playback speed, 1.0 keeps the recorded timing, 2.0 plays twice as fast.
+		// 0.0 submits as fast as possible.
+		//
+		FLOAT Speed;
+
+		//
+		// The final stretch before each report in microseconds that's busy-waited
+		// instead of slept, trading CPU time for timing accuracy.
+		//
+		ULONG SpinMicroseconds;
+
+	} VIGEM_REPLAY_CONFIG, *PVIGEM_REPLAY_CONFIG;
+
+	/**
+	 * Initializes a VIGEM_REPLAY_CONFIG structure for real-time playback.
+	 *
+	 * @param 	Config	The configuration to initialize.
+	 */
+	VOID FORCEINLINE VIGEM_REPLAY_CONFIG_INIT(
+		_Out_ PVIGEM_REPLAY_CONFIG Config
+	)
+	{
+		RtlZeroMemory(Config, sizeof(VIGEM_REPLAY_CONFIG));
+
+		Config->Size = sizeof(VIGEM_REPLAY_CONFIG);
+		Config->Speed = 1.0f;
+		Config->SpinMicroseconds = 1000;
+	}
+
+	/** Outcome of a replay run */
+	typedef struct _VIGEM_REPLAY_STATS
+	{
+		//
+		// sizeof(struct _VIGEM_REPLAY_STATS)
+		//
+		ULONG Size;
+
+		//
+		// Reports submitted, reports the bus rejected and records of unknown type
+		//
+		ULONGLONG Submitted;
+		ULONGLONG Failed;
+		ULONGLONG Skipped;
+
+		//
+		// Playback duration the recording asked for (scaled by speed) and the
+		// one achieved, in microseconds
+		//
+		ULONGLONG IntendedMicroseconds;
+		ULONGLONG ActualMicroseconds;
+
+		//
+		// How late reports were submitted compared to their scheduled time
+		//
+		FLOAT MeanErrorMicroseconds;
+		FLOAT MaxErrorMicroseconds;
+
+	} VIGEM_REPLAY_STATS, *PVIGEM_REPLAY_STATS;
+
+	/** Defines an alias representing a replay engine */
+	typedef struct _VIGEM_REPLAY_T* PVIGEM_REPLAY;
+
+	/**
+	 * Opens a recording made with vigem_record_start for replay through the given driver
+	 * connection. Records are indexed in timestamp order, report data stays in the mapped
+	 * file.
+	 *
+	 * @param 	vigem 	The driver connection object, may be connected to the simulated bus.
+	 * @param 	path  	The recording file path.
+	 * @param 	replay	Receives the replay engine.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_replay_open(
+		PVIGEM_CLIENT vigem,
+		LPCWSTR path,
+		PVIGEM_REPLAY* replay
+	);
+
+	/**
+	 * Removes the targets created by the replay and closes the recording.
+	 *
+	 * @param 	replay	The replay engine.
+	 */
+	VIGEM_API void vigem_replay_close(
+		PVIGEM_REPLAY replay
+	);
+
+	/**
+	 * Returns the target replaying the reports recorded for a serial number. Targets are
+	 * created and plugged in by the first vigem_replay_run call.
+	 *
+	 * @param 	replay  	The replay engine.
+	 * @param 	serialNo	The serial number the reports were recorded with.
+	 *
+	 * @returns	The target or NULL.
+	 */
+	VIGEM_API PVIGEM_TARGET vigem_replay_get_target(
+		PVIGEM_REPLAY replay,
+		ULONG serialNo
+	);
+
+	/**
+	 * Plays the recording from the start, blocking until all reports are submitted or the
+	 * replay is aborted. Every recorded serial number gets its own target, submitted through
+	 * the regular update functions. Replays are deterministic: reports with equal timestamps
+	 * keep their recorded order.
+	 *
+	 * @param 	replay	The replay engine.
+	 * @param 	config	The configuration, initialized with VIGEM_REPLAY_CONFIG_INIT.
+	 * @param 	stats 	Receives the outcome, may be NULL. Size must be initialized.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_replay_run(
+		PVIGEM_REPLAY replay,
+		const VIGEM_REPLAY_CONFIG* config,
+		PVIGEM_REPLAY_STATS stats
+	);
+
+	/**
+	 * Makes a running vigem_replay_run return early. Safe to call from any thread.
+	 *
+	 * @param 	replay	The replay engine.
+	 */
+	VIGEM_API void vigem_replay_abort(
+		PVIGEM_REPLAY replay
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmReplay_h__
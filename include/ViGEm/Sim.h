@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ViGEmSim_h__
+#define ViGEmSim_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Connects to an in-process simulated bus instead of the bus driver. Targets can be
+	 * added, updated and removed as usual; submitted reports are validated, counted and
+	 * the latest one per target is kept. Notification and output report requests stay
+	 * pending until host output is injected with vigem_sim_x360_notify or
+	 * vigem_sim_ds4_output, or until cancelled. No driver needs to be installed, which makes this suitable
+	 * for automated tests and benchmarks.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_connect_simulated(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Attaches to a process-wide simulated bus session like vigem_connect_shared does to the
+	 * bus driver's. It's independent of the one vigem_connect_shared attaches to.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_connect_simulated_shared(
+		PVIGEM_CLIENT vigem
+	);
+
+	/**
+	 * Connects to several independent simulated buses like vigem_connect_multi_bus does to
+	 * the bus devices present. The vigem_sim_* functions take the driver object and find the
+	 * bus of the target themselves.
+	 *
+	 * @param 	vigem   	The driver connection object.
+	 * @param 	busCount	The number of simulated buses, at least 1.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_connect_simulated_multi_bus(
+		PVIGEM_CLIENT vigem,
+		ULONG busCount
+	);
+
+	/**
+	 * Returns the latest report the simulated bus accepted for a target.
+	 *
+	 * @param 	vigem 	The driver connection object, connected with vigem_connect_simulated.
+	 * @param 	target	The target device object.
+	 * @param 	buffer	Receives up to size bytes of the report, may be NULL.
+	 * @param 	size  	The size of buffer in bytes.
+	 * @param 	count 	Receives the number of reports accepted for the target, may be NULL.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_sim_get_report(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		PVOID buffer,
+		ULONG size,
+		PULONGLONG count
+	);
+
+	/**
+	 * Simulates the host sending rumble and LED state to an Xbox 360 target. Completes a
+	 * pending notification request of the target or, if none is pending, the next one.
+	 *
+	 * @param 	vigem	  	The driver connection object, connected with vigem_connect_simulated.
+	 * @param 	target	  	The target device object.
+	 * @param 	largeMotor	The large motor intensity (0-255).
+	 * @param 	smallMotor	The small motor intensity (0-255).
+	 * @param 	ledNumber 	The LED (player) number.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_sim_x360_notify(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		UCHAR largeMotor,
+		UCHAR smallMotor,
+		UCHAR ledNumber
+	);
+
+	/**
+	 * Simulates the host writing a raw output report to a DualShock 4 target. Completes a
+	 * pending notification request of the target and a pending output report pickup or, if
+	 * none is pending, the next one.
+	 *
+	 * @param 	vigem 	The driver connection object, connected with vigem_connect_simulated.
+	 * @param 	target	The target device object.
+	 * @param 	buffer	The 64-bytes output report.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_sim_ds4_output(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_TARGET target,
+		const DS4_OUTPUT_BUFFER* buffer
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmSim_h__
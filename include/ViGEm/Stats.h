@@ -0,0 +1,241 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ViGEmStats_h__
+#define ViGEmStats_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Latency histograms are log-linear (HDR style): values below
+ * VIGEM_STATS_SUB_BUCKETS nanoseconds get a bucket each, every following power
+ * of two is split into VIGEM_STATS_SUB_BUCKETS equally wide buckets. The
+ * relative error is below 12.5%, the last bucket also holds everything above
+ * about 17 seconds.
+ */
+
+#define VIGEM_STATS_SUB_BUCKETS     8
+#define VIGEM_STATS_BUCKETS         256
+#define VIGEM_STATS_ERROR_SLOTS     32
+
+//
+// Errors slot a VIGEM_ERROR is counted in, slot 0 counts VIGEM_ERROR_NONE.
+//
+#define VIGEM_STATS_ERROR_SLOT(_error_)     ((ULONG)(_error_) & (VIGEM_STATS_ERROR_SLOTS - 1))
+
+	/** Values that represent the API functions statistics are kept for */
+	typedef enum _VIGEM_STATS_FUNCTION
+	{
+		VIGEM_STATS_TARGET_ADD = 0,
+		VIGEM_STATS_TARGET_REMOVE,
+		VIGEM_STATS_X360_UPDATE,
+		VIGEM_STATS_DS4_UPDATE,
+		VIGEM_STATS_DS4_UPDATE_EX,
+		VIGEM_STATS_X360_GET_USER_INDEX,
+		VIGEM_STATS_DS4_AWAIT_OUTPUT_REPORT,
+		VIGEM_STATS_FUNCTION_COUNT
+
+	} VIGEM_STATS_FUNCTION;
+
+	/** Call counters and latency histogram of an API function or target */
+	typedef struct _VIGEM_STATS_ENTRY
+	{
+		//
+		// Number of calls, equals the sum of Errors and of Buckets
+		//
+		ULONGLONG Calls;
+
+		//
+		// Summed up and longest call duration
+		//
+		ULONGLONG TotalNanoseconds;
+		ULONGLONG MaxNanoseconds;
+
+		//
+		// Calls per returned VIGEM_ERROR, indexed with VIGEM_STATS_ERROR_SLOT
+		//
+		ULONGLONG Errors[VIGEM_STATS_ERROR_SLOTS];
+
+		//
+		// Calls per duration bucket
+		//
+		ULONGLONG Buckets[VIGEM_STATS_BUCKETS];
+
+	} VIGEM_STATS_ENTRY, *PVIGEM_STATS_ENTRY;
+
+	/** Statistics snapshot of a driver connection */
+	typedef struct _VIGEM_STATS
+	{
+		//
+		// sizeof(struct _VIGEM_STATS)
+		//
+		ULONG Size;
+
+		//
+		// Number of threads that made instrumented calls
+		//
+		ULONG Threads;
+
+		//
+		// One entry per VIGEM_STATS_FUNCTION
+		//
+		VIGEM_STATS_ENTRY Functions[VIGEM_STATS_FUNCTION_COUNT];
+
+	} VIGEM_STATS, *PVIGEM_STATS;
+
+	/**
+	 * Initializes a VIGEM_STATS structure.
+	 *
+	 * @param 	Stats	The structure to initialize.
+	 */
+	VOID FORCEINLINE VIGEM_STATS_INIT(
+		_Out_ PVIGEM_STATS Stats
+	)
+	{
+		RtlZeroMemory(Stats, sizeof(VIGEM_STATS));
+
+		Stats->Size = sizeof(VIGEM_STATS);
+	}
+
+	/**
+	 * Returns the smallest duration counted in a histogram bucket.
+	 *
+	 * @param 	Index	The bucket index.
+	 *
+	 * @returns	The duration in nanoseconds.
+	 */
+	ULONGLONG FORCEINLINE VIGEM_STATS_BUCKET_LOWER(
+		_In_ ULONG Index
+	)
+	{
+		if (Index < VIGEM_STATS_SUB_BUCKETS)
+			return Index;
+
+		const ULONG shift = Index / VIGEM_STATS_SUB_BUCKETS - 1;
+
+		return (ULONGLONG)(VIGEM_STATS_SUB_BUCKETS + Index % VIGEM_STATS_SUB_BUCKETS) << shift;
+	}
+
+	/**
+	 * Returns the largest duration counted in a histogram bucket.
+	 *
+	 * @param 	Index	The bucket index.
+	 *
+	 * @returns	The duration in nanoseconds.
+	 */
+	ULONGLONG FORCEINLINE VIGEM_STATS_BUCKET_UPPER(
+		_In_ ULONG Index
+	)
+	{
+		if (Index < VIGEM_STATS_SUB_BUCKETS)
+			return Index;
+
+		return VIGEM_STATS_BUCKET_LOWER(Index) + (1ULL << (Index / VIGEM_STATS_SUB_BUCKETS - 1)) - 1;
+	}
+
+	/**
+	 * Returns the duration below which the given fraction of calls completed, with the
+	 * precision of the histogram.
+	 *
+	 * @param 	Entry	  	The entry.
+	 * @param 	Percentile	The fraction of calls (0.0 - 1.0), e.g. 0.99.
+	 *
+	 * @returns	The upper bound of the bucket the percentile falls into in nanoseconds, 0 if
+	 * 			there were no calls.
+	 */
+	ULONGLONG FORCEINLINE VIGEM_STATS_PERCENTILE(
+		_In_ const VIGEM_STATS_ENTRY* Entry,
+		_In_ DOUBLE Percentile
+	)
+	{
+		const ULONGLONG rank = (ULONGLONG)(Percentile * (DOUBLE)Entry->Calls + 0.5);
+		ULONGLONG seen = 0;
+
+		for (ULONG index = 0; index < VIGEM_STATS_BUCKETS; index++)
+		{
+			seen += Entry->Buckets[index];
+
+			if (seen > 0 && seen >= rank)
+				return (VIGEM_STATS_BUCKET_UPPER(index) < Entry->MaxNanoseconds)
+					? VIGEM_STATS_BUCKET_UPPER(index)
+					: Entry->MaxNanoseconds;
+		}
+
+		return 0;
+	}
+
+	/**
+	 * Turns statistics collection for a driver connection on or off. While off, the
+	 * instrumented functions only test a flag. While on, every call is timed and
+	 * accounted in a shard owned by the calling thread, so threads never contend.
+	 * Collected statistics are kept when turned off and freed on disconnect.
+	 *
+	 * @param 	vigem 	The driver connection object.
+	 * @param 	enable	TRUE to collect statistics, FALSE to stop.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_stats_enable(
+		PVIGEM_CLIENT vigem,
+		BOOLEAN enable
+	);
+
+	/**
+	 * Merges the per-thread statistics of a driver connection into a snapshot. Calls
+	 * in progress on other threads may or may not be included.
+	 *
+	 * @param 	vigem	The driver connection object.
+	 * @param 	stats	The snapshot, initialized with VIGEM_STATS_INIT.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_get_stats(
+		PVIGEM_CLIENT vigem,
+		PVIGEM_STATS stats
+	);
+
+	/**
+	 * Returns the statistics of all report updates submitted to a target while
+	 * statistics collection was on.
+	 *
+	 * @param 	target	The target device object.
+	 * @param 	stats 	Receives the statistics.
+	 *
+	 * @returns	A VIGEM_ERROR.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_target_get_stats(
+		PVIGEM_TARGET target,
+		PVIGEM_STATS_ENTRY stats
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmStats_h__
@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+#ifndef ViGEmTrace_h__
+#define ViGEmTrace_h__
+
+#include "ViGEm/Client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Timeline tracing
+ *
+ * Trace points only exist in builds with VIGEM_TRACING_ENABLED defined
+ * (-DViGEmClient_TRACING=ON). Those builds record report updates with their
+ * IOCTL round trip, target plugin/unplug phases, DS4 output report pickup and
+ * dispatch and notification callbacks. While tracing is off every trace point
+ * is a single test of a global flag.
+ *
+ * Every thread writes to its own ring of VIGEM_TRACE_RING_EVENTS events; when
+ * a ring is full its oldest events are overwritten. Rings are process-wide, not
+ * bound to a driver connection.
+ *
+ * vigem_trace_flush writes a Chrome trace event JSON file that chrome://tracing
+ * and ui.perfetto.dev can open.
+ */
+
+#define VIGEM_TRACE_RING_EVENTS     8192
+
+	/**
+	 * Turns recording of trace events on or off. Events recorded so far are kept
+	 * until flushed.
+	 *
+	 * @param 	enable	TRUE to record trace events, FALSE to stop.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_NOT_SUPPORTED if the library was built
+	 * 			without VIGEM_TRACING_ENABLED.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_trace_enable(
+		BOOLEAN enable
+	);
+
+	/**
+	 * Writes all events recorded since the previous flush to a Chrome trace event JSON
+	 * file, replacing an existing file. May be called while tracing is on; events
+	 * overwritten before they could be written are counted in the file's metadata.
+	 *
+	 * @param 	path	The file path.
+	 *
+	 * @returns	A VIGEM_ERROR, VIGEM_ERROR_NOT_SUPPORTED if the library was built
+	 * 			without VIGEM_TRACING_ENABLED.
+	 */
+	VIGEM_API VIGEM_ERROR vigem_trace_flush(
+		LPCWSTR path
+	);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ViGEmTrace_h__
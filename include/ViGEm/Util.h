@@ -3,6 +3,106 @@
 #include "ViGEm/Common.h"
 #include <limits.h>
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define VIGEM_UTIL_SSE2
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER) || defined(__SSSE3__)
+#define VIGEM_UTIL_SSSE3
+#endif
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define VIGEM_UTIL_AVX2
+#endif
+#elif defined(_M_ARM64) || defined(__ARM_NEON)
+#define VIGEM_UTIL_NEON
+#if defined(_MSC_VER)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#endif
+
+//
+// Marks a function using intrinsics of an extension dispatched at runtime.
+// GCC and clang (clang-cl included) only compile those intrinsics into a
+// function targeting the extension; MSVC accepts them anywhere.
+//
+#if !defined(_MSC_VER) || defined(__clang__)
+#define VIGEM_UTIL_TARGET(_features_)   __attribute__((target(_features_)))
+#else
+#define VIGEM_UTIL_TARGET(_features_)
+#endif
+
+#if defined(VIGEM_UTIL_SSE2)
+
+#define VIGEM_UTIL_CPU_SSSE3    0x1
+#define VIGEM_UTIL_CPU_AVX2     0x2
+
+//
+// Queries the VIGEM_UTIL_CPU_* instruction set extensions usable on the
+// executing CPU and OS. Use VIGEM_UTIL_CPU_FEATURES, which caches the result.
+//
+static ULONG VIGEM_UTIL_CPU_DETECT(void)
+{
+    ULONG result = 0;
+
+#if defined(_MSC_VER)
+    int info[4] = { 0 };
+
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    if (info[2] & (1 << 9))
+        result |= VIGEM_UTIL_CPU_SSSE3;
+
+    // AVX2 additionally requires OSXSAVE, AVX and the OS saving XMM and YMM state
+    if (maxLeaf >= 7
+        && (info[2] & (1 << 27)) != 0
+        && (info[2] & (1 << 28)) != 0
+        && (_xgetbv(0) & 0x6) == 0x6)
+    {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5))
+            result |= VIGEM_UTIL_CPU_AVX2;
+    }
+#else
+#if defined(__SSSE3__)
+    result |= VIGEM_UTIL_CPU_SSSE3;
+#endif
+#if defined(__AVX2__)
+    result |= VIGEM_UTIL_CPU_AVX2;
+#endif
+#endif
+
+    return result;
+}
+
+//
+// Returns the VIGEM_UTIL_CPU_* instruction set extensions usable on the
+// executing CPU and OS (evaluated once). The cache is a plain static so the
+// header stays valid C; threads racing the first call store the same value.
+//
+static ULONG FORCEINLINE VIGEM_UTIL_CPU_FEATURES(void)
+{
+    // bit 31 marks the cache as filled, so a CPU without extensions is queried once as well
+    static volatile LONG features = 0;
+    LONG value = features;
+
+    if (value == 0)
+    {
+        value = (LONG)(VIGEM_UTIL_CPU_DETECT() | 0x80000000UL);
+        features = value;
+    }
+
+    return (ULONG)value & ~0x80000000UL;
+}
+
+#endif
+
 VOID FORCEINLINE XUSB_TO_DS4_REPORT(
     _Out_ PXUSB_REPORT Input,
     _Out_ PDS4_REPORT Output
@@ -48,3 +148,748 @@ VOID FORCEINLINE XUSB_TO_DS4_REPORT(
     Output->bThumbRY = (Output->bThumbRY == 0) ? 0xFF : Output->bThumbRY;
 }
 
+//
+// HAT value XUSB_TO_DS4_REPORT ends up with for every combination of the four
+// XUSB_GAMEPAD_DPAD_* bits (later DS4_SET_DPAD calls win over earlier ones).
+//
+static const UCHAR XUSB_TO_DS4_DPAD_TABLE[16] =
+{
+    DS4_BUTTON_DPAD_NONE,      DS4_BUTTON_DPAD_NORTH,     DS4_BUTTON_DPAD_SOUTH,     DS4_BUTTON_DPAD_SOUTH,
+    DS4_BUTTON_DPAD_WEST,      DS4_BUTTON_DPAD_NORTHWEST, DS4_BUTTON_DPAD_SOUTHWEST, DS4_BUTTON_DPAD_NORTHWEST,
+    DS4_BUTTON_DPAD_EAST,      DS4_BUTTON_DPAD_NORTHEAST, DS4_BUTTON_DPAD_SOUTHEAST, DS4_BUTTON_DPAD_SOUTHEAST,
+    DS4_BUTTON_DPAD_WEST,      DS4_BUTTON_DPAD_NORTHWEST, DS4_BUTTON_DPAD_SOUTHWEST, DS4_BUTTON_DPAD_NORTHWEST
+};
+
+//
+// Branch-free equivalent of the wButtons part of XUSB_TO_DS4_REPORT applied
+// to a report freshly initialized with DS4_REPORT_INIT.
+//
+USHORT FORCEINLINE XUSB_TO_DS4_BUTTONS(
+    _In_ USHORT Buttons,
+    _In_ BYTE LeftTrigger,
+    _In_ BYTE RightTrigger
+)
+{
+    // START, BACK, LEFT_THUMB, RIGHT_THUMB -> OPTIONS, SHARE, THUMB_LEFT, THUMB_RIGHT
+    const USHORT system = (USHORT)((((Buttons >> 4) & 0x1) << 13)
+        | (((Buttons >> 5) & 0x1) << 12)
+        | (Buttons & 0x00C0) << 8);
+    // LEFT_SHOULDER and RIGHT_SHOULDER stay in place
+    const USHORT shoulders = (USHORT)(Buttons & 0x0300);
+    // A, B, X, Y -> CROSS, CIRCLE, SQUARE, TRIANGLE
+    const USHORT face = (USHORT)((((Buttons >> 12) & 0x3) << 5)
+        | (((Buttons >> 14) & 0x1) << 4)
+        | (((Buttons >> 15) & 0x1) << 7));
+    const USHORT triggers = (USHORT)(((LeftTrigger != 0) << 10) | ((RightTrigger != 0) << 11));
+
+    return (USHORT)(system | shoulders | face | triggers | XUSB_TO_DS4_DPAD_TABLE[Buttons & 0xF]);
+}
+
+//
+// Converts a biased (0 - 65535) XUSB axis value to its DS4 counterpart; this is
+// an exact shift-only replacement of the division by 257.
+//
+BYTE FORCEINLINE XUSB_TO_DS4_AXIS(
+    _In_ USHORT Biased
+)
+{
+    return (BYTE)((Biased - (Biased >> 8)) >> 8);
+}
+
+//
+// Converts a biased (0 - 65535) XUSB axis value to an inverted DS4 axis, with
+// the same wrap-around and 0 to 0xFF substitution as XUSB_TO_DS4_REPORT.
+//
+BYTE FORCEINLINE XUSB_TO_DS4_AXIS_INVERTED(
+    _In_ USHORT Biased
+)
+{
+    const BYTE value = XUSB_TO_DS4_AXIS(Biased);
+
+    return (BYTE)(0x100 - (value + (value == 0)));
+}
+
+//
+// Writes the full DS4 report XUSB_TO_DS4_REPORT produces for a DS4_REPORT_INIT
+// initialized output, except for the axes which are left to the caller.
+//
+VOID FORCEINLINE XUSB_TO_DS4_REPORT_DIGITAL(
+    _In_ const XUSB_REPORT* Input,
+    _Out_ PDS4_REPORT Output
+)
+{
+    Output->wButtons = XUSB_TO_DS4_BUTTONS(Input->wButtons, Input->bLeftTrigger, Input->bRightTrigger);
+    Output->bSpecial = (BYTE)((Input->wButtons >> 10) & DS4_SPECIAL_BUTTON_PS);
+    Output->bTriggerL = Input->bLeftTrigger;
+    Output->bTriggerR = Input->bRightTrigger;
+}
+
+//
+// Branch-free single report conversion. The result is bit-exact with calling
+// DS4_REPORT_INIT followed by XUSB_TO_DS4_REPORT on the same output.
+//
+VOID FORCEINLINE XUSB_TO_DS4_REPORT_FAST(
+    _In_ const XUSB_REPORT* Input,
+    _Out_ PDS4_REPORT Output
+)
+{
+    RtlZeroMemory(Output, sizeof(DS4_REPORT));
+
+    XUSB_TO_DS4_REPORT_DIGITAL(Input, Output);
+
+    Output->bThumbLX = XUSB_TO_DS4_AXIS((USHORT)(Input->sThumbLX + 0x8000));
+    // the legacy conversion biases LY by 32766 instead of 32768, mirrored here
+    Output->bThumbLY = XUSB_TO_DS4_AXIS_INVERTED(
+        (USHORT)((Input->sThumbLY + 0x7FFE) < 0 ? 0 : (Input->sThumbLY + 0x7FFE)));
+    Output->bThumbRX = XUSB_TO_DS4_AXIS((USHORT)(Input->sThumbRX + 0x8000));
+    Output->bThumbRY = XUSB_TO_DS4_AXIS_INVERTED((USHORT)(Input->sThumbRY + 0x8000));
+}
+
+//
+// Writes a converted report from pre-computed axes (LX, LY, RX, RY) as used
+// by the vectorized batch paths.
+//
+VOID FORCEINLINE XUSB_TO_DS4_REPORT_STORE(
+    _In_ const XUSB_REPORT* Input,
+    _Out_ PDS4_REPORT Output,
+    _In_reads_(4) const UCHAR* Axes
+)
+{
+    RtlZeroMemory(Output, sizeof(DS4_REPORT));
+    RtlCopyMemory(&Output->bThumbLX, Axes, 4);
+
+    XUSB_TO_DS4_REPORT_DIGITAL(Input, Output);
+}
+
+#if defined(VIGEM_UTIL_SSE2)
+
+//
+// Converts the four packed stick words of two XUSB reports (LX, LY, RX, RY)
+// to the leading four bytes of the matching DS4 reports.
+//
+static FORCEINLINE __m128i XUSB_TO_DS4_AXES_SSE2(
+    _In_ __m128i Sticks
+)
+{
+    const __m128i bias = _mm_set1_epi16((SHORT)0x8000);
+    const __m128i lyBias = _mm_setr_epi16(0, 2, 0, 0, 0, 2, 0, 0);
+    const __m128i yMask = _mm_setr_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+
+    const __m128i biased = _mm_subs_epu16(_mm_xor_si128(Sticks, bias), lyBias);
+    const __m128i axis = _mm_srli_epi16(_mm_sub_epi16(biased, _mm_srli_epi16(biased, 8)), 8);
+    const __m128i inverted = _mm_sub_epi16(_mm_set1_epi16(0x100), _mm_max_epi16(axis, _mm_set1_epi16(1)));
+
+    return _mm_packus_epi16(
+        _mm_or_si128(_mm_andnot_si128(yMask, axis), _mm_and_si128(yMask, inverted)),
+        _mm_setzero_si128()
+    );
+}
+
+#endif
+
+//
+// The XUSB_TO_DS4_REPORT_BATCH variants for the individual instruction sets.
+// Only call one directly when the executing CPU is known to support it.
+//
+#if defined(VIGEM_UTIL_SSE2)
+
+static VOID XUSB_TO_DS4_REPORT_BATCH_SSE2(
+    _In_reads_(Count) const XUSB_REPORT* Input,
+    _Out_writes_(Count) PDS4_REPORT Output,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+    for (; i + 2 <= Count; i += 2)
+    {
+        const __m128i sticks = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i*)&Input[i + 0].sThumbLX),
+            _mm_loadl_epi64((const __m128i*)&Input[i + 1].sThumbLX)
+        );
+        UCHAR axes[8];
+        _mm_storel_epi64((__m128i*)axes, XUSB_TO_DS4_AXES_SSE2(sticks));
+
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 0], &Output[i + 0], &axes[0]);
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 1], &Output[i + 1], &axes[4]);
+    }
+
+    for (; i < Count; i++)
+    {
+        XUSB_TO_DS4_REPORT_FAST(&Input[i], &Output[i]);
+    }
+}
+
+#elif defined(VIGEM_UTIL_NEON)
+
+static VOID XUSB_TO_DS4_REPORT_BATCH_NEON(
+    _In_reads_(Count) const XUSB_REPORT* Input,
+    _Out_writes_(Count) PDS4_REPORT Output,
+    _In_ SIZE_T Count
+)
+{
+    static const uint16_t lyBiasLanes[8] = { 0, 2, 0, 0, 0, 2, 0, 0 };
+    static const uint16_t yMaskLanes[8] = { 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF };
+    const uint16x8_t lyBias = vld1q_u16(lyBiasLanes);
+    const uint16x8_t yMask = vld1q_u16(yMaskLanes);
+    SIZE_T i = 0;
+
+    for (; i + 2 <= Count; i += 2)
+    {
+        const uint16x8_t sticks = vcombine_u16(
+            vld1_u16((const uint16_t*)&Input[i + 0].sThumbLX),
+            vld1_u16((const uint16_t*)&Input[i + 1].sThumbLX)
+        );
+        const uint16x8_t biased = vqsubq_u16(veorq_u16(sticks, vdupq_n_u16(0x8000)), lyBias);
+        const uint16x8_t axis = vshrq_n_u16(vsubq_u16(biased, vshrq_n_u16(biased, 8)), 8);
+        const uint16x8_t inverted = vsubq_u16(vdupq_n_u16(0x100), vmaxq_u16(axis, vdupq_n_u16(1)));
+        UCHAR axes[8];
+        vst1_u8(axes, vmovn_u16(vbslq_u16(yMask, inverted, axis)));
+
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 0], &Output[i + 0], &axes[0]);
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 1], &Output[i + 1], &axes[4]);
+    }
+
+    for (; i < Count; i++)
+    {
+        XUSB_TO_DS4_REPORT_FAST(&Input[i], &Output[i]);
+    }
+}
+
+#endif
+
+#if defined(VIGEM_UTIL_AVX2)
+
+VIGEM_UTIL_TARGET("avx2")
+static VOID XUSB_TO_DS4_REPORT_BATCH_AVX2(
+    _In_reads_(Count) const XUSB_REPORT* Input,
+    _Out_writes_(Count) PDS4_REPORT Output,
+    _In_ SIZE_T Count
+)
+{
+    const __m256i bias = _mm256_set1_epi16((SHORT)0x8000);
+    const __m256i lyBias = _mm256_setr_epi16(0, 2, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0, 0, 2, 0, 0);
+    const __m256i yMask = _mm256_setr_epi16(0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1, 0, -1);
+    SIZE_T i = 0;
+
+    for (; i + 4 <= Count; i += 4)
+    {
+        const __m256i sticks = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i*)&Input[i + 0].sThumbLX),
+                _mm_loadl_epi64((const __m128i*)&Input[i + 1].sThumbLX)
+            )),
+            _mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i*)&Input[i + 2].sThumbLX),
+                _mm_loadl_epi64((const __m128i*)&Input[i + 3].sThumbLX)
+            ),
+            1
+        );
+
+        const __m256i biased = _mm256_subs_epu16(_mm256_xor_si256(sticks, bias), lyBias);
+        const __m256i axis = _mm256_srli_epi16(_mm256_sub_epi16(biased, _mm256_srli_epi16(biased, 8)), 8);
+        const __m256i inverted = _mm256_sub_epi16(
+            _mm256_set1_epi16(0x100),
+            _mm256_max_epi16(axis, _mm256_set1_epi16(1))
+        );
+        const __m256i packed = _mm256_packus_epi16(
+            _mm256_blendv_epi8(axis, inverted, yMask),
+            _mm256_setzero_si256()
+        );
+
+        // packing happens per 128-bit lane, reports 0/1 are in the low lane and 2/3 in the high one
+        UCHAR axes[16];
+        _mm_storel_epi64((__m128i*)&axes[0], _mm256_castsi256_si128(packed));
+        _mm_storel_epi64((__m128i*)&axes[8], _mm256_extracti128_si256(packed, 1));
+
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 0], &Output[i + 0], &axes[0]);
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 1], &Output[i + 1], &axes[4]);
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 2], &Output[i + 2], &axes[8]);
+        XUSB_TO_DS4_REPORT_STORE(&Input[i + 3], &Output[i + 3], &axes[12]);
+    }
+
+    for (; i < Count; i++)
+    {
+        XUSB_TO_DS4_REPORT_FAST(&Input[i], &Output[i]);
+    }
+}
+
+#endif
+
+//
+// Converts an array of XUSB reports to DS4 reports. Every output report is
+// written in full and is bit-exact with DS4_REPORT_INIT followed by
+// XUSB_TO_DS4_REPORT. Uses AVX2 (if supported by the CPU), SSE2 or NEON for
+// the stick axes and branch-free scalar code for everything else.
+//
+VOID FORCEINLINE XUSB_TO_DS4_REPORT_BATCH(
+    _In_reads_(Count) const XUSB_REPORT* Input,
+    _Out_writes_(Count) PDS4_REPORT Output,
+    _In_ SIZE_T Count
+)
+{
+#if defined(VIGEM_UTIL_AVX2)
+    if (VIGEM_UTIL_CPU_FEATURES() & VIGEM_UTIL_CPU_AVX2)
+    {
+        XUSB_TO_DS4_REPORT_BATCH_AVX2(Input, Output, Count);
+        return;
+    }
+#endif
+
+#if defined(VIGEM_UTIL_SSE2)
+    XUSB_TO_DS4_REPORT_BATCH_SSE2(Input, Output, Count);
+#elif defined(VIGEM_UTIL_NEON)
+    XUSB_TO_DS4_REPORT_BATCH_NEON(Input, Output, Count);
+#else
+    for (SIZE_T i = 0; i < Count; i++)
+    {
+        XUSB_TO_DS4_REPORT_FAST(&Input[i], &Output[i]);
+    }
+#endif
+}
+
+//
+// XUSB_GAMEPAD_DPAD_* bits for every DS4 HAT value; values above
+// DS4_BUTTON_DPAD_NONE are treated as released.
+//
+static const UCHAR DS4_TO_XUSB_DPAD_TABLE[16] =
+{
+    XUSB_GAMEPAD_DPAD_UP,
+    XUSB_GAMEPAD_DPAD_UP | XUSB_GAMEPAD_DPAD_RIGHT,
+    XUSB_GAMEPAD_DPAD_RIGHT,
+    XUSB_GAMEPAD_DPAD_RIGHT | XUSB_GAMEPAD_DPAD_DOWN,
+    XUSB_GAMEPAD_DPAD_DOWN,
+    XUSB_GAMEPAD_DPAD_DOWN | XUSB_GAMEPAD_DPAD_LEFT,
+    XUSB_GAMEPAD_DPAD_LEFT,
+    XUSB_GAMEPAD_DPAD_LEFT | XUSB_GAMEPAD_DPAD_UP,
+    0, 0, 0, 0, 0, 0, 0, 0
+};
+
+//
+// Branch-free mapping of DS4 wButtons and bSpecial to XUSB_BUTTON bits. The
+// digital trigger bits and DS4_SPECIAL_BUTTON_TOUCHPAD have no XUSB equivalent
+// and are dropped.
+//
+USHORT FORCEINLINE DS4_TO_XUSB_BUTTONS(
+    _In_ USHORT Buttons,
+    _In_ BYTE Special
+)
+{
+    // OPTIONS, SHARE, THUMB_LEFT, THUMB_RIGHT -> START, BACK, LEFT_THUMB, RIGHT_THUMB
+    const USHORT system = (USHORT)((((Buttons >> 13) & 0x1) << 4)
+        | (((Buttons >> 12) & 0x1) << 5)
+        | ((Buttons >> 8) & 0x00C0));
+    // SHOULDER_LEFT and SHOULDER_RIGHT stay in place
+    const USHORT shoulders = (USHORT)(Buttons & 0x0300);
+    // CROSS, CIRCLE, SQUARE, TRIANGLE -> A, B, X, Y
+    const USHORT face = (USHORT)((((Buttons >> 5) & 0x3) << 12)
+        | (((Buttons >> 4) & 0x1) << 14)
+        | (((Buttons >> 7) & 0x1) << 15));
+    const USHORT guide = (USHORT)((Special & DS4_SPECIAL_BUTTON_PS) << 10);
+
+    return (USHORT)(system | shoulders | face | guide | DS4_TO_XUSB_DPAD_TABLE[Buttons & 0xF]);
+}
+
+//
+// Scales a DS4 axis (0 - 255) to the full XUSB range (-32768 - 32767). The
+// DS4 center 0x80 ends up one step above the XUSB center (+128), which is -129
+// on the inverted Y axes.
+//
+SHORT FORCEINLINE DS4_TO_XUSB_AXIS(
+    _In_ BYTE Value
+)
+{
+    return (SHORT)(((USHORT)Value * 257) ^ 0x8000);
+}
+
+//
+// Scales an inverted (down-positive) DS4 axis to an up-positive XUSB axis.
+//
+SHORT FORCEINLINE DS4_TO_XUSB_AXIS_INVERTED(
+    _In_ BYTE Value
+)
+{
+    return (SHORT)~DS4_TO_XUSB_AXIS(Value);
+}
+
+//
+// Converts the common part of DS4_REPORT and DS4_REPORT_EX to an XUSB report.
+//
+// Round trip properties, with XUSB_TO_DS4_REPORT as the forward conversion:
+//  - buttons, bSpecial PS and the D-Pad HAT (0 - 8) are exact in both
+//    directions, except for the touchpad click and the digital trigger bits
+//    which XUSB_TO_DS4_REPORT re-derives from the analog trigger values
+//  - triggers are exact in both directions
+//  - X axes are exact DS4 -> XUSB -> DS4; XUSB -> DS4 -> XUSB rounds down to
+//    the next multiple of 257 (biased)
+//  - Y axes are not exact: XUSB_TO_DS4_REPORT maps the XUSB center to 0x81,
+//    so DS4 -> XUSB -> DS4 yields the input plus one (RY) or two (LY),
+//    saturating at 0xFF
+//
+VOID FORCEINLINE DS4_TO_XUSB_REPORT_FIELDS(
+    _In_ BYTE ThumbLX,
+    _In_ BYTE ThumbLY,
+    _In_ BYTE ThumbRX,
+    _In_ BYTE ThumbRY,
+    _In_ USHORT Buttons,
+    _In_ BYTE Special,
+    _In_ BYTE TriggerL,
+    _In_ BYTE TriggerR,
+    _Out_ PXUSB_REPORT Output
+)
+{
+    Output->wButtons = DS4_TO_XUSB_BUTTONS(Buttons, Special);
+    Output->bLeftTrigger = TriggerL;
+    Output->bRightTrigger = TriggerR;
+    Output->sThumbLX = DS4_TO_XUSB_AXIS(ThumbLX);
+    Output->sThumbLY = DS4_TO_XUSB_AXIS_INVERTED(ThumbLY);
+    Output->sThumbRX = DS4_TO_XUSB_AXIS(ThumbRX);
+    Output->sThumbRY = DS4_TO_XUSB_AXIS_INVERTED(ThumbRY);
+}
+
+//
+// Converts a DS4 report to an XUSB report.
+//
+VOID FORCEINLINE DS4_TO_XUSB_REPORT(
+    _In_ const DS4_REPORT* Input,
+    _Out_ PXUSB_REPORT Output
+)
+{
+    DS4_TO_XUSB_REPORT_FIELDS(
+        Input->bThumbLX, Input->bThumbLY, Input->bThumbRX, Input->bThumbRY,
+        Input->wButtons, Input->bSpecial, Input->bTriggerL, Input->bTriggerR,
+        Output
+    );
+}
+
+//
+// Converts a full size DS4 report to an XUSB report. Motion, touch and battery
+// data has no XUSB equivalent and is ignored.
+//
+VOID FORCEINLINE DS4_REPORT_EX_TO_XUSB_REPORT(
+    _In_ const DS4_REPORT_EX* Input,
+    _Out_ PXUSB_REPORT Output
+)
+{
+    DS4_TO_XUSB_REPORT_FIELDS(
+        Input->Report.bThumbLX, Input->Report.bThumbLY, Input->Report.bThumbRX, Input->Report.bThumbRY,
+        Input->Report.wButtons, Input->Report.bSpecial, Input->Report.bTriggerL, Input->Report.bTriggerR,
+        Output
+    );
+}
+
+//
+// Converts the stick bytes (LX, LY, RX, RY) of two DS4 reports, located at
+// the given addresses, to the four stick words of two XUSB reports.
+//
+VOID FORCEINLINE DS4_TO_XUSB_AXES_X2(
+    _In_reads_(4) const UCHAR* First,
+    _In_reads_(4) const UCHAR* Second,
+    _Out_ PXUSB_REPORT FirstOutput,
+    _Out_ PXUSB_REPORT SecondOutput
+)
+{
+#if defined(VIGEM_UTIL_SSE2)
+    int first, second;
+    RtlCopyMemory(&first, First, 4);
+    RtlCopyMemory(&second, Second, 4);
+
+    const __m128i bytes = _mm_unpacklo_epi32(_mm_cvtsi32_si128(first), _mm_cvtsi32_si128(second));
+    // b * 257 == b | b << 8, XOR-ing with 0x8000 removes the bias, Y lanes get inverted on top
+    const __m128i words = _mm_xor_si128(
+        _mm_unpacklo_epi8(bytes, bytes),
+        _mm_setr_epi16((SHORT)0x8000, 0x7FFF, (SHORT)0x8000, 0x7FFF, (SHORT)0x8000, 0x7FFF, (SHORT)0x8000, 0x7FFF)
+    );
+
+    _mm_storel_epi64((__m128i*)&FirstOutput->sThumbLX, words);
+    _mm_storel_epi64((__m128i*)&SecondOutput->sThumbLX, _mm_unpackhi_epi64(words, words));
+#elif defined(VIGEM_UTIL_NEON)
+    static const uint16_t maskLanes[8] = { 0x8000, 0x7FFF, 0x8000, 0x7FFF, 0x8000, 0x7FFF, 0x8000, 0x7FFF };
+    UCHAR bytes[8];
+    RtlCopyMemory(&bytes[0], First, 4);
+    RtlCopyMemory(&bytes[4], Second, 4);
+
+    const uint8x8_t packed = vld1_u8(bytes);
+    const uint16x8_t words = veorq_u16(
+        vreinterpretq_u16_u8(vcombine_u8(vzip1_u8(packed, packed), vzip2_u8(packed, packed))),
+        vld1q_u16(maskLanes)
+    );
+
+    vst1_u16((uint16_t*)&FirstOutput->sThumbLX, vget_low_u16(words));
+    vst1_u16((uint16_t*)&SecondOutput->sThumbLX, vget_high_u16(words));
+#else
+    FirstOutput->sThumbLX = DS4_TO_XUSB_AXIS(First[0]);
+    FirstOutput->sThumbLY = DS4_TO_XUSB_AXIS_INVERTED(First[1]);
+    FirstOutput->sThumbRX = DS4_TO_XUSB_AXIS(First[2]);
+    FirstOutput->sThumbRY = DS4_TO_XUSB_AXIS_INVERTED(First[3]);
+    SecondOutput->sThumbLX = DS4_TO_XUSB_AXIS(Second[0]);
+    SecondOutput->sThumbLY = DS4_TO_XUSB_AXIS_INVERTED(Second[1]);
+    SecondOutput->sThumbRX = DS4_TO_XUSB_AXIS(Second[2]);
+    SecondOutput->sThumbRY = DS4_TO_XUSB_AXIS_INVERTED(Second[3]);
+#endif
+}
+
+//
+// Converts an array of DS4 reports to XUSB reports, bit-exact with
+// DS4_TO_XUSB_REPORT. Stick axes are converted two reports at a time with
+// SSE2 or NEON where available.
+//
+VOID FORCEINLINE DS4_TO_XUSB_REPORT_BATCH(
+    _In_reads_(Count) const DS4_REPORT* Input,
+    _Out_writes_(Count) PXUSB_REPORT Output,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+    for (; i + 2 <= Count; i += 2)
+    {
+        DS4_TO_XUSB_AXES_X2(&Input[i + 0].bThumbLX, &Input[i + 1].bThumbLX, &Output[i + 0], &Output[i + 1]);
+
+        Output[i + 0].wButtons = DS4_TO_XUSB_BUTTONS(Input[i + 0].wButtons, Input[i + 0].bSpecial);
+        Output[i + 0].bLeftTrigger = Input[i + 0].bTriggerL;
+        Output[i + 0].bRightTrigger = Input[i + 0].bTriggerR;
+        Output[i + 1].wButtons = DS4_TO_XUSB_BUTTONS(Input[i + 1].wButtons, Input[i + 1].bSpecial);
+        Output[i + 1].bLeftTrigger = Input[i + 1].bTriggerL;
+        Output[i + 1].bRightTrigger = Input[i + 1].bTriggerR;
+    }
+
+    for (; i < Count; i++)
+    {
+        DS4_TO_XUSB_REPORT(&Input[i], &Output[i]);
+    }
+}
+
+//
+// Converts an array of full size DS4 reports to XUSB reports, bit-exact with
+// DS4_REPORT_EX_TO_XUSB_REPORT.
+//
+VOID FORCEINLINE DS4_REPORT_EX_TO_XUSB_REPORT_BATCH(
+    _In_reads_(Count) const DS4_REPORT_EX* Input,
+    _Out_writes_(Count) PXUSB_REPORT Output,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+    for (; i + 2 <= Count; i += 2)
+    {
+        DS4_TO_XUSB_AXES_X2(&Input[i + 0].Report.bThumbLX, &Input[i + 1].Report.bThumbLX, &Output[i + 0], &Output[i + 1]);
+
+        Output[i + 0].wButtons = DS4_TO_XUSB_BUTTONS(Input[i + 0].Report.wButtons, Input[i + 0].Report.bSpecial);
+        Output[i + 0].bLeftTrigger = Input[i + 0].Report.bTriggerL;
+        Output[i + 0].bRightTrigger = Input[i + 0].Report.bTriggerR;
+        Output[i + 1].wButtons = DS4_TO_XUSB_BUTTONS(Input[i + 1].Report.wButtons, Input[i + 1].Report.bSpecial);
+        Output[i + 1].bLeftTrigger = Input[i + 1].Report.bTriggerL;
+        Output[i + 1].bRightTrigger = Input[i + 1].Report.bTriggerR;
+    }
+
+    for (; i < Count; i++)
+    {
+        DS4_REPORT_EX_TO_XUSB_REPORT(&Input[i], &Output[i]);
+    }
+}
+
+//
+// DualShock 4 touchpad resolution
+//
+#define DS4_TOUCHPAD_WIDTH      1920
+#define DS4_TOUCHPAD_HEIGHT     943
+
+//
+// Unpacked state of a single DS4 touchpad contact.
+//
+typedef struct _DS4_TOUCH_POINT
+{
+    //
+    // Horizontal position (0 - 1919).
+    //
+    USHORT X;
+
+    //
+    // Vertical position (0 - 942).
+    //
+    USHORT Y;
+
+    //
+    // Tracking number (0 - 127), incremented for every new contact.
+    //
+    BYTE TrackingNum;
+
+    //
+    // TRUE while the finger touches the pad.
+    //
+    BOOLEAN IsDown;
+
+    USHORT Reserved;
+
+} DS4_TOUCH_POINT, *PDS4_TOUCH_POINT;
+
+//
+// Packs a contact into the 32-bit little-endian layout of bIsUpTrackingNum
+// followed by bTouchData (X and Y are clamped to the touchpad resolution).
+//
+ULONG FORCEINLINE DS4_TOUCH_POINT_ENCODE(
+    _In_ const DS4_TOUCH_POINT* Point
+)
+{
+    const ULONG x = Point->X < DS4_TOUCHPAD_WIDTH - 1 ? Point->X : DS4_TOUCHPAD_WIDTH - 1;
+    const ULONG y = Point->Y < DS4_TOUCHPAD_HEIGHT - 1 ? Point->Y : DS4_TOUCHPAD_HEIGHT - 1;
+
+    return (Point->TrackingNum & 0x7F) | ((ULONG)(Point->IsDown == FALSE) << 7) | (x << 8) | (y << 20);
+}
+
+//
+// Unpacks a contact from the layout produced by DS4_TOUCH_POINT_ENCODE.
+//
+VOID FORCEINLINE DS4_TOUCH_POINT_DECODE(
+    _In_ ULONG Packed,
+    _Out_ PDS4_TOUCH_POINT Point
+)
+{
+    Point->X = (USHORT)((Packed >> 8) & 0xFFF);
+    Point->Y = (USHORT)(Packed >> 20);
+    Point->TrackingNum = (BYTE)(Packed & 0x7F);
+    Point->IsDown = (Packed & 0x80) == 0;
+    Point->Reserved = 0;
+}
+
+//
+// Fills a DS4_TOUCH packet from two contacts. Pass IsDown = FALSE for an
+// unused second contact.
+//
+VOID FORCEINLINE DS4_TOUCH_SET(
+    _Out_ PDS4_TOUCH Touch,
+    _In_ BYTE PacketCounter,
+    _In_ const DS4_TOUCH_POINT* First,
+    _In_ const DS4_TOUCH_POINT* Second
+)
+{
+    const ULONG first = DS4_TOUCH_POINT_ENCODE(First);
+    const ULONG second = DS4_TOUCH_POINT_ENCODE(Second);
+
+    Touch->bPacketCounter = PacketCounter;
+    RtlCopyMemory(&Touch->bIsUpTrackingNum1, &first, sizeof(ULONG));
+    RtlCopyMemory(&Touch->bIsUpTrackingNum2, &second, sizeof(ULONG));
+}
+
+//
+// Extracts both contacts of a DS4_TOUCH packet.
+//
+VOID FORCEINLINE DS4_TOUCH_GET(
+    _In_ const DS4_TOUCH* Touch,
+    _Out_ PDS4_TOUCH_POINT First,
+    _Out_ PDS4_TOUCH_POINT Second
+)
+{
+    ULONG first, second;
+
+    RtlCopyMemory(&first, &Touch->bIsUpTrackingNum1, sizeof(ULONG));
+    RtlCopyMemory(&second, &Touch->bIsUpTrackingNum2, sizeof(ULONG));
+
+    DS4_TOUCH_POINT_DECODE(first, First);
+    DS4_TOUCH_POINT_DECODE(second, Second);
+}
+
+//
+// Appends a touch packet to a full size report: sCurrentTouch moves into the
+// sPreviousTouch history (newest first), the oldest entry is dropped and
+// bTouchPacketsN counts up to the USB maximum of 3.
+//
+VOID FORCEINLINE DS4_REPORT_EX_PUSH_TOUCH(
+    _Inout_ PDS4_REPORT_EX Report,
+    _In_ const DS4_TOUCH* Touch
+)
+{
+    Report->Report.sPreviousTouch[1] = Report->Report.sPreviousTouch[0];
+    Report->Report.sPreviousTouch[0] = Report->Report.sCurrentTouch;
+    Report->Report.sCurrentTouch = *Touch;
+    Report->Report.bTouchPacketsN = (BYTE)(Report->Report.bTouchPacketsN < 3 ? Report->Report.bTouchPacketsN + 1 : 3);
+}
+
+//
+// Encodes Count touch packets from 2 * Count contacts (two per packet), with
+// packet counters starting at PacketCounter and incrementing per packet.
+// Bit-exact with DS4_TOUCH_SET; uses SSE2 where available.
+//
+VOID FORCEINLINE DS4_TOUCH_ENCODE_BATCH(
+    _In_reads_(Count * 2) const DS4_TOUCH_POINT* Points,
+    _Out_writes_(Count) PDS4_TOUCH Touches,
+    _In_ SIZE_T Count,
+    _In_ BYTE PacketCounter
+)
+{
+    SIZE_T i = 0;
+
+#if defined(VIGEM_UTIL_SSE2)
+    // per point: X, Y words clamped in the low dword, flags in the high dword
+    const __m128i limits = _mm_setr_epi16(
+        DS4_TOUCHPAD_WIDTH - 1, DS4_TOUCHPAD_HEIGHT - 1, -1, -1,
+        DS4_TOUCHPAD_WIDTH - 1, DS4_TOUCHPAD_HEIGHT - 1, -1, -1
+    );
+    const __m128i downMask = _mm_setr_epi32(0, 0xFF00, 0, 0xFF00);
+
+    for (; i < Count; i++)
+    {
+        const __m128i points = _mm_loadu_si128((const __m128i*)&Points[i * 2]);
+        // min(x, limit) for unsigned words without SSE4.1
+        const __m128i clamped = _mm_sub_epi16(points, _mm_subs_epu16(points, limits));
+        const __m128i coords = _mm_or_si128(
+            _mm_slli_epi32(_mm_and_si128(clamped, _mm_setr_epi32(0xFFFF, 0, 0xFFFF, 0)), 8),
+            _mm_slli_epi32(_mm_and_si128(clamped, _mm_setr_epi32((int)0xFFFF0000, 0, (int)0xFFFF0000, 0)), 4)
+        );
+        const __m128i flags = _mm_or_si128(
+            _mm_and_si128(points, _mm_setr_epi32(0, 0x7F, 0, 0x7F)),
+            _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(points, downMask), _mm_setzero_si128()), _mm_setr_epi32(0, 0x80, 0, 0x80))
+        );
+        const __m128i packed = _mm_shuffle_epi32(_mm_or_si128(coords, _mm_srli_epi64(flags, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+
+        Touches[i].bPacketCounter = (BYTE)(PacketCounter + i);
+        _mm_storel_epi64((__m128i*)&Touches[i].bIsUpTrackingNum1, packed);
+    }
+#endif
+
+    for (; i < Count; i++)
+    {
+        DS4_TOUCH_SET(&Touches[i], (BYTE)(PacketCounter + i), &Points[i * 2], &Points[i * 2 + 1]);
+    }
+}
+
+//
+// Decodes Count touch packets into 2 * Count contacts (two per packet).
+// Bit-exact with DS4_TOUCH_GET; uses SSE2 where available.
+//
+VOID FORCEINLINE DS4_TOUCH_DECODE_BATCH(
+    _In_reads_(Count) const DS4_TOUCH* Touches,
+    _Out_writes_(Count * 2) PDS4_TOUCH_POINT Points,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T i = 0;
+
+#if defined(VIGEM_UTIL_SSE2)
+    for (; i < Count; i++)
+    {
+        // both contacts, zero-extended into one 64-bit lane each
+        const __m128i packed = _mm_unpacklo_epi32(
+            _mm_loadl_epi64((const __m128i*)&Touches[i].bIsUpTrackingNum1),
+            _mm_setzero_si128()
+        );
+        const __m128i coords = _mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(packed, 8), _mm_set1_epi64x(0xFFF)),
+            _mm_and_si128(_mm_srli_epi32(packed, 4), _mm_set1_epi64x(0x0FFF0000))
+        );
+        const __m128i flags = _mm_or_si128(
+            _mm_and_si128(packed, _mm_set1_epi64x(0x7F)),
+            _mm_slli_epi32(_mm_andnot_si128(packed, _mm_set1_epi64x(0x80)), 1)
+        );
+
+        _mm_storeu_si128((__m128i*)&Points[i * 2], _mm_or_si128(coords, _mm_slli_epi64(flags, 32)));
+    }
+#endif
+
+    for (; i < Count; i++)
+    {
+        DS4_TOUCH_GET(&Touches[i], &Points[i * 2], &Points[i * 2 + 1]);
+    }
+}
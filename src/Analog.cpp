@@ -0,0 +1,625 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// Driver shared
+//
+#include "ViGEm/Analog.h"
+
+//
+// STL
+//
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#define VIGEM_ANALOG_SSE2
+#endif
+
+//
+// Internal
+// 
+#include "Memory.h"
+
+
+//
+// Number of processed channels (LX, LY, RX, RY, LT, RT).
+//
+#define VIGEM_ANALOG_CHANNELS       6
+
+#define VIGEM_ANALOG_PI             3.14159265358979f
+
+//
+// Represents an analog processing pipeline. All per-pad arrays are 16-byte
+// aligned and padded to a multiple of four elements.
+//
+typedef struct _VIGEM_ANALOG_PIPELINE_T
+{
+	ULONG Capacity;
+	VIGEM_ANALOG_CONFIG Config;
+
+	//
+	// Response curves as (base, slope) per segment, so the interpolation only
+	// needs a single table index.
+	//
+	FLOAT StickBase[VIGEM_ANALOG_CURVE_POINTS];
+	FLOAT StickSlope[VIGEM_ANALOG_CURVE_POINTS];
+	FLOAT TriggerBase[VIGEM_ANALOG_CURVE_POINTS];
+	FLOAT TriggerSlope[VIGEM_ANALOG_CURVE_POINTS];
+
+	VIGEM_ANALOG_INPUT Input;
+
+	//
+	// Normalized working values, filter state and one-shot priming flags.
+	//
+	PFLOAT Value[VIGEM_ANALOG_CHANNELS];
+	PFLOAT Filtered[VIGEM_ANALOG_CHANNELS];
+	PFLOAT Derivative[VIGEM_ANALOG_CHANNELS];
+	PFLOAT Primed;
+
+	PVOID Memory;
+} VIGEM_ANALOG_PIPELINE;
+
+static void vigem_internal_analog_build_curve(const FLOAT* Curve, PFLOAT Base, PFLOAT Slope)
+{
+	for (int i = 0; i < VIGEM_ANALOG_CURVE_POINTS - 1; i++)
+	{
+		Base[i] = Curve[i];
+		Slope[i] = Curve[i + 1] - Curve[i];
+	}
+
+	Base[VIGEM_ANALOG_CURVE_POINTS - 1] = Curve[VIGEM_ANALOG_CURVE_POINTS - 1];
+	Slope[VIGEM_ANALOG_CURVE_POINTS - 1] = 0.0f;
+}
+
+static FORCEINLINE FLOAT vigem_internal_analog_clamp(FLOAT Value, FLOAT Min, FLOAT Max)
+{
+	return Value < Min ? Min : (Value > Max ? Max : Value);
+}
+
+static bool vigem_internal_analog_finite(const FLOAT* Values, SIZE_T Count)
+{
+	for (SIZE_T i = 0; i < Count; i++)
+	{
+		if (!std::isfinite(Values[i]))
+			return false;
+	}
+
+	return true;
+}
+
+//
+// Rounds a normalized value to an integer axis, saturating so that values
+// slightly out of range (e.g. a One Euro overshoot) can't wrap around.
+//
+static FORCEINLINE LONG vigem_internal_analog_round(FLOAT Value, FLOAT Min, FLOAT Max, FLOAT Scale)
+{
+	return std::lrint(vigem_internal_analog_clamp(Value, Min, Max) * Scale);
+}
+
+//
+// Rescales a normalized magnitude into the deadzone range and maps it through a curve.
+//
+static FORCEINLINE FLOAT vigem_internal_analog_shape(
+	FLOAT Magnitude,
+	FLOAT Inner,
+	FLOAT Range,
+	const FLOAT* Base,
+	const FLOAT* Slope
+)
+{
+	const FLOAT rescaled = vigem_internal_analog_clamp((Magnitude - Inner) / Range, 0.0f, 1.0f);
+	const FLOAT position = rescaled * (VIGEM_ANALOG_CURVE_POINTS - 1);
+	const int index = static_cast<int>(position);
+
+	return Base[index] + (position - static_cast<FLOAT>(index)) * Slope[index];
+}
+
+//
+// Radial deadzone and curve for one stick, scalar reference path.
+//
+static void vigem_internal_analog_stick(
+	PVIGEM_ANALOG_PIPELINE Pipeline,
+	const SHORT* InX,
+	const SHORT* InY,
+	PFLOAT OutX,
+	PFLOAT OutY,
+	ULONG Begin,
+	ULONG End
+)
+{
+	const FLOAT inner = Pipeline->Config.StickInnerDeadzone;
+	const FLOAT range = (std::max)(Pipeline->Config.StickOuterDeadzone - inner, 1e-6f);
+
+	for (ULONG i = Begin; i < End; i++)
+	{
+		const FLOAT x = (std::max)(InX[i] / 32767.0f, -1.0f);
+		const FLOAT y = (std::max)(InY[i] / 32767.0f, -1.0f);
+		const FLOAT magnitude = std::sqrt(x * x + y * y);
+		const FLOAT shaped = vigem_internal_analog_shape(
+			magnitude, inner, range, Pipeline->StickBase, Pipeline->StickSlope
+		);
+		const FLOAT scale = magnitude > 1e-6f ? shaped / magnitude : 0.0f;
+
+		OutX[i] = vigem_internal_analog_clamp(x * scale, -1.0f, 1.0f);
+		OutY[i] = vigem_internal_analog_clamp(y * scale, -1.0f, 1.0f);
+	}
+}
+
+//
+// Deadzone and curve for one trigger, scalar reference path. Curve points
+// outside 0 - 1 are allowed, the result is clamped.
+//
+static void vigem_internal_analog_trigger(
+	PVIGEM_ANALOG_PIPELINE Pipeline,
+	const BYTE* In,
+	PFLOAT Out,
+	ULONG Begin,
+	ULONG End
+)
+{
+	const FLOAT inner = Pipeline->Config.TriggerInnerDeadzone;
+	const FLOAT range = (std::max)(Pipeline->Config.TriggerOuterDeadzone - inner, 1e-6f);
+
+	for (ULONG i = Begin; i < End; i++)
+	{
+		Out[i] = vigem_internal_analog_clamp(vigem_internal_analog_shape(
+			In[i] / 255.0f, inner, range, Pipeline->TriggerBase, Pipeline->TriggerSlope
+		), 0.0f, 1.0f);
+	}
+}
+
+#if defined(VIGEM_ANALOG_SSE2)
+
+//
+// Looks up four curve segments at once; SSE2 has no gather, so the indices
+// take a round-trip through memory.
+//
+static FORCEINLINE __m128 vigem_internal_analog_shape_sse2(
+	__m128 Magnitude,
+	__m128 Inner,
+	__m128 Range,
+	const FLOAT* Base,
+	const FLOAT* Slope
+)
+{
+	const __m128 rescaled = _mm_min_ps(
+		_mm_max_ps(_mm_div_ps(_mm_sub_ps(Magnitude, Inner), Range), _mm_setzero_ps()),
+		_mm_set1_ps(1.0f)
+	);
+	const __m128 position = _mm_mul_ps(rescaled, _mm_set1_ps(VIGEM_ANALOG_CURVE_POINTS - 1));
+	const __m128i index = _mm_cvttps_epi32(position);
+	const __m128 fraction = _mm_sub_ps(position, _mm_cvtepi32_ps(index));
+
+	alignas(16) int lanes[4];
+	_mm_store_si128(reinterpret_cast<__m128i*>(lanes), index);
+
+	const __m128 base = _mm_setr_ps(Base[lanes[0]], Base[lanes[1]], Base[lanes[2]], Base[lanes[3]]);
+	const __m128 slope = _mm_setr_ps(Slope[lanes[0]], Slope[lanes[1]], Slope[lanes[2]], Slope[lanes[3]]);
+
+	return _mm_add_ps(base, _mm_mul_ps(fraction, slope));
+}
+
+//
+// Sign-extends four SHORT values into floats.
+//
+static FORCEINLINE __m128 vigem_internal_analog_load_short_sse2(const SHORT* Values)
+{
+	const __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(Values));
+
+	return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16));
+}
+
+//
+// Zero-extends four BYTE values into floats.
+//
+static FORCEINLINE __m128 vigem_internal_analog_load_byte_sse2(const BYTE* Values)
+{
+	int packed;
+	RtlCopyMemory(&packed, Values, sizeof(packed));
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bytes = _mm_cvtsi32_si128(packed);
+
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero));
+}
+
+#endif
+
+//
+// EMA or One Euro filter over one channel. The first sample after a reset
+// primes the state and passes through unchanged.
+//
+static void vigem_internal_analog_filter(
+	PVIGEM_ANALOG_PIPELINE Pipeline,
+	ULONG Channel,
+	ULONG Count,
+	FLOAT Seconds
+)
+{
+	const PFLOAT value = Pipeline->Value[Channel];
+	const PFLOAT filtered = Pipeline->Filtered[Channel];
+	const PFLOAT derivative = Pipeline->Derivative[Channel];
+	const PFLOAT primed = Pipeline->Primed;
+	const VIGEM_ANALOG_CONFIG* config = &Pipeline->Config;
+	const FLOAT rate = Seconds > 1e-6f ? 1.0f / Seconds : 1e6f;
+	ULONG i = 0;
+
+	if (config->Filter == VIGEM_ANALOG_FILTER_EMA)
+	{
+		const FLOAT alpha = vigem_internal_analog_clamp(config->EmaAlpha, 0.0f, 1.0f);
+
+#if defined(VIGEM_ANALOG_SSE2)
+		const __m128 a = _mm_set1_ps(alpha);
+
+		for (; i + 4 <= Count; i += 4)
+		{
+			const __m128 x = _mm_load_ps(&value[i]);
+			const __m128 p = _mm_load_ps(&primed[i]);
+			const __m128 previous = _mm_load_ps(&filtered[i]);
+			// unprimed lanes take the sample as is
+			const __m128 blend = _mm_add_ps(_mm_mul_ps(p, a), _mm_sub_ps(_mm_set1_ps(1.0f), p));
+			const __m128 result = _mm_add_ps(previous, _mm_mul_ps(blend, _mm_sub_ps(x, previous)));
+
+			_mm_store_ps(&filtered[i], result);
+			_mm_store_ps(&value[i], result);
+		}
+#endif
+
+		for (; i < Count; i++)
+		{
+			const FLOAT blend = primed[i] != 0.0f ? alpha : 1.0f;
+
+			filtered[i] += blend * (value[i] - filtered[i]);
+			value[i] = filtered[i];
+		}
+
+		return;
+	}
+
+	//
+	// One Euro: the cutoff frequency rises with the (smoothed) speed of change.
+	// alpha(cutoff) = 1 / (1 + rate / (2 * pi * cutoff))
+	//
+	const FLOAT tauRate = rate / (2.0f * VIGEM_ANALOG_PI);
+	const FLOAT derivativeAlpha = 1.0f / (1.0f + tauRate / (std::max)(config->OneEuroDerivativeCutoff, 1e-6f));
+	const FLOAT minCutoff = (std::max)(config->OneEuroMinCutoff, 1e-6f);
+	const FLOAT beta = config->OneEuroBeta;
+
+#if defined(VIGEM_ANALOG_SSE2)
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	for (; i + 4 <= Count; i += 4)
+	{
+		const __m128 x = _mm_load_ps(&value[i]);
+		const __m128 p = _mm_load_ps(&primed[i]);
+		const __m128 previous = _mm_load_ps(&filtered[i]);
+		const __m128 dx = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(x, previous), _mm_set1_ps(rate)), p);
+		const __m128 previousDx = _mm_load_ps(&derivative[i]);
+		const __m128 edx = _mm_add_ps(previousDx, _mm_mul_ps(_mm_set1_ps(derivativeAlpha), _mm_sub_ps(dx, previousDx)));
+		const __m128 cutoff = _mm_add_ps(_mm_set1_ps(minCutoff), _mm_mul_ps(_mm_set1_ps(beta), _mm_and_ps(edx, absMask)));
+		const __m128 alpha = _mm_div_ps(one, _mm_add_ps(one, _mm_div_ps(_mm_set1_ps(tauRate), cutoff)));
+		const __m128 blend = _mm_add_ps(_mm_mul_ps(p, alpha), _mm_sub_ps(one, p));
+		const __m128 result = _mm_add_ps(previous, _mm_mul_ps(blend, _mm_sub_ps(x, previous)));
+
+		_mm_store_ps(&derivative[i], _mm_mul_ps(edx, p));
+		_mm_store_ps(&filtered[i], result);
+		_mm_store_ps(&value[i], result);
+	}
+#endif
+
+	for (; i < Count; i++)
+	{
+		const FLOAT x = value[i];
+
+		if (primed[i] == 0.0f)
+		{
+			derivative[i] = 0.0f;
+			filtered[i] = x;
+			continue;
+		}
+
+		const FLOAT dx = (x - filtered[i]) * rate;
+		const FLOAT edx = derivative[i] + derivativeAlpha * (dx - derivative[i]);
+		const FLOAT cutoff = minCutoff + beta * std::fabs(edx);
+		const FLOAT alpha = 1.0f / (1.0f + tauRate / cutoff);
+
+		derivative[i] = edx;
+		filtered[i] += alpha * (x - filtered[i]);
+		value[i] = filtered[i];
+	}
+}
+
+PVIGEM_ANALOG_PIPELINE vigem_analog_alloc(ULONG capacity)
+{
+	if (capacity == 0)
+		return nullptr;
+
+	const auto pipeline = static_cast<PVIGEM_ANALOG_PIPELINE>(vigem_internal_alloc(sizeof(VIGEM_ANALOG_PIPELINE)));
+
+	if (!pipeline)
+		return nullptr;
+
+	RtlZeroMemory(pipeline, sizeof(VIGEM_ANALOG_PIPELINE));
+
+	const SIZE_T padded = (static_cast<SIZE_T>(capacity) + 15) & ~static_cast<SIZE_T>(15);
+	const SIZE_T floatArrays = VIGEM_ANALOG_CHANNELS * 3 + 1;
+	const SIZE_T size = padded * (floatArrays * sizeof(FLOAT) + 4 * sizeof(SHORT) + 2 * sizeof(BYTE));
+
+	pipeline->Memory = vigem_internal_alloc_aligned(size, 64);
+
+	if (!pipeline->Memory)
+	{
+		vigem_internal_free(pipeline);
+		return nullptr;
+	}
+
+	RtlZeroMemory(pipeline->Memory, size);
+
+	auto cursor = static_cast<PUCHAR>(pipeline->Memory);
+	const auto carveFloats = [&cursor, padded]()
+	{
+		const auto result = reinterpret_cast<PFLOAT>(cursor);
+		cursor += padded * sizeof(FLOAT);
+		return result;
+	};
+
+	for (ULONG channel = 0; channel < VIGEM_ANALOG_CHANNELS; channel++)
+	{
+		pipeline->Value[channel] = carveFloats();
+		pipeline->Filtered[channel] = carveFloats();
+		pipeline->Derivative[channel] = carveFloats();
+	}
+
+	pipeline->Primed = carveFloats();
+
+	pipeline->Input.ThumbLX = reinterpret_cast<PSHORT>(cursor);
+	pipeline->Input.ThumbLY = pipeline->Input.ThumbLX + padded;
+	pipeline->Input.ThumbRX = pipeline->Input.ThumbLY + padded;
+	pipeline->Input.ThumbRY = pipeline->Input.ThumbRX + padded;
+	pipeline->Input.LeftTrigger = reinterpret_cast<PBYTE>(pipeline->Input.ThumbRY + padded);
+	pipeline->Input.RightTrigger = pipeline->Input.LeftTrigger + padded;
+
+	pipeline->Capacity = capacity;
+
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+	vigem_analog_set_config(pipeline, &config);
+
+	return pipeline;
+}
+
+void vigem_analog_free(PVIGEM_ANALOG_PIPELINE pipeline)
+{
+	if (pipeline)
+	{
+		vigem_internal_free(pipeline->Memory);
+
+		vigem_internal_free(pipeline);
+	}
+}
+
+VIGEM_ERROR vigem_analog_set_config(PVIGEM_ANALOG_PIPELINE pipeline, const VIGEM_ANALOG_CONFIG* config)
+{
+	if (!pipeline || !config || config->Size != sizeof(VIGEM_ANALOG_CONFIG))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (config->Filter > VIGEM_ANALOG_FILTER_ONE_EURO)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	// a single NaN point would poison every value interpolated from its segment
+	const FLOAT parameters[] =
+	{
+		config->StickInnerDeadzone, config->StickOuterDeadzone,
+		config->TriggerInnerDeadzone, config->TriggerOuterDeadzone,
+		config->EmaAlpha, config->OneEuroMinCutoff, config->OneEuroBeta, config->OneEuroDerivativeCutoff
+	};
+
+	if (!vigem_internal_analog_finite(config->StickCurve, VIGEM_ANALOG_CURVE_POINTS)
+		|| !vigem_internal_analog_finite(config->TriggerCurve, VIGEM_ANALOG_CURVE_POINTS)
+		|| !vigem_internal_analog_finite(parameters, sizeof(parameters) / sizeof(parameters[0])))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	pipeline->Config = *config;
+
+	vigem_internal_analog_build_curve(config->StickCurve, pipeline->StickBase, pipeline->StickSlope);
+	vigem_internal_analog_build_curve(config->TriggerCurve, pipeline->TriggerBase, pipeline->TriggerSlope);
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_analog_get_input(PVIGEM_ANALOG_PIPELINE pipeline, PVIGEM_ANALOG_INPUT input)
+{
+	if (!pipeline || !input)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	*input = pipeline->Input;
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_analog_load_xusb(PVIGEM_ANALOG_PIPELINE pipeline, const XUSB_REPORT* reports, ULONG count)
+{
+	if (!pipeline || !reports || count > pipeline->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		pipeline->Input.ThumbLX[i] = reports[i].sThumbLX;
+		pipeline->Input.ThumbLY[i] = reports[i].sThumbLY;
+		pipeline->Input.ThumbRX[i] = reports[i].sThumbRX;
+		pipeline->Input.ThumbRY[i] = reports[i].sThumbRY;
+		pipeline->Input.LeftTrigger[i] = reports[i].bLeftTrigger;
+		pipeline->Input.RightTrigger[i] = reports[i].bRightTrigger;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_analog_reset(PVIGEM_ANALOG_PIPELINE pipeline, ULONG index)
+{
+	if (!pipeline || index >= pipeline->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	pipeline->Primed[index] = 0.0f;
+
+	for (ULONG channel = 0; channel < VIGEM_ANALOG_CHANNELS; channel++)
+	{
+		pipeline->Filtered[channel][index] = 0.0f;
+		pipeline->Derivative[channel][index] = 0.0f;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_analog_process(PVIGEM_ANALOG_PIPELINE pipeline, ULONG count, FLOAT seconds)
+{
+	if (!pipeline || count > pipeline->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const VIGEM_ANALOG_INPUT* in = &pipeline->Input;
+	ULONG i = 0;
+
+#if defined(VIGEM_ANALOG_SSE2)
+	const __m128 stickInner = _mm_set1_ps(pipeline->Config.StickInnerDeadzone);
+	const __m128 stickRange = _mm_set1_ps(
+		(std::max)(pipeline->Config.StickOuterDeadzone - pipeline->Config.StickInnerDeadzone, 1e-6f)
+	);
+	const __m128 triggerInner = _mm_set1_ps(pipeline->Config.TriggerInnerDeadzone);
+	const __m128 triggerRange = _mm_set1_ps(
+		(std::max)(pipeline->Config.TriggerOuterDeadzone - pipeline->Config.TriggerInnerDeadzone, 1e-6f)
+	);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minusOne = _mm_set1_ps(-1.0f);
+	const __m128 axisScale = _mm_set1_ps(1.0f / 32767.0f);
+	const __m128 triggerScale = _mm_set1_ps(1.0f / 255.0f);
+	const __m128 epsilon = _mm_set1_ps(1e-6f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const SHORT* sticks[2][2] = {
+			{ &in->ThumbLX[i], &in->ThumbLY[i] },
+			{ &in->ThumbRX[i], &in->ThumbRY[i] }
+		};
+
+		for (ULONG stick = 0; stick < 2; stick++)
+		{
+			const __m128 x = _mm_max_ps(_mm_mul_ps(vigem_internal_analog_load_short_sse2(sticks[stick][0]), axisScale), minusOne);
+			const __m128 y = _mm_max_ps(_mm_mul_ps(vigem_internal_analog_load_short_sse2(sticks[stick][1]), axisScale), minusOne);
+			const __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+			const __m128 shaped = vigem_internal_analog_shape_sse2(
+				magnitude, stickInner, stickRange, pipeline->StickBase, pipeline->StickSlope
+			);
+			// zero magnitude lanes produce 0 instead of NaN
+			const __m128 scale = _mm_and_ps(
+				_mm_div_ps(shaped, _mm_max_ps(magnitude, epsilon)),
+				_mm_cmpgt_ps(magnitude, epsilon)
+			);
+
+			_mm_store_ps(&pipeline->Value[stick * 2 + 0][i], _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scale), minusOne), one));
+			_mm_store_ps(&pipeline->Value[stick * 2 + 1][i], _mm_min_ps(_mm_max_ps(_mm_mul_ps(y, scale), minusOne), one));
+		}
+
+		_mm_store_ps(&pipeline->Value[4][i], _mm_min_ps(_mm_max_ps(vigem_internal_analog_shape_sse2(
+			_mm_mul_ps(vigem_internal_analog_load_byte_sse2(&in->LeftTrigger[i]), triggerScale),
+			triggerInner, triggerRange, pipeline->TriggerBase, pipeline->TriggerSlope
+		), zero), one));
+		_mm_store_ps(&pipeline->Value[5][i], _mm_min_ps(_mm_max_ps(vigem_internal_analog_shape_sse2(
+			_mm_mul_ps(vigem_internal_analog_load_byte_sse2(&in->RightTrigger[i]), triggerScale),
+			triggerInner, triggerRange, pipeline->TriggerBase, pipeline->TriggerSlope
+		), zero), one));
+	}
+#endif
+
+	vigem_internal_analog_stick(pipeline, in->ThumbLX, in->ThumbLY, pipeline->Value[0], pipeline->Value[1], i, count);
+	vigem_internal_analog_stick(pipeline, in->ThumbRX, in->ThumbRY, pipeline->Value[2], pipeline->Value[3], i, count);
+	vigem_internal_analog_trigger(pipeline, in->LeftTrigger, pipeline->Value[4], i, count);
+	vigem_internal_analog_trigger(pipeline, in->RightTrigger, pipeline->Value[5], i, count);
+
+	if (pipeline->Config.Filter != VIGEM_ANALOG_FILTER_NONE)
+	{
+		for (ULONG channel = 0; channel < VIGEM_ANALOG_CHANNELS; channel++)
+		{
+			vigem_internal_analog_filter(pipeline, channel, count, seconds);
+		}
+
+		for (i = 0; i < count; i++)
+		{
+			pipeline->Primed[i] = 1.0f;
+		}
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_analog_store_xusb(PVIGEM_ANALOG_PIPELINE pipeline, PXUSB_REPORT reports, ULONG count)
+{
+	if (!pipeline || !reports || count > pipeline->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		reports[i].sThumbLX = static_cast<SHORT>(vigem_internal_analog_round(pipeline->Value[0][i], -1.0f, 1.0f, 32767.0f));
+		reports[i].sThumbLY = static_cast<SHORT>(vigem_internal_analog_round(pipeline->Value[1][i], -1.0f, 1.0f, 32767.0f));
+		reports[i].sThumbRX = static_cast<SHORT>(vigem_internal_analog_round(pipeline->Value[2][i], -1.0f, 1.0f, 32767.0f));
+		reports[i].sThumbRY = static_cast<SHORT>(vigem_internal_analog_round(pipeline->Value[3][i], -1.0f, 1.0f, 32767.0f));
+		reports[i].bLeftTrigger = static_cast<BYTE>(vigem_internal_analog_round(pipeline->Value[4][i], 0.0f, 1.0f, 255.0f));
+		reports[i].bRightTrigger = static_cast<BYTE>(vigem_internal_analog_round(pipeline->Value[5][i], 0.0f, 1.0f, 255.0f));
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_analog_store_ds4(PVIGEM_ANALOG_PIPELINE pipeline, PDS4_REPORT reports, ULONG count)
+{
+	if (!pipeline || !reports || count > pipeline->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		// DS4 axes are unsigned with 0x80 as center, Y grows downwards
+		reports[i].bThumbLX = static_cast<BYTE>(vigem_internal_analog_round(1.0f + pipeline->Value[0][i], 0.0f, 2.0f, 127.5f));
+		reports[i].bThumbLY = static_cast<BYTE>(vigem_internal_analog_round(1.0f - pipeline->Value[1][i], 0.0f, 2.0f, 127.5f));
+		reports[i].bThumbRX = static_cast<BYTE>(vigem_internal_analog_round(1.0f + pipeline->Value[2][i], 0.0f, 2.0f, 127.5f));
+		reports[i].bThumbRY = static_cast<BYTE>(vigem_internal_analog_round(1.0f - pipeline->Value[3][i], 0.0f, 2.0f, 127.5f));
+		reports[i].bTriggerL = static_cast<BYTE>(vigem_internal_analog_round(pipeline->Value[4][i], 0.0f, 1.0f, 255.0f));
+		reports[i].bTriggerR = static_cast<BYTE>(vigem_internal_analog_round(pipeline->Value[5][i], 0.0f, 1.0f, 255.0f));
+
+		reports[i].wButtons &= ~(DS4_BUTTON_TRIGGER_LEFT | DS4_BUTTON_TRIGGER_RIGHT);
+		reports[i].wButtons |= (reports[i].bTriggerL > 0) ? DS4_BUTTON_TRIGGER_LEFT : 0;
+		reports[i].wButtons |= (reports[i].bTriggerR > 0) ? DS4_BUTTON_TRIGGER_RIGHT : 0;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
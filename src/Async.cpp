@@ -0,0 +1,716 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Async.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "SimBus.h"
+#include "Async.h"
+#include "Log.h"
+#include "Memory.h"
+#include "Trace.h"
+
+
+//
+// Links an operation into the client's list, fails if the target is being
+// removed. Checked under the list lock, as removal marks the target before
+// completing the operations in the list.
+// 
+static BOOLEAN vigem_internal_async_link(PVIGEM_ASYNC_OP Op)
+{
+	const PVIGEM_CLIENT vigem = Op->Client;
+
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+
+	if (Op->Target->IsDisposing)
+	{
+		ReleaseSRWLockExclusive(&vigem->AsyncLock);
+		return FALSE;
+	}
+
+	Op->Prev = nullptr;
+	Op->Next = vigem->AsyncOps;
+
+	if (Op->Next)
+		Op->Next->Prev = Op;
+
+	vigem->AsyncOps = Op;
+	InterlockedIncrement(&vigem->AsyncPending);
+
+	if (Op->Owner != vigem)
+		InterlockedIncrement(&Op->Owner->AsyncPending);
+
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+
+	return TRUE;
+}
+
+//
+// Caller holds the list lock.
+// 
+static VOID vigem_internal_async_unlink(PVIGEM_ASYNC_OP Op)
+{
+	const PVIGEM_CLIENT vigem = Op->Client;
+
+	if (Op->Prev)
+		Op->Prev->Next = Op->Next;
+	else
+		vigem->AsyncOps = Op->Next;
+
+	if (Op->Next)
+		Op->Next->Prev = Op->Prev;
+
+	Op->Next = Op->Prev = nullptr;
+}
+
+static VOID vigem_internal_async_destroy(PVIGEM_ASYNC_OP Op)
+{
+	//
+	// Also fine from the wait's own callback, it's released once that returns
+	// 
+	if (Op->Wait)
+		CloseThreadpoolWait(Op->Wait);
+
+	if (Op->Overlapped.hEvent)
+		CloseHandle(Op->Overlapped.hEvent);
+
+	vigem_internal_free(Op);
+}
+
+//
+// Keeps a finished operation with its event and wait for the connection's
+// next one, so steady awaiting doesn't allocate.
+// 
+static VOID vigem_internal_async_free(PVIGEM_ASYNC_OP Op)
+{
+	const PVIGEM_CLIENT vigem = Op->Client;
+
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+
+	Op->Next = vigem->AsyncFree;
+	vigem->AsyncFree = Op;
+
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+}
+
+//
+// Frees an unlinked operation and calls its completion routine. The client
+// no longer counts it as pending by then, so the routine may disconnect.
+// The operation is back on the free list before that, for the disconnect
+// to find it.
+// 
+static VOID vigem_internal_async_complete(PVIGEM_ASYNC_OP Op, VIGEM_ERROR Error)
+{
+	const PVIGEM_CLIENT vigem = Op->Client;
+	const PVIGEM_CLIENT owner = Op->Owner;
+	const PVIGEM_TARGET target = Op->Target;
+	const PFN_VIGEM_ASYNC_COMPLETION completion = Op->Completion;
+	const LPVOID context = Op->Context;
+
+	vigem_internal_async_free(Op);
+
+	InterlockedDecrement(&vigem->AsyncPending);
+
+	if (owner != vigem)
+		InterlockedDecrement(&owner->AsyncPending);
+
+	completion(owner, target, Error, context);
+}
+
+//
+// Unlinks all operations matching the filter into a chain, then completes
+// them outside the lock.
+// 
+template <typename TFilter>
+static VOID vigem_internal_async_complete_all(PVIGEM_CLIENT vigem, VIGEM_ERROR Error, TFilter Filter)
+{
+	PVIGEM_ASYNC_OP chain = nullptr;
+
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+
+	for (PVIGEM_ASYNC_OP op = vigem->AsyncOps; op;)
+	{
+		const PVIGEM_ASYNC_OP next = op->Next;
+
+		if (Filter(op))
+		{
+			vigem_internal_async_unlink(op);
+			op->Next = chain;
+			chain = op;
+		}
+
+		op = next;
+	}
+
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+
+	while (chain)
+	{
+		const PVIGEM_ASYNC_OP op = chain;
+		chain = op->Next;
+
+		vigem_internal_async_complete(op, Error);
+	}
+}
+
+//
+// Issues the operation's current request and arms the wait for its event.
+// Returns FALSE if the request failed right away, in which case the event
+// may never be signalled.
+// 
+static BOOLEAN vigem_internal_async_issue(PVIGEM_ASYNC_OP Op, LPDWORD Error)
+{
+	DWORD transferred = 0;
+	const HANDLE event = Op->Overlapped.hEvent;
+	const BOOLEAN hasOutput = (Op->IoControlCode == IOCTL_XUSB_REQUEST_NOTIFICATION);
+
+	RtlZeroMemory(&Op->Overlapped, sizeof(OVERLAPPED));
+	Op->Overlapped.hEvent = event;
+	ResetEvent(event);
+
+	if (vigem_internal_io_control(
+		Op->Client,
+		Op->IoControlCode,
+		&Op->Request,
+		Op->Request.Plugin.Size,
+		hasOutput ? &Op->Request : nullptr,
+		hasOutput ? Op->Request.Plugin.Size : 0,
+		&transferred,
+		&Op->Overlapped
+	) || GetLastError() == ERROR_IO_PENDING)
+	{
+		SetThreadpoolWait(Op->Wait, event, nullptr);
+		return TRUE;
+	}
+
+	*Error = GetLastError();
+
+	return FALSE;
+}
+
+//
+// Advances an operation whose last request finished. Loops rather than
+// recursing for requests failing right away, like plug-ins of occupied
+// slots.
+// 
+static VOID vigem_internal_async_step(PVIGEM_ASYNC_OP Op, BOOL Succeeded, DWORD Error)
+{
+	const PVIGEM_CLIENT vigem = Op->Client;
+	const PVIGEM_TARGET target = Op->Target;
+	VIGEM_ERROR result;
+
+	do
+	{
+		if (Op->Type == VIGEM_ASYNC_X360_NOTIFICATION)
+		{
+			if (Succeeded)
+			{
+				const auto notification = static_cast<PVIGEM_X360_NOTIFICATION>(Op->Result);
+
+				notification->LargeMotor = Op->Request.Notification.LargeMotor;
+				notification->SmallMotor = Op->Request.Notification.SmallMotor;
+				notification->LedNumber = Op->Request.Notification.LedNumber;
+
+				result = VIGEM_ERROR_NONE;
+			}
+			else
+			{
+				result = (Error == ERROR_ACCESS_DENIED || Error == ERROR_OPERATION_ABORTED)
+					? VIGEM_ERROR_IS_DISPOSING
+					: VIGEM_ERROR_WINAPI;
+			}
+
+			break;
+		}
+
+		//
+		// Target add, same sequence as vigem_target_add
+		// 
+		if (!Op->WaitingReady)
+		{
+			if (Succeeded)
+			{
+				// balanced by the unplug, also if waiting fails below
+				InterlockedIncrement(&vigem->TargetCount);
+
+				vigem_internal_bus_own(vigem, target, Op->Owner);
+
+				Op->WaitingReady = TRUE;
+				Op->IoControlCode = IOCTL_VIGEM_WAIT_DEVICE_READY;
+				VIGEM_WAIT_DEVICE_READY_INIT(&Op->Request.Ready, target->SerialNo);
+			}
+			else if (Error == ERROR_OPERATION_ABORTED)
+			{
+				//
+				// Cancelled by disconnect, don't go on probing slots
+				// 
+				result = VIGEM_ERROR_IS_DISPOSING;
+				break;
+			}
+			else if (++target->SerialNo <= VIGEM_TARGETS_MAX)
+			{
+				VIGEM_PLUGIN_TARGET_INIT(&Op->Request.Plugin, target->SerialNo, target->Type);
+
+				Op->Request.Plugin.VendorId = target->VendorId;
+				Op->Request.Plugin.ProductId = target->ProductId;
+			}
+			else
+			{
+				result = VIGEM_ERROR_NO_FREE_SLOT;
+				break;
+			}
+
+			if (vigem_internal_async_issue(Op, &Error))
+				return;
+
+			Succeeded = FALSE;
+			continue;
+		}
+
+		if (Succeeded || Error == ERROR_INVALID_PARAMETER)
+		{
+			//
+			// Pre-v1.17 drivers don't know the wait request
+			// 
+			target->IsWaitReadyUnsupported = !Succeeded;
+			target->State = VIGEM_TARGET_CONNECTED;
+
+			result = VIGEM_ERROR_NONE;
+		}
+		else
+		{
+			//
+			// Don't leave device connected if the wait call failed
+			// 
+			result = vigem_target_remove(vigem, target);
+			vigem_internal_bus_own(vigem, target, nullptr);
+		}
+
+		if (VIGEM_SUCCESS(result))
+			vigem->pTargetsList[target->SerialNo] = target;
+
+		if (Op->Owner != vigem)
+			vigem_internal_bus_release(vigem, target, VIGEM_SUCCESS(result));
+
+		break;
+	} while (TRUE);
+
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+	vigem_internal_async_unlink(Op);
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+
+	vigem_internal_async_complete(Op, result);
+}
+
+static VOID CALLBACK vigem_internal_async_wait_callback(
+	PTP_CALLBACK_INSTANCE Instance,
+	PVOID Context,
+	PTP_WAIT Wait,
+	TP_WAIT_RESULT WaitResult
+)
+{
+	UNREFERENCED_PARAMETER(Instance);
+	UNREFERENCED_PARAMETER(Wait);
+	UNREFERENCED_PARAMETER(WaitResult);
+
+	const auto op = static_cast<PVIGEM_ASYNC_OP>(Context);
+	DWORD transferred = 0;
+
+	const BOOL succeeded = vigem_internal_get_overlapped_result(op->Client, &op->Overlapped, &transferred, FALSE);
+
+	vigem_internal_async_step(op, succeeded, succeeded ? ERROR_SUCCESS : GetLastError());
+}
+
+//
+// Takes an operation from the connection's free list or allocates one, with
+// an event and a thread pool wait for those issuing requests. Reused ones
+// keep theirs.
+// 
+static PVIGEM_ASYNC_OP vigem_internal_async_alloc(
+	VIGEM_ASYNC_TYPE Type,
+	PVIGEM_CLIENT vigem,
+	PVIGEM_CLIENT owner,
+	PVIGEM_TARGET target,
+	PVOID Result,
+	PFN_VIGEM_ASYNC_COMPLETION Completion,
+	LPVOID Context
+)
+{
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+
+	PVIGEM_ASYNC_OP op = vigem->AsyncFree;
+
+	if (op)
+		vigem->AsyncFree = op->Next;
+
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+
+	HANDLE event = nullptr;
+	PTP_WAIT wait = nullptr;
+
+	if (op)
+	{
+		event = op->Overlapped.hEvent;
+		wait = op->Wait;
+	}
+	else
+	{
+		op = static_cast<PVIGEM_ASYNC_OP>(vigem_internal_alloc(sizeof(VIGEM_ASYNC_OP)));
+
+		if (!op)
+			return nullptr;
+	}
+
+	RtlZeroMemory(op, sizeof(VIGEM_ASYNC_OP));
+
+	op->Type = Type;
+	op->Client = vigem;
+	op->Owner = owner;
+	op->Target = target;
+	op->Result = Result;
+	op->Completion = Completion;
+	op->Context = Context;
+
+	op->Overlapped.hEvent = event;
+	op->Wait = wait;
+
+	if (Type == VIGEM_ASYNC_DS4_OUTPUT_REPORT)
+		return op;
+
+	if (!op->Overlapped.hEvent)
+		op->Overlapped.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	if (!op->Wait)
+		op->Wait = CreateThreadpoolWait(vigem_internal_async_wait_callback, op, nullptr);
+
+	if (!op->Overlapped.hEvent || !op->Wait)
+	{
+		vigem_internal_async_destroy(op);
+		return nullptr;
+	}
+
+	return op;
+}
+
+//
+// Links and issues the first request of an operation.
+// 
+static VIGEM_ERROR vigem_internal_async_start(PVIGEM_ASYNC_OP Op)
+{
+	if (!vigem_internal_async_link(Op))
+	{
+		vigem_internal_async_free(Op);
+		return VIGEM_ERROR_IS_DISPOSING;
+	}
+
+	DWORD error;
+
+	if (!vigem_internal_async_issue(Op, &error))
+		vigem_internal_async_step(Op, FALSE, error);
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_target_add_async_ex(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PFN_VIGEM_ASYNC_COMPLETION completion,
+	LPVOID context
+)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_NOT_FOUND;
+
+	if (target->State == VIGEM_TARGET_NEW)
+		return VIGEM_ERROR_TARGET_UNINITIALIZED;
+
+	if (target->State == VIGEM_TARGET_CONNECTED)
+		return VIGEM_ERROR_ALREADY_CONNECTED;
+
+	if (!completion)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const PVIGEM_CLIENT bus = vigem->Buses ? vigem_internal_bus_reserve(vigem) : vigem;
+	const PVIGEM_ASYNC_OP op = vigem_internal_async_alloc(VIGEM_ASYNC_TARGET_ADD, bus, vigem, target, nullptr, completion, context);
+
+	if (!op)
+	{
+		if (bus != vigem)
+			vigem_internal_bus_release(bus, target, FALSE);
+
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	VIGEM_TRACE_INSTANT("target_add_async", 0);
+
+	target->SerialNo = 1;
+
+	op->IoControlCode = IOCTL_VIGEM_PLUGIN_TARGET;
+	VIGEM_PLUGIN_TARGET_INIT(&op->Request.Plugin, target->SerialNo, target->Type);
+
+	op->Request.Plugin.VendorId = target->VendorId;
+	op->Request.Plugin.ProductId = target->ProductId;
+
+	const VIGEM_ERROR error = vigem_internal_async_start(op);
+
+	// otherwise released once the add completed
+	if (!VIGEM_SUCCESS(error) && bus != vigem)
+		vigem_internal_bus_release(bus, target, FALSE);
+
+	return error;
+}
+
+VIGEM_ERROR vigem_target_x360_await_notification_async(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PVIGEM_X360_NOTIFICATION notification,
+	PFN_VIGEM_ASYNC_COMPLETION completion,
+	LPVOID context
+)
+{
+	const PVIGEM_CLIENT owner = vigem;
+	vigem = vigem_internal_bus(vigem, target);
+
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_NOT_FOUND;
+
+	if (target->SerialNo == 0 || target->Type != Xbox360Wired)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (!notification || !completion)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const PVIGEM_ASYNC_OP op = vigem_internal_async_alloc(
+		VIGEM_ASYNC_X360_NOTIFICATION,
+		vigem,
+		owner,
+		target,
+		notification,
+		completion,
+		context
+	);
+
+	if (!op)
+		return VIGEM_ERROR_WINAPI;
+
+	op->IoControlCode = IOCTL_XUSB_REQUEST_NOTIFICATION;
+	XUSB_REQUEST_NOTIFICATION_INIT(&op->Request.Notification, target->SerialNo);
+
+	return vigem_internal_async_start(op);
+}
+
+VIGEM_ERROR vigem_target_ds4_await_output_report_async(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PDS4_OUTPUT_BUFFER buffer,
+	PFN_VIGEM_ASYNC_COMPLETION completion,
+	LPVOID context
+)
+{
+	const PVIGEM_CLIENT owner = vigem;
+	vigem = vigem_internal_bus(vigem, target);
+
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_NOT_FOUND;
+
+	if (target->SerialNo == 0 || target->Type != DualShock4Wired)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (!buffer || !completion)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const PVIGEM_ASYNC_OP op = vigem_internal_async_alloc(
+		VIGEM_ASYNC_DS4_OUTPUT_REPORT,
+		vigem,
+		owner,
+		target,
+		buffer,
+		completion,
+		context
+	);
+
+	if (!op)
+		return VIGEM_ERROR_WINAPI;
+
+	//
+	// Completed by the output report thread or on removal
+	// 
+	if (!vigem_internal_async_link(op))
+	{
+		vigem_internal_async_free(op);
+		return VIGEM_ERROR_IS_DISPOSING;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VOID vigem_internal_async_ds4_output(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, const DS4_OUTPUT_BUFFER* report)
+{
+	if (!vigem->AsyncOps)
+		return;
+
+	PVIGEM_ASYNC_OP chain = nullptr;
+
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+
+	for (PVIGEM_ASYNC_OP op = vigem->AsyncOps; op;)
+	{
+		const PVIGEM_ASYNC_OP next = op->Next;
+
+		if (op->Type == VIGEM_ASYNC_DS4_OUTPUT_REPORT && op->Target == target)
+		{
+			vigem_internal_async_unlink(op);
+			op->Next = chain;
+			chain = op;
+		}
+
+		op = next;
+	}
+
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+
+	while (chain)
+	{
+		const PVIGEM_ASYNC_OP op = chain;
+		chain = op->Next;
+
+		RtlCopyMemory(op->Result, report, sizeof(DS4_OUTPUT_BUFFER));
+		vigem_internal_async_complete(op, VIGEM_ERROR_NONE);
+	}
+}
+
+VOID vigem_internal_async_target_removed(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	vigem_internal_async_complete_all(vigem, VIGEM_ERROR_IS_DISPOSING, [target](PVIGEM_ASYNC_OP Op)
+	{
+		return Op->Type == VIGEM_ASYNC_DS4_OUTPUT_REPORT && Op->Target == target;
+	});
+}
+
+//
+// Cancels the operations started through owner, all of them if it's NULL,
+// and waits until the owner no longer counts any as pending.
+// 
+static VOID vigem_internal_async_cancel(PVIGEM_CLIENT vigem, PVIGEM_CLIENT owner)
+{
+	const auto owned = [owner](PVIGEM_ASYNC_OP Op)
+	{
+		return !owner || Op->Owner == owner;
+	};
+
+	vigem_internal_async_complete_all(vigem, VIGEM_ERROR_IS_DISPOSING, [owned](PVIGEM_ASYNC_OP Op)
+	{
+		return Op->Type == VIGEM_ASYNC_DS4_OUTPUT_REPORT && owned(Op);
+	});
+
+	const PVIGEM_CLIENT counting = owner ? owner : vigem;
+
+	//
+	// Requests complete as cancelled through the thread pool. A target add may
+	// issue its next request meanwhile, so cancel again until none is left.
+	// 
+	while (counting->AsyncPending != 0)
+	{
+		AcquireSRWLockShared(&vigem->AsyncLock);
+
+		for (PVIGEM_ASYNC_OP op = vigem->AsyncOps; op; op = op->Next)
+		{
+			if (owned(op))
+				vigem_internal_cancel_io(vigem, &op->Overlapped);
+		}
+
+		ReleaseSRWLockShared(&vigem->AsyncLock);
+
+		Sleep(1);
+	}
+
+	VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Cancelled asynchronous operations of 0x%p", counting);
+}
+
+VOID vigem_internal_async_cancel_all(PVIGEM_CLIENT vigem)
+{
+	vigem_internal_async_cancel(vigem, nullptr);
+}
+
+VOID vigem_internal_async_cancel_owned(PVIGEM_CLIENT vigem, PVIGEM_CLIENT owner)
+{
+	vigem_internal_async_cancel(vigem, owner);
+}
+
+VOID vigem_internal_async_release(PVIGEM_CLIENT vigem)
+{
+	AcquireSRWLockExclusive(&vigem->AsyncLock);
+
+	PVIGEM_ASYNC_OP op = vigem->AsyncFree;
+	vigem->AsyncFree = nullptr;
+
+	ReleaseSRWLockExclusive(&vigem->AsyncLock);
+
+	while (op)
+	{
+		const PVIGEM_ASYNC_OP next = op->Next;
+
+		vigem_internal_async_destroy(op);
+
+		op = next;
+	}
+}
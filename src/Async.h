@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ViGEm/Async.h"
+
+typedef enum _VIGEM_ASYNC_TYPE
+{
+    VIGEM_ASYNC_TARGET_ADD,
+    VIGEM_ASYNC_X360_NOTIFICATION,
+    VIGEM_ASYNC_DS4_OUTPUT_REPORT
+} VIGEM_ASYNC_TYPE;
+
+//
+// An operation started by one of the *_async functions. Linked into the
+// client's list until it completes, so disconnecting can cancel it.
+//
+typedef struct _VIGEM_ASYNC_OP_T
+{
+    struct _VIGEM_ASYNC_OP_T* Next;
+    struct _VIGEM_ASYNC_OP_T* Prev;
+    VIGEM_ASYNC_TYPE Type;
+    PVIGEM_CLIENT Client;
+    //
+    // Client the operation was started through and is completed to, the one
+    // owning Client's bus unless they're the same. Counts it as pending too.
+    //
+    PVIGEM_CLIENT Owner;
+    PVIGEM_TARGET Target;
+    PFN_VIGEM_ASYNC_COMPLETION Completion;
+    LPVOID Context;
+    //
+    // Caller's buffer receiving the notification or output report
+    //
+    PVOID Result;
+
+    //
+    // Request currently issued, continued from the thread pool once its
+    // event is signalled. Unused for DS4 output reports, which are handed
+    // over by the output report thread.
+    //
+    OVERLAPPED Overlapped;
+    PTP_WAIT Wait;
+    DWORD IoControlCode;
+    BOOLEAN WaitingReady;
+    union
+    {
+        VIGEM_PLUGIN_TARGET Plugin;
+        VIGEM_WAIT_DEVICE_READY Ready;
+        XUSB_REQUEST_NOTIFICATION Notification;
+    } Request;
+} VIGEM_ASYNC_OP, *PVIGEM_ASYNC_OP;
+
+//
+// Hands a DS4 output report to the target's asynchronous waiters, called by
+// the output report thread.
+//
+VOID vigem_internal_async_ds4_output(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, const DS4_OUTPUT_BUFFER* report);
+
+//
+// Completes the target's asynchronous DS4 output report waiters with
+// VIGEM_ERROR_IS_DISPOSING, called once the target is unplugged.
+//
+VOID vigem_internal_async_target_removed(PVIGEM_CLIENT vigem, PVIGEM_TARGET target);
+
+//
+// Cancels all pending operations and waits until they completed. Called on
+// disconnect while the bus is still open.
+//
+VOID vigem_internal_async_cancel_all(PVIGEM_CLIENT vigem);
+
+//
+// Cancels the operations of a shared connection started through one of the
+// attached clients and waits until they completed.
+//
+VOID vigem_internal_async_cancel_owned(PVIGEM_CLIENT vigem, PVIGEM_CLIENT owner);
+
+//
+// Frees the operations kept for reuse, once all of them completed.
+//
+VOID vigem_internal_async_release(PVIGEM_CLIENT vigem);
@@ -0,0 +1,651 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Capture.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "Capture.h"
+#include "Memory.h"
+#include "Thread.h"
+
+
+//
+// pcapng block types and options used
+// 
+#define PCAPNG_SECTION_HEADER_BLOCK     0x0A0D0D0A
+#define PCAPNG_INTERFACE_BLOCK          0x00000001
+#define PCAPNG_STATISTICS_BLOCK         0x00000005
+#define PCAPNG_ENHANCED_PACKET_BLOCK    0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC         0x1A2B3C4D
+#define PCAPNG_OPT_END                  0
+#define PCAPNG_OPT_SHB_USERAPPL         4
+#define PCAPNG_OPT_IF_NAME              2
+#define PCAPNG_OPT_IF_TSRESOL           9
+#define PCAPNG_OPT_ISB_IFDROP           5
+
+//
+// Enhanced Packet Block without packet data: type, length, interface,
+// timestamp (2), captured and original length plus the trailing length
+// 
+#define PCAPNG_EPB_OVERHEAD             (8 * sizeof(ULONG))
+
+//
+// How often the writer thread writes out a partially filled buffer
+// 
+#define VIGEM_CAPTURE_FLUSH_INTERVAL_MS 100
+
+#pragma region pcapng writing
+
+//
+// Appends to a block being built in memory. Every block and option is
+// padded to 32 bits.
+// 
+typedef struct _VIGEM_CAPTURE_BLOCK
+{
+	UCHAR Data[128];
+	ULONG Length;
+
+	VOID Put(const VOID* Source, ULONG Size)
+	{
+		RtlCopyMemory(&Data[Length], Source, Size);
+		Length += Size;
+
+		while (Length % 4)
+			Data[Length++] = 0;
+	}
+
+	VOID Put32(ULONG Value)
+	{
+		Put(&Value, sizeof(Value));
+	}
+
+	VOID PutOption(USHORT Code, const VOID* Value, USHORT Size)
+	{
+		const USHORT header[2] = { Code, Size };
+		Put(header, sizeof(header));
+
+		if (Size)
+			Put(Value, Size);
+	}
+
+	//
+	// Starts a block, the length is filled in by End
+	// 
+	VOID Begin(ULONG Type)
+	{
+		Length = 0;
+		Put32(Type);
+		Put32(0);
+	}
+
+	VOID End()
+	{
+		Put32(Length + sizeof(ULONG));
+		RtlCopyMemory(&Data[sizeof(ULONG)], &Length, sizeof(ULONG));
+	}
+} VIGEM_CAPTURE_BLOCK;
+
+static BOOLEAN vigem_internal_capture_write(HANDLE hFile, const VOID* Data, SIZE_T Size)
+{
+	DWORD written = 0;
+
+	return WriteFile(hFile, Data, static_cast<DWORD>(Size), &written, nullptr) && written == Size;
+}
+
+static BOOLEAN vigem_internal_capture_write_headers(HANDLE hFile)
+{
+	static const char application[] = "ViGEmClient";
+	static const char interfaceName[] = "ViGEm bus";
+	const UCHAR nanoseconds = 9;
+	VIGEM_CAPTURE_BLOCK block;
+
+	block.Begin(PCAPNG_SECTION_HEADER_BLOCK);
+	block.Put32(PCAPNG_BYTE_ORDER_MAGIC);
+	block.Put32(0x00000001); // major version 1, minor 0
+	block.Put32(0xFFFFFFFF); // section length unknown
+	block.Put32(0xFFFFFFFF);
+	block.PutOption(PCAPNG_OPT_SHB_USERAPPL, application, sizeof(application) - 1);
+	block.PutOption(PCAPNG_OPT_END, nullptr, 0);
+	block.End();
+
+	if (!vigem_internal_capture_write(hFile, block.Data, block.Length))
+		return FALSE;
+
+	block.Begin(PCAPNG_INTERFACE_BLOCK);
+	block.Put32(VIGEM_CAPTURE_LINKTYPE); // link type, reserved
+	block.Put32(0); // no snap length
+	block.PutOption(PCAPNG_OPT_IF_NAME, interfaceName, sizeof(interfaceName) - 1);
+	block.PutOption(PCAPNG_OPT_IF_TSRESOL, &nanoseconds, sizeof(nanoseconds));
+	block.PutOption(PCAPNG_OPT_END, nullptr, 0);
+	block.End();
+
+	return vigem_internal_capture_write(hFile, block.Data, block.Length);
+}
+
+static BOOLEAN vigem_internal_capture_write_statistics(PVIGEM_CAPTURE Capture, ULONGLONG Timestamp)
+{
+	VIGEM_CAPTURE_BLOCK block;
+
+	block.Begin(PCAPNG_STATISTICS_BLOCK);
+	block.Put32(0); // interface
+	block.Put32(static_cast<ULONG>(Timestamp >> 32));
+	block.Put32(static_cast<ULONG>(Timestamp));
+	block.PutOption(PCAPNG_OPT_ISB_IFDROP, &Capture->DroppedPackets, sizeof(Capture->DroppedPackets));
+	block.PutOption(PCAPNG_OPT_END, nullptr, 0);
+	block.End();
+
+	return vigem_internal_capture_write(Capture->hFile, block.Data, block.Length);
+}
+
+#pragma endregion
+
+static FORCEINLINE ULONGLONG vigem_internal_capture_timestamp(PVIGEM_CAPTURE Capture)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	return Capture->BaseNanoseconds
+		+ static_cast<ULONGLONG>((now.QuadPart - Capture->BaseCounter) * Capture->NanosecondsPerTick);
+}
+
+//
+// Hands the buffer being filled to the writer thread. Called with the lock
+// held, fails if the writer thread hasn't freed the next buffer yet.
+// 
+static BOOLEAN vigem_internal_capture_rotate(PVIGEM_CAPTURE Capture)
+{
+	if (Capture->FillIndex + 1 - Capture->WriteIndex >= VIGEM_CAPTURE_BUFFERS)
+		return FALSE;
+
+	Capture->Filled[Capture->FillIndex % VIGEM_CAPTURE_BUFFERS] = Capture->Used;
+	Capture->FillIndex++;
+	Capture->Used = 0;
+
+	return TRUE;
+}
+
+//
+// Appends a packet as an Enhanced Packet Block.
+// 
+static VOID vigem_internal_capture_append(
+	PVIGEM_CAPTURE Capture,
+	const VIGEM_CAPTURE_PACKET& Packet,
+	const VOID* Payload,
+	ULONG PayloadSize
+)
+{
+	const ULONGLONG timestamp = vigem_internal_capture_timestamp(Capture);
+
+	if (PayloadSize > VIGEM_CAPTURE_MAX_PAYLOAD)
+		PayloadSize = VIGEM_CAPTURE_MAX_PAYLOAD;
+
+	const ULONG captured = sizeof(VIGEM_CAPTURE_PACKET) + PayloadSize;
+	const ULONG padded = (captured + 3) & ~3UL;
+	const ULONG blockLength = PCAPNG_EPB_OVERHEAD + padded;
+
+	EnterCriticalSection(&Capture->Lock);
+
+	if (Capture->Used + blockLength > VIGEM_CAPTURE_BUFFER_SIZE)
+	{
+		if (!vigem_internal_capture_rotate(Capture))
+		{
+			Capture->DroppedPackets++;
+			LeaveCriticalSection(&Capture->Lock);
+			return;
+		}
+
+		SetEvent(Capture->hWake);
+	}
+
+	const PUCHAR block = Capture->Buffers[Capture->FillIndex % VIGEM_CAPTURE_BUFFERS] + Capture->Used;
+	const ULONG fields[] =
+	{
+		PCAPNG_ENHANCED_PACKET_BLOCK,
+		blockLength,
+		0, // interface
+		static_cast<ULONG>(timestamp >> 32),
+		static_cast<ULONG>(timestamp),
+		captured,
+		captured
+	};
+
+	RtlCopyMemory(block, fields, sizeof(fields));
+	RtlCopyMemory(block + sizeof(fields), &Packet, sizeof(VIGEM_CAPTURE_PACKET));
+
+	if (PayloadSize)
+		RtlCopyMemory(block + sizeof(fields) + sizeof(VIGEM_CAPTURE_PACKET), Payload, PayloadSize);
+
+	RtlZeroMemory(block + sizeof(fields) + captured, padded - captured);
+	RtlCopyMemory(block + blockLength - sizeof(ULONG), &blockLength, sizeof(ULONG));
+
+	Capture->Used += blockLength;
+
+	LeaveCriticalSection(&Capture->Lock);
+}
+
+//
+// Writes out full buffers, and every VIGEM_CAPTURE_FLUSH_INTERVAL_MS the
+// partially filled one, until the capture is stopped.
+// 
+static DWORD WINAPI vigem_internal_capture_writer(LPVOID Parameter)
+{
+	const auto capture = static_cast<PVIGEM_CAPTURE>(Parameter);
+	BOOLEAN stopping;
+
+	vigem_internal_thread_start(&capture->ThreadConfig, capture->Client, VIGEM_THREAD_CAPTURE_WRITER);
+
+	do
+	{
+		WaitForSingleObject(capture->hWake, VIGEM_CAPTURE_FLUSH_INTERVAL_MS);
+
+		// read first, the last pass must see everything appended before the stop
+		stopping = capture->Stop;
+
+		EnterCriticalSection(&capture->Lock);
+
+		if (capture->Used)
+			vigem_internal_capture_rotate(capture);
+
+		const LONGLONG fillIndex = capture->FillIndex;
+
+		LeaveCriticalSection(&capture->Lock);
+
+		for (LONGLONG index = capture->WriteIndex; index < fillIndex; index++)
+		{
+			const ULONG buffer = static_cast<ULONG>(index % VIGEM_CAPTURE_BUFFERS);
+
+			if (!vigem_internal_capture_write(capture->hFile, capture->Buffers[buffer], capture->Filled[buffer]))
+				capture->WriteFailed = TRUE;
+
+			InterlockedExchange64(&capture->WriteIndex, index + 1);
+		}
+	} while (!stopping);
+
+	return 0;
+}
+
+static VOID vigem_internal_capture_free_entries(PVIGEM_CAPTURE_IN_FLIGHT Entry)
+{
+	while (Entry)
+	{
+		const PVIGEM_CAPTURE_IN_FLIGHT next = Entry->Next;
+		vigem_internal_free(Entry);
+		Entry = next;
+	}
+}
+
+static VOID vigem_internal_capture_free(PVIGEM_CAPTURE Capture)
+{
+	if (Capture->hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(Capture->hFile);
+
+	if (Capture->hWake)
+		CloseHandle(Capture->hWake);
+
+	for (ULONG buffer = 0; buffer < VIGEM_CAPTURE_BUFFERS; buffer++)
+		vigem_internal_free(Capture->Buffers[buffer]);
+
+	vigem_internal_capture_free_entries(Capture->InFlight);
+	vigem_internal_capture_free_entries(Capture->InFlightFree);
+
+	DeleteCriticalSection(&Capture->Lock);
+	vigem_internal_free(Capture);
+}
+
+#pragma region Transport hooks
+
+//
+// Remembers a request until its completion or cancellation is captured,
+// which may happen on another thread. An OVERLAPPED is reused once its
+// request finished, so an entry left behind by a request failing right
+// away is taken over rather than shadowing the new one.
+// 
+static VOID vigem_internal_capture_track(
+	PVIGEM_CAPTURE Capture,
+	LPOVERLAPPED Overlapped,
+	const VIGEM_CAPTURE_PACKET& Packet,
+	LPVOID OutBuffer,
+	DWORD OutBufferSize
+)
+{
+	AcquireSRWLockExclusive(&Capture->InFlightLock);
+
+	PVIGEM_CAPTURE_IN_FLIGHT entry = Capture->InFlight;
+
+	while (entry && entry->Overlapped != Overlapped)
+		entry = entry->Next;
+
+	if (!entry)
+	{
+		entry = Capture->InFlightFree;
+
+		if (entry)
+			Capture->InFlightFree = entry->Next;
+		else
+			entry = static_cast<PVIGEM_CAPTURE_IN_FLIGHT>(vigem_internal_alloc(sizeof(VIGEM_CAPTURE_IN_FLIGHT)));
+
+		if (entry)
+		{
+			entry->Next = Capture->InFlight;
+			Capture->InFlight = entry;
+		}
+	}
+
+	if (entry)
+	{
+		entry->Overlapped = Overlapped;
+		entry->RequestId = Packet.RequestId;
+		entry->IoControlCode = Packet.IoControlCode;
+		entry->SerialNo = Packet.SerialNo;
+		entry->OutBuffer = OutBuffer;
+		entry->OutBufferSize = OutBufferSize;
+	}
+
+	ReleaseSRWLockExclusive(&Capture->InFlightLock);
+}
+
+VOID vigem_internal_capture_request(
+	PVIGEM_CLIENT vigem,
+	DWORD IoControlCode,
+	LPCVOID InBuffer,
+	DWORD InBufferSize,
+	LPVOID OutBuffer,
+	DWORD OutBufferSize,
+	LPOVERLAPPED Overlapped
+)
+{
+	//
+	// vigem_capture_stop waits for this count to drop to zero before it frees
+	// the capture, so it stays valid until we're done
+	// 
+	InterlockedIncrement(&vigem->CaptureWriters);
+
+	const PVIGEM_CAPTURE capture = vigem->Capture;
+
+	if (capture)
+	{
+		VIGEM_CAPTURE_PACKET packet = {};
+
+		packet.Event = VIGEM_CAPTURE_REQUEST;
+		packet.Simulated = (vigem->SimBus != nullptr);
+		packet.RequestId = static_cast<ULONG>(InterlockedIncrement(&capture->NextRequestId));
+		packet.IoControlCode = IoControlCode;
+		packet.Length = InBufferSize;
+
+		// every bus request but the version check starts with Size and SerialNo
+		if (IoControlCode != IOCTL_VIGEM_CHECK_VERSION && InBuffer && InBufferSize >= 2 * sizeof(ULONG))
+			packet.SerialNo = static_cast<const ULONG*>(InBuffer)[1];
+
+		vigem_internal_capture_track(capture, Overlapped, packet, OutBuffer, OutBufferSize);
+
+		vigem_internal_capture_append(capture, packet, InBuffer, InBuffer ? InBufferSize : 0);
+	}
+
+	InterlockedDecrement(&vigem->CaptureWriters);
+}
+
+//
+// Takes the in-flight entry of a request off the capture's list.
+// 
+static BOOLEAN vigem_internal_capture_take(PVIGEM_CAPTURE Capture, LPOVERLAPPED Overlapped, VIGEM_CAPTURE_IN_FLIGHT& Entry)
+{
+	BOOLEAN found = FALSE;
+
+	AcquireSRWLockExclusive(&Capture->InFlightLock);
+
+	for (PVIGEM_CAPTURE_IN_FLIGHT* link = &Capture->InFlight; *link; link = &(*link)->Next)
+	{
+		const PVIGEM_CAPTURE_IN_FLIGHT entry = *link;
+
+		if (entry->Overlapped == Overlapped)
+		{
+			*link = entry->Next;
+
+			Entry = *entry;
+			entry->Next = Capture->InFlightFree;
+			Capture->InFlightFree = entry;
+
+			found = TRUE;
+			break;
+		}
+	}
+
+	ReleaseSRWLockExclusive(&Capture->InFlightLock);
+
+	return found;
+}
+
+VOID vigem_internal_capture_completion(
+	PVIGEM_CLIENT vigem,
+	LPOVERLAPPED Overlapped,
+	BOOL Result,
+	DWORD BytesTransferred
+)
+{
+	const DWORD status = Result ? ERROR_SUCCESS : GetLastError();
+
+	// polled and still pending, nothing completed
+	if (status == ERROR_IO_INCOMPLETE)
+		return;
+
+	InterlockedIncrement(&vigem->CaptureWriters);
+
+	const PVIGEM_CAPTURE capture = vigem->Capture;
+	VIGEM_CAPTURE_IN_FLIGHT entry = {};
+
+	if (capture && vigem_internal_capture_take(capture, Overlapped, entry))
+	{
+		VIGEM_CAPTURE_PACKET packet = {};
+		const DWORD filled = (BytesTransferred < entry.OutBufferSize) ? BytesTransferred : entry.OutBufferSize;
+
+		packet.Event = VIGEM_CAPTURE_COMPLETION;
+		packet.Simulated = (vigem->SimBus != nullptr);
+		packet.RequestId = entry.RequestId;
+		packet.IoControlCode = entry.IoControlCode;
+		packet.SerialNo = entry.SerialNo;
+		packet.Status = status;
+		packet.Length = filled;
+
+		// the bus reports the target of a DS4 output report in the output buffer
+		if (entry.IoControlCode == IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE && Result && filled >= 2 * sizeof(ULONG))
+			packet.SerialNo = static_cast<const ULONG*>(entry.OutBuffer)[1];
+
+		vigem_internal_capture_append(capture, packet, entry.OutBuffer, Result ? filled : 0);
+	}
+
+	InterlockedDecrement(&vigem->CaptureWriters);
+
+	SetLastError(status);
+}
+
+VOID vigem_internal_capture_cancel(
+	PVIGEM_CLIENT vigem,
+	LPOVERLAPPED Overlapped
+)
+{
+	InterlockedIncrement(&vigem->CaptureWriters);
+
+	const PVIGEM_CAPTURE capture = vigem->Capture;
+	VIGEM_CAPTURE_IN_FLIGHT entry = {};
+
+	if (capture && vigem_internal_capture_take(capture, Overlapped, entry))
+	{
+		VIGEM_CAPTURE_PACKET packet = {};
+
+		packet.Event = VIGEM_CAPTURE_CANCEL;
+		packet.Simulated = (vigem->SimBus != nullptr);
+		packet.RequestId = entry.RequestId;
+		packet.IoControlCode = entry.IoControlCode;
+		packet.SerialNo = entry.SerialNo;
+
+		vigem_internal_capture_append(capture, packet, nullptr, 0);
+	}
+
+	InterlockedDecrement(&vigem->CaptureWriters);
+}
+
+#pragma endregion
+
+VIGEM_ERROR vigem_capture_start(PVIGEM_CLIENT vigem, LPCWSTR path)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!path)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	// requests go out on the session's connection, which isn't captured
+	if (vigem->Session)
+		return VIGEM_ERROR_NOT_SUPPORTED;
+
+	if (vigem->Capture)
+		return VIGEM_ERROR_ALREADY_CONNECTED;
+
+	const auto capture = static_cast<PVIGEM_CAPTURE>(vigem_internal_alloc(sizeof(VIGEM_CAPTURE)));
+
+	if (!capture)
+		return VIGEM_ERROR_WINAPI;
+
+	RtlZeroMemory(capture, sizeof(VIGEM_CAPTURE));
+	InitializeCriticalSection(&capture->Lock);
+
+	capture->Client = vigem;
+	capture->ThreadConfig = vigem->ThreadConfigs[VIGEM_THREAD_CAPTURE_WRITER];
+
+	capture->hWake = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	capture->hFile = CreateFileW(
+		path,
+		GENERIC_WRITE,
+		FILE_SHARE_READ,
+		nullptr,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+
+	BOOLEAN ready = capture->hWake && capture->hFile != INVALID_HANDLE_VALUE;
+
+	for (ULONG buffer = 0; ready && buffer < VIGEM_CAPTURE_BUFFERS; buffer++)
+	{
+		capture->Buffers[buffer] = static_cast<PUCHAR>(vigem_internal_alloc(VIGEM_CAPTURE_BUFFER_SIZE));
+		ready = (capture->Buffers[buffer] != nullptr);
+	}
+
+	if (!ready || !vigem_internal_capture_write_headers(capture->hFile))
+	{
+		vigem_internal_capture_free(capture);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	//
+	// pcapng timestamps count from the Unix epoch, FILETIME from 1601
+	// 
+	FILETIME now;
+	LARGE_INTEGER frequency, counter;
+
+	GetSystemTimeAsFileTime(&now);
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	ULARGE_INTEGER fileTime;
+	fileTime.LowPart = now.dwLowDateTime;
+	fileTime.HighPart = now.dwHighDateTime;
+
+	capture->BaseCounter = counter.QuadPart;
+	capture->BaseNanoseconds = (fileTime.QuadPart - 116444736000000000ULL) * 100;
+	capture->NanosecondsPerTick = 1e9 / static_cast<DOUBLE>(frequency.QuadPart);
+
+	capture->hThread = CreateThread(nullptr, 0, vigem_internal_capture_writer, capture, 0, nullptr);
+
+	if (!capture->hThread)
+	{
+		vigem_internal_capture_free(capture);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	if (InterlockedCompareExchangePointer(
+		reinterpret_cast<PVOID volatile*>(&vigem->Capture),
+		capture,
+		nullptr
+	) != nullptr)
+	{
+		// lost against a concurrent call
+		capture->Stop = TRUE;
+		SetEvent(capture->hWake);
+		WaitForSingleObject(capture->hThread, INFINITE);
+		CloseHandle(capture->hThread);
+		vigem_internal_capture_free(capture);
+
+		return VIGEM_ERROR_ALREADY_CONNECTED;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+void vigem_capture_stop(PVIGEM_CLIENT vigem)
+{
+	if (!vigem)
+		return;
+
+	const auto capture = static_cast<PVIGEM_CAPTURE>(
+		InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&vigem->Capture), nullptr)
+	);
+
+	if (!capture)
+		return;
+
+	//
+	// Writers that picked up the capture before it was detached finish first
+	// 
+	while (vigem->CaptureWriters != 0)
+		SwitchToThread();
+
+	capture->Stop = TRUE;
+	SetEvent(capture->hWake);
+	WaitForSingleObject(capture->hThread, INFINITE);
+	CloseHandle(capture->hThread);
+
+	vigem_internal_capture_write_statistics(capture, vigem_internal_capture_timestamp(capture));
+	vigem_internal_capture_free(capture);
+}
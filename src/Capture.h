@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ViGEm/Capture.h"
+
+//
+// Memory buffers packets are appended to, a full one is handed to the
+// writer thread and the next one is filled meanwhile.
+// 
+#define VIGEM_CAPTURE_BUFFERS           4
+#define VIGEM_CAPTURE_BUFFER_SIZE       0x40000
+
+//
+// Request issued but not completed yet, looked up by its OVERLAPPED.
+// 
+typedef struct _VIGEM_CAPTURE_IN_FLIGHT_T
+{
+    struct _VIGEM_CAPTURE_IN_FLIGHT_T* Next;
+    LPOVERLAPPED Overlapped;
+    ULONG RequestId;
+    DWORD IoControlCode;
+    ULONG SerialNo;
+    LPVOID OutBuffer;
+    DWORD OutBufferSize;
+} VIGEM_CAPTURE_IN_FLIGHT, *PVIGEM_CAPTURE_IN_FLIGHT;
+
+//
+// Represents an active capture.
+// 
+typedef struct _VIGEM_CAPTURE_T
+{
+    HANDLE hFile;
+    HANDLE hThread;
+    HANDLE hWake;
+    volatile BOOLEAN Stop;
+    BOOLEAN WriteFailed;
+
+    //
+    // Client and its writer thread configuration as of the start
+    // 
+    PVIGEM_CLIENT Client;
+    VIGEM_THREAD_CONFIG ThreadConfig;
+
+    //
+    // Guards appending to the buffers
+    // 
+    CRITICAL_SECTION Lock;
+    PUCHAR Buffers[VIGEM_CAPTURE_BUFFERS];
+    SIZE_T Filled[VIGEM_CAPTURE_BUFFERS];
+    //
+    // Buffer being filled (modulo VIGEM_CAPTURE_BUFFERS) and bytes used in it
+    // 
+    LONGLONG FillIndex;
+    SIZE_T Used;
+    //
+    // Next buffer the writer thread writes out, buffers from here to
+    // FillIndex are full
+    // 
+    volatile LONGLONG WriteIndex;
+
+    volatile LONG NextRequestId;
+    ULONGLONG DroppedPackets;
+
+    //
+    // Requests of the connection still in flight and entries to reuse.
+    // Asynchronous requests complete on thread pool threads, not the one
+    // issuing them, so they're tracked per capture rather than per thread.
+    // 
+    SRWLOCK InFlightLock;
+    PVIGEM_CAPTURE_IN_FLIGHT InFlight;
+    PVIGEM_CAPTURE_IN_FLIGHT InFlightFree;
+
+    //
+    // Maps performance counter values to pcapng timestamps
+    // 
+    LONGLONG BaseCounter;
+    ULONGLONG BaseNanoseconds;
+    DOUBLE NanosecondsPerTick;
+} VIGEM_CAPTURE, *PVIGEM_CAPTURE;
+
+//
+// Transport hooks, called only while a capture is active.
+// 
+VOID vigem_internal_capture_request(
+    PVIGEM_CLIENT vigem,
+    DWORD IoControlCode,
+    LPCVOID InBuffer,
+    DWORD InBufferSize,
+    LPVOID OutBuffer,
+    DWORD OutBufferSize,
+    LPOVERLAPPED Overlapped
+);
+
+//
+// Captures the outcome of GetOverlappedResult, preserves the last error.
+// 
+VOID vigem_internal_capture_completion(
+    PVIGEM_CLIENT vigem,
+    LPOVERLAPPED Overlapped,
+    BOOL Result,
+    DWORD BytesTransferred
+);
+
+VOID vigem_internal_capture_cancel(
+    PVIGEM_CLIENT vigem,
+    LPOVERLAPPED Overlapped
+);
@@ -0,0 +1,228 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Stats.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+#include <climits>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "Instrumentation.h"
+#include "Memory.h"
+
+
+//
+// Shard the calling thread last accounted to.
+// 
+typedef struct _VIGEM_STATS_CACHED_SHARD
+{
+	LONGLONG CollectorId;
+	PVIGEM_STATS_SHARD Shard;
+} VIGEM_STATS_CACHED_SHARD;
+
+static thread_local VIGEM_STATS_CACHED_SHARD g_StatsShard;
+
+static volatile LONGLONG g_StatsCollectorId;
+
+PVIGEM_STATS_SHARD vigem_internal_stats_shard(PVIGEM_STATS_COLLECTOR Collector)
+{
+	VIGEM_STATS_CACHED_SHARD& cached = g_StatsShard;
+
+	if (cached.CollectorId == Collector->Id)
+		return cached.Shard;
+
+	//
+	// A thread using several connections alternately ends up here on every
+	// switch, find the shard it already owns. Shards are only ever prepended,
+	// so the list can be walked without a lock.
+	// 
+	const DWORD threadId = GetCurrentThreadId();
+	PVIGEM_STATS_SHARD shard;
+
+	for (shard = Collector->Shards; shard; shard = shard->Next)
+	{
+		if (shard->ThreadId == threadId)
+			break;
+	}
+
+	if (!shard)
+	{
+		shard = static_cast<PVIGEM_STATS_SHARD>(vigem_internal_alloc_aligned(sizeof(VIGEM_STATS_SHARD), alignof(VIGEM_STATS_SHARD)));
+
+		if (!shard)
+			return nullptr;
+
+		RtlZeroMemory(shard, sizeof(VIGEM_STATS_SHARD));
+		shard->ThreadId = threadId;
+
+		PVIGEM_STATS_SHARD head;
+
+		do
+		{
+			head = Collector->Shards;
+			shard->Next = head;
+		} while (InterlockedCompareExchangePointer(
+			reinterpret_cast<PVOID volatile*>(&Collector->Shards),
+			shard,
+			head
+		) != head);
+	}
+
+	cached.CollectorId = Collector->Id;
+	cached.Shard = shard;
+
+	return shard;
+}
+
+VOID vigem_internal_stats_free(PVIGEM_CLIENT vigem)
+{
+	const PVIGEM_STATS_COLLECTOR collector = vigem->Stats;
+
+	if (!collector)
+		return;
+
+	vigem->Stats = nullptr;
+
+	PVIGEM_STATS_SHARD shard = collector->Shards;
+
+	while (shard)
+	{
+		const PVIGEM_STATS_SHARD next = shard->Next;
+		vigem_internal_free(shard);
+		shard = next;
+	}
+
+	vigem_internal_free(collector);
+}
+
+VIGEM_ERROR vigem_stats_enable(PVIGEM_CLIENT vigem, BOOLEAN enable)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!vigem->Stats && enable)
+	{
+		const auto collector = static_cast<PVIGEM_STATS_COLLECTOR>(vigem_internal_alloc(sizeof(VIGEM_STATS_COLLECTOR)));
+
+		if (!collector)
+			return VIGEM_ERROR_WINAPI;
+
+		RtlZeroMemory(collector, sizeof(VIGEM_STATS_COLLECTOR));
+
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+
+		collector->Id = InterlockedIncrement64(&g_StatsCollectorId);
+		collector->NanosecondsPerTick = 1e9 / static_cast<DOUBLE>(frequency.QuadPart);
+
+		if (InterlockedCompareExchangePointer(
+			reinterpret_cast<PVOID volatile*>(&vigem->Stats),
+			collector,
+			nullptr
+		) != nullptr)
+		{
+			// lost against a concurrent call
+			vigem_internal_free(collector);
+		}
+	}
+
+	if (vigem->Stats)
+		vigem->Stats->Enabled = enable;
+
+	return VIGEM_ERROR_NONE;
+}
+
+static VOID vigem_internal_stats_merge(PVIGEM_STATS_ENTRY Target, const VIGEM_STATS_ENTRY* Source)
+{
+	Target->Calls += Source->Calls;
+	Target->TotalNanoseconds += Source->TotalNanoseconds;
+
+	if (Source->MaxNanoseconds > Target->MaxNanoseconds)
+		Target->MaxNanoseconds = Source->MaxNanoseconds;
+
+	for (ULONG slot = 0; slot < VIGEM_STATS_ERROR_SLOTS; slot++)
+		Target->Errors[slot] += Source->Errors[slot];
+
+	for (ULONG bucket = 0; bucket < VIGEM_STATS_BUCKETS; bucket++)
+		Target->Buckets[bucket] += Source->Buckets[bucket];
+}
+
+VIGEM_ERROR vigem_get_stats(PVIGEM_CLIENT vigem, PVIGEM_STATS stats)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!stats || stats->Size != sizeof(VIGEM_STATS))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	VIGEM_STATS_INIT(stats);
+
+	const PVIGEM_STATS_COLLECTOR collector = vigem->Stats;
+
+	if (!collector)
+		return VIGEM_ERROR_NONE;
+
+	for (PVIGEM_STATS_SHARD shard = collector->Shards; shard; shard = shard->Next)
+	{
+		for (ULONG function = 0; function < VIGEM_STATS_FUNCTION_COUNT; function++)
+			vigem_internal_stats_merge(&stats->Functions[function], &shard->Functions[function]);
+
+		stats->Threads++;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_target_get_stats(PVIGEM_TARGET target, PVIGEM_STATS_ENTRY stats)
+{
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (!stats)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (target->Stats)
+		RtlCopyMemory(stats, target->Stats, sizeof(VIGEM_STATS_ENTRY));
+	else
+		RtlZeroMemory(stats, sizeof(VIGEM_STATS_ENTRY));
+
+	return VIGEM_ERROR_NONE;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ViGEm/Stats.h"
+#include "Memory.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//
+// Statistics of one thread. Only the owning thread writes to it, readers
+// merge all shards; shards are cache-line aligned so they never share one.
+//
+typedef struct alignas(64) _VIGEM_STATS_SHARD
+{
+    DWORD ThreadId;
+    struct _VIGEM_STATS_SHARD* Next;
+    VIGEM_STATS_ENTRY Functions[VIGEM_STATS_FUNCTION_COUNT];
+} VIGEM_STATS_SHARD, *PVIGEM_STATS_SHARD;
+
+//
+// Statistics of a driver connection.
+//
+typedef struct _VIGEM_STATS_COLLECTOR_T
+{
+    //
+    // Unique per collector, tells threads their cached shard is stale
+    //
+    LONGLONG Id;
+    volatile BOOLEAN Enabled;
+    DOUBLE NanosecondsPerTick;
+    PVIGEM_STATS_SHARD volatile Shards;
+} VIGEM_STATS_COLLECTOR, *PVIGEM_STATS_COLLECTOR;
+
+//
+// Returns the shard of the calling thread, allocating it on first use.
+//
+PVIGEM_STATS_SHARD vigem_internal_stats_shard(PVIGEM_STATS_COLLECTOR Collector);
+
+//
+// Frees the collector of a driver connection, if any.
+//
+VOID vigem_internal_stats_free(PVIGEM_CLIENT vigem);
+
+FORCEINLINE ULONG vigem_internal_stats_bucket(ULONGLONG Nanoseconds)
+{
+    if (Nanoseconds < VIGEM_STATS_SUB_BUCKETS)
+        return static_cast<ULONG>(Nanoseconds);
+
+    ULONG msb;
+
+#if defined(_WIN64)
+    _BitScanReverse64(&msb, Nanoseconds);
+#else
+    if (Nanoseconds >> 32)
+    {
+        _BitScanReverse(&msb, static_cast<ULONG>(Nanoseconds >> 32));
+        msb += 32;
+    }
+    else
+    {
+        _BitScanReverse(&msb, static_cast<ULONG>(Nanoseconds));
+    }
+#endif
+
+    // the three bits below the leading one select the sub-bucket
+    const ULONG index = (msb - 2) * VIGEM_STATS_SUB_BUCKETS
+        + static_cast<ULONG>(Nanoseconds >> (msb - 3)) % VIGEM_STATS_SUB_BUCKETS;
+
+    return (index < VIGEM_STATS_BUCKETS) ? index : VIGEM_STATS_BUCKETS - 1;
+}
+
+FORCEINLINE VOID vigem_internal_stats_account(
+    PVIGEM_STATS_ENTRY Entry,
+    ULONGLONG Nanoseconds,
+    ULONG Bucket,
+    VIGEM_ERROR Error
+)
+{
+    Entry->Calls++;
+    Entry->TotalNanoseconds += Nanoseconds;
+
+    if (Nanoseconds > Entry->MaxNanoseconds)
+        Entry->MaxNanoseconds = Nanoseconds;
+
+    Entry->Errors[VIGEM_STATS_ERROR_SLOT(Error)]++;
+    Entry->Buckets[Bucket]++;
+}
+
+//
+// Runs an API call and, if statistics are enabled, accounts its duration and
+// result to the calling thread's shard and to the target (if any). Targets
+// aren't shared between threads without synchronization by the caller, so
+// their entry is updated without interlocked operations.
+//
+template <typename TCall>
+FORCEINLINE VIGEM_ERROR vigem_internal_stats_call(
+    PVIGEM_CLIENT vigem,
+    PVIGEM_TARGET target,
+    VIGEM_STATS_FUNCTION Function,
+    TCall Call
+)
+{
+    const PVIGEM_STATS_COLLECTOR collector = vigem ? vigem->Stats : nullptr;
+
+    if (!collector || !collector->Enabled)
+        return Call();
+
+    LARGE_INTEGER start, stop;
+
+    QueryPerformanceCounter(&start);
+    const VIGEM_ERROR error = Call();
+    QueryPerformanceCounter(&stop);
+
+    const auto nanoseconds = static_cast<ULONGLONG>((stop.QuadPart - start.QuadPart) * collector->NanosecondsPerTick);
+    const ULONG bucket = vigem_internal_stats_bucket(nanoseconds);
+    const PVIGEM_STATS_SHARD shard = vigem_internal_stats_shard(collector);
+
+    if (shard)
+        vigem_internal_stats_account(&shard->Functions[Function], nanoseconds, bucket, error);
+
+    if (target && Function >= VIGEM_STATS_X360_UPDATE && Function <= VIGEM_STATS_DS4_UPDATE_EX)
+    {
+        if (!target->Stats)
+        {
+            target->Stats = static_cast<PVIGEM_STATS_ENTRY>(vigem_internal_alloc(sizeof(VIGEM_STATS_ENTRY)));
+
+            if (target->Stats)
+                RtlZeroMemory(target->Stats, sizeof(VIGEM_STATS_ENTRY));
+        }
+
+        if (target->Stats)
+            vigem_internal_stats_account(target->Stats, nanoseconds, bucket, error);
+    }
+
+    return error;
+}
@@ -37,8 +37,49 @@ SOFTWARE.
 typedef struct _VIGEM_CLIENT_T
 {
     HANDLE hBusDevice;
+    struct _VIGEM_SIM_BUS_T* SimBus;
+    //
+    // Multi-bus mode: the client owns a connection per bus instance, each
+    // with its own pickup thread and target list, and routes every target to
+    // the connection it was added to. Those point back at the client, which
+    // keeps recording and capturing for all of them.
+    // 
+    struct _VIGEM_CLIENT_T** Buses;
+    ULONG BusCount;
+    struct _VIGEM_CLIENT_T* Primary;
+    //
+    // Plugged in targets and adds in progress, to pick the least loaded bus
+    // 
+    volatile LONG TargetCount;
+    volatile LONG AddsPending;
+    //
+    // Shared session the client is attached to, its connection is the only
+    // entry of Buses. The session's own connection instead maps the serial
+    // numbers of its targets to the attached client that added them.
+    // 
+    struct _VIGEM_SHARED_SESSION_T* Session;
+    struct _VIGEM_CLIENT_T** Owners;
+    struct _VIGEM_RECORDER_T* volatile Recorder;
+    volatile LONG RecordWriters;
+    struct _VIGEM_CAPTURE_T* volatile Capture;
+    volatile LONG CaptureWriters;
+    struct _VIGEM_STATS_COLLECTOR_T* volatile Stats;
+    struct _VIGEM_TARGET_POOL_T* volatile TargetPool;
+    //
+    // Pending asynchronous operations and finished ones kept for reuse,
+    // SRWLOCK as it's valid zeroed
+    // 
+    SRWLOCK AsyncLock;
+    struct _VIGEM_ASYNC_OP_T* volatile AsyncOps;
+    struct _VIGEM_ASYNC_OP_T* AsyncFree;
+    volatile LONG AsyncPending;
     HANDLE hDS4OutputReportPickupThread;
     HANDLE hDS4OutputReportPickupThreadAbortEvent;
+    //
+    // Scheduling of the threads the client creates, by VIGEM_THREAD_KIND.
+    // Bus connections of a multi-bus client use the ones of the client.
+    // 
+    VIGEM_THREAD_CONFIG ThreadConfigs[VIGEM_THREAD_LOG];
     PVIGEM_TARGET pTargetsList[VIGEM_TARGETS_MAX];
 } VIGEM_CLIENT;
 
@@ -54,26 +95,143 @@ typedef enum
 } VIGEM_TARGET_STATE, *PVIGEM_TARGET_STATE;
 
 //
-// Represents a virtual gamepad object.
+// Rarely used state of a target, allocated on first use: most pads never
+// register a notification and X360 ones never receive output reports. The
+// DS4 sync objects only exist in the block of a DualShock 4 target.
 // 
-typedef struct _VIGEM_TARGET_T
+typedef struct _VIGEM_TARGET_COLD_T
 {
-    ULONG Size;
-    ULONG SerialNo;
-    VIGEM_TARGET_STATE State;
-    USHORT VendorId;
-    USHORT ProductId;
-    VIGEM_TARGET_TYPE Type;
     FARPROC Notification;
     LPVOID NotificationUserData;
-    BOOLEAN IsWaitReadyUnsupported;
-	HANDLE CancelNotificationThreadEvent;
+    HANDLE CancelNotificationThreadEvent;
     DS4_OUTPUT_BUFFER Ds4CachedOutputReport;
     HANDLE Ds4CachedOutputReportUpdateAvailable;
     CRITICAL_SECTION Ds4CachedOutputReportUpdateLock;
+} VIGEM_TARGET_COLD, *PVIGEM_TARGET_COLD;
+
+//
+// Represents a virtual gamepad object. Everything a report update reads
+// shares the first cache line, followed by the pinned submission buffer.
+// 
+typedef struct alignas(64) _VIGEM_TARGET_T
+{
+    ULONG Size;
+    ULONG SerialNo;
+    VIGEM_TARGET_STATE State;
+    VIGEM_TARGET_TYPE Type;
     BOOLEAN IsDisposing;
+    BOOLEAN IsWaitReadyUnsupported;
+    USHORT VendorId;
+    USHORT ProductId;
+    struct _VIGEM_STATS_ENTRY* Stats;
+    //
+    // Bus connection of a multi-bus client the target was last added to
+    // 
+    struct _VIGEM_CLIENT_T* Bus;
+    PVIGEM_TARGET_COLD volatile Cold;
+    //
+    // Pinned submission buffer, Size is 0 until it's set up for one of the
+    // formats. The event waits for every update of the target, created on
+    // the first one.
+    // 
+    HANDLE SubmitEvent;
+    union
+    {
+        XUSB_SUBMIT_REPORT Xusb;
+        DS4_SUBMIT_REPORT_EX Ds4Ex;
+    } Submit;
+    //
+    // Pool the target is returned to when freed, NULL if it's from the heap
+    // 
+    struct _VIGEM_TARGET_POOL_T* Pool;
 } VIGEM_TARGET;
 
+static_assert(offsetof(VIGEM_TARGET, Submit) <= 64, "update path fields exceed a cache line");
+
+//
+// Target validated once by vigem_target_prepare for the unchecked update
+// functions, with the connection resolved and a wait event of its own.
+// 
+typedef struct _VIGEM_PREPARED_TARGET_T
+{
+    struct _VIGEM_CLIENT_T* Client;
+    struct _VIGEM_CLIENT_T* Bus;
+    PVIGEM_TARGET Target;
+    //
+    // Serial number as of preparing, debug builds assert it's unchanged
+    // 
+    ULONG SerialNo;
+    HANDLE Event;
+} VIGEM_PREPARED_TARGET;
+
+//
+// The connection a target's requests go to, the client itself unless it
+// spans several buses.
+// 
+FORCEINLINE PVIGEM_CLIENT vigem_internal_bus(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+    return (vigem && vigem->Buses && target && target->Bus) ? target->Bus : vigem;
+}
+
+//
+// The client callbacks are invoked with and instrumentation is kept by.
+// 
+FORCEINLINE PVIGEM_CLIENT vigem_internal_primary(PVIGEM_CLIENT vigem)
+{
+    return vigem->Primary ? vigem->Primary : vigem;
+}
+
+//
+// The client a target of the connection was added through, which records
+// its reports and receives its callbacks.
+// 
+FORCEINLINE PVIGEM_CLIENT vigem_internal_owner(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+    const PVIGEM_CLIENT owner = vigem->Owners ? vigem->Owners[target->SerialNo] : nullptr;
+
+    return owner ? owner : vigem_internal_primary(vigem);
+}
+
+//
+// Picks the bus to add a target to and counts the add as pending there, so
+// concurrent adds spread out before any of them completed.
+// 
+FORCEINLINE PVIGEM_CLIENT vigem_internal_bus_reserve(PVIGEM_CLIENT vigem)
+{
+    PVIGEM_CLIENT bus = vigem->Buses[0];
+
+    for (ULONG index = 1; index < vigem->BusCount; index++)
+    {
+        const PVIGEM_CLIENT candidate = vigem->Buses[index];
+
+        if (candidate->TargetCount + candidate->AddsPending < bus->TargetCount + bus->AddsPending)
+            bus = candidate;
+    }
+
+    InterlockedIncrement(&bus->AddsPending);
+
+    return bus;
+}
+
+FORCEINLINE VOID vigem_internal_bus_release(PVIGEM_CLIENT bus, PVIGEM_TARGET target, BOOLEAN added)
+{
+    if (added)
+        target->Bus = bus;
+
+    InterlockedDecrement(&bus->AddsPending);
+}
+
+//
+// Records the client adding a target to a shared session's connection. Set
+// once the plug-in succeeded, before waiting for the device to be ready, so
+// reports and notifications from then on reach the owner.
+// 
+FORCEINLINE VOID vigem_internal_bus_own(PVIGEM_CLIENT bus, PVIGEM_TARGET target, PVIGEM_CLIENT owner)
+{
+    if (bus->Owners)
+        bus->Owners[target->SerialNo] = owner;
+}
+
 #define DEVICE_IO_CONTROL_BEGIN	\
 	DWORD transferred = 0; \
 	OVERLAPPED lOverlapped = { 0 }; \
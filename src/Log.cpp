@@ -0,0 +1,774 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/Client.h"
+#include "ViGEm/Log.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+#include <cstdio>
+#include <cwchar>
+
+//
+// Internal
+// 
+#include "Log.h"
+#include "Memory.h"
+#include "Thread.h"
+
+//#define VIGEM_VERBOSE_LOGGING_ENABLED
+
+
+//
+// How often the logging thread picks up records when not woken early
+// 
+#define VIGEM_LOG_DRAIN_INTERVAL_MS     50
+
+#define VIGEM_LOG_MESSAGE_CHARS         1024
+
+#if defined(VIGEM_VERBOSE_LOGGING_ENABLED)
+volatile LONG g_LogLevel = VIGEM_LOG_LEVEL_VERBOSE;
+static BOOLEAN g_LogDebugger = TRUE;
+#else
+volatile LONG g_LogLevel = VIGEM_LOG_LEVEL_NONE;
+static BOOLEAN g_LogDebugger = FALSE;
+#endif
+
+//
+// All rings allocated, prepended to with g_LogStartLock held shared.
+// vigem_log_shutdown frees the unused ones with it held exclusive.
+// 
+static PVIGEM_LOG_RING volatile g_LogRings;
+
+//
+// Logging thread, started by the first log call that gets through and
+// stopped by vigem_log_shutdown. g_LogStartLock serializes the two.
+// 
+static SRWLOCK g_LogStartLock = SRWLOCK_INIT;
+static volatile LONG g_LogThreadStarted;
+static HANDLE g_LogThreadHandle;
+static volatile DWORD g_LogThreadId;
+static HANDLE g_LogWake;
+static HANDLE g_LogStop;
+static LONGLONG g_LogBase;
+static LONGLONG g_LogFrequency;
+
+//
+// Serializes formatting, only one thread consumes the rings at a time
+// 
+static SRWLOCK g_LogDrainLock = SRWLOCK_INIT;
+
+//
+// Set on the thread draining, so a callback flushing or changing the sinks
+// doesn't wait for the drain it runs in
+// 
+static thread_local BOOLEAN g_LogDraining;
+
+//
+// Guards the sinks. Never held while the callback runs.
+// 
+static SRWLOCK g_LogLock = SRWLOCK_INIT;
+static HANDLE g_LogFile = INVALID_HANDLE_VALUE;
+static PFN_VIGEM_LOG g_LogCallback;
+static LPVOID g_LogCallbackUserData;
+
+//
+// Read once by the logging thread as it starts
+// 
+static VIGEM_THREAD_CONFIG g_LogThreadConfig;
+
+//
+// Ring of the calling thread, handed back for reuse when the thread exits.
+// 
+typedef struct _VIGEM_LOG_THREAD
+{
+	PVIGEM_LOG_RING Ring;
+
+	~_VIGEM_LOG_THREAD()
+	{
+		if (Ring)
+			InterlockedExchange(&Ring->InUse, 0);
+	}
+} VIGEM_LOG_THREAD;
+
+static thread_local VIGEM_LOG_THREAD g_LogThread;
+
+static VOID vigem_internal_log_drain();
+
+//
+// Drains the rings unless the calling thread is draining already.
+// 
+static VOID vigem_internal_log_flush_pending()
+{
+	if (g_LogDraining)
+		return;
+
+	AcquireSRWLockExclusive(&g_LogDrainLock);
+	g_LogDraining = TRUE;
+
+	vigem_internal_log_drain();
+
+	g_LogDraining = FALSE;
+	ReleaseSRWLockExclusive(&g_LogDrainLock);
+}
+
+static DWORD WINAPI vigem_internal_log_thread(LPVOID Parameter)
+{
+	UNREFERENCED_PARAMETER(Parameter);
+
+	VIGEM_THREAD_CONFIG config;
+
+	g_LogThreadId = GetCurrentThreadId();
+
+	AcquireSRWLockShared(&g_LogLock);
+	config = g_LogThreadConfig;
+	ReleaseSRWLockShared(&g_LogLock);
+
+	// unlocked, the start function may well call vigem_log_flush
+	vigem_internal_thread_start(&config, nullptr, VIGEM_THREAD_LOG);
+
+	const HANDLE events[] = { g_LogStop, g_LogWake };
+
+	// vigem_log_shutdown drains what is left once the thread exited
+	while (WaitForMultipleObjects(_countof(events), events, FALSE, VIGEM_LOG_DRAIN_INTERVAL_MS) != WAIT_OBJECT_0)
+		vigem_internal_log_flush_pending();
+
+	g_LogThreadId = 0;
+
+	return 0;
+}
+
+//
+// Starts the logging thread on the first log call that gets through, and
+// again on the first one after vigem_log_shutdown.
+// 
+static VOID vigem_internal_log_start()
+{
+	if (g_LogThreadStarted)
+		return;
+
+	AcquireSRWLockExclusive(&g_LogStartLock);
+
+	if (!g_LogThreadStarted)
+	{
+		if (!g_LogWake)
+		{
+			LARGE_INTEGER frequency, now;
+			QueryPerformanceFrequency(&frequency);
+			QueryPerformanceCounter(&now);
+
+			g_LogFrequency = frequency.QuadPart;
+			g_LogBase = now.QuadPart;
+			g_LogWake = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+			g_LogStop = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		}
+
+		if (g_LogWake && g_LogStop)
+		{
+			ResetEvent(g_LogStop);
+			g_LogThreadHandle = CreateThread(nullptr, 0, vigem_internal_log_thread, nullptr, 0, nullptr);
+		}
+
+		// not retried if it failed, vigem_log_flush still works
+		InterlockedExchange(&g_LogThreadStarted, 1);
+	}
+
+	ReleaseSRWLockExclusive(&g_LogStartLock);
+}
+
+static PVIGEM_LOG_RING vigem_internal_log_ring()
+{
+	VIGEM_LOG_THREAD& thread = g_LogThread;
+
+	if (thread.Ring)
+		return thread.Ring;
+
+	AcquireSRWLockShared(&g_LogStartLock);
+
+	PVIGEM_LOG_RING ring;
+
+	for (ring = g_LogRings; ring; ring = ring->Next)
+	{
+		if (ring->InUse == 0 && InterlockedCompareExchange(&ring->InUse, 1, 0) == 0)
+			break;
+	}
+
+	if (!ring)
+	{
+		ring = static_cast<PVIGEM_LOG_RING>(vigem_internal_alloc_aligned(sizeof(VIGEM_LOG_RING), alignof(VIGEM_LOG_RING)));
+
+		if (!ring)
+		{
+			ReleaseSRWLockShared(&g_LogStartLock);
+			return nullptr;
+		}
+
+		ring->InUse = 1;
+		ring->Head = 0;
+		ring->Tail = 0;
+		ring->Dropped = 0;
+		ring->DroppedReported = 0;
+
+		PVIGEM_LOG_RING head;
+
+		do
+		{
+			head = g_LogRings;
+			ring->Next = head;
+		} while (InterlockedCompareExchangePointer(
+			reinterpret_cast<PVOID volatile*>(&g_LogRings),
+			ring,
+			head
+		) != head);
+	}
+
+	ReleaseSRWLockShared(&g_LogStartLock);
+
+	thread.Ring = ring;
+
+	return ring;
+}
+
+VOID vigem_internal_log_write(
+	VIGEM_LOG_LEVEL Level,
+	LPCWSTR Function,
+	ULONG Line,
+	LPCWSTR Format,
+	const ULONGLONG* Args,
+	ULONG ArgCount
+)
+{
+	vigem_internal_log_start();
+
+	const PVIGEM_LOG_RING ring = vigem_internal_log_ring();
+
+	if (!ring)
+		return;
+
+	const LONGLONG head = ring->Head;
+	const LONGLONG pending = head - ring->Tail;
+
+	if (pending >= VIGEM_LOG_RING_RECORDS)
+	{
+		InterlockedIncrement(&ring->Dropped);
+		return;
+	}
+
+	VIGEM_LOG_RECORD& record = ring->Records[head & (VIGEM_LOG_RING_RECORDS - 1)];
+	LARGE_INTEGER now;
+
+	QueryPerformanceCounter(&now);
+
+	record.Timestamp = now.QuadPart;
+	record.Format = Format;
+	record.Function = Function;
+	record.Line = Line;
+	record.ThreadId = GetCurrentThreadId();
+	record.Level = static_cast<UCHAR>(Level);
+	record.ArgCount = static_cast<UCHAR>(ArgCount);
+
+	for (ULONG index = 0; index < ArgCount; index++)
+		record.Args[index] = Args[index];
+
+	// publish the record only once it is complete
+	InterlockedExchange64(&ring->Head, head + 1);
+
+	// don't wait for the next interval when a burst fills the ring
+	if (pending == VIGEM_LOG_RING_RECORDS / 2 && g_LogWake)
+		SetEvent(g_LogWake);
+}
+
+#pragma region Formatting
+
+//
+// Appends to a fixed size, always terminated message buffer.
+// 
+typedef struct _VIGEM_LOG_MESSAGE
+{
+	WCHAR Text[VIGEM_LOG_MESSAGE_CHARS];
+	SIZE_T Length;
+
+	VOID Append(WCHAR Char)
+	{
+		if (Length + 1 < VIGEM_LOG_MESSAGE_CHARS)
+			Text[Length++] = Char;
+	}
+
+	VOID Append(LPCWSTR String)
+	{
+		while (*String)
+			Append(*String++);
+	}
+
+	VOID Append(LPCSTR String)
+	{
+		while (*String)
+			Append(static_cast<WCHAR>(static_cast<UCHAR>(*String++)));
+	}
+
+	template <typename T>
+	VOID Print(LPCWSTR Format, T Value)
+	{
+		const int written = swprintf(&Text[Length], VIGEM_LOG_MESSAGE_CHARS - Length, Format, Value);
+
+		if (written > 0)
+			Length += written;
+	}
+} VIGEM_LOG_MESSAGE;
+
+static BOOLEAN vigem_internal_log_is_any_of(WCHAR Char, LPCWSTR Set)
+{
+	return Char != L'\0' && wcschr(Set, Char) != nullptr;
+}
+
+//
+// Formats a record the way the printf family would have at the call site.
+// Every conversion is printed on its own with the argument converted to the
+// type the format asks for.
+// 
+static VOID vigem_internal_log_format(const VIGEM_LOG_RECORD& Record, VIGEM_LOG_MESSAGE& Message)
+{
+	LPCWSTR format = Record.Format;
+	ULONG arg = 0;
+
+	while (*format)
+	{
+		if (*format != L'%')
+		{
+			Message.Append(*format++);
+			continue;
+		}
+
+		if (format[1] == L'%')
+		{
+			Message.Append(L'%');
+			format += 2;
+			continue;
+		}
+
+		//
+		// %[flags][width][.precision][length]conversion
+		// 
+		WCHAR spec[32] = L"%";
+		SIZE_T specLength = 1;
+
+		format++;
+
+		while (vigem_internal_log_is_any_of(*format, L"-+ #0123456789.") && specLength < 24)
+			spec[specLength++] = *format++;
+
+		const LPCWSTR length = format;
+
+		if (wcsncmp(format, L"I64", 3) == 0 || wcsncmp(format, L"I32", 3) == 0)
+			format += 3;
+		else
+			while (vigem_internal_log_is_any_of(*format, L"hlLjztI"))
+				format++;
+
+		const WCHAR conversion = *format;
+
+		if (conversion == L'\0')
+			break;
+
+		format++;
+
+		const SIZE_T lengthChars = format - 1 - length;
+		const BOOLEAN isShort = (lengthChars > 0 && length[0] == L'h');
+		const BOOLEAN isLong = (lengthChars > 0 && length[0] == L'l');
+		const BOOLEAN is64 = (lengthChars >= 2 && length[0] == L'l' && length[1] == L'l')
+			|| (lengthChars >= 3 && wcsncmp(length, L"I64", 3) == 0)
+			|| (lengthChars > 0 && vigem_internal_log_is_any_of(length[0], L"jzt"))
+			|| (lengthChars == 1 && length[0] == L'I' && sizeof(PVOID) == 8);
+
+		const ULONGLONG value = (arg < Record.ArgCount) ? Record.Args[arg] : 0;
+		arg++;
+
+		switch (conversion)
+		{
+		case L'd':
+		case L'i':
+		case L'u':
+		case L'o':
+		case L'x':
+		case L'X':
+		{
+			const BOOLEAN isSigned = (conversion == L'd' || conversion == L'i');
+
+			if (is64)
+			{
+				spec[specLength++] = L'l';
+				spec[specLength++] = L'l';
+			}
+			else if (isShort)
+			{
+				spec[specLength++] = L'h';
+			}
+
+			spec[specLength++] = conversion;
+			spec[specLength] = L'\0';
+
+			if (is64)
+			{
+				if (isSigned)
+					Message.Print(spec, static_cast<LONGLONG>(value));
+				else
+					Message.Print(spec, value);
+			}
+			else
+			{
+				if (isSigned)
+					Message.Print(spec, static_cast<INT>(value));
+				else
+					Message.Print(spec, static_cast<UINT>(value));
+			}
+			break;
+		}
+		case L'e':
+		case L'E':
+		case L'f':
+		case L'F':
+		case L'g':
+		case L'G':
+		case L'a':
+		case L'A':
+		{
+			DOUBLE number;
+			memcpy(&number, &value, sizeof(number));
+
+			spec[specLength++] = conversion;
+			spec[specLength] = L'\0';
+
+			Message.Print(spec, number);
+			break;
+		}
+		case L'p':
+			Message.Print(sizeof(PVOID) == 8 ? L"%016llX" : L"%08llX", value);
+			break;
+		case L'c':
+		case L'C':
+			Message.Append(static_cast<WCHAR>(value));
+			break;
+		case L's':
+		case L'S':
+		{
+			//
+			// Wide function semantics: %s and %ls are wide, %S and %hs narrow
+			// 
+			const BOOLEAN narrow = isShort || (conversion == L'S' && !isLong);
+
+			if (value == 0)
+				Message.Append(L"(null)");
+			else if (narrow)
+				Message.Append(reinterpret_cast<LPCSTR>(static_cast<ULONG_PTR>(value)));
+			else
+				Message.Append(reinterpret_cast<LPCWSTR>(static_cast<ULONG_PTR>(value)));
+			break;
+		}
+		default:
+			// unsupported (%n, %*d, ...), keep the text
+			Message.Append(L'%');
+			Message.Append(conversion);
+			break;
+		}
+	}
+}
+
+#pragma endregion
+
+//
+// Called with g_LogDrainLock held, calls the callback without any other lock
+// so it may flush or change the sinks.
+// 
+static VOID vigem_internal_log_sink(VIGEM_LOG_LEVEL Level, LONGLONG Timestamp, DWORD ThreadId, LPCWSTR Message)
+{
+	AcquireSRWLockShared(&g_LogLock);
+
+	if (g_LogDebugger)
+	{
+		OutputDebugStringW(Message);
+		OutputDebugStringW(L"\n");
+	}
+
+	if (g_LogFile != INVALID_HANDLE_VALUE)
+	{
+		static const char levels[] = { ' ', 'E', 'W', 'I', 'V' };
+		CHAR line[VIGEM_LOG_MESSAGE_CHARS * 3 + 64];
+
+		int length = snprintf(line, sizeof(line), "%12.6f %6lu %c ",
+			static_cast<DOUBLE>(Timestamp - g_LogBase) / static_cast<DOUBLE>(g_LogFrequency),
+			static_cast<unsigned long>(ThreadId),
+			levels[static_cast<SIZE_T>(Level) < _countof(levels) ? Level : 0]
+		);
+
+		const int converted = WideCharToMultiByte(
+			CP_UTF8,
+			0,
+			Message,
+			-1,
+			&line[length],
+			static_cast<int>(sizeof(line)) - length - 1,
+			nullptr,
+			nullptr
+		);
+
+		// without the terminator
+		if (converted > 0)
+			length += converted - 1;
+
+		line[length++] = '\n';
+
+		DWORD written;
+		WriteFile(g_LogFile, line, static_cast<DWORD>(length), &written, nullptr);
+	}
+
+	const PFN_VIGEM_LOG callback = g_LogCallback;
+	const LPVOID userData = g_LogCallbackUserData;
+
+	ReleaseSRWLockShared(&g_LogLock);
+
+	if (callback)
+		callback(Level, Message, userData);
+}
+
+//
+// Formats and sinks all published records. Called with g_LogDrainLock held.
+// 
+static VOID vigem_internal_log_drain()
+{
+	VIGEM_LOG_MESSAGE message;
+
+	for (PVIGEM_LOG_RING ring = g_LogRings; ring; ring = ring->Next)
+	{
+		const LONGLONG head = ring->Head;
+		LONGLONG tail = ring->Tail;
+
+		MemoryBarrier();
+
+		for (; tail < head; tail++)
+		{
+			const VIGEM_LOG_RECORD& record = ring->Records[tail & (VIGEM_LOG_RING_RECORDS - 1)];
+
+			message.Length = 0;
+			message.Print(L"[%ls:", record.Function);
+			message.Print(L"%lu] ", static_cast<unsigned long>(record.Line));
+			vigem_internal_log_format(record, message);
+			message.Text[message.Length] = L'\0';
+
+			vigem_internal_log_sink(static_cast<VIGEM_LOG_LEVEL>(record.Level), record.Timestamp, record.ThreadId, message.Text);
+		}
+
+		// hand the slots back only once the records were read
+		InterlockedExchange64(&ring->Tail, tail);
+
+		const LONG dropped = ring->Dropped;
+
+		if (dropped != ring->DroppedReported)
+		{
+			message.Length = 0;
+			message.Print(L"[log] %ld messages dropped, the logging thread fell behind", static_cast<long>(dropped - ring->DroppedReported));
+			message.Text[message.Length] = L'\0';
+
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+
+			vigem_internal_log_sink(VIGEM_LOG_LEVEL_WARNING, now.QuadPart, 0, message.Text);
+			ring->DroppedReported = dropped;
+		}
+	}
+}
+
+VIGEM_ERROR vigem_log_set_level(VIGEM_LOG_LEVEL level)
+{
+	if (level < VIGEM_LOG_LEVEL_NONE || level > VIGEM_LOG_LEVEL_VERBOSE)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	InterlockedExchange(&g_LogLevel, level);
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_log_set_debugger(BOOLEAN enable)
+{
+	AcquireSRWLockExclusive(&g_LogLock);
+	g_LogDebugger = enable;
+	ReleaseSRWLockExclusive(&g_LogLock);
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_log_set_file(LPCWSTR path)
+{
+	// whatever is pending still belongs to the old file
+	vigem_internal_log_flush_pending();
+
+	HANDLE file = INVALID_HANDLE_VALUE;
+
+	if (path)
+	{
+		file = CreateFileW(
+			path,
+			GENERIC_WRITE,
+			FILE_SHARE_READ,
+			nullptr,
+			CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL,
+			nullptr
+		);
+	}
+
+	AcquireSRWLockExclusive(&g_LogLock);
+
+	const HANDLE previous = g_LogFile;
+	g_LogFile = file;
+
+	ReleaseSRWLockExclusive(&g_LogLock);
+
+	if (previous != INVALID_HANDLE_VALUE)
+		CloseHandle(previous);
+
+	return (!path || file != INVALID_HANDLE_VALUE) ? VIGEM_ERROR_NONE : VIGEM_ERROR_WINAPI;
+}
+
+VIGEM_ERROR vigem_log_set_callback(PFN_VIGEM_LOG callback, LPVOID userData)
+{
+	vigem_internal_log_flush_pending();
+
+	AcquireSRWLockExclusive(&g_LogLock);
+
+	g_LogCallback = callback;
+	g_LogCallbackUserData = userData;
+
+	ReleaseSRWLockExclusive(&g_LogLock);
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_log_set_thread_config(const VIGEM_THREAD_CONFIG* config)
+{
+	if (config)
+	{
+		const VIGEM_ERROR error = vigem_internal_thread_config_check(config);
+
+		if (!VIGEM_SUCCESS(error))
+			return error;
+	}
+
+	AcquireSRWLockExclusive(&g_LogLock);
+
+	if (config)
+		g_LogThreadConfig = *config;
+	else
+		RtlZeroMemory(&g_LogThreadConfig, sizeof(VIGEM_THREAD_CONFIG));
+
+	ReleaseSRWLockExclusive(&g_LogLock);
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_log_flush(void)
+{
+	vigem_internal_log_flush_pending();
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_log_shutdown(void)
+{
+	//
+	// The logging thread can't join itself, and a callback flushing on
+	// another thread holds up the drain the logging thread may wait for
+	// 
+	if (g_LogDraining || GetCurrentThreadId() == g_LogThreadId)
+		return VIGEM_ERROR_NOT_SUPPORTED;
+
+	//
+	// Taken over under the lock but joined without it, the callback running
+	// on the thread may need it to get a ring
+	// 
+	AcquireSRWLockExclusive(&g_LogStartLock);
+
+	const HANDLE thread = g_LogThreadHandle;
+	g_LogThreadHandle = nullptr;
+
+	ReleaseSRWLockExclusive(&g_LogStartLock);
+
+	if (thread)
+	{
+		SetEvent(g_LogStop);
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+	}
+
+	// unlocked, the callback may log and start the thread again
+	vigem_internal_log_flush_pending();
+
+	//
+	// Frees the rings of the calling thread and of threads that exited, so
+	// the library holds no memory once its other objects are freed. Rings of
+	// other running threads and ones not drained yet are kept.
+	// 
+	AcquireSRWLockExclusive(&g_LogStartLock);
+	AcquireSRWLockExclusive(&g_LogDrainLock);
+
+	VIGEM_LOG_THREAD& self = g_LogThread;
+
+	if (self.Ring && self.Ring->Head == self.Ring->Tail)
+	{
+		InterlockedExchange(&self.Ring->InUse, 0);
+		self.Ring = nullptr;
+	}
+
+	for (PVIGEM_LOG_RING* link = const_cast<PVIGEM_LOG_RING*>(&g_LogRings); *link;)
+	{
+		const PVIGEM_LOG_RING ring = *link;
+
+		if (ring->Head == ring->Tail && InterlockedCompareExchange(&ring->InUse, 1, 0) == 0)
+		{
+			*link = ring->Next;
+			vigem_internal_free(ring);
+		}
+		else
+			link = &ring->Next;
+	}
+
+	if (!g_LogThreadHandle)
+		InterlockedExchange(&g_LogThreadStarted, 0);
+
+	ReleaseSRWLockExclusive(&g_LogDrainLock);
+	ReleaseSRWLockExclusive(&g_LogStartLock);
+
+	return vigem_log_set_file(nullptr);
+}
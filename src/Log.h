@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ViGEm/Log.h"
+
+#include <type_traits>
+#include <cstring>
+
+//
+// A log call as copied by the logging thread. Format is the static format
+// string of the call site and doubles as its message id; the arguments are
+// only interpreted according to it when formatted.
+//
+typedef struct _VIGEM_LOG_RECORD
+{
+    LONGLONG Timestamp;
+    LPCWSTR Format;
+    LPCWSTR Function;
+    ULONG Line;
+    DWORD ThreadId;
+    UCHAR Level;
+    UCHAR ArgCount;
+    ULONGLONG Args[VIGEM_LOG_MAX_ARGS];
+} VIGEM_LOG_RECORD, *PVIGEM_LOG_RECORD;
+
+//
+// Single-producer single-consumer record ring of one thread. The owning
+// thread advances Head, the thread formatting the records advances Tail.
+// Rings are reused by later threads once their owner exited.
+//
+typedef struct alignas(64) _VIGEM_LOG_RING
+{
+    struct _VIGEM_LOG_RING* Next;
+    volatile LONG InUse;
+    volatile LONGLONG Head;
+    volatile LONGLONG Tail;
+    //
+    // Records that didn't fit, and how many of those were reported
+    //
+    volatile LONG Dropped;
+    LONG DroppedReported;
+    VIGEM_LOG_RECORD Records[VIGEM_LOG_RING_RECORDS];
+} VIGEM_LOG_RING, *PVIGEM_LOG_RING;
+
+extern volatile LONG g_LogLevel;
+
+//
+// Copies a log call into the calling thread's ring.
+//
+VOID vigem_internal_log_write(
+    VIGEM_LOG_LEVEL Level,
+    LPCWSTR Function,
+    ULONG Line,
+    LPCWSTR Format,
+    const ULONGLONG* Args,
+    ULONG ArgCount
+);
+
+template <typename T>
+FORCEINLINE typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, ULONGLONG>::type
+vigem_internal_log_arg(T Value)
+{
+    // sign-extends signed values, the format picks the width again
+    return static_cast<ULONGLONG>(static_cast<LONGLONG>(Value));
+}
+
+template <typename T>
+FORCEINLINE ULONGLONG vigem_internal_log_arg(T* Value)
+{
+    return static_cast<ULONGLONG>(reinterpret_cast<ULONG_PTR>(Value));
+}
+
+FORCEINLINE ULONGLONG vigem_internal_log_arg(double Value)
+{
+    ULONGLONG bits;
+    memcpy(&bits, &Value, sizeof(bits));
+    return bits;
+}
+
+template <typename... TArgs>
+FORCEINLINE VOID vigem_internal_log(
+    VIGEM_LOG_LEVEL Level,
+    LPCWSTR Function,
+    ULONG Line,
+    LPCWSTR Format,
+    TArgs... Args
+)
+{
+    static_assert(sizeof...(TArgs) <= VIGEM_LOG_MAX_ARGS, "too many log arguments");
+
+    const ULONGLONG args[sizeof...(TArgs) + 1] = { vigem_internal_log_arg(Args)..., 0 };
+
+    vigem_internal_log_write(Level, Function, Line, Format, args, sizeof...(TArgs));
+}
+
+//
+// Logs a printf style message. The format must be a string literal, string
+// arguments must be static as they're only read when the message is
+// formatted, widths and precisions must be literal.
+//
+#define VIGEM_LOG(_level_, ...) \
+    do { if (static_cast<LONG>(_level_) <= g_LogLevel) vigem_internal_log((_level_), __FUNCTIONW__, __LINE__, __VA_ARGS__); } while (0)
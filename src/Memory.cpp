@@ -0,0 +1,114 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/Client.h"
+#include "ViGEm/Memory.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+
+//
+// Internal
+// 
+#include "Memory.h"
+
+
+//
+// Size 0 selects the CRT heap. Only replaced while no block is live, so a
+// block is always freed by the allocator it came from; allocations hold the
+// lock shared to not race with that.
+// 
+static VIGEM_ALLOCATOR g_Allocator = { 0 };
+static SRWLOCK g_AllocatorLock = SRWLOCK_INIT;
+static volatile LONG g_LiveAllocations = 0;
+
+PVOID vigem_internal_alloc_aligned(SIZE_T Size, SIZE_T Alignment)
+{
+	if (Alignment < MEMORY_ALLOCATION_ALIGNMENT)
+		Alignment = MEMORY_ALLOCATION_ALIGNMENT;
+
+	AcquireSRWLockShared(&g_AllocatorLock);
+
+	const PVOID memory = g_Allocator.Size
+		? g_Allocator.Alloc(Size ? Size : 1, Alignment, g_Allocator.Context)
+		: _aligned_malloc(Size ? Size : 1, Alignment);
+
+	if (memory)
+		InterlockedIncrement(&g_LiveAllocations);
+
+	ReleaseSRWLockShared(&g_AllocatorLock);
+
+	return memory;
+}
+
+VOID vigem_internal_free(PVOID Memory)
+{
+	if (!Memory)
+		return;
+
+	//
+	// Can't change before the count drops
+	// 
+	if (g_Allocator.Size)
+		g_Allocator.Free(Memory, g_Allocator.Context);
+	else
+		_aligned_free(Memory);
+
+	InterlockedDecrement(&g_LiveAllocations);
+}
+
+VIGEM_ERROR vigem_set_allocator(const VIGEM_ALLOCATOR* allocator)
+{
+	if (allocator && (allocator->Size != sizeof(VIGEM_ALLOCATOR) || !allocator->Alloc || !allocator->Free))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	AcquireSRWLockExclusive(&g_AllocatorLock);
+
+	if (g_LiveAllocations != 0)
+	{
+		ReleaseSRWLockExclusive(&g_AllocatorLock);
+		return VIGEM_ERROR_NOT_SUPPORTED;
+	}
+
+	if (allocator)
+		g_Allocator = *allocator;
+	else
+		RtlZeroMemory(&g_Allocator, sizeof(VIGEM_ALLOCATOR));
+
+	ReleaseSRWLockExclusive(&g_AllocatorLock);
+
+	return VIGEM_ERROR_NONE;
+}
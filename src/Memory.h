@@ -0,0 +1,31 @@
+#pragma once
+
+//
+// Heap memory of the library, from the allocator set by vigem_set_allocator
+// or the CRT heap. Blocks are aligned to MEMORY_ALLOCATION_ALIGNMENT at least
+// and all of them are returned with vigem_internal_free.
+//
+PVOID vigem_internal_alloc_aligned(SIZE_T Size, SIZE_T Alignment);
+
+VOID vigem_internal_free(PVOID Memory);
+
+FORCEINLINE PVOID vigem_internal_alloc(SIZE_T Size)
+{
+    return vigem_internal_alloc_aligned(Size, MEMORY_ALLOCATION_ALIGNMENT);
+}
+
+//
+// Zeroed array of Count elements, NULL if the size overflows.
+//
+FORCEINLINE PVOID vigem_internal_calloc(SIZE_T Count, SIZE_T Size)
+{
+    if (Size && Count > static_cast<SIZE_T>(-1) / Size)
+        return nullptr;
+
+    const PVOID memory = vigem_internal_alloc(Count * Size);
+
+    if (memory)
+        RtlZeroMemory(memory, Count * Size);
+
+    return memory;
+}
@@ -0,0 +1,441 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// Driver shared
+//
+#include "ViGEm/Motion.h"
+
+//
+// STL
+//
+#include <cstdlib>
+#include <cmath>
+#include <climits>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#define VIGEM_MOTION_SSE2
+#endif
+
+//
+// Internal
+// 
+#include "Memory.h"
+
+
+//
+// Interpolated channels of a keyframe: orientation (W, X, Y, Z), angular
+// velocity (X, Y, Z) and linear acceleration (X, Y, Z).
+//
+#define VIGEM_MOTION_CHANNELS       10
+
+//
+// Synthesized report channels: gyroscope (X, Y, Z) and accelerometer (X, Y, Z).
+//
+#define VIGEM_MOTION_OUTPUTS        6
+
+//
+// Radians per second to raw gyroscope units.
+//
+#define VIGEM_MOTION_GYRO_SCALE     (VIGEM_MOTION_GYRO_RESOLUTION * 57.2957795f)
+
+//
+// Represents a motion synthesis engine. Keyframes are kept as structure of
+// arrays so four pads are blended per SSE2 iteration.
+//
+typedef struct _VIGEM_MOTION_ENGINE_T
+{
+	ULONG Capacity;
+
+	//
+	// Two most recent samples per pad and the number of samples seen (0 - 2).
+	//
+	PULONGLONG PreviousTimestamp;
+	PULONGLONG CurrentTimestamp;
+	PFLOAT Previous[VIGEM_MOTION_CHANNELS];
+	PFLOAT Current[VIGEM_MOTION_CHANNELS];
+	PUCHAR Samples;
+
+	//
+	// Per call scratch: blend factors and raw sensor values.
+	//
+	PFLOAT Blend;
+	PSHORT Output[VIGEM_MOTION_OUTPUTS];
+
+	PVOID Memory;
+} VIGEM_MOTION_ENGINE;
+
+static FORCEINLINE SHORT vigem_internal_motion_saturate(FLOAT Value)
+{
+	const FLOAT rounded = std::nearbyint(Value);
+
+	if (!(rounded > -32768.0f))
+		return SHRT_MIN;
+
+	if (rounded > 32767.0f)
+		return SHRT_MAX;
+
+	return static_cast<SHORT>(rounded);
+}
+
+static void vigem_internal_motion_store(PFLOAT* Keyframe, ULONG Index, const VIGEM_MOTION_SAMPLE* Sample)
+{
+	for (int i = 0; i < 4; i++)
+		Keyframe[i][Index] = Sample->Orientation[i];
+
+	for (int i = 0; i < 3; i++)
+	{
+		Keyframe[4 + i][Index] = Sample->AngularVelocity[i];
+		Keyframe[7 + i][Index] = Sample->Acceleration[i];
+	}
+}
+
+//
+// Blends the keyframes of one pad and converts to raw sensor units, scalar
+// reference path.
+//
+static void vigem_internal_motion_blend(PVIGEM_MOTION_ENGINE Engine, ULONG Begin, ULONG End)
+{
+	for (ULONG i = Begin; i < End; i++)
+	{
+		const FLOAT t = Engine->Blend[i];
+		FLOAT previous[VIGEM_MOTION_CHANNELS];
+		FLOAT current[VIGEM_MOTION_CHANNELS];
+		FLOAT blended[VIGEM_MOTION_CHANNELS];
+
+		for (int channel = 0; channel < VIGEM_MOTION_CHANNELS; channel++)
+		{
+			previous[channel] = Engine->Previous[channel][i];
+			current[channel] = Engine->Current[channel][i];
+		}
+
+		// q and -q are the same rotation, blend along the shorter arc
+		const FLOAT dot = previous[0] * current[0] + previous[1] * current[1]
+			+ previous[2] * current[2] + previous[3] * current[3];
+
+		if (dot < 0.0f)
+		{
+			for (int channel = 0; channel < 4; channel++)
+				current[channel] = -current[channel];
+		}
+
+		for (int channel = 0; channel < VIGEM_MOTION_CHANNELS; channel++)
+			blended[channel] = previous[channel] + t * (current[channel] - previous[channel]);
+
+		const FLOAT length = blended[0] * blended[0] + blended[1] * blended[1]
+			+ blended[2] * blended[2] + blended[3] * blended[3];
+		const FLOAT norm = 1.0f / std::sqrt(length > 1e-12f ? length : 1e-12f);
+		const FLOAT w = blended[0] * norm;
+		const FLOAT x = blended[1] * norm;
+		const FLOAT y = blended[2] * norm;
+		const FLOAT z = blended[3] * norm;
+
+		// world up (+Y) rotated into the device frame
+		const FLOAT gravity[3] =
+		{
+			2.0f * (x * y + w * z),
+			1.0f - 2.0f * (x * x + z * z),
+			2.0f * (y * z - w * x)
+		};
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			Engine->Output[axis][i] = vigem_internal_motion_saturate(
+				blended[4 + axis] * VIGEM_MOTION_GYRO_SCALE
+			);
+			Engine->Output[3 + axis][i] = vigem_internal_motion_saturate(
+				(gravity[axis] + blended[7 + axis]) * VIGEM_MOTION_ACCEL_RESOLUTION
+			);
+		}
+	}
+}
+
+#if defined(VIGEM_MOTION_SSE2)
+
+static FORCEINLINE __m128 vigem_internal_motion_lerp_sse2(__m128 From, __m128 To, __m128 T)
+{
+	return _mm_add_ps(From, _mm_mul_ps(T, _mm_sub_ps(To, From)));
+}
+
+//
+// Rounds four floats to the nearest integer and saturates them to SHORT.
+//
+static FORCEINLINE void vigem_internal_motion_saturate_sse2(__m128 Values, PSHORT Out)
+{
+	// keep the conversion in range, out of range lanes would become 0x80000000
+	const __m128 clamped = _mm_min_ps(_mm_max_ps(Values, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+	const __m128i words = _mm_cvtps_epi32(clamped);
+
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(Out), _mm_packs_epi32(words, words));
+}
+
+//
+// Blends the keyframes of four pads at once.
+//
+static void vigem_internal_motion_blend_sse2(PVIGEM_MOTION_ENGINE Engine, ULONG Index)
+{
+	const __m128 t = _mm_load_ps(&Engine->Blend[Index]);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	__m128 previous[VIGEM_MOTION_CHANNELS];
+	__m128 current[VIGEM_MOTION_CHANNELS];
+	__m128 blended[VIGEM_MOTION_CHANNELS];
+
+	for (int channel = 0; channel < VIGEM_MOTION_CHANNELS; channel++)
+	{
+		previous[channel] = _mm_load_ps(&Engine->Previous[channel][Index]);
+		current[channel] = _mm_load_ps(&Engine->Current[channel][Index]);
+	}
+
+	// flip the lanes whose dot product is negative onto the shorter arc
+	const __m128 dot = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(previous[0], current[0]), _mm_mul_ps(previous[1], current[1])),
+		_mm_add_ps(_mm_mul_ps(previous[2], current[2]), _mm_mul_ps(previous[3], current[3]))
+	);
+	const __m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), signMask);
+
+	for (int channel = 0; channel < 4; channel++)
+		current[channel] = _mm_xor_ps(current[channel], flip);
+
+	for (int channel = 0; channel < VIGEM_MOTION_CHANNELS; channel++)
+		blended[channel] = vigem_internal_motion_lerp_sse2(previous[channel], current[channel], t);
+
+	const __m128 length = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(blended[0], blended[0]), _mm_mul_ps(blended[1], blended[1])),
+		_mm_add_ps(_mm_mul_ps(blended[2], blended[2]), _mm_mul_ps(blended[3], blended[3]))
+	);
+	// full precision division, rsqrt alone is off by up to 12 bits of LSB
+	const __m128 norm = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(length, _mm_set1_ps(1e-12f))));
+	const __m128 w = _mm_mul_ps(blended[0], norm);
+	const __m128 x = _mm_mul_ps(blended[1], norm);
+	const __m128 y = _mm_mul_ps(blended[2], norm);
+	const __m128 z = _mm_mul_ps(blended[3], norm);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	const __m128 gravity[3] =
+	{
+		_mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, y), _mm_mul_ps(w, z))),
+		_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(two, _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)))),
+		_mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(y, z), _mm_mul_ps(w, x)))
+	};
+
+	const __m128 gyroScale = _mm_set1_ps(VIGEM_MOTION_GYRO_SCALE);
+	const __m128 accelScale = _mm_set1_ps(VIGEM_MOTION_ACCEL_RESOLUTION);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		vigem_internal_motion_saturate_sse2(
+			_mm_mul_ps(blended[4 + axis], gyroScale), &Engine->Output[axis][Index]
+		);
+		vigem_internal_motion_saturate_sse2(
+			_mm_mul_ps(_mm_add_ps(gravity[axis], blended[7 + axis]), accelScale), &Engine->Output[3 + axis][Index]
+		);
+	}
+}
+
+#endif
+
+PVIGEM_MOTION_ENGINE vigem_motion_alloc(ULONG capacity)
+{
+	if (capacity == 0)
+		return nullptr;
+
+	const auto engine = static_cast<PVIGEM_MOTION_ENGINE>(vigem_internal_alloc(sizeof(VIGEM_MOTION_ENGINE)));
+
+	if (!engine)
+		return nullptr;
+
+	RtlZeroMemory(engine, sizeof(VIGEM_MOTION_ENGINE));
+
+	const SIZE_T padded = (static_cast<SIZE_T>(capacity) + 15) & ~static_cast<SIZE_T>(15);
+	const SIZE_T size = padded * (
+		2 * sizeof(ULONGLONG)
+		+ (2 * VIGEM_MOTION_CHANNELS + 1) * sizeof(FLOAT)
+		+ VIGEM_MOTION_OUTPUTS * sizeof(SHORT)
+		+ sizeof(UCHAR)
+		);
+
+	engine->Memory = vigem_internal_alloc_aligned(size, 64);
+
+	if (!engine->Memory)
+	{
+		vigem_internal_free(engine);
+		return nullptr;
+	}
+
+	RtlZeroMemory(engine->Memory, size);
+
+	auto cursor = static_cast<PUCHAR>(engine->Memory);
+
+	engine->PreviousTimestamp = reinterpret_cast<PULONGLONG>(cursor);
+	cursor += padded * sizeof(ULONGLONG);
+	engine->CurrentTimestamp = reinterpret_cast<PULONGLONG>(cursor);
+	cursor += padded * sizeof(ULONGLONG);
+
+	for (ULONG channel = 0; channel < VIGEM_MOTION_CHANNELS; channel++)
+	{
+		engine->Previous[channel] = reinterpret_cast<PFLOAT>(cursor);
+		cursor += padded * sizeof(FLOAT);
+		engine->Current[channel] = reinterpret_cast<PFLOAT>(cursor);
+		cursor += padded * sizeof(FLOAT);
+	}
+
+	engine->Blend = reinterpret_cast<PFLOAT>(cursor);
+	cursor += padded * sizeof(FLOAT);
+
+	for (ULONG output = 0; output < VIGEM_MOTION_OUTPUTS; output++)
+	{
+		engine->Output[output] = reinterpret_cast<PSHORT>(cursor);
+		cursor += padded * sizeof(SHORT);
+	}
+
+	engine->Samples = cursor;
+	engine->Capacity = capacity;
+
+	for (ULONG index = 0; index < capacity; index++)
+	{
+		vigem_motion_reset(engine, index);
+	}
+
+	return engine;
+}
+
+void vigem_motion_free(PVIGEM_MOTION_ENGINE engine)
+{
+	if (engine)
+	{
+		vigem_internal_free(engine->Memory);
+
+		vigem_internal_free(engine);
+	}
+}
+
+VIGEM_ERROR vigem_motion_push(PVIGEM_MOTION_ENGINE engine, ULONG index, const VIGEM_MOTION_SAMPLE* sample)
+{
+	if (!engine || !sample || index >= engine->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (engine->Samples[index] == 0)
+	{
+		//
+		// First sample, hold it until the next one arrives
+		// 
+		vigem_internal_motion_store(engine->Previous, index, sample);
+		engine->PreviousTimestamp[index] = sample->Timestamp;
+		engine->Samples[index] = 1;
+	}
+	else
+	{
+		for (ULONG channel = 0; channel < VIGEM_MOTION_CHANNELS; channel++)
+		{
+			engine->Previous[channel][index] = engine->Current[channel][index];
+		}
+
+		engine->PreviousTimestamp[index] = engine->CurrentTimestamp[index];
+		engine->Samples[index] = 2;
+	}
+
+	vigem_internal_motion_store(engine->Current, index, sample);
+	engine->CurrentTimestamp[index] = sample->Timestamp;
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_motion_reset(PVIGEM_MOTION_ENGINE engine, ULONG index)
+{
+	if (!engine || index >= engine->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	VIGEM_MOTION_SAMPLE rest;
+	RtlZeroMemory(&rest, sizeof(VIGEM_MOTION_SAMPLE));
+	rest.Orientation[0] = 1.0f;
+
+	vigem_internal_motion_store(engine->Previous, index, &rest);
+	vigem_internal_motion_store(engine->Current, index, &rest);
+	engine->PreviousTimestamp[index] = 0;
+	engine->CurrentTimestamp[index] = 0;
+	engine->Samples[index] = 0;
+
+	return VIGEM_ERROR_NONE;
+}
+
+VIGEM_ERROR vigem_motion_synthesize(
+	PVIGEM_MOTION_ENGINE engine,
+	ULONGLONG timestamp,
+	PDS4_REPORT_EX reports,
+	ULONG count
+)
+{
+	if (!engine || !reports || count > engine->Capacity)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	//
+	// Blend factors stay scalar, they need 64-bit timestamp math
+	// 
+	for (ULONG i = 0; i < count; i++)
+	{
+		const ULONGLONG previous = engine->PreviousTimestamp[i];
+		const ULONGLONG duration = engine->CurrentTimestamp[i] - previous;
+
+		if (engine->Samples[i] < 2 || duration == 0 || timestamp >= previous + duration)
+			engine->Blend[i] = 1.0f;
+		else if (timestamp <= previous)
+			engine->Blend[i] = 0.0f;
+		else
+			engine->Blend[i] = static_cast<FLOAT>(static_cast<double>(timestamp - previous) / duration);
+	}
+
+	ULONG i = 0;
+
+#if defined(VIGEM_MOTION_SSE2)
+	for (; i + 4 <= count; i += 4)
+	{
+		vigem_internal_motion_blend_sse2(engine, i);
+	}
+#endif
+
+	vigem_internal_motion_blend(engine, i, count);
+
+	// the DS4 timestamp counts in units of 16/3 microseconds
+	const auto ds4Timestamp = static_cast<USHORT>(timestamp * 3 / 16);
+
+	for (i = 0; i < count; i++)
+	{
+		reports[i].Report.wTimestamp = ds4Timestamp;
+		reports[i].Report.wGyroX = engine->Output[0][i];
+		reports[i].Report.wGyroY = engine->Output[1][i];
+		reports[i].Report.wGyroZ = engine->Output[2][i];
+		reports[i].Report.wAccelX = engine->Output[3][i];
+		reports[i].Report.wAccelY = engine->Output[4][i];
+		reports[i].Report.wAccelZ = engine->Output[5][i];
+	}
+
+	return VIGEM_ERROR_NONE;
+}
@@ -0,0 +1,450 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Record.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+#include <climits>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "Recorder.h"
+#include "Memory.h"
+
+
+//
+// Represents a recording opened for reading.
+// 
+typedef struct _VIGEM_RECORDING_T
+{
+	HANDLE hFile;
+	HANDLE hMapping;
+	PUCHAR View;
+	ULONGLONG End;
+} VIGEM_RECORDING;
+
+//
+// Slab the calling thread currently appends to.
+// 
+typedef struct _VIGEM_RECORDER_SLAB
+{
+	LONGLONG RecorderId;
+	PUCHAR Cursor;
+	PUCHAR End;
+} VIGEM_RECORDER_SLAB;
+
+static thread_local VIGEM_RECORDER_SLAB g_RecorderSlab;
+
+static volatile LONGLONG g_RecorderId;
+
+//
+// Grows the file to cover the chunk and maps it. Serialized, every chunk is
+// mapped once per recording.
+// 
+static PUCHAR vigem_internal_recorder_map_chunk(PVIGEM_RECORDER Recorder, LONGLONG Chunk)
+{
+	EnterCriticalSection(&Recorder->ChunkLock);
+
+	PUCHAR view = Recorder->Chunks[Chunk];
+
+	if (!view)
+	{
+		ULARGE_INTEGER size, offset;
+		size.QuadPart = static_cast<ULONGLONG>(Chunk + 1) * VIGEM_RECORDING_CHUNK_SIZE;
+		offset.QuadPart = static_cast<ULONGLONG>(Chunk) * VIGEM_RECORDING_CHUNK_SIZE;
+
+		const HANDLE hMapping = CreateFileMapping(
+			Recorder->hFile,
+			nullptr,
+			PAGE_READWRITE,
+			size.HighPart,
+			size.LowPart,
+			nullptr
+		);
+
+		if (hMapping)
+		{
+			view = static_cast<PUCHAR>(MapViewOfFile(
+				hMapping,
+				FILE_MAP_WRITE,
+				offset.HighPart,
+				offset.LowPart,
+				VIGEM_RECORDING_CHUNK_SIZE
+			));
+
+			// the view keeps the mapping alive
+			CloseHandle(hMapping);
+		}
+
+		if (view)
+			InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&Recorder->Chunks[Chunk]), view);
+	}
+
+	LeaveCriticalSection(&Recorder->ChunkLock);
+
+	return view;
+}
+
+//
+// Hands out the next free slab of the file.
+// 
+static PUCHAR vigem_internal_recorder_claim_slab(PVIGEM_RECORDER Recorder)
+{
+	const LONGLONG slab = InterlockedIncrement64(&Recorder->NextSlab) - 1;
+	const LONGLONG chunk = slab / VIGEM_RECORDING_SLABS_PER_CHUNK;
+
+	if (chunk >= VIGEM_RECORDING_MAX_CHUNKS)
+		return nullptr;
+
+	PUCHAR view = Recorder->Chunks[chunk];
+
+	if (!view)
+		view = vigem_internal_recorder_map_chunk(Recorder, chunk);
+
+	if (!view)
+		return nullptr;
+
+	return view + (slab % VIGEM_RECORDING_SLABS_PER_CHUNK) * VIGEM_RECORDING_SLAB_SIZE;
+}
+
+VOID vigem_internal_record(
+	PVIGEM_CLIENT vigem,
+	VIGEM_RECORD_TYPE Type,
+	ULONG SerialNo,
+	LONGLONG Timestamp,
+	const VOID* Report,
+	USHORT ReportSize
+)
+{
+	//
+	// vigem_record_stop waits for this count to drop to zero before it frees
+	// the recorder, so it stays valid until we're done
+	// 
+	InterlockedIncrement(&vigem->RecordWriters);
+
+	const PVIGEM_RECORDER recorder = vigem->Recorder;
+
+	if (recorder)
+	{
+		const SIZE_T needed = (sizeof(VIGEM_RECORD) + ReportSize + 7) & ~static_cast<SIZE_T>(7);
+		VIGEM_RECORDER_SLAB& slab = g_RecorderSlab;
+
+		if (slab.RecorderId != recorder->Id || static_cast<SIZE_T>(slab.End - slab.Cursor) < needed)
+		{
+			// the rest of the old slab is still zeroed, which terminates it
+			slab.RecorderId = recorder->Id;
+			slab.Cursor = vigem_internal_recorder_claim_slab(recorder);
+			slab.End = slab.Cursor ? slab.Cursor + VIGEM_RECORDING_SLAB_SIZE : nullptr;
+		}
+
+		if (slab.Cursor)
+		{
+			const auto record = reinterpret_cast<PVIGEM_RECORD>(slab.Cursor);
+
+			record->Type = static_cast<USHORT>(Type);
+			record->ReportSize = ReportSize;
+			record->SerialNo = SerialNo;
+			record->Timestamp = Timestamp;
+			RtlCopyMemory(record + 1, Report, ReportSize);
+			// size last, a crashed process leaves no half-written record behind
+			record->Size = static_cast<ULONG>(needed);
+
+			slab.Cursor += needed;
+		}
+		else
+		{
+			InterlockedIncrement64(&recorder->DroppedRecords);
+		}
+	}
+
+	InterlockedDecrement(&vigem->RecordWriters);
+}
+
+VIGEM_ERROR vigem_record_start(PVIGEM_CLIENT vigem, LPCWSTR path)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!path)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	vigem_record_stop(vigem);
+
+	const auto recorder = static_cast<PVIGEM_RECORDER>(vigem_internal_alloc(sizeof(VIGEM_RECORDER)));
+
+	if (!recorder)
+		return VIGEM_ERROR_WINAPI;
+
+	RtlZeroMemory(recorder, sizeof(VIGEM_RECORDER));
+
+	recorder->hFile = CreateFileW(
+		path,
+		GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ,
+		nullptr,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+
+	if (recorder->hFile == INVALID_HANDLE_VALUE)
+	{
+		vigem_internal_free(recorder);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	InitializeCriticalSection(&recorder->ChunkLock);
+
+	recorder->Id = InterlockedIncrement64(&g_RecorderId);
+	// slab 0 holds the header
+	recorder->NextSlab = 1;
+
+	const auto header = reinterpret_cast<PVIGEM_RECORDING_HEADER>(vigem_internal_recorder_map_chunk(recorder, 0));
+
+	if (!header)
+	{
+		DeleteCriticalSection(&recorder->ChunkLock);
+		CloseHandle(recorder->hFile);
+		vigem_internal_free(recorder);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+
+	header->Magic = VIGEM_RECORDING_MAGIC;
+	header->Version = VIGEM_RECORDING_VERSION;
+	header->HeaderSize = sizeof(VIGEM_RECORDING_HEADER);
+	header->SlabSize = VIGEM_RECORDING_SLAB_SIZE;
+	header->TimestampFrequency = frequency.QuadPart;
+	header->StartTimestamp = now.QuadPart;
+
+	InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&vigem->Recorder), recorder);
+
+	return VIGEM_ERROR_NONE;
+}
+
+void vigem_record_stop(PVIGEM_CLIENT vigem)
+{
+	if (!vigem)
+		return;
+
+	const auto recorder = static_cast<PVIGEM_RECORDER>(
+		InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&vigem->Recorder), nullptr)
+	);
+
+	if (!recorder)
+		return;
+
+	//
+	// Writers that picked up the recorder before it was detached finish first
+	// 
+	while (vigem->RecordWriters != 0)
+		SwitchToThread();
+
+	const LONGLONG maxSlabs = static_cast<LONGLONG>(VIGEM_RECORDING_MAX_CHUNKS) * VIGEM_RECORDING_SLABS_PER_CHUNK;
+	const LONGLONG slabCount = (recorder->NextSlab < maxSlabs) ? recorder->NextSlab : maxSlabs;
+
+	const auto header = reinterpret_cast<PVIGEM_RECORDING_HEADER>(recorder->Chunks[0]);
+	header->SlabCount = slabCount;
+	header->DroppedRecords = recorder->DroppedRecords;
+
+	for (ULONG chunk = 0; chunk < VIGEM_RECORDING_MAX_CHUNKS; chunk++)
+	{
+		if (recorder->Chunks[chunk])
+			UnmapViewOfFile(recorder->Chunks[chunk]);
+	}
+
+	//
+	// Drop the unused tail of the last chunk
+	// 
+	LARGE_INTEGER size;
+	size.QuadPart = slabCount * VIGEM_RECORDING_SLAB_SIZE;
+
+	if (SetFilePointerEx(recorder->hFile, size, nullptr, FILE_BEGIN))
+		SetEndOfFile(recorder->hFile);
+
+	CloseHandle(recorder->hFile);
+	DeleteCriticalSection(&recorder->ChunkLock);
+	vigem_internal_free(recorder);
+}
+
+VIGEM_ERROR vigem_recording_open(LPCWSTR path, PVIGEM_RECORDING* recording)
+{
+	if (!path || !recording)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	*recording = nullptr;
+
+	const auto reader = static_cast<PVIGEM_RECORDING>(vigem_internal_alloc(sizeof(VIGEM_RECORDING)));
+
+	if (!reader)
+		return VIGEM_ERROR_WINAPI;
+
+	RtlZeroMemory(reader, sizeof(VIGEM_RECORDING));
+
+	VIGEM_ERROR error = VIGEM_ERROR_WINAPI;
+	LARGE_INTEGER size;
+
+	do
+	{
+		reader->hFile = CreateFileW(
+			path,
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr
+		);
+
+		if (reader->hFile == INVALID_HANDLE_VALUE)
+			break;
+
+		if (!GetFileSizeEx(reader->hFile, &size))
+			break;
+
+		if (size.QuadPart < VIGEM_RECORDING_SLAB_SIZE
+			|| static_cast<ULONGLONG>(size.QuadPart) > static_cast<ULONGLONG>(SIZE_MAX))
+		{
+			error = VIGEM_ERROR_INVALID_PARAMETER;
+			break;
+		}
+
+		reader->hMapping = CreateFileMapping(reader->hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+		if (!reader->hMapping)
+			break;
+
+		reader->View = static_cast<PUCHAR>(MapViewOfFile(reader->hMapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (!reader->View)
+			break;
+
+		const auto header = reinterpret_cast<const VIGEM_RECORDING_HEADER*>(reader->View);
+
+		if (header->Magic != VIGEM_RECORDING_MAGIC
+			|| header->Version != VIGEM_RECORDING_VERSION
+			|| header->SlabSize != VIGEM_RECORDING_SLAB_SIZE)
+		{
+			error = VIGEM_ERROR_INVALID_PARAMETER;
+			break;
+		}
+
+		//
+		// Unterminated recordings are read up to the last complete slab
+		// 
+		reader->End = static_cast<ULONGLONG>(size.QuadPart) & ~static_cast<ULONGLONG>(VIGEM_RECORDING_SLAB_SIZE - 1);
+
+		if (header->SlabCount != 0 && header->SlabCount * VIGEM_RECORDING_SLAB_SIZE < reader->End)
+			reader->End = header->SlabCount * VIGEM_RECORDING_SLAB_SIZE;
+
+		*recording = reader;
+
+		return VIGEM_ERROR_NONE;
+
+	} while (FALSE);
+
+	vigem_recording_close(reader);
+
+	return error;
+}
+
+void vigem_recording_close(PVIGEM_RECORDING recording)
+{
+	if (recording)
+	{
+		if (recording->View)
+			UnmapViewOfFile(recording->View);
+
+		if (recording->hMapping)
+			CloseHandle(recording->hMapping);
+
+		if (recording->hFile && recording->hFile != INVALID_HANDLE_VALUE)
+			CloseHandle(recording->hFile);
+
+		vigem_internal_free(recording);
+	}
+}
+
+const VIGEM_RECORDING_HEADER* vigem_recording_get_header(PVIGEM_RECORDING recording)
+{
+	return recording ? reinterpret_cast<const VIGEM_RECORDING_HEADER*>(recording->View) : nullptr;
+}
+
+BOOLEAN vigem_recording_next(
+	PVIGEM_RECORDING recording,
+	PVIGEM_RECORDING_ITERATOR iterator,
+	const VIGEM_RECORD** record
+)
+{
+	if (!recording || !iterator || !record)
+		return FALSE;
+
+	while (iterator->Offset < recording->End)
+	{
+		const ULONGLONG slabEnd = (iterator->Offset & ~static_cast<ULONGLONG>(VIGEM_RECORDING_SLAB_SIZE - 1))
+			+ VIGEM_RECORDING_SLAB_SIZE;
+		const ULONGLONG remaining = slabEnd - iterator->Offset;
+
+		if (remaining >= sizeof(VIGEM_RECORD))
+		{
+			const auto candidate = reinterpret_cast<const VIGEM_RECORD*>(recording->View + iterator->Offset);
+
+			if (candidate->Size >= sizeof(VIGEM_RECORD)
+				&& candidate->Size <= remaining
+				&& sizeof(VIGEM_RECORD) + candidate->ReportSize <= candidate->Size)
+			{
+				iterator->Offset += candidate->Size;
+				*record = candidate;
+
+				return TRUE;
+			}
+		}
+
+		//
+		// Zero size or garbage ends the slab
+		// 
+		iterator->Offset = slabEnd;
+	}
+
+	return FALSE;
+}
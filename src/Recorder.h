@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ViGEm/Record.h"
+
+//
+// Chunks mapped at most, limits a recording to 64 GiB.
+// 
+#define VIGEM_RECORDING_MAX_CHUNKS          4096
+#define VIGEM_RECORDING_SLABS_PER_CHUNK     (VIGEM_RECORDING_CHUNK_SIZE / VIGEM_RECORDING_SLAB_SIZE)
+
+//
+// Represents an active recording.
+// 
+typedef struct _VIGEM_RECORDER_T
+{
+    //
+    // Unique per recording, tells threads their cached slab is stale
+    // 
+    LONGLONG Id;
+    HANDLE hFile;
+    volatile LONGLONG NextSlab;
+    volatile LONGLONG DroppedRecords;
+    CRITICAL_SECTION ChunkLock;
+    PUCHAR volatile Chunks[VIGEM_RECORDING_MAX_CHUNKS];
+} VIGEM_RECORDER, *PVIGEM_RECORDER;
+
+//
+// Appends a submitted report to the active recording, if any. Lock-free: the
+// calling thread writes into its own slab of the mapped file and only takes
+// a lock when a new chunk has to be mapped.
+// 
+VOID vigem_internal_record(
+    PVIGEM_CLIENT vigem,
+    VIGEM_RECORD_TYPE Type,
+    ULONG SerialNo,
+    LONGLONG Timestamp,
+    const VOID* Report,
+    USHORT ReportSize
+);
@@ -0,0 +1,399 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Record.h"
+#include "ViGEm/Replay.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "Memory.h"
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION   0x00000002
+#endif
+
+
+//
+// Represents a replay engine.
+// 
+typedef struct _VIGEM_REPLAY_T
+{
+	PVIGEM_CLIENT Client;
+	PVIGEM_RECORDING Recording;
+
+	//
+	// Records in timestamp order, pointing into the mapped recording
+	// 
+	const VIGEM_RECORD** Index;
+	SIZE_T Count;
+
+	//
+	// Replay target per recorded serial number
+	// 
+	PVIGEM_TARGET* Targets;
+
+	HANDLE hTimer;
+	volatile LONG Abort;
+} VIGEM_REPLAY;
+
+static VOID vigem_internal_replay_free(PVIGEM_REPLAY Replay)
+{
+	if (Replay->Targets)
+	{
+		for (ULONG serialNo = 0; serialNo < VIGEM_TARGETS_MAX; serialNo++)
+		{
+			const PVIGEM_TARGET target = Replay->Targets[serialNo];
+
+			if (target)
+			{
+				vigem_target_remove(Replay->Client, target);
+				vigem_target_free(target);
+			}
+		}
+
+		vigem_internal_free(Replay->Targets);
+	}
+
+	if (Replay->hTimer)
+		CloseHandle(Replay->hTimer);
+
+	vigem_internal_free(Replay->Index);
+	vigem_recording_close(Replay->Recording);
+	vigem_internal_free(Replay);
+}
+
+//
+// Plugs in one target per recorded serial number, typed after its first record.
+// 
+static VIGEM_ERROR vigem_internal_replay_plug_in(PVIGEM_REPLAY Replay)
+{
+	for (SIZE_T i = 0; i < Replay->Count; i++)
+	{
+		const VIGEM_RECORD* record = Replay->Index[i];
+
+		if (record->SerialNo == 0 || record->SerialNo >= VIGEM_TARGETS_MAX || Replay->Targets[record->SerialNo])
+			continue;
+
+		PVIGEM_TARGET target;
+
+		switch (record->Type)
+		{
+		case VIGEM_RECORD_XUSB_REPORT:
+			target = vigem_target_x360_alloc();
+			break;
+		case VIGEM_RECORD_DS4_REPORT:
+		case VIGEM_RECORD_DS4_REPORT_EX:
+			target = vigem_target_ds4_alloc();
+			break;
+		default:
+			continue;
+		}
+
+		if (!target)
+			return VIGEM_ERROR_NO_FREE_SLOT;
+
+		const VIGEM_ERROR error = vigem_target_add(Replay->Client, target);
+
+		if (!VIGEM_SUCCESS(error))
+		{
+			vigem_target_free(target);
+			return error;
+		}
+
+		Replay->Targets[record->SerialNo] = target;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+//
+// Hybrid wait: sleeps on the (high resolution if available) timer until the
+// spin window, then busy-waits for the rest.
+// 
+static VOID vigem_internal_replay_wait_until(
+	PVIGEM_REPLAY Replay,
+	LONGLONG Deadline,
+	LONGLONG SpinTicks,
+	LONGLONG Frequency
+)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	const LONGLONG sleepTicks = Deadline - now.QuadPart - SpinTicks;
+
+	if (sleepTicks > 0)
+	{
+		LARGE_INTEGER dueTime;
+		// relative due time in 100ns units
+		dueTime.QuadPart = -static_cast<LONGLONG>(static_cast<double>(sleepTicks) * 10000000.0 / Frequency);
+
+		if (Replay->hTimer && SetWaitableTimer(Replay->hTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+			WaitForSingleObject(Replay->hTimer, INFINITE);
+		else
+			Sleep(static_cast<DWORD>(sleepTicks * 1000 / Frequency));
+	}
+
+	do
+	{
+		YieldProcessor();
+		QueryPerformanceCounter(&now);
+	} while (now.QuadPart < Deadline);
+}
+
+static VIGEM_ERROR vigem_internal_replay_submit(PVIGEM_REPLAY Replay, const VIGEM_RECORD* Record)
+{
+	if (Record->Type < VIGEM_RECORD_XUSB_REPORT || Record->Type > VIGEM_RECORD_DS4_REPORT_EX)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const PVIGEM_TARGET target = (Record->SerialNo < VIGEM_TARGETS_MAX) ? Replay->Targets[Record->SerialNo] : nullptr;
+
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	switch (Record->Type)
+	{
+	case VIGEM_RECORD_XUSB_REPORT:
+	{
+		if (Record->ReportSize != sizeof(XUSB_REPORT))
+			break;
+
+		XUSB_REPORT report;
+		RtlCopyMemory(&report, VIGEM_RECORD_REPORT(Record), sizeof(XUSB_REPORT));
+
+		return vigem_target_x360_update(Replay->Client, target, report);
+	}
+	case VIGEM_RECORD_DS4_REPORT:
+	{
+		if (Record->ReportSize != sizeof(DS4_REPORT))
+			break;
+
+		DS4_REPORT report;
+		RtlCopyMemory(&report, VIGEM_RECORD_REPORT(Record), sizeof(DS4_REPORT));
+
+		return vigem_target_ds4_update(Replay->Client, target, report);
+	}
+	case VIGEM_RECORD_DS4_REPORT_EX:
+	{
+		if (Record->ReportSize != sizeof(DS4_REPORT_EX))
+			break;
+
+		DS4_REPORT_EX report;
+		RtlCopyMemory(&report, VIGEM_RECORD_REPORT(Record), sizeof(DS4_REPORT_EX));
+
+		return vigem_target_ds4_update_ex(Replay->Client, target, report);
+	}
+	default:
+		break;
+	}
+
+	return VIGEM_ERROR_INVALID_PARAMETER;
+}
+
+VIGEM_ERROR vigem_replay_open(PVIGEM_CLIENT vigem, LPCWSTR path, PVIGEM_REPLAY* replay)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!path || !replay)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	*replay = nullptr;
+
+	const auto engine = static_cast<PVIGEM_REPLAY>(vigem_internal_alloc(sizeof(VIGEM_REPLAY)));
+
+	if (!engine)
+		return VIGEM_ERROR_WINAPI;
+
+	RtlZeroMemory(engine, sizeof(VIGEM_REPLAY));
+	engine->Client = vigem;
+
+	VIGEM_ERROR error = vigem_recording_open(path, &engine->Recording);
+
+	if (!VIGEM_SUCCESS(error))
+	{
+		vigem_internal_free(engine);
+		return error;
+	}
+
+	VIGEM_RECORDING_ITERATOR iterator;
+	const VIGEM_RECORD* record;
+
+	VIGEM_RECORDING_ITERATOR_INIT(&iterator);
+	while (vigem_recording_next(engine->Recording, &iterator, &record))
+		engine->Count++;
+
+	engine->Index = static_cast<const VIGEM_RECORD**>(vigem_internal_alloc((engine->Count ? engine->Count : 1) * sizeof(PVOID)));
+	engine->Targets = static_cast<PVIGEM_TARGET*>(vigem_internal_calloc(VIGEM_TARGETS_MAX, sizeof(PVIGEM_TARGET)));
+
+	if (!engine->Index || !engine->Targets)
+	{
+		vigem_internal_replay_free(engine);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	SIZE_T count = 0;
+
+	VIGEM_RECORDING_ITERATOR_INIT(&iterator);
+	while (vigem_recording_next(engine->Recording, &iterator, &record))
+		engine->Index[count++] = record;
+
+	//
+	// Stable, so equally timed records keep their file order and every run
+	// submits the exact same sequence
+	// 
+	std::stable_sort(
+		engine->Index,
+		engine->Index + engine->Count,
+		[](const VIGEM_RECORD* a, const VIGEM_RECORD* b) { return a->Timestamp < b->Timestamp; }
+	);
+
+	engine->hTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	// high resolution timers need Windows 10 1803
+	if (!engine->hTimer)
+		engine->hTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+
+	*replay = engine;
+
+	return VIGEM_ERROR_NONE;
+}
+
+void vigem_replay_close(PVIGEM_REPLAY replay)
+{
+	if (replay)
+		vigem_internal_replay_free(replay);
+}
+
+PVIGEM_TARGET vigem_replay_get_target(PVIGEM_REPLAY replay, ULONG serialNo)
+{
+	if (!replay || serialNo >= VIGEM_TARGETS_MAX)
+		return nullptr;
+
+	return replay->Targets[serialNo];
+}
+
+VIGEM_ERROR vigem_replay_run(PVIGEM_REPLAY replay, const VIGEM_REPLAY_CONFIG* config, PVIGEM_REPLAY_STATS stats)
+{
+	if (!replay || !config || config->Size != sizeof(VIGEM_REPLAY_CONFIG) || config->Speed < 0.0f)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (stats && stats->Size != sizeof(VIGEM_REPLAY_STATS))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	VIGEM_ERROR error = vigem_internal_replay_plug_in(replay);
+
+	if (!VIGEM_SUCCESS(error))
+		return error;
+
+	InterlockedExchange(&replay->Abort, 0);
+
+	VIGEM_REPLAY_STATS result;
+	RtlZeroMemory(&result, sizeof(VIGEM_REPLAY_STATS));
+	result.Size = sizeof(VIGEM_REPLAY_STATS);
+
+	LARGE_INTEGER frequency, start, now;
+	QueryPerformanceFrequency(&frequency);
+
+	const LONGLONG recordedFrequency = vigem_recording_get_header(replay->Recording)->TimestampFrequency;
+	const LONGLONG spinTicks = static_cast<LONGLONG>(config->SpinMicroseconds) * frequency.QuadPart / 1000000;
+	// recorded ticks to playback ticks
+	const double scale = (config->Speed > 0.0f && recordedFrequency > 0)
+		? static_cast<double>(frequency.QuadPart) / recordedFrequency / config->Speed
+		: 0.0;
+	const LONGLONG first = replay->Count ? replay->Index[0]->Timestamp : 0;
+	LONGLONG deadline = 0;
+	double errorSum = 0.0;
+	LONGLONG errorMax = 0;
+
+	QueryPerformanceCounter(&start);
+
+	for (SIZE_T i = 0; i < replay->Count && !replay->Abort; i++)
+	{
+		const VIGEM_RECORD* record = replay->Index[i];
+
+		if (scale > 0.0)
+		{
+			deadline = start.QuadPart + static_cast<LONGLONG>(static_cast<double>(record->Timestamp - first) * scale);
+
+			vigem_internal_replay_wait_until(replay, deadline, spinTicks, frequency.QuadPart);
+
+			QueryPerformanceCounter(&now);
+
+			const LONGLONG lateness = now.QuadPart - deadline;
+			errorSum += static_cast<double>(lateness);
+			errorMax = (std::max)(errorMax, lateness);
+		}
+
+		const VIGEM_ERROR submitted = vigem_internal_replay_submit(replay, record);
+
+		if (VIGEM_SUCCESS(submitted))
+			result.Submitted++;
+		else if (submitted == VIGEM_ERROR_INVALID_PARAMETER)
+			result.Skipped++;
+		else
+			result.Failed++;
+	}
+
+	QueryPerformanceCounter(&now);
+
+	const double microsecondsPerTick = 1000000.0 / frequency.QuadPart;
+	const ULONGLONG processed = result.Submitted + result.Failed + result.Skipped;
+
+	result.IntendedMicroseconds = static_cast<ULONGLONG>((deadline > start.QuadPart ? deadline - start.QuadPart : 0) * microsecondsPerTick);
+	result.ActualMicroseconds = static_cast<ULONGLONG>((now.QuadPart - start.QuadPart) * microsecondsPerTick);
+	result.MeanErrorMicroseconds = processed ? static_cast<FLOAT>(errorSum / processed * microsecondsPerTick) : 0.0f;
+	result.MaxErrorMicroseconds = static_cast<FLOAT>(errorMax * microsecondsPerTick);
+
+	if (stats)
+		*stats = result;
+
+	return VIGEM_ERROR_NONE;
+}
+
+void vigem_replay_abort(PVIGEM_REPLAY replay)
+{
+	if (replay)
+		InterlockedExchange(&replay->Abort, 1);
+}
@@ -0,0 +1,737 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+#include <climits>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "SimBus.h"
+
+
+//
+// Largest report accepted, DS4_REPORT_EX
+// 
+#define VIGEM_SIM_REPORT_MAX    sizeof(DS4_REPORT_EX)
+
+//
+// Represents a child device on the simulated bus.
+// 
+typedef struct _VIGEM_SIM_TARGET
+{
+	VIGEM_TARGET_TYPE Type;
+	ULONGLONG ReportCount;
+	ULONG ReportSize;
+	UCHAR Report[VIGEM_SIM_REPORT_MAX];
+
+	//
+	// Host output injected while no request was pending, delivered to the
+	// next request instead
+	// 
+	BOOLEAN XusbNotificationQueued;
+	BOOLEAN Ds4NotificationQueued;
+	BOOLEAN Ds4OutputQueued;
+	UCHAR LargeMotor;
+	UCHAR SmallMotor;
+	UCHAR LedNumber;
+	DS4_OUTPUT_BUFFER Output;
+} VIGEM_SIM_TARGET, *PVIGEM_SIM_TARGET;
+
+//
+// Represents a request kept pending by the simulated bus.
+// 
+typedef struct _VIGEM_SIM_PENDING
+{
+	LPOVERLAPPED Overlapped;
+	DWORD IoControlCode;
+	ULONG SerialNo;
+	LPVOID OutBuffer;
+	DWORD OutBufferSize;
+	struct _VIGEM_SIM_PENDING* Next;
+} VIGEM_SIM_PENDING, *PVIGEM_SIM_PENDING;
+
+typedef struct _VIGEM_SIM_BUS_T
+{
+	CRITICAL_SECTION Lock;
+	PVIGEM_SIM_PENDING Pending;
+	ULONG Ds4OutputQueuedCount;
+	PVIGEM_SIM_TARGET Targets[VIGEM_TARGETS_MAX];
+} VIGEM_SIM_BUS;
+
+//
+// Completes a request the way the I/O manager would: status and size go to
+// the OVERLAPPED, then its event is signalled.
+// 
+static VOID vigem_internal_sim_complete(LPOVERLAPPED Overlapped, DWORD Error, DWORD Transferred)
+{
+	Overlapped->InternalHigh = Transferred;
+	MemoryBarrier();
+	*reinterpret_cast<volatile ULONG_PTR*>(&Overlapped->Internal) = Error;
+
+	if (Overlapped->hEvent)
+		SetEvent(Overlapped->hEvent);
+}
+
+//
+// Completes and removes all pending requests matching the serial (0 = all).
+// Caller holds the lock.
+// 
+static VOID vigem_internal_sim_flush(PVIGEM_SIM_BUS Bus, ULONG SerialNo, DWORD Error)
+{
+	PVIGEM_SIM_PENDING* link = &Bus->Pending;
+
+	while (*link)
+	{
+		const PVIGEM_SIM_PENDING entry = *link;
+
+		if (SerialNo == 0 || entry->SerialNo == SerialNo)
+		{
+			*link = entry->Next;
+			vigem_internal_sim_complete(entry->Overlapped, Error, 0);
+			free(entry);
+		}
+		else
+		{
+			link = &entry->Next;
+		}
+	}
+}
+
+//
+// Removes the oldest pending request matching the IOCTL and serial (ULONG_MAX
+// = any). Caller holds the lock.
+// 
+static PVIGEM_SIM_PENDING vigem_internal_sim_dequeue(PVIGEM_SIM_BUS Bus, DWORD IoControlCode, ULONG SerialNo)
+{
+	PVIGEM_SIM_PENDING* match = nullptr;
+
+	// new requests get pushed to the front, the last match is the oldest
+	for (PVIGEM_SIM_PENDING* link = &Bus->Pending; *link; link = &(*link)->Next)
+	{
+		if ((*link)->IoControlCode == IoControlCode && (SerialNo == ULONG_MAX || (*link)->SerialNo == SerialNo))
+			match = link;
+	}
+
+	if (!match)
+		return nullptr;
+
+	const PVIGEM_SIM_PENDING entry = *match;
+	*match = entry->Next;
+
+	return entry;
+}
+
+//
+// Fills the output of a notification or output report request from the
+// target's injected state and returns the bytes written.
+// 
+static DWORD vigem_internal_sim_fill(
+	PVIGEM_SIM_TARGET Target,
+	ULONG SerialNo,
+	DWORD IoControlCode,
+	LPVOID OutBuffer,
+	DWORD OutBufferSize
+)
+{
+	switch (IoControlCode)
+	{
+	case IOCTL_XUSB_REQUEST_NOTIFICATION:
+	{
+		if (!OutBuffer || OutBufferSize < sizeof(XUSB_REQUEST_NOTIFICATION))
+			return 0;
+
+		const auto notification = static_cast<PXUSB_REQUEST_NOTIFICATION>(OutBuffer);
+		notification->LargeMotor = Target->LargeMotor;
+		notification->SmallMotor = Target->SmallMotor;
+		notification->LedNumber = Target->LedNumber;
+
+		return sizeof(XUSB_REQUEST_NOTIFICATION);
+	}
+	case IOCTL_DS4_REQUEST_NOTIFICATION:
+	{
+		if (!OutBuffer || OutBufferSize < sizeof(DS4_REQUEST_NOTIFICATION))
+			return 0;
+
+		//
+		// Same fields the driver picks from a USB output report (ID 0x05)
+		// 
+		const auto notification = static_cast<PDS4_REQUEST_NOTIFICATION>(OutBuffer);
+		notification->Report.SmallMotor = Target->Output.Buffer[4];
+		notification->Report.LargeMotor = Target->Output.Buffer[5];
+		notification->Report.LightbarColor.Red = Target->Output.Buffer[6];
+		notification->Report.LightbarColor.Green = Target->Output.Buffer[7];
+		notification->Report.LightbarColor.Blue = Target->Output.Buffer[8];
+
+		return sizeof(DS4_REQUEST_NOTIFICATION);
+	}
+	case IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE:
+	{
+		if (!OutBuffer || OutBufferSize < sizeof(DS4_AWAIT_OUTPUT))
+			return 0;
+
+		const auto await = static_cast<PDS4_AWAIT_OUTPUT>(OutBuffer);
+		await->SerialNo = SerialNo;
+		RtlCopyMemory(&await->Report, &Target->Output, sizeof(DS4_OUTPUT_BUFFER));
+
+		return sizeof(DS4_AWAIT_OUTPUT);
+	}
+	default:
+		return 0;
+	}
+}
+
+//
+// Delivers injected state to the oldest matching pending request, returns
+// FALSE if there is none. Caller holds the lock.
+// 
+static BOOLEAN vigem_internal_sim_deliver(PVIGEM_SIM_BUS Bus, ULONG SerialNo, DWORD IoControlCode)
+{
+	const PVIGEM_SIM_PENDING entry = vigem_internal_sim_dequeue(
+		Bus,
+		IoControlCode,
+		(IoControlCode == IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE) ? ULONG_MAX : SerialNo
+	);
+
+	if (!entry)
+		return FALSE;
+
+	const DWORD transferred = vigem_internal_sim_fill(
+		Bus->Targets[SerialNo],
+		SerialNo,
+		IoControlCode,
+		entry->OutBuffer,
+		entry->OutBufferSize
+	);
+
+	vigem_internal_sim_complete(entry->Overlapped, transferred ? ERROR_SUCCESS : ERROR_INVALID_PARAMETER, transferred);
+	free(entry);
+
+	return TRUE;
+}
+
+//
+// Handles a request, returns a Win32 error or ERROR_IO_PENDING. Caller holds
+// the lock.
+// 
+static DWORD vigem_internal_sim_dispatch(
+	PVIGEM_SIM_BUS Bus,
+	DWORD IoControlCode,
+	LPVOID InBuffer,
+	DWORD InBufferSize,
+	LPVOID OutBuffer,
+	DWORD OutBufferSize,
+	LPDWORD Transferred,
+	LPOVERLAPPED Overlapped
+)
+{
+	//
+	// Every request starts with ULONG Size, ULONG SerialNo
+	// 
+	if (!InBuffer || InBufferSize < 2 * sizeof(ULONG))
+		return ERROR_INVALID_PARAMETER;
+
+	const ULONG serialNo = static_cast<PULONG>(InBuffer)[1];
+	const PVIGEM_SIM_TARGET target = (serialNo < VIGEM_TARGETS_MAX) ? Bus->Targets[serialNo] : nullptr;
+
+	switch (IoControlCode)
+	{
+	case IOCTL_VIGEM_CHECK_VERSION:
+	{
+		if (InBufferSize < sizeof(VIGEM_CHECK_VERSION))
+			return ERROR_INVALID_PARAMETER;
+
+		return (static_cast<PVIGEM_CHECK_VERSION>(InBuffer)->Version == VIGEM_COMMON_VERSION)
+			? ERROR_SUCCESS
+			: ERROR_INVALID_PARAMETER;
+	}
+	case IOCTL_VIGEM_PLUGIN_TARGET:
+	{
+		if (InBufferSize < sizeof(VIGEM_PLUGIN_TARGET) || serialNo == 0 || serialNo >= VIGEM_TARGETS_MAX)
+			return ERROR_INVALID_PARAMETER;
+
+		if (target)
+			return ERROR_ALREADY_EXISTS;
+
+		const auto child = static_cast<PVIGEM_SIM_TARGET>(malloc(sizeof(VIGEM_SIM_TARGET)));
+
+		if (!child)
+			return ERROR_NOT_ENOUGH_MEMORY;
+
+		RtlZeroMemory(child, sizeof(VIGEM_SIM_TARGET));
+		child->Type = static_cast<PVIGEM_PLUGIN_TARGET>(InBuffer)->TargetType;
+		Bus->Targets[serialNo] = child;
+
+		return ERROR_SUCCESS;
+	}
+	case IOCTL_VIGEM_WAIT_DEVICE_READY:
+		return target ? ERROR_SUCCESS : ERROR_DEV_NOT_EXIST;
+	case IOCTL_VIGEM_UNPLUG_TARGET:
+	{
+		if (!target)
+			return ERROR_DEV_NOT_EXIST;
+
+		vigem_internal_sim_flush(Bus, serialNo, ERROR_OPERATION_ABORTED);
+
+		if (target->Ds4OutputQueued)
+			Bus->Ds4OutputQueuedCount--;
+
+		Bus->Targets[serialNo] = nullptr;
+		free(target);
+
+		return ERROR_SUCCESS;
+	}
+	case IOCTL_XUSB_SUBMIT_REPORT:
+	case IOCTL_DS4_SUBMIT_REPORT:
+	{
+		if (!target)
+			return ERROR_ACCESS_DENIED;
+
+		ULONG offset, size;
+
+		if (IoControlCode == IOCTL_XUSB_SUBMIT_REPORT)
+		{
+			if (target->Type != Xbox360Wired || InBufferSize != sizeof(XUSB_SUBMIT_REPORT))
+				return ERROR_INVALID_PARAMETER;
+
+			offset = FIELD_OFFSET(XUSB_SUBMIT_REPORT, Report);
+			size = sizeof(XUSB_REPORT);
+		}
+		else if (target->Type == DualShock4Wired && InBufferSize == sizeof(DS4_SUBMIT_REPORT))
+		{
+			offset = FIELD_OFFSET(DS4_SUBMIT_REPORT, Report);
+			size = sizeof(DS4_REPORT);
+		}
+		else if (target->Type == DualShock4Wired && InBufferSize == sizeof(DS4_SUBMIT_REPORT_EX))
+		{
+			offset = FIELD_OFFSET(DS4_SUBMIT_REPORT_EX, Report);
+			size = sizeof(DS4_REPORT_EX);
+		}
+		else
+		{
+			return ERROR_INVALID_PARAMETER;
+		}
+
+		RtlCopyMemory(target->Report, static_cast<PUCHAR>(InBuffer) + offset, size);
+		target->ReportSize = size;
+		target->ReportCount++;
+
+		return ERROR_SUCCESS;
+	}
+	case IOCTL_XUSB_GET_USER_INDEX:
+	{
+		if (!target || target->Type != Xbox360Wired)
+			return ERROR_ACCESS_DENIED;
+
+		if (!OutBuffer || OutBufferSize < sizeof(XUSB_GET_USER_INDEX))
+			return ERROR_INVALID_PARAMETER;
+
+		//
+		// Like XInput, only the first four pads get a slot
+		// 
+		if (serialNo > 4)
+			return ERROR_INVALID_DEVICE_OBJECT_PARAMETER;
+
+		static_cast<PXUSB_GET_USER_INDEX>(OutBuffer)->UserIndex = serialNo - 1;
+		*Transferred = sizeof(XUSB_GET_USER_INDEX);
+
+		return ERROR_SUCCESS;
+	}
+	case IOCTL_XUSB_REQUEST_NOTIFICATION:
+	case IOCTL_DS4_REQUEST_NOTIFICATION:
+	case IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE:
+	{
+		// output report pickup isn't bound to a target
+		if (IoControlCode != IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE && !target)
+			return ERROR_ACCESS_DENIED;
+
+		//
+		// Complete right away if output was injected in the meantime
+		// 
+		PVIGEM_SIM_TARGET queued = nullptr;
+		ULONG queuedSerialNo = serialNo;
+
+		if (IoControlCode == IOCTL_XUSB_REQUEST_NOTIFICATION && target->XusbNotificationQueued)
+		{
+			target->XusbNotificationQueued = FALSE;
+			queued = target;
+		}
+		else if (IoControlCode == IOCTL_DS4_REQUEST_NOTIFICATION && target->Ds4NotificationQueued)
+		{
+			target->Ds4NotificationQueued = FALSE;
+			queued = target;
+		}
+		else if (IoControlCode == IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE && Bus->Ds4OutputQueuedCount)
+		{
+			for (queuedSerialNo = 1; queuedSerialNo < VIGEM_TARGETS_MAX; queuedSerialNo++)
+			{
+				if (Bus->Targets[queuedSerialNo] && Bus->Targets[queuedSerialNo]->Ds4OutputQueued)
+				{
+					queued = Bus->Targets[queuedSerialNo];
+					queued->Ds4OutputQueued = FALSE;
+					Bus->Ds4OutputQueuedCount--;
+					break;
+				}
+			}
+		}
+
+		if (queued)
+		{
+			*Transferred = vigem_internal_sim_fill(queued, queuedSerialNo, IoControlCode, OutBuffer, OutBufferSize);
+
+			return *Transferred ? ERROR_SUCCESS : ERROR_INVALID_PARAMETER;
+		}
+
+		const auto entry = static_cast<PVIGEM_SIM_PENDING>(malloc(sizeof(VIGEM_SIM_PENDING)));
+
+		if (!entry)
+			return ERROR_NOT_ENOUGH_MEMORY;
+
+		entry->Overlapped = Overlapped;
+		entry->IoControlCode = IoControlCode;
+		entry->SerialNo = (IoControlCode == IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE) ? ULONG_MAX : serialNo;
+		entry->OutBuffer = OutBuffer;
+		entry->OutBufferSize = OutBufferSize;
+		entry->Next = Bus->Pending;
+		Bus->Pending = entry;
+
+		return ERROR_IO_PENDING;
+	}
+	default:
+		return ERROR_INVALID_PARAMETER;
+	}
+}
+
+PVIGEM_SIM_BUS vigem_internal_sim_bus_alloc(void)
+{
+	const auto bus = static_cast<PVIGEM_SIM_BUS>(malloc(sizeof(VIGEM_SIM_BUS)));
+
+	if (!bus)
+		return nullptr;
+
+	RtlZeroMemory(bus, sizeof(VIGEM_SIM_BUS));
+	InitializeCriticalSection(&bus->Lock);
+
+	return bus;
+}
+
+VOID vigem_internal_sim_bus_free(PVIGEM_SIM_BUS Bus)
+{
+	if (!Bus)
+		return;
+
+	EnterCriticalSection(&Bus->Lock);
+	vigem_internal_sim_flush(Bus, 0, ERROR_OPERATION_ABORTED);
+	LeaveCriticalSection(&Bus->Lock);
+
+	for (ULONG serialNo = 0; serialNo < VIGEM_TARGETS_MAX; serialNo++)
+	{
+		free(Bus->Targets[serialNo]);
+	}
+
+	DeleteCriticalSection(&Bus->Lock);
+	free(Bus);
+}
+
+BOOL vigem_internal_sim_io_control(
+	PVIGEM_SIM_BUS Bus,
+	DWORD IoControlCode,
+	LPVOID InBuffer,
+	DWORD InBufferSize,
+	LPVOID OutBuffer,
+	DWORD OutBufferSize,
+	LPDWORD BytesReturned,
+	LPOVERLAPPED Overlapped
+)
+{
+	DWORD transferred = 0;
+
+	//
+	// The bus is only ever used with overlapped I/O
+	// 
+	if (!Overlapped)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return FALSE;
+	}
+
+	*reinterpret_cast<volatile ULONG_PTR*>(&Overlapped->Internal) = ERROR_IO_PENDING;
+
+	if (Overlapped->hEvent)
+		ResetEvent(Overlapped->hEvent);
+
+	EnterCriticalSection(&Bus->Lock);
+
+	const DWORD error = vigem_internal_sim_dispatch(
+		Bus,
+		IoControlCode,
+		InBuffer,
+		InBufferSize,
+		OutBuffer,
+		OutBufferSize,
+		&transferred,
+		Overlapped
+	);
+
+	LeaveCriticalSection(&Bus->Lock);
+
+	if (error == ERROR_IO_PENDING)
+	{
+		SetLastError(ERROR_IO_PENDING);
+		return FALSE;
+	}
+
+	vigem_internal_sim_complete(Overlapped, error, transferred);
+
+	if (BytesReturned)
+		*BytesReturned = transferred;
+
+	if (error != ERROR_SUCCESS)
+	{
+		SetLastError(error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL vigem_internal_sim_get_overlapped_result(
+	LPOVERLAPPED Overlapped,
+	LPDWORD BytesTransferred,
+	BOOL Wait
+)
+{
+	const volatile ULONG_PTR* status = reinterpret_cast<volatile ULONG_PTR*>(&Overlapped->Internal);
+
+	while (*status == ERROR_IO_PENDING)
+	{
+		if (!Wait || !Overlapped->hEvent)
+		{
+			SetLastError(ERROR_IO_INCOMPLETE);
+			return FALSE;
+		}
+
+		WaitForSingleObject(Overlapped->hEvent, INFINITE);
+	}
+
+	MemoryBarrier();
+
+	*BytesTransferred = static_cast<DWORD>(Overlapped->InternalHigh);
+
+	const auto error = static_cast<DWORD>(*status);
+
+	if (error != ERROR_SUCCESS)
+	{
+		SetLastError(error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL vigem_internal_sim_cancel_io(PVIGEM_SIM_BUS Bus, LPOVERLAPPED Overlapped)
+{
+	BOOL found = FALSE;
+
+	EnterCriticalSection(&Bus->Lock);
+
+	for (PVIGEM_SIM_PENDING* link = &Bus->Pending; *link; link = &(*link)->Next)
+	{
+		const PVIGEM_SIM_PENDING entry = *link;
+
+		if (entry->Overlapped == Overlapped)
+		{
+			*link = entry->Next;
+			vigem_internal_sim_complete(Overlapped, ERROR_OPERATION_ABORTED, 0);
+			free(entry);
+			found = TRUE;
+			break;
+		}
+	}
+
+	LeaveCriticalSection(&Bus->Lock);
+
+	if (!found)
+		SetLastError(ERROR_NOT_FOUND);
+
+	return found;
+}
+
+VIGEM_ERROR vigem_sim_get_report(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PVOID buffer,
+	ULONG size,
+	PULONGLONG count
+)
+{
+	vigem = vigem_internal_bus(vigem, target);
+
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!vigem->SimBus)
+		return VIGEM_ERROR_NOT_SUPPORTED;
+
+	if (!target || target->SerialNo == 0 || target->SerialNo >= VIGEM_TARGETS_MAX)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	VIGEM_ERROR error = VIGEM_ERROR_TARGET_NOT_PLUGGED_IN;
+	const PVIGEM_SIM_BUS bus = vigem->SimBus;
+
+	EnterCriticalSection(&bus->Lock);
+
+	const PVIGEM_SIM_TARGET child = bus->Targets[target->SerialNo];
+
+	if (child)
+	{
+		if (buffer)
+			RtlCopyMemory(buffer, child->Report, (size < child->ReportSize) ? size : child->ReportSize);
+
+		if (count)
+			*count = child->ReportCount;
+
+		error = VIGEM_ERROR_NONE;
+	}
+
+	LeaveCriticalSection(&bus->Lock);
+
+	return error;
+}
+
+VIGEM_ERROR vigem_sim_x360_notify(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	UCHAR largeMotor,
+	UCHAR smallMotor,
+	UCHAR ledNumber
+)
+{
+	vigem = vigem_internal_bus(vigem, target);
+
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!vigem->SimBus)
+		return VIGEM_ERROR_NOT_SUPPORTED;
+
+	if (!target || target->SerialNo == 0 || target->SerialNo >= VIGEM_TARGETS_MAX)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	VIGEM_ERROR error = VIGEM_ERROR_TARGET_NOT_PLUGGED_IN;
+	const PVIGEM_SIM_BUS bus = vigem->SimBus;
+
+	EnterCriticalSection(&bus->Lock);
+
+	const PVIGEM_SIM_TARGET child = bus->Targets[target->SerialNo];
+
+	if (child && child->Type != Xbox360Wired)
+	{
+		error = VIGEM_ERROR_INVALID_TARGET;
+	}
+	else if (child)
+	{
+		child->LargeMotor = largeMotor;
+		child->SmallMotor = smallMotor;
+		child->LedNumber = ledNumber;
+
+		if (!vigem_internal_sim_deliver(bus, target->SerialNo, IOCTL_XUSB_REQUEST_NOTIFICATION))
+			child->XusbNotificationQueued = TRUE;
+
+		error = VIGEM_ERROR_NONE;
+	}
+
+	LeaveCriticalSection(&bus->Lock);
+
+	return error;
+}
+
+VIGEM_ERROR vigem_sim_ds4_output(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	const DS4_OUTPUT_BUFFER* buffer
+)
+{
+	vigem = vigem_internal_bus(vigem, target);
+
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!vigem->SimBus)
+		return VIGEM_ERROR_NOT_SUPPORTED;
+
+	if (!target || target->SerialNo == 0 || target->SerialNo >= VIGEM_TARGETS_MAX)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (!buffer)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	VIGEM_ERROR error = VIGEM_ERROR_TARGET_NOT_PLUGGED_IN;
+	const PVIGEM_SIM_BUS bus = vigem->SimBus;
+
+	EnterCriticalSection(&bus->Lock);
+
+	const PVIGEM_SIM_TARGET child = bus->Targets[target->SerialNo];
+
+	if (child && child->Type != DualShock4Wired)
+	{
+		error = VIGEM_ERROR_INVALID_TARGET;
+	}
+	else if (child)
+	{
+		RtlCopyMemory(&child->Output, buffer, sizeof(DS4_OUTPUT_BUFFER));
+
+		if (!vigem_internal_sim_deliver(bus, target->SerialNo, IOCTL_DS4_REQUEST_NOTIFICATION))
+			child->Ds4NotificationQueued = TRUE;
+
+		if (!vigem_internal_sim_deliver(bus, target->SerialNo, IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE) && !child->Ds4OutputQueued)
+		{
+			child->Ds4OutputQueued = TRUE;
+			bus->Ds4OutputQueuedCount++;
+		}
+
+		error = VIGEM_ERROR_NONE;
+	}
+
+	LeaveCriticalSection(&bus->Lock);
+
+	return error;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Capture.h"
+
+//
+// Represents an in-process stand-in for the bus driver.
+//
+typedef struct _VIGEM_SIM_BUS_T* PVIGEM_SIM_BUS;
+
+PVIGEM_SIM_BUS vigem_internal_sim_bus_alloc(void);
+
+//
+// Completes all pending requests as cancelled and frees the simulated bus.
+//
+VOID vigem_internal_sim_bus_free(PVIGEM_SIM_BUS Bus);
+
+BOOL vigem_internal_sim_io_control(
+    PVIGEM_SIM_BUS Bus,
+    DWORD IoControlCode,
+    LPVOID InBuffer,
+    DWORD InBufferSize,
+    LPVOID OutBuffer,
+    DWORD OutBufferSize,
+    LPDWORD BytesReturned,
+    LPOVERLAPPED Overlapped
+);
+
+BOOL vigem_internal_sim_get_overlapped_result(
+    LPOVERLAPPED Overlapped,
+    LPDWORD BytesTransferred,
+    BOOL Wait
+);
+
+BOOL vigem_internal_sim_cancel_io(PVIGEM_SIM_BUS Bus, LPOVERLAPPED Overlapped);
+
+//
+// Bus transport. All driver I/O goes through these so a connection can be
+// served by the simulated bus instead of the driver, and so it can be
+// captured. The bus connections of a multi-bus client are captured by it.
+//
+FORCEINLINE BOOL vigem_internal_io_control(
+    PVIGEM_CLIENT vigem,
+    DWORD IoControlCode,
+    LPVOID InBuffer,
+    DWORD InBufferSize,
+    LPVOID OutBuffer,
+    DWORD OutBufferSize,
+    LPDWORD BytesReturned,
+    LPOVERLAPPED Overlapped
+)
+{
+    const PVIGEM_CLIENT primary = vigem_internal_primary(vigem);
+
+    if (primary->Capture)
+        vigem_internal_capture_request(
+            primary,
+            IoControlCode,
+            InBuffer,
+            InBufferSize,
+            OutBuffer,
+            OutBufferSize,
+            Overlapped
+        );
+
+    if (vigem->SimBus)
+        return vigem_internal_sim_io_control(
+            vigem->SimBus,
+            IoControlCode,
+            InBuffer,
+            InBufferSize,
+            OutBuffer,
+            OutBufferSize,
+            BytesReturned,
+            Overlapped
+        );
+
+    return DeviceIoControl(
+        vigem->hBusDevice,
+        IoControlCode,
+        InBuffer,
+        InBufferSize,
+        OutBuffer,
+        OutBufferSize,
+        BytesReturned,
+        Overlapped
+    );
+}
+
+FORCEINLINE BOOL vigem_internal_get_overlapped_result(
+    PVIGEM_CLIENT vigem,
+    LPOVERLAPPED Overlapped,
+    LPDWORD BytesTransferred,
+    BOOL Wait
+)
+{
+    const BOOL result = vigem->SimBus
+        ? vigem_internal_sim_get_overlapped_result(Overlapped, BytesTransferred, Wait)
+        : GetOverlappedResult(vigem->hBusDevice, Overlapped, BytesTransferred, Wait);
+
+    const PVIGEM_CLIENT primary = vigem_internal_primary(vigem);
+
+    if (primary->Capture)
+        vigem_internal_capture_completion(primary, Overlapped, result, *BytesTransferred);
+
+    return result;
+}
+
+FORCEINLINE BOOL vigem_internal_cancel_io(PVIGEM_CLIENT vigem, LPOVERLAPPED Overlapped)
+{
+    const PVIGEM_CLIENT primary = vigem_internal_primary(vigem);
+
+    if (primary->Capture)
+        vigem_internal_capture_cancel(primary, Overlapped);
+
+    if (vigem->SimBus)
+        return vigem_internal_sim_cancel_io(vigem->SimBus, Overlapped);
+
+    return CancelIoEx(vigem->hBusDevice, Overlapped);
+}
+
+FORCEINLINE VOID vigem_internal_close_bus(PVIGEM_CLIENT vigem)
+{
+    if (vigem->SimBus)
+    {
+        vigem_internal_sim_bus_free(vigem->SimBus);
+        vigem->SimBus = nullptr;
+    }
+    else
+    {
+        CloseHandle(vigem->hBusDevice);
+    }
+}
@@ -0,0 +1,252 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Log.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "Log.h"
+#include "Memory.h"
+#include "TargetPool.h"
+
+
+static_assert(sizeof(SLIST_ENTRY) <= offsetof(VIGEM_TARGET, Stats), "list entry overlaps kept target fields");
+
+//
+// Returns the client's pool, creating it on first use. NULL if that failed.
+// 
+static PVIGEM_TARGET_POOL vigem_internal_target_pool_get(PVIGEM_CLIENT vigem)
+{
+	if (vigem->TargetPool)
+		return vigem->TargetPool;
+
+	const auto pool = static_cast<PVIGEM_TARGET_POOL>(vigem_internal_alloc_aligned(sizeof(VIGEM_TARGET_POOL), alignof(VIGEM_TARGET_POOL)));
+
+	if (!pool)
+		return nullptr;
+
+	RtlZeroMemory(pool, sizeof(VIGEM_TARGET_POOL));
+	InitializeSListHead(&pool->FreeList);
+
+	// the client's
+	pool->References = 1;
+
+	if (InterlockedCompareExchangePointer(
+		reinterpret_cast<PVOID volatile*>(&vigem->TargetPool),
+		pool,
+		nullptr
+	) != nullptr)
+	{
+		// lost against a concurrent call
+		vigem_internal_free(pool);
+	}
+
+	return vigem->TargetPool;
+}
+
+//
+// Allocates a slab of Count zeroed targets and pushes them, the caller
+// holds the grow lock.
+// 
+static BOOLEAN vigem_internal_target_pool_grow(PVIGEM_TARGET_POOL Pool, ULONG Count)
+{
+	if (Pool->Capacity + Count > VIGEM_TARGETS_MAX)
+		return FALSE;
+
+	const size_t size = sizeof(VIGEM_TARGET_POOL_SLAB) + Count * sizeof(VIGEM_TARGET);
+	const auto slab = static_cast<PVIGEM_TARGET_POOL_SLAB>(vigem_internal_alloc_aligned(size, alignof(VIGEM_TARGET_POOL_SLAB)));
+
+	if (!slab)
+		return FALSE;
+
+	RtlZeroMemory(slab, size);
+
+	slab->Count = Count;
+	slab->Next = Pool->Slabs;
+	Pool->Slabs = slab;
+
+	const auto targets = reinterpret_cast<PVIGEM_TARGET>(slab + 1);
+
+	for (ULONG index = 0; index < Count; index++)
+	{
+		targets[index].Pool = Pool;
+		InterlockedPushEntrySList(&Pool->FreeList, reinterpret_cast<PSLIST_ENTRY>(&targets[index]));
+	}
+
+	InterlockedExchangeAdd(&Pool->Capacity, static_cast<LONG>(Count));
+	InterlockedIncrement(&Pool->SlabCount);
+
+	VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Target pool 0x%p grown by %u to %d", Pool, Count, Pool->Capacity);
+
+	return TRUE;
+}
+
+//
+// Every target is back on the list once the last reference is gone
+// 
+static VOID vigem_internal_target_pool_dereference(PVIGEM_TARGET_POOL Pool)
+{
+	if (InterlockedDecrement(&Pool->References) != 0)
+		return;
+
+	for (PVIGEM_TARGET_POOL_SLAB slab = Pool->Slabs; slab;)
+	{
+		const PVIGEM_TARGET_POOL_SLAB next = slab->Next;
+		const auto targets = reinterpret_cast<PVIGEM_TARGET>(slab + 1);
+
+		for (ULONG index = 0; index < slab->Count; index++)
+		{
+			if (targets[index].SubmitEvent)
+				CloseHandle(targets[index].SubmitEvent);
+		}
+
+		vigem_internal_free(slab);
+		slab = next;
+	}
+
+	VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Freed target pool 0x%p", Pool);
+
+	vigem_internal_free(Pool);
+}
+
+PVIGEM_TARGET vigem_internal_target_pool_pop(PVIGEM_CLIENT vigem)
+{
+	const PVIGEM_TARGET_POOL pool = vigem_internal_target_pool_get(vigem);
+
+	if (!pool)
+		return nullptr;
+
+	PSLIST_ENTRY entry = InterlockedPopEntrySList(&pool->FreeList);
+
+	if (!entry)
+	{
+		AcquireSRWLockExclusive(&pool->GrowLock);
+
+		// another thread may have grown it meanwhile
+		entry = InterlockedPopEntrySList(&pool->FreeList);
+
+		if (!entry && vigem_internal_target_pool_grow(pool, VIGEM_TARGET_POOL_GROWTH))
+			entry = InterlockedPopEntrySList(&pool->FreeList);
+
+		ReleaseSRWLockExclusive(&pool->GrowLock);
+
+		if (!entry)
+			return nullptr;
+	}
+
+	InterlockedIncrement(&pool->References);
+
+	const auto target = reinterpret_cast<PVIGEM_TARGET>(entry);
+	const HANDLE submitEvent = target->SubmitEvent;
+
+	RtlZeroMemory(target, sizeof(VIGEM_TARGET));
+
+	target->Pool = pool;
+	target->SubmitEvent = submitEvent;
+
+	return target;
+}
+
+VOID vigem_internal_target_pool_push(PVIGEM_TARGET target)
+{
+	const PVIGEM_TARGET_POOL pool = target->Pool;
+
+	InterlockedPushEntrySList(&pool->FreeList, reinterpret_cast<PSLIST_ENTRY>(target));
+
+	vigem_internal_target_pool_dereference(pool);
+}
+
+VOID vigem_internal_target_pool_release(PVIGEM_CLIENT vigem)
+{
+	const auto pool = static_cast<PVIGEM_TARGET_POOL>(InterlockedExchangePointer(
+		reinterpret_cast<PVOID volatile*>(&vigem->TargetPool),
+		nullptr
+	));
+
+	if (pool)
+		vigem_internal_target_pool_dereference(pool);
+}
+
+VIGEM_ERROR vigem_target_pool_reserve(PVIGEM_CLIENT vigem, ULONG count)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (count == 0 || count > VIGEM_TARGETS_MAX)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const PVIGEM_TARGET_POOL pool = vigem_internal_target_pool_get(vigem);
+
+	if (!pool)
+		return VIGEM_ERROR_WINAPI;
+
+	VIGEM_ERROR error = VIGEM_ERROR_NONE;
+
+	AcquireSRWLockExclusive(&pool->GrowLock);
+
+	// one slab for the whole difference
+	if (static_cast<ULONG>(pool->Capacity) < count
+		&& !vigem_internal_target_pool_grow(pool, count - static_cast<ULONG>(pool->Capacity)))
+		error = VIGEM_ERROR_WINAPI;
+
+	ReleaseSRWLockExclusive(&pool->GrowLock);
+
+	return error;
+}
+
+VIGEM_ERROR vigem_target_pool_get_stats(PVIGEM_CLIENT vigem, PVIGEM_TARGET_POOL_STATS stats)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!stats || stats->Size != sizeof(VIGEM_TARGET_POOL_STATS))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	const PVIGEM_TARGET_POOL pool = vigem->TargetPool;
+
+	stats->Capacity = pool ? static_cast<ULONG>(pool->Capacity) : 0;
+	stats->Available = pool ? QueryDepthSList(&pool->FreeList) : 0;
+	stats->Slabs = pool ? static_cast<ULONG>(pool->SlabCount) : 0;
+
+	return VIGEM_ERROR_NONE;
+}
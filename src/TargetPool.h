@@ -0,0 +1,48 @@
+#pragma once
+
+//
+// Targets handed out per slab allocation when a pool runs dry
+//
+#define VIGEM_TARGET_POOL_GROWTH    64
+
+//
+// Slab of pooled targets, the header takes the first cache line so the
+// targets following it stay aligned. Slabs are only freed with the pool.
+//
+typedef struct alignas(64) _VIGEM_TARGET_POOL_SLAB_T
+{
+    struct _VIGEM_TARGET_POOL_SLAB_T* Next;
+    ULONG Count;
+} VIGEM_TARGET_POOL_SLAB, *PVIGEM_TARGET_POOL_SLAB;
+
+//
+// Client-level pool of target objects. Free targets are pushed on a
+// lock-free list, growing takes the lock. Every target handed out holds a
+// reference like the client does, the last one frees the pool.
+//
+typedef struct alignas(MEMORY_ALLOCATION_ALIGNMENT) _VIGEM_TARGET_POOL_T
+{
+    SLIST_HEADER FreeList;
+    SRWLOCK GrowLock;
+    PVIGEM_TARGET_POOL_SLAB Slabs;
+    volatile LONG Capacity;
+    volatile LONG SlabCount;
+    volatile LONG References;
+} VIGEM_TARGET_POOL, *PVIGEM_TARGET_POOL;
+
+//
+// Takes a zeroed target from the client's pool, creating or growing it if
+// needed. Only its pool and submission event are kept from earlier use.
+//
+PVIGEM_TARGET vigem_internal_target_pool_pop(PVIGEM_CLIENT vigem);
+
+//
+// Returns a target to its pool, after its cold block and statistics were
+// freed.
+//
+VOID vigem_internal_target_pool_push(PVIGEM_TARGET target);
+
+//
+// Drops the client's reference of its pool, on disconnect and free.
+//
+VOID vigem_internal_target_pool_release(PVIGEM_CLIENT vigem);
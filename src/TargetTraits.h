@@ -0,0 +1,106 @@
+#pragma once
+
+//
+// Compile-time description of a report format a target accepts. Every
+// specialization names the report, the bus submit structure wrapping it,
+// its initializer, the IOCTL it's sent with, its recording type, its trace
+// slice name and how
+// driver errors map to VIGEM_ERROR. vigem_internal_target_submit is
+// instantiated once per report. Formats with a pinned submission buffer
+// also name where it lives in the target.
+//
+template <typename TReport>
+struct VIGEM_TARGET_TRAITS;
+
+template <>
+struct VIGEM_TARGET_TRAITS<XUSB_REPORT>
+{
+    using Report = XUSB_REPORT;
+    using SubmitReport = XUSB_SUBMIT_REPORT;
+    using Notification = PFN_VIGEM_X360_NOTIFICATION;
+
+    static constexpr VIGEM_TARGET_TYPE Type = Xbox360Wired;
+    static constexpr DWORD IoControlCode = IOCTL_XUSB_SUBMIT_REPORT;
+    static constexpr VIGEM_RECORD_TYPE RecordType = VIGEM_RECORD_XUSB_REPORT;
+    static constexpr LPCSTR TraceName = "x360_update";
+
+    static FORCEINLINE VOID Init(SubmitReport* Submit, ULONG SerialNo)
+    {
+        XUSB_SUBMIT_REPORT_INIT(Submit, SerialNo);
+    }
+
+    static FORCEINLINE SubmitReport* Pinned(PVIGEM_TARGET Target)
+    {
+        return &Target->Submit.Xusb;
+    }
+
+    static FORCEINLINE VIGEM_ERROR MapError(DWORD Error)
+    {
+        return (Error == ERROR_ACCESS_DENIED) ? VIGEM_ERROR_INVALID_TARGET : VIGEM_ERROR_NONE;
+    }
+};
+
+template <>
+struct VIGEM_TARGET_TRAITS<DS4_REPORT>
+{
+    using Report = DS4_REPORT;
+    using SubmitReport = DS4_SUBMIT_REPORT;
+    using Notification = PFN_VIGEM_DS4_NOTIFICATION;
+
+    static constexpr VIGEM_TARGET_TYPE Type = DualShock4Wired;
+    static constexpr DWORD IoControlCode = IOCTL_DS4_SUBMIT_REPORT;
+    static constexpr VIGEM_RECORD_TYPE RecordType = VIGEM_RECORD_DS4_REPORT;
+    static constexpr LPCSTR TraceName = "ds4_update";
+
+    static FORCEINLINE VOID Init(SubmitReport* Submit, ULONG SerialNo)
+    {
+        DS4_SUBMIT_REPORT_INIT(Submit, SerialNo);
+    }
+
+    static FORCEINLINE VIGEM_ERROR MapError(DWORD Error)
+    {
+        return (Error == ERROR_ACCESS_DENIED) ? VIGEM_ERROR_INVALID_TARGET : VIGEM_ERROR_NONE;
+    }
+};
+
+template <>
+struct VIGEM_TARGET_TRAITS<DS4_REPORT_EX>
+{
+    using Report = DS4_REPORT_EX;
+    using SubmitReport = DS4_SUBMIT_REPORT_EX;
+    using Notification = PFN_VIGEM_DS4_NOTIFICATION;
+
+    static constexpr VIGEM_TARGET_TYPE Type = DualShock4Wired;
+    // Same IOCTL, just different size
+    static constexpr DWORD IoControlCode = IOCTL_DS4_SUBMIT_REPORT;
+    static constexpr VIGEM_RECORD_TYPE RecordType = VIGEM_RECORD_DS4_REPORT_EX;
+    static constexpr LPCSTR TraceName = "ds4_update_ex";
+
+    static FORCEINLINE VOID Init(SubmitReport* Submit, ULONG SerialNo)
+    {
+        DS4_SUBMIT_REPORT_EX_INIT(Submit, SerialNo);
+    }
+
+    static FORCEINLINE SubmitReport* Pinned(PVIGEM_TARGET Target)
+    {
+        return &Target->Submit.Ds4Ex;
+    }
+
+    static FORCEINLINE VIGEM_ERROR MapError(DWORD Error)
+    {
+        if (Error == ERROR_ACCESS_DENIED)
+            return VIGEM_ERROR_INVALID_TARGET;
+
+        /*
+         * NOTE: this will not happen on v1.16 due to NTSTATUS accidentally been set
+         * as STATUS_SUCCESS when the submitted buffer size wasn't the expected one.
+         * For backwards compatibility this function will silently fail (not cause
+         * report updates) when run with the v1.16 driver. This API was introduced
+         * with v1.17 so it won't affect existing applications built before.
+         */
+        if (Error == ERROR_INVALID_PARAMETER)
+            return VIGEM_ERROR_NOT_SUPPORTED;
+
+        return VIGEM_ERROR_NONE;
+    }
+};
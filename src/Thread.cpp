@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Log.h"
+
+//
+// Internal
+// 
+#include "Internal.h"
+#include "Log.h"
+#include "Thread.h"
+
+
+VIGEM_ERROR vigem_internal_thread_config_check(const VIGEM_THREAD_CONFIG* Config)
+{
+	if (Config->Size != sizeof(VIGEM_THREAD_CONFIG))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (Config->AffinityMask)
+	{
+		DWORD_PTR processMask, systemMask;
+
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+			return VIGEM_ERROR_WINAPI;
+
+		if ((Config->AffinityMask & ~processMask) != 0)
+			return VIGEM_ERROR_INVALID_PARAMETER;
+	}
+
+	return VIGEM_ERROR_NONE;
+}
+
+VOID vigem_internal_thread_start(const VIGEM_THREAD_CONFIG* Config, PVIGEM_CLIENT Client, VIGEM_THREAD_KIND Kind)
+{
+	if (Config->Size == 0)
+		return;
+
+	const HANDLE thread = GetCurrentThread();
+
+	//
+	// Failures leave the thread running as it was, it's still useful
+	// 
+	if (Config->AffinityMask && !SetThreadAffinityMask(thread, Config->AffinityMask))
+	{
+		VIGEM_LOG(VIGEM_LOG_LEVEL_WARNING, L"Setting affinity 0x%llX of thread kind %d failed: %u",
+		          static_cast<ULONGLONG>(Config->AffinityMask), Kind, GetLastError());
+	}
+
+	const INT priority = Config->TimeCritical ? THREAD_PRIORITY_TIME_CRITICAL : Config->Priority;
+
+	if (priority != THREAD_PRIORITY_NORMAL && !SetThreadPriority(thread, priority))
+	{
+		VIGEM_LOG(VIGEM_LOG_LEVEL_WARNING, L"Setting priority %d of thread kind %d failed: %u",
+		          priority, Kind, GetLastError());
+	}
+
+	if (Config->OnStart)
+		Config->OnStart(Client, Kind, Config->Context);
+}
+
+VIGEM_ERROR vigem_set_thread_config(PVIGEM_CLIENT vigem, VIGEM_THREAD_KIND kind, const VIGEM_THREAD_CONFIG* config)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (kind < VIGEM_THREAD_OUTPUT_REPORT_PICKUP || kind >= VIGEM_THREAD_LOG)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (!config)
+	{
+		RtlZeroMemory(&vigem->ThreadConfigs[kind], sizeof(VIGEM_THREAD_CONFIG));
+		return VIGEM_ERROR_NONE;
+	}
+
+	const VIGEM_ERROR error = vigem_internal_thread_config_check(config);
+
+	if (!VIGEM_SUCCESS(error))
+		return error;
+
+	vigem->ThreadConfigs[kind] = *config;
+
+	return VIGEM_ERROR_NONE;
+}
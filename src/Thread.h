@@ -0,0 +1,13 @@
+#pragma once
+
+//
+// Validates a configuration passed to one of the set_thread_config functions.
+//
+VIGEM_ERROR vigem_internal_thread_config_check(const VIGEM_THREAD_CONFIG* Config);
+
+//
+// Applies a thread configuration to the calling thread and runs its start
+// function. Called first thing by every thread the library creates, a
+// configuration of Size 0 leaves the thread as it is.
+//
+VOID vigem_internal_thread_start(const VIGEM_THREAD_CONFIG* Config, PVIGEM_CLIENT Client, VIGEM_THREAD_KIND Kind);
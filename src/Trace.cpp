@@ -0,0 +1,378 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+// 
+#include <Windows.h>
+
+//
+// Driver shared
+// 
+#include "ViGEm/Client.h"
+#include "ViGEm/Trace.h"
+
+//
+// STL
+// 
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <mutex>
+#include <tuple>
+
+//
+// Internal
+// 
+#include "Trace.h"
+#include "Memory.h"
+
+
+#if defined(VIGEM_TRACING_ENABLED)
+
+#define VIGEM_TRACE_FLUSH_BUFFER_SIZE   0x10000
+
+volatile BOOLEAN g_TraceEnabled;
+
+//
+// All rings ever allocated, only ever prepended to. Rings live until the
+// process exits so flushing never races with a free.
+// 
+static PVIGEM_TRACE_RING volatile g_TraceRings;
+
+//
+// Timestamp and frequency event times are converted with on flush
+// 
+static volatile LONGLONG g_TraceBase;
+static LONGLONG g_TraceFrequency;
+
+static std::mutex g_TraceFlushLock;
+
+//
+// Ring and name of the calling thread, the ring is handed back for reuse when
+// the thread exits.
+// 
+typedef struct _VIGEM_TRACE_THREAD
+{
+	PVIGEM_TRACE_RING Ring;
+	LPCSTR Name;
+
+	~_VIGEM_TRACE_THREAD()
+	{
+		if (Ring)
+			InterlockedExchange(&Ring->InUse, 0);
+	}
+} VIGEM_TRACE_THREAD;
+
+static thread_local VIGEM_TRACE_THREAD g_TraceThread;
+
+static FORCEINLINE VOID vigem_internal_trace_append(
+	PVIGEM_TRACE_RING Ring,
+	CHAR Phase,
+	LPCSTR Name,
+	ULONG SerialNo
+)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	const LONGLONG head = Ring->Head;
+	VIGEM_TRACE_EVENT& event = Ring->Events[head & (VIGEM_TRACE_RING_EVENTS - 1)];
+
+	event.Timestamp = now.QuadPart;
+	event.Name = Name;
+	event.ThreadId = GetCurrentThreadId();
+	event.SerialNo = SerialNo;
+	event.Phase = Phase;
+
+	// publish the event only once it is complete
+	InterlockedExchange64(&Ring->Head, head + 1);
+}
+
+static PVIGEM_TRACE_RING vigem_internal_trace_ring()
+{
+	VIGEM_TRACE_THREAD& thread = g_TraceThread;
+
+	if (thread.Ring)
+		return thread.Ring;
+
+	PVIGEM_TRACE_RING ring;
+
+	//
+	// Prefer taking over the ring of an exited thread, notification and
+	// async add threads come and go
+	// 
+	for (ring = g_TraceRings; ring; ring = ring->Next)
+	{
+		if (ring->InUse == 0 && InterlockedCompareExchange(&ring->InUse, 1, 0) == 0)
+			break;
+	}
+
+	if (!ring)
+	{
+		ring = static_cast<PVIGEM_TRACE_RING>(vigem_internal_alloc_aligned(sizeof(VIGEM_TRACE_RING), alignof(VIGEM_TRACE_RING)));
+
+		if (!ring)
+			return nullptr;
+
+		// events are only read below Head, no need to clear them
+		ring->InUse = 1;
+		ring->Head = 0;
+		ring->Tail = 0;
+
+		PVIGEM_TRACE_RING head;
+
+		do
+		{
+			head = g_TraceRings;
+			ring->Next = head;
+		} while (InterlockedCompareExchangePointer(
+			reinterpret_cast<PVOID volatile*>(&g_TraceRings),
+			ring,
+			head
+		) != head);
+	}
+
+	thread.Ring = ring;
+
+	if (thread.Name)
+		vigem_internal_trace_append(ring, VIGEM_TRACE_PHASE_THREAD_NAME, thread.Name, 0);
+
+	return ring;
+}
+
+VOID vigem_internal_trace_record(CHAR Phase, LPCSTR Name, ULONG SerialNo)
+{
+	const PVIGEM_TRACE_RING ring = vigem_internal_trace_ring();
+
+	if (ring)
+		vigem_internal_trace_append(ring, Phase, Name, SerialNo);
+}
+
+VOID vigem_internal_trace_thread_name(LPCSTR Name)
+{
+	VIGEM_TRACE_THREAD& thread = g_TraceThread;
+
+	thread.Name = Name;
+
+	if (thread.Ring)
+		vigem_internal_trace_append(thread.Ring, VIGEM_TRACE_PHASE_THREAD_NAME, Name, 0);
+}
+
+//
+// Buffered writer for the flushed JSON.
+// 
+typedef struct _VIGEM_TRACE_WRITER
+{
+	HANDLE hFile;
+	PCHAR Buffer;
+	SIZE_T Used;
+	BOOLEAN Failed;
+} VIGEM_TRACE_WRITER;
+
+static VOID vigem_internal_trace_write_out(VIGEM_TRACE_WRITER& Writer)
+{
+	DWORD written = 0;
+
+	if (Writer.Used && !WriteFile(Writer.hFile, Writer.Buffer, static_cast<DWORD>(Writer.Used), &written, nullptr))
+		Writer.Failed = TRUE;
+
+	Writer.Used = 0;
+}
+
+static VOID vigem_internal_trace_write(VIGEM_TRACE_WRITER& Writer, const char* Format, ...)
+{
+	// every line written is far shorter than this
+	if (Writer.Used + 512 > VIGEM_TRACE_FLUSH_BUFFER_SIZE)
+		vigem_internal_trace_write_out(Writer);
+
+	va_list args;
+	va_start(args, Format);
+
+	const int length = vsnprintf(
+		Writer.Buffer + Writer.Used,
+		VIGEM_TRACE_FLUSH_BUFFER_SIZE - Writer.Used,
+		Format,
+		args
+	);
+
+	va_end(args);
+
+	if (length > 0)
+	{
+		const SIZE_T available = VIGEM_TRACE_FLUSH_BUFFER_SIZE - Writer.Used - 1;
+
+		Writer.Used += (static_cast<SIZE_T>(length) < available) ? static_cast<SIZE_T>(length) : available;
+	}
+}
+
+static VOID vigem_internal_trace_write_event(VIGEM_TRACE_WRITER& Writer, const VIGEM_TRACE_EVENT& Event, DWORD ProcessId)
+{
+	if (Event.Phase == VIGEM_TRACE_PHASE_THREAD_NAME)
+	{
+		vigem_internal_trace_write(Writer,
+			"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+			static_cast<unsigned long>(ProcessId),
+			static_cast<unsigned long>(Event.ThreadId),
+			Event.Name
+		);
+		return;
+	}
+
+	const double microseconds = static_cast<double>(Event.Timestamp - g_TraceBase) * 1e6 / static_cast<double>(g_TraceFrequency);
+
+	vigem_internal_trace_write(Writer,
+		"{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu%s",
+		Event.Name,
+		Event.Phase,
+		microseconds,
+		static_cast<unsigned long>(ProcessId),
+		static_cast<unsigned long>(Event.ThreadId),
+		(Event.Phase == VIGEM_TRACE_PHASE_INSTANT) ? ",\"s\":\"t\"" : ""
+	);
+
+	if (Event.SerialNo)
+		vigem_internal_trace_write(Writer, ",\"args\":{\"serial\":%lu}}", static_cast<unsigned long>(Event.SerialNo));
+	else
+		vigem_internal_trace_write(Writer, "}");
+}
+
+#endif
+
+VIGEM_ERROR vigem_trace_enable(BOOLEAN enable)
+{
+#if defined(VIGEM_TRACING_ENABLED)
+	if (enable && g_TraceBase == 0)
+	{
+		LARGE_INTEGER frequency, now;
+		QueryPerformanceFrequency(&frequency);
+		QueryPerformanceCounter(&now);
+
+		g_TraceFrequency = frequency.QuadPart;
+		InterlockedCompareExchange64(&g_TraceBase, now.QuadPart, 0);
+	}
+
+	g_TraceEnabled = enable;
+
+	return VIGEM_ERROR_NONE;
+#else
+	std::ignore = enable;
+
+	return VIGEM_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+VIGEM_ERROR vigem_trace_flush(LPCWSTR path)
+{
+#if defined(VIGEM_TRACING_ENABLED)
+	if (!path)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	// nothing was ever recorded
+	if (g_TraceBase == 0)
+		return VIGEM_ERROR_NONE;
+
+	std::lock_guard<std::mutex> lock(g_TraceFlushLock);
+
+	VIGEM_TRACE_WRITER writer = {};
+
+	writer.Buffer = static_cast<PCHAR>(vigem_internal_alloc(VIGEM_TRACE_FLUSH_BUFFER_SIZE));
+
+	if (!writer.Buffer)
+		return VIGEM_ERROR_WINAPI;
+
+	writer.hFile = CreateFileW(
+		path,
+		GENERIC_WRITE,
+		0,
+		nullptr,
+		CREATE_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+
+	if (writer.hFile == INVALID_HANDLE_VALUE)
+	{
+		vigem_internal_free(writer.Buffer);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	const DWORD processId = GetCurrentProcessId();
+	ULONGLONG dropped = 0;
+	BOOLEAN first = TRUE;
+
+	vigem_internal_trace_write(writer, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+	for (PVIGEM_TRACE_RING ring = g_TraceRings; ring; ring = ring->Next)
+	{
+		MemoryBarrier();
+
+		const LONGLONG head = ring->Head;
+		LONGLONG index = ring->Tail;
+
+		if (head - index > VIGEM_TRACE_RING_EVENTS)
+		{
+			dropped += head - VIGEM_TRACE_RING_EVENTS - index;
+			index = head - VIGEM_TRACE_RING_EVENTS;
+		}
+
+		for (; index < head; index++)
+		{
+			const VIGEM_TRACE_EVENT event = ring->Events[index & (VIGEM_TRACE_RING_EVENTS - 1)];
+
+			//
+			// The owner may have lapped us while copying, the slot of the
+			// event it is writing right now doesn't count as valid either
+			// 
+			MemoryBarrier();
+
+			if (index <= ring->Head - VIGEM_TRACE_RING_EVENTS)
+			{
+				dropped++;
+				continue;
+			}
+
+			vigem_internal_trace_write(writer, first ? "" : ",\n");
+			vigem_internal_trace_write_event(writer, event, processId);
+			first = FALSE;
+		}
+
+		ring->Tail = head;
+	}
+
+	vigem_internal_trace_write(writer, "\n],\"otherData\":{\"droppedEvents\":%llu}}\n", dropped);
+	vigem_internal_trace_write_out(writer);
+
+	CloseHandle(writer.hFile);
+	vigem_internal_free(writer.Buffer);
+
+	return writer.Failed ? VIGEM_ERROR_WINAPI : VIGEM_ERROR_NONE;
+#else
+	std::ignore = path;
+
+	return VIGEM_ERROR_NOT_SUPPORTED;
+#endif
+}
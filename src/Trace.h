@@ -0,0 +1,111 @@
+#pragma once
+
+#include "ViGEm/Trace.h"
+
+#if defined(VIGEM_TRACING_ENABLED)
+
+//
+// Chrome trace event phases
+//
+#define VIGEM_TRACE_PHASE_BEGIN         'B'
+#define VIGEM_TRACE_PHASE_END           'E'
+#define VIGEM_TRACE_PHASE_INSTANT       'i'
+#define VIGEM_TRACE_PHASE_THREAD_NAME   'M'
+
+typedef struct _VIGEM_TRACE_EVENT
+{
+    LONGLONG Timestamp;
+    //
+    // Static string, formatted only on flush
+    //
+    LPCSTR Name;
+    DWORD ThreadId;
+    //
+    // Serial number of the target the event concerns, 0 if none
+    //
+    ULONG SerialNo;
+    CHAR Phase;
+} VIGEM_TRACE_EVENT, *PVIGEM_TRACE_EVENT;
+
+//
+// Event ring of one thread. The owning thread is the only writer, it
+// publishes an event by advancing Head. Rings are reused by later threads
+// once their owner exited, so events carry their thread id.
+//
+typedef struct alignas(64) _VIGEM_TRACE_RING
+{
+    struct _VIGEM_TRACE_RING* Next;
+    volatile LONG InUse;
+    //
+    // Index of the next event to write, only ever grows
+    //
+    volatile LONGLONG Head;
+    //
+    // Index of the first event not flushed yet, owned by the flushing thread
+    //
+    LONGLONG Tail;
+    VIGEM_TRACE_EVENT Events[VIGEM_TRACE_RING_EVENTS];
+} VIGEM_TRACE_RING, *PVIGEM_TRACE_RING;
+
+extern volatile BOOLEAN g_TraceEnabled;
+
+//
+// Appends an event to the calling thread's ring.
+//
+VOID vigem_internal_trace_record(CHAR Phase, LPCSTR Name, ULONG SerialNo);
+
+//
+// Names the calling thread. The name is remembered even while tracing is
+// off and written ahead of the thread's first event.
+//
+VOID vigem_internal_trace_thread_name(LPCSTR Name);
+
+//
+// Begins a slice on construction and ends it on destruction. Whether tracing
+// was on at the beginning decides for both, so slices are always balanced.
+//
+class VIGEM_TRACE_SCOPE_T
+{
+    LPCSTR Name;
+    ULONG SerialNo;
+    BOOLEAN Active;
+
+public:
+    FORCEINLINE VIGEM_TRACE_SCOPE_T(LPCSTR Name, ULONG SerialNo) : Name(Name), SerialNo(SerialNo), Active(g_TraceEnabled)
+    {
+        if (Active)
+            vigem_internal_trace_record(VIGEM_TRACE_PHASE_BEGIN, Name, SerialNo);
+    }
+
+    FORCEINLINE ~VIGEM_TRACE_SCOPE_T()
+    {
+        if (Active)
+            vigem_internal_trace_record(VIGEM_TRACE_PHASE_END, Name, SerialNo);
+    }
+
+    VIGEM_TRACE_SCOPE_T(const VIGEM_TRACE_SCOPE_T&) = delete;
+    VIGEM_TRACE_SCOPE_T& operator=(const VIGEM_TRACE_SCOPE_T&) = delete;
+};
+
+#define VIGEM_TRACE_CONCAT_(_a_, _b_)   _a_##_b_
+#define VIGEM_TRACE_CONCAT(_a_, _b_)    VIGEM_TRACE_CONCAT_(_a_, _b_)
+
+//
+// Traces the rest of the enclosing block as a slice
+//
+#define VIGEM_TRACE_SCOPE(_name_, _serial_) \
+    const VIGEM_TRACE_SCOPE_T VIGEM_TRACE_CONCAT(_vigem_trace_scope_, __LINE__)((_name_), (_serial_))
+
+#define VIGEM_TRACE_INSTANT(_name_, _serial_) \
+    do { if (g_TraceEnabled) vigem_internal_trace_record(VIGEM_TRACE_PHASE_INSTANT, (_name_), (_serial_)); } while (0)
+
+#define VIGEM_TRACE_THREAD_NAME(_name_) \
+    vigem_internal_trace_thread_name(_name_)
+
+#else
+
+#define VIGEM_TRACE_SCOPE(_name_, _serial_)     ((void)0)
+#define VIGEM_TRACE_INSTANT(_name_, _serial_)   ((void)0)
+#define VIGEM_TRACE_THREAD_NAME(_name_)         ((void)0)
+
+#endif
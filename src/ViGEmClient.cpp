@@ -29,13 +29,19 @@ SOFTWARE.
 #include <Windows.h>
 #include <SetupAPI.h>
 #include <initguid.h>
-#include <strsafe.h>
 
 //
 // Driver shared
 // 
 #include "ViGEm/km/BusShared.h"
 #include "ViGEm/Client.h"
+#include "ViGEm/Record.h"
+#include "ViGEm/Capture.h"
+#include "ViGEm/Sim.h"
+#include "ViGEm/Stats.h"
+#include "ViGEm/Trace.h"
+#include "ViGEm/Log.h"
+#include "ViGEm/Async.h"
 #include <winioctl.h>
 
 //
@@ -43,87 +49,45 @@ SOFTWARE.
 // 
 #include <cstdlib>
 #include <climits>
-#include <thread>
+#include <cassert>
 #include <functional>
 
 //
 // Internal
 // 
 #include "Internal.h"
-
-//#define VIGEM_VERBOSE_LOGGING_ENABLED
-
+#include "Recorder.h"
+#include "SimBus.h"
+#include "TargetTraits.h"
+#include "Instrumentation.h"
+#include "Trace.h"
+#include "Log.h"
+#include "Memory.h"
+#include "Async.h"
+#include "Thread.h"
+#include "TargetPool.h"
 
 #pragma region Diagnostics
 
-#ifdef _DEBUG
-#define DBGPRINT(kwszDebugFormatString, ...) _DBGPRINT(__FUNCTIONW__, __LINE__, kwszDebugFormatString, __VA_ARGS__)
-#else
-#define DBGPRINT( kwszDebugFormatString, ... ) ;;
-#endif
-
-VOID _DBGPRINT(LPCWSTR kwszFunction, INT iLineNumber, LPCWSTR kwszDebugFormatString, ...)
+//
+// Packs eight bytes so that %016llX prints them in buffer order.
+// 
+static FORCEINLINE ULONGLONG vigem_internal_log_bytes(const UCHAR* Bytes)
 {
-#if defined(VIGEM_VERBOSE_LOGGING_ENABLED)
-	INT cbFormatString = 0;
-	va_list args;
-	PWCHAR wszDebugString = nullptr;
-	size_t st_Offset = 0;
-
-	va_start(args, kwszDebugFormatString);
-
-	// Get size of message string from formatting args
-	cbFormatString = _scwprintf(L"[%s:%d] ", kwszFunction, iLineNumber) * sizeof(WCHAR);
-	cbFormatString += _vscwprintf(kwszDebugFormatString, args) * sizeof(WCHAR);
-	cbFormatString += sizeof(WCHAR); // for null-terminator
-
-	// Allocate message string
-	wszDebugString = static_cast<PWCHAR>(malloc(cbFormatString));
-	if (wszDebugString == nullptr)
-		return;
-
-	// Populate the buffer with the contents of the format string
-	StringCbPrintfW(wszDebugString, cbFormatString, L"[%s:%d] ", kwszFunction, iLineNumber);
-	StringCbLengthW(wszDebugString, cbFormatString, &st_Offset);
-	StringCbVPrintfW(&wszDebugString[st_Offset / sizeof(WCHAR)], cbFormatString - st_Offset, kwszDebugFormatString,
-		args);
+	ULONGLONG value = 0;
 
-	// Ensure null-terminated
-	wszDebugString[cbFormatString - 1] = L'\0';
+	for (int index = 0; index < 8; index++)
+		value = (value << 8) | Bytes[index];
 
-	// Output message
-	OutputDebugStringW(wszDebugString);
-	OutputDebugStringW(L"\n");
-
-	free(wszDebugString);
-	va_end(args);
-#else
-	std::ignore = kwszFunction;
-	std::ignore = iLineNumber;
-	std::ignore = kwszDebugFormatString;
-#endif
+	return value;
 }
 
-static void to_hex(unsigned char* in, size_t insz, char* out, size_t outsz)
-{
-	unsigned char* pin = in;
-	auto hex = "0123456789ABCDEF";
-	char* pout = out;
-	for (; pin < in + insz; pout += 3, pin++)
-	{
-		pout[0] = hex[(*pin >> 4) & 0xF];
-		pout[1] = hex[*pin & 0xF];
-		pout[2] = ':';
-		if ((size_t)(pout + 3 - out) > outsz)
-		{
-			/* Better to truncate output string than overflow buffer */
-			/* it would be still better to either return a status */
-			/* or ensure the target buffer is large enough and it never happen */
-			break;
-		}
-	}
-	pout[-1] = 0;
-}
+#define VIGEM_LOG_DS4_OUTPUT(_serial_, _buffer_) \
+	VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Output report for %d: %016llX %016llX %016llX %016llX...", (_serial_), \
+		vigem_internal_log_bytes(&(_buffer_)[0]), \
+		vigem_internal_log_bytes(&(_buffer_)[8]), \
+		vigem_internal_log_bytes(&(_buffer_)[16]), \
+		vigem_internal_log_bytes(&(_buffer_)[24]))
 
 #pragma endregion
 
@@ -135,7 +99,7 @@ PVIGEM_TARGET FORCEINLINE VIGEM_TARGET_ALLOC_INIT(
 	_In_ VIGEM_TARGET_TYPE Type
 )
 {
-	auto target = static_cast<PVIGEM_TARGET>(malloc(sizeof(VIGEM_TARGET)));
+	auto target = static_cast<PVIGEM_TARGET>(vigem_internal_alloc_aligned(sizeof(VIGEM_TARGET), alignof(VIGEM_TARGET)));
 
 	if (!target)
 		return nullptr;
@@ -148,6 +112,81 @@ PVIGEM_TARGET FORCEINLINE VIGEM_TARGET_ALLOC_INIT(
 	return target;
 }
 
+//
+// Takes a target from the client's pool instead, see VIGEM_TARGET_ALLOC_INIT
+// 
+PVIGEM_TARGET FORCEINLINE VIGEM_TARGET_POOL_ALLOC_INIT(
+	_In_ PVIGEM_CLIENT vigem,
+	_In_ VIGEM_TARGET_TYPE Type
+)
+{
+	if (!vigem)
+		return nullptr;
+
+	const auto target = vigem_internal_target_pool_pop(vigem);
+
+	if (!target)
+		return nullptr;
+
+	target->Size = sizeof(VIGEM_TARGET);
+	target->State = VIGEM_TARGET_INITIALIZED;
+	target->Type = Type;
+	return target;
+}
+
+//
+// Returns the cold block of the target, allocating it (and the DS4 sync
+// objects) on first use. NULL if that failed.
+// 
+static PVIGEM_TARGET_COLD vigem_internal_target_cold(PVIGEM_TARGET target)
+{
+	if (target->Cold)
+		return target->Cold;
+
+	const auto cold = static_cast<PVIGEM_TARGET_COLD>(vigem_internal_alloc(sizeof(VIGEM_TARGET_COLD)));
+
+	if (!cold)
+		return nullptr;
+
+	RtlZeroMemory(cold, sizeof(VIGEM_TARGET_COLD));
+
+	if (target->Type == DualShock4Wired)
+	{
+		cold->Ds4CachedOutputReportUpdateAvailable = CreateEvent(
+			nullptr,
+			FALSE,
+			FALSE,
+			nullptr
+		);
+
+		if (!cold->Ds4CachedOutputReportUpdateAvailable)
+		{
+			vigem_internal_free(cold);
+			return nullptr;
+		}
+
+		InitializeCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
+	}
+
+	if (InterlockedCompareExchangePointer(
+		reinterpret_cast<PVOID volatile*>(&target->Cold),
+		cold,
+		nullptr
+	) != nullptr)
+	{
+		// lost against a concurrent first use
+		if (target->Type == DualShock4Wired)
+		{
+			CloseHandle(cold->Ds4CachedOutputReportUpdateAvailable);
+			DeleteCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
+		}
+
+		vigem_internal_free(cold);
+	}
+
+	return target->Cold;
+}
+
 static DWORD WINAPI vigem_internal_ds4_output_report_pickup_handler(LPVOID Parameter)
 {
 	const auto pClient = static_cast<PVIGEM_CLIENT>(Parameter);
@@ -161,14 +200,24 @@ static DWORD WINAPI vigem_internal_ds4_output_report_pickup_handler(LPVOID Param
 		lOverlapped.hEvent
 	};
 
-	DBGPRINT(L"Started DS4 Output Report pickup thread for 0x%p", pClient);
+	VIGEM_LOG(VIGEM_LOG_LEVEL_INFO, L"Started DS4 Output Report pickup thread for 0x%p", pClient);
+
+	VIGEM_TRACE_THREAD_NAME("DS4 output report pickup");
+
+	// a shared session's connection belongs to none of its clients
+	const PVIGEM_CLIENT primary = vigem_internal_primary(pClient);
+	vigem_internal_thread_start(
+		&primary->ThreadConfigs[VIGEM_THREAD_OUTPUT_REPORT_PICKUP],
+		pClient->Owners ? nullptr : primary,
+		VIGEM_THREAD_OUTPUT_REPORT_PICKUP
+	);
 
 	do
 	{
 		DS4_AWAIT_OUTPUT_INIT(&await, 0);
 
-		DeviceIoControl(
-			pClient->hBusDevice,
+		vigem_internal_io_control(
+			pClient,
 			IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE,
 			&await,
 			await.Size,
@@ -178,33 +227,39 @@ static DWORD WINAPI vigem_internal_ds4_output_report_pickup_handler(LPVOID Param
 			&lOverlapped
 		);
 
-		const DWORD waitResult = WaitForMultipleObjects(
-			static_cast<DWORD>(std::size(waitEvents)),
-			waitEvents,
-			FALSE,
-			INFINITE
-		);
+		DWORD waitResult;
+
+		{
+			VIGEM_TRACE_SCOPE("ds4_output_await", 0);
+
+			waitResult = WaitForMultipleObjects(
+				static_cast<DWORD>(std::size(waitEvents)),
+				waitEvents,
+				FALSE,
+				INFINITE
+			);
+		}
 
 		if (waitResult == WAIT_OBJECT_0)
 		{
-			DBGPRINT(L"Abort event signalled during read, exiting thread");
-			CancelIoEx(pClient->hBusDevice, &lOverlapped);
+			VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Abort event signalled during read, exiting thread");
+			vigem_internal_cancel_io(pClient, &lOverlapped);
 			break;
 		}
 
 		if (waitResult == WAIT_FAILED)
 		{
 			const DWORD error = GetLastError();
-			DBGPRINT(L"Win32 error from multi-object wait: 0x%X", error);
+			VIGEM_LOG(VIGEM_LOG_LEVEL_ERROR, L"Win32 error from multi-object wait: 0x%X", error);
 			continue;
 		}
 
 		if (waitResult != WAIT_OBJECT_0 + 1)
 		{
-			DBGPRINT(L"Unexpected result from multi-object wait: 0x%X", waitResult);
+			VIGEM_LOG(VIGEM_LOG_LEVEL_WARNING, L"Unexpected result from multi-object wait: 0x%X", waitResult);
 		}
 
-		if (GetOverlappedResult(pClient->hBusDevice, &lOverlapped, &transferred, FALSE) == FALSE)
+		if (vigem_internal_get_overlapped_result(pClient, &lOverlapped, &transferred, FALSE) == FALSE)
 		{
 			const DWORD error = GetLastError();
 
@@ -213,62 +268,62 @@ static DWORD WINAPI vigem_internal_ds4_output_report_pickup_handler(LPVOID Param
 			// 
 			if (error == ERROR_INVALID_PARAMETER)
 			{
-				DBGPRINT(L"Currently used driver version doesn't support this request, aborting");
+				VIGEM_LOG(VIGEM_LOG_LEVEL_WARNING, L"Currently used driver version doesn't support this request, aborting");
 				break;
 			}
 
 			if (error == ERROR_OPERATION_ABORTED)
 			{
-				DBGPRINT(L"Read has been cancelled, aborting");
+				VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Read has been cancelled, aborting");
 				break;
 			}
 
 			if (error == ERROR_IO_INCOMPLETE)
 			{
-				DBGPRINT(L"Pending I/O not completed, aborting");
-				CancelIoEx(pClient->hBusDevice, &lOverlapped);
+				VIGEM_LOG(VIGEM_LOG_LEVEL_WARNING, L"Pending I/O not completed, aborting");
+				vigem_internal_cancel_io(pClient, &lOverlapped);
 				break;
 			}
 
-			DBGPRINT(L"Win32 error from overlapped result: 0x%X", error);
+			VIGEM_LOG(VIGEM_LOG_LEVEL_ERROR, L"Win32 error from overlapped result: 0x%X", error);
 			continue;
 		}
 
-#if defined(VIGEM_VERBOSE_LOGGING_ENABLED)
-		DBGPRINT(L"Dumping buffer for %d", await.SerialNo);
+		VIGEM_LOG_DS4_OUTPUT(await.SerialNo, await.Report.Buffer);
 
-		const PCHAR dumpBuffer = (PCHAR)calloc(sizeof(DS4_OUTPUT_BUFFER), 3);
-		if (dumpBuffer != nullptr)
-		{
-			to_hex(await.Report.Buffer, sizeof(DS4_OUTPUT_BUFFER), dumpBuffer, sizeof(DS4_OUTPUT_BUFFER) * 3);
-			OutputDebugStringA(dumpBuffer);
-			free(dumpBuffer);
-		}
-#endif
+		VIGEM_TRACE_SCOPE("ds4_output_dispatch", await.SerialNo);
 
 		const PVIGEM_TARGET pTarget = pClient->pTargetsList[await.SerialNo];
 
 		if (pTarget && !pTarget->IsDisposing && pTarget->Type == DualShock4Wired)
 		{
-			memcpy(&pTarget->Ds4CachedOutputReport, &await.Report, sizeof(DS4_OUTPUT_BUFFER));
-			SetEvent(pTarget->Ds4CachedOutputReportUpdateAvailable);
+			// kept for a later vigem_target_ds4_await_output_report
+			const PVIGEM_TARGET_COLD cold = vigem_internal_target_cold(pTarget);
+
+			if (cold)
+			{
+				memcpy(&cold->Ds4CachedOutputReport, &await.Report, sizeof(DS4_OUTPUT_BUFFER));
+				SetEvent(cold->Ds4CachedOutputReportUpdateAvailable);
+			}
+
+			vigem_internal_async_ds4_output(pClient, pTarget, &await.Report);
 		}
 		else
 		{
-			DBGPRINT(L"No target to report to for serial %d", await.SerialNo);
+			VIGEM_LOG(VIGEM_LOG_LEVEL_WARNING, L"No target to report to for serial %d", await.SerialNo);
 		}
 	} while (TRUE);
 
 	DEVICE_IO_CONTROL_END;
 
-	DBGPRINT(L"Finished DS4 Output Report pickup thread for 0x%p", pClient);
+	VIGEM_LOG(VIGEM_LOG_LEVEL_INFO, L"Finished DS4 Output Report pickup thread for 0x%p", pClient);
 
 	return 0;
 }
 
 PVIGEM_CLIENT vigem_alloc()
 {
-	const auto driver = static_cast<PVIGEM_CLIENT>(malloc(sizeof(VIGEM_CLIENT)));
+	const auto driver = static_cast<PVIGEM_CLIENT>(vigem_internal_alloc(sizeof(VIGEM_CLIENT)));
 
 	if (!driver)
 		return nullptr;
@@ -290,28 +345,93 @@ void vigem_free(PVIGEM_CLIENT vigem)
 {
 	if (vigem)
 	{
+		vigem_record_stop(vigem);
+		vigem_capture_stop(vigem);
+		vigem_internal_stats_free(vigem);
+		vigem_internal_target_pool_release(vigem);
+
 		CloseHandle(vigem->hDS4OutputReportPickupThreadAbortEvent);
 
-		free(vigem);
+		vigem_internal_free(vigem);
 	}
 }
 
-VIGEM_ERROR vigem_connect(PVIGEM_CLIENT vigem)
+//
+// Opens a bus instance, checks it's compatible and starts its pickup thread.
+// 
+static VIGEM_ERROR vigem_internal_open_bus(PVIGEM_CLIENT vigem, LPCTSTR devicePath)
 {
-	if (!vigem)
-		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+	vigem->hBusDevice = CreateFile(
+		devicePath,
+		GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH | FILE_FLAG_OVERLAPPED,
+		nullptr
+	);
+
+	// check bus open result
+	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+
+	DWORD transferred = 0;
+	OVERLAPPED lOverlapped = { 0 };
+	lOverlapped.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	VIGEM_CHECK_VERSION version;
+	VIGEM_CHECK_VERSION_INIT(&version, VIGEM_COMMON_VERSION);
+
+	// send compiled library version to driver to check compatibility
+	vigem_internal_io_control(
+		vigem,
+		IOCTL_VIGEM_CHECK_VERSION,
+		&version,
+		version.Size,
+		nullptr,
+		0,
+		&transferred,
+		&lOverlapped
+	);
+
+	// wait for result
+	const BOOL compatible = vigem_internal_get_overlapped_result(vigem, &lOverlapped, &transferred, TRUE);
+
+	CloseHandle(lOverlapped.hEvent);
+
+	if (!compatible)
+	{
+		CloseHandle(vigem->hBusDevice);
+		vigem->hBusDevice = INVALID_HANDLE_VALUE;
+
+		return VIGEM_ERROR_BUS_VERSION_MISMATCH;
+	}
+
+	vigem->hDS4OutputReportPickupThread = CreateThread(
+		nullptr,
+		0,
+		vigem_internal_ds4_output_report_pickup_handler,
+		vigem,
+		0,
+		nullptr
+	);
+
+	return VIGEM_ERROR_NONE;
+}
 
+//
+// Calls Open with the device path of every bus instance, or only until one
+// succeeded. Returns VIGEM_ERROR_NONE if any did, the last error otherwise.
+// 
+template <typename TOpen>
+static VIGEM_ERROR vigem_internal_enum_buses(BOOLEAN all, TOpen Open)
+{
 	SP_DEVICE_INTERFACE_DATA deviceInterfaceData = { 0 };
 	deviceInterfaceData.cbSize = sizeof(deviceInterfaceData);
 	DWORD memberIndex = 0;
 	DWORD requiredSize = 0;
 	auto error = VIGEM_ERROR_BUS_NOT_FOUND;
-
-	// check for already open handle as re-opening accidentally would destroy all live targets
-	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
-	{
-		return VIGEM_ERROR_BUS_ALREADY_CONNECTED;
-	}
+	BOOLEAN opened = FALSE;
 
 	const auto deviceInfoSet = SetupDiGetClassDevs(
 		&GUID_DEVINTERFACE_BUSENUM_VIGEM,
@@ -333,7 +453,7 @@ VIGEM_ERROR vigem_connect(PVIGEM_CLIENT vigem)
 		SetupDiGetDeviceInterfaceDetail(deviceInfoSet, &deviceInterfaceData, nullptr, 0, &requiredSize, nullptr);
 
 		// allocate target buffer
-		const auto detailDataBuffer = static_cast<PSP_DEVICE_INTERFACE_DETAIL_DATA>(malloc(requiredSize));
+		const auto detailDataBuffer = static_cast<PSP_DEVICE_INTERFACE_DETAIL_DATA>(vigem_internal_alloc(requiredSize));
 		detailDataBuffer->cbSize = sizeof(SP_DEVICE_INTERFACE_DETAIL_DATA);
 
 		// get detail buffer
@@ -346,176 +466,533 @@ VIGEM_ERROR vigem_connect(PVIGEM_CLIENT vigem)
 			nullptr
 		))
 		{
-			free(detailDataBuffer);
+			vigem_internal_free(detailDataBuffer);
 			error = VIGEM_ERROR_BUS_NOT_FOUND;
 			continue;
 		}
 
 		// bus found, open it
-		vigem->hBusDevice = CreateFile(
-			detailDataBuffer->DevicePath,
-			GENERIC_READ | GENERIC_WRITE,
-			FILE_SHARE_READ | FILE_SHARE_WRITE,
-			nullptr,
-			OPEN_EXISTING,
-			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH | FILE_FLAG_OVERLAPPED,
-			nullptr
-		);
-
-		// check bus open result
-		if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
-		{
-			error = VIGEM_ERROR_BUS_ACCESS_FAILED;
-			free(detailDataBuffer);
-			continue;
-		}
-
-		DWORD transferred = 0;
-		OVERLAPPED lOverlapped = { 0 };
-		lOverlapped.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-
-		VIGEM_CHECK_VERSION version;
-		VIGEM_CHECK_VERSION_INIT(&version, VIGEM_COMMON_VERSION);
+		const VIGEM_ERROR result = Open(detailDataBuffer->DevicePath);
 
-		// send compiled library version to driver to check compatibility
-		DeviceIoControl(
-			vigem->hBusDevice,
-			IOCTL_VIGEM_CHECK_VERSION,
-			&version,
-			version.Size,
-			nullptr,
-			0,
-			&transferred,
-			&lOverlapped
-		);
+		vigem_internal_free(detailDataBuffer);
 
-		// wait for result
-		if (GetOverlappedResult(vigem->hBusDevice, &lOverlapped, &transferred, TRUE) != 0)
+		if (VIGEM_SUCCESS(result))
 		{
-			vigem->hDS4OutputReportPickupThread = CreateThread(
-				nullptr,
-				0,
-				vigem_internal_ds4_output_report_pickup_handler,
-				vigem,
-				0,
-				nullptr
-			);
+			opened = TRUE;
 
-			error = VIGEM_ERROR_NONE;
-			free(detailDataBuffer);
-			CloseHandle(lOverlapped.hEvent);
-			break;
+			if (!all)
+				break;
+		}
+		else
+		{
+			error = result;
 		}
-
-		error = VIGEM_ERROR_BUS_VERSION_MISMATCH;
-
-		CloseHandle(lOverlapped.hEvent);
-		free(detailDataBuffer);
 	}
 
 	SetupDiDestroyDeviceInfoList(deviceInfoSet);
 
-	return error;
+	return opened ? VIGEM_ERROR_NONE : error;
 }
 
-void vigem_disconnect(PVIGEM_CLIENT vigem)
+VIGEM_ERROR vigem_connect(PVIGEM_CLIENT vigem)
 {
 	if (!vigem)
-		return;
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
 
-	if (vigem->hDS4OutputReportPickupThread && vigem->hDS4OutputReportPickupThreadAbortEvent)
+	// check for already open handle as re-opening accidentally would destroy all live targets
+	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
 	{
-		DBGPRINT(L"Awaiting DS4 thread clean-up for 0x%p", vigem);
-
-		SetEvent(vigem->hDS4OutputReportPickupThreadAbortEvent);
-		WaitForSingleObject(vigem->hDS4OutputReportPickupThread, INFINITE);
-		CloseHandle(vigem->hDS4OutputReportPickupThread);
-
-		DBGPRINT(L"DS4 thread clean-up for 0x%p finished", vigem);
+		return VIGEM_ERROR_BUS_ALREADY_CONNECTED;
 	}
 
-	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
+	return vigem_internal_enum_buses(FALSE, [vigem](LPCTSTR devicePath)
 	{
-		DBGPRINT(L"Closing bus handle for 0x%p", vigem);
+		return vigem_internal_open_bus(vigem, devicePath);
+	});
+}
 
-		CloseHandle(vigem->hBusDevice);
-		vigem->hBusDevice = INVALID_HANDLE_VALUE;
+//
+// Allocates a connection of a multi-bus client and connects it with Connect,
+// keeping it only if that succeeded.
+// 
+template <typename TConnect>
+static VIGEM_ERROR vigem_internal_add_bus(PVIGEM_CLIENT vigem, TConnect Connect)
+{
+	const auto buses = static_cast<PVIGEM_CLIENT*>(vigem_internal_alloc((vigem->BusCount + 1) * sizeof(PVIGEM_CLIENT)));
+
+	if (!buses)
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+
+	if (vigem->Buses)
+		memcpy(buses, vigem->Buses, vigem->BusCount * sizeof(PVIGEM_CLIENT));
+
+	vigem_internal_free(vigem->Buses);
+	vigem->Buses = buses;
+
+	const PVIGEM_CLIENT bus = vigem_alloc();
+
+	if (!bus)
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+
+	bus->Primary = vigem;
+
+	const VIGEM_ERROR error = Connect(bus);
+
+	if (!VIGEM_SUCCESS(error))
+	{
+		vigem_free(bus);
+		return error;
 	}
 
-	RtlZeroMemory(vigem, sizeof(VIGEM_CLIENT));
+	vigem->Buses[vigem->BusCount++] = bus;
+
+	return VIGEM_ERROR_NONE;
 }
 
-BOOLEAN vigem_target_is_waitable_add_supported(PVIGEM_TARGET target)
+//
+// Disconnects and frees the connections of a multi-bus client.
+// 
+static VOID vigem_internal_close_buses(PVIGEM_CLIENT vigem)
 {
-	//
-	// Safety check to make people use the older functions and not cause issues
-	// Should never pass in an invalid target but doesn't hurt to check.
-	//
-	if (!target)
-		return FALSE;
+	for (ULONG index = 0; index < vigem->BusCount; index++)
+	{
+		vigem_disconnect(vigem->Buses[index]);
+		vigem_free(vigem->Buses[index]);
+	}
 
-	// TODO: Replace all this with a more robust version check system
-	return !target->IsWaitReadyUnsupported;
+	vigem_internal_free(vigem->Buses);
+
+	vigem->Buses = nullptr;
+	vigem->BusCount = 0;
 }
 
-PVIGEM_TARGET vigem_target_x360_alloc(void)
+//
+// Marks a multi-bus client connected if any bus was, the handle is only
+// checked against INVALID_HANDLE_VALUE and never used.
+// 
+static VIGEM_ERROR vigem_internal_multi_bus_connected(PVIGEM_CLIENT vigem, VIGEM_ERROR error)
 {
-	const auto target = VIGEM_TARGET_ALLOC_INIT(Xbox360Wired);
+	if (vigem->BusCount == 0)
+	{
+		vigem_internal_free(vigem->Buses);
+		vigem->Buses = nullptr;
 
-	if (!target)
-		return nullptr;
+		return VIGEM_SUCCESS(error) ? VIGEM_ERROR_BUS_NOT_FOUND : error;
+	}
 
-	target->VendorId = 0x045E;
-	target->ProductId = 0x028E;
+	vigem->hBusDevice = vigem->Buses[0]->hBusDevice;
 
-	return target;
+	VIGEM_LOG(VIGEM_LOG_LEVEL_INFO, L"Connected 0x%p to %u buses", vigem, vigem->BusCount);
+
+	return VIGEM_ERROR_NONE;
 }
 
-PVIGEM_TARGET vigem_target_ds4_alloc(void)
+VIGEM_ERROR vigem_connect_multi_bus(PVIGEM_CLIENT vigem)
 {
-	const auto target = VIGEM_TARGET_ALLOC_INIT(DualShock4Wired);
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
 
-	if (!target)
-		return nullptr;
+	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_ALREADY_CONNECTED;
 
-	target->VendorId = 0x054C;
-	target->ProductId = 0x05C4;
-	target->Ds4CachedOutputReportUpdateAvailable = CreateEvent(
-		nullptr,
-		FALSE,
-		FALSE,
-		nullptr
-	);
-	InitializeCriticalSection(&target->Ds4CachedOutputReportUpdateLock);
+	const VIGEM_ERROR error = vigem_internal_enum_buses(TRUE, [vigem](LPCTSTR devicePath)
+	{
+		return vigem_internal_add_bus(vigem, [devicePath](PVIGEM_CLIENT bus)
+		{
+			return vigem_internal_open_bus(bus, devicePath);
+		});
+	});
 
-	return target;
+	return vigem_internal_multi_bus_connected(vigem, error);
 }
 
-void vigem_target_free(PVIGEM_TARGET target)
+VIGEM_ERROR vigem_connect_simulated_multi_bus(PVIGEM_CLIENT vigem, ULONG busCount)
 {
-	if (target)
-	{
-		if (target->Ds4CachedOutputReportUpdateAvailable)
-		{
-			CloseHandle(target->Ds4CachedOutputReportUpdateAvailable);
-		}
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_ALREADY_CONNECTED;
 
-		DeleteCriticalSection(&target->Ds4CachedOutputReportUpdateLock);
+	if (busCount == 0)
+		return VIGEM_ERROR_INVALID_PARAMETER;
 
-		free(target);
-	}
+	VIGEM_ERROR error = VIGEM_ERROR_NONE;
+
+	for (ULONG index = 0; index < busCount && VIGEM_SUCCESS(error); index++)
+		error = vigem_internal_add_bus(vigem, vigem_connect_simulated);
+
+	if (!VIGEM_SUCCESS(error))
+		vigem_internal_close_buses(vigem);
+
+	return vigem_internal_multi_bus_connected(vigem, error);
 }
 
-VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+ULONG vigem_get_bus_count(PVIGEM_CLIENT vigem)
 {
-	VIGEM_ERROR error = VIGEM_ERROR_NO_FREE_SLOT;
-	DWORD transferred = 0;
-	VIGEM_PLUGIN_TARGET plugin;
-	VIGEM_WAIT_DEVICE_READY devReady;
-	OVERLAPPED olPlugIn = { 0 };
-	olPlugIn.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-	OVERLAPPED olWait = { 0 };
-	olWait.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (!vigem || vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return 0;
+
+	return vigem->Buses ? vigem->BusCount : 1;
+}
+
+//
+// Process-wide connection clients attach to instead of opening their own,
+// one to the bus driver and one to a simulated bus. Closed with the last
+// client detaching.
+// 
+typedef struct _VIGEM_SHARED_SESSION_T
+{
+	SRWLOCK Lock;
+	PVIGEM_CLIENT Client;
+	ULONG References;
+} VIGEM_SHARED_SESSION, *PVIGEM_SHARED_SESSION;
+
+static VIGEM_SHARED_SESSION g_SharedSessions[2];
+
+static VIGEM_ERROR vigem_internal_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target);
+
+//
+// Opens the session's connection, the caller holds the session lock.
+// 
+template <typename TConnect>
+static VIGEM_ERROR vigem_internal_shared_open(PVIGEM_SHARED_SESSION session, PVIGEM_CLIENT vigem, TConnect Connect)
+{
+	const PVIGEM_CLIENT client = vigem_alloc();
+
+	if (!client)
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+
+	const auto owners = static_cast<PVIGEM_CLIENT*>(vigem_internal_calloc(VIGEM_TARGETS_MAX, sizeof(PVIGEM_CLIENT)));
+
+	if (!owners)
+	{
+		vigem_free(client);
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+	}
+
+	client->Owners = owners;
+
+	// the pickup thread is scheduled as the first client asked for
+	client->ThreadConfigs[VIGEM_THREAD_OUTPUT_REPORT_PICKUP] = vigem->ThreadConfigs[VIGEM_THREAD_OUTPUT_REPORT_PICKUP];
+
+	const VIGEM_ERROR error = Connect(client);
+
+	if (!VIGEM_SUCCESS(error))
+	{
+		vigem_internal_free(owners);
+		vigem_free(client);
+		return error;
+	}
+
+	session->Client = client;
+
+	VIGEM_LOG(VIGEM_LOG_LEVEL_INFO, L"Opened shared session 0x%p", client);
+
+	return VIGEM_ERROR_NONE;
+}
+
+template <typename TConnect>
+static VIGEM_ERROR vigem_internal_shared_attach(PVIGEM_CLIENT vigem, PVIGEM_SHARED_SESSION session, TConnect Connect)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_ALREADY_CONNECTED;
+
+	const auto buses = static_cast<PVIGEM_CLIENT*>(vigem_internal_alloc(sizeof(PVIGEM_CLIENT)));
+
+	if (!buses)
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+
+	AcquireSRWLockExclusive(&session->Lock);
+
+	VIGEM_ERROR error = VIGEM_ERROR_NONE;
+
+	if (!session->Client)
+		error = vigem_internal_shared_open(session, vigem, Connect);
+
+	if (VIGEM_SUCCESS(error))
+	{
+		session->References++;
+
+		buses[0] = session->Client;
+
+		vigem->Buses = buses;
+		vigem->BusCount = 1;
+		vigem->Session = session;
+		vigem->hBusDevice = session->Client->hBusDevice;
+	}
+
+	ReleaseSRWLockExclusive(&session->Lock);
+
+	if (!VIGEM_SUCCESS(error))
+		vigem_internal_free(buses);
+
+	return error;
+}
+
+//
+// Unplugs the targets the client left on the session and cancels its
+// operations, then closes the session if it was the last client.
+// 
+static VOID vigem_internal_shared_detach(PVIGEM_CLIENT vigem)
+{
+	const PVIGEM_SHARED_SESSION session = vigem->Session;
+	const PVIGEM_CLIENT bus = vigem->Buses[0];
+
+	for (ULONG serial = 1; serial < VIGEM_TARGETS_MAX; serial++)
+	{
+		if (bus->Owners[serial] == vigem)
+			vigem_internal_target_remove(bus, bus->pTargetsList[serial]);
+	}
+
+	vigem_internal_async_cancel_owned(bus, vigem);
+
+	AcquireSRWLockExclusive(&session->Lock);
+
+	if (--session->References == 0)
+	{
+		const auto owners = bus->Owners;
+
+		vigem_disconnect(bus);
+		vigem_free(bus);
+		vigem_internal_free(owners);
+
+		session->Client = nullptr;
+
+		VIGEM_LOG(VIGEM_LOG_LEVEL_INFO, L"Closed shared session 0x%p", bus);
+	}
+
+	ReleaseSRWLockExclusive(&session->Lock);
+
+	vigem_internal_free(vigem->Buses);
+
+	vigem->Buses = nullptr;
+	vigem->BusCount = 0;
+	vigem->Session = nullptr;
+}
+
+VIGEM_ERROR vigem_connect_shared(PVIGEM_CLIENT vigem)
+{
+	return vigem_internal_shared_attach(vigem, &g_SharedSessions[0], vigem_connect);
+}
+
+VIGEM_ERROR vigem_connect_simulated_shared(PVIGEM_CLIENT vigem)
+{
+	return vigem_internal_shared_attach(vigem, &g_SharedSessions[1], vigem_connect_simulated);
+}
+
+VIGEM_ERROR vigem_connect_simulated(PVIGEM_CLIENT vigem)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_ALREADY_CONNECTED;
+
+	vigem->SimBus = vigem_internal_sim_bus_alloc();
+
+	if (!vigem->SimBus)
+		return VIGEM_ERROR_BUS_ACCESS_FAILED;
+
+	//
+	// Never used as a handle, all I/O is routed to the simulated bus
+	// 
+	vigem->hBusDevice = reinterpret_cast<HANDLE>(vigem->SimBus);
+
+	vigem->hDS4OutputReportPickupThread = CreateThread(
+		nullptr,
+		0,
+		vigem_internal_ds4_output_report_pickup_handler,
+		vigem,
+		0,
+		nullptr
+	);
+
+	return VIGEM_ERROR_NONE;
+}
+
+void vigem_disconnect(PVIGEM_CLIENT vigem)
+{
+	if (!vigem)
+		return;
+
+	vigem_record_stop(vigem);
+	vigem_internal_stats_free(vigem);
+	vigem_internal_target_pool_release(vigem);
+
+	if (vigem->hDS4OutputReportPickupThread && vigem->hDS4OutputReportPickupThreadAbortEvent)
+	{
+		VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Awaiting DS4 thread clean-up for 0x%p", vigem);
+
+		SetEvent(vigem->hDS4OutputReportPickupThreadAbortEvent);
+		WaitForSingleObject(vigem->hDS4OutputReportPickupThread, INFINITE);
+		CloseHandle(vigem->hDS4OutputReportPickupThread);
+
+		VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"DS4 thread clean-up for 0x%p finished", vigem);
+	}
+
+	if (vigem->Session)
+	{
+		vigem_internal_shared_detach(vigem);
+
+		// borrowed from the session
+		vigem->hBusDevice = INVALID_HANDLE_VALUE;
+	}
+	else if (vigem->Buses)
+	{
+		vigem_internal_close_buses(vigem);
+
+		// borrowed from the first bus, closed with it
+		vigem->hBusDevice = INVALID_HANDLE_VALUE;
+	}
+
+	// the pickup thread no longer hands out reports, the bus is still open
+	vigem_internal_async_cancel_all(vigem);
+	vigem_internal_async_release(vigem);
+
+	// after the pickup thread so its cancelled request is captured too
+	vigem_capture_stop(vigem);
+
+	if (vigem->hBusDevice != INVALID_HANDLE_VALUE)
+	{
+		VIGEM_LOG(VIGEM_LOG_LEVEL_VERBOSE, L"Closing bus handle for 0x%p", vigem);
+
+		vigem_internal_close_bus(vigem);
+		vigem->hBusDevice = INVALID_HANDLE_VALUE;
+	}
+
+	//
+	// Back to the state vigem_alloc left it in so it can connect again. Thread
+	// configurations are set up before connecting and apply to the next
+	// connection too.
+	// 
+	const HANDLE abortEvent = vigem->hDS4OutputReportPickupThreadAbortEvent;
+	VIGEM_THREAD_CONFIG threadConfigs[_countof(vigem->ThreadConfigs)];
+	RtlCopyMemory(threadConfigs, vigem->ThreadConfigs, sizeof(threadConfigs));
+
+	RtlZeroMemory(vigem, sizeof(VIGEM_CLIENT));
+
+	vigem->hBusDevice = INVALID_HANDLE_VALUE;
+	vigem->hDS4OutputReportPickupThreadAbortEvent = abortEvent;
+	RtlCopyMemory(vigem->ThreadConfigs, threadConfigs, sizeof(threadConfigs));
+
+	if (abortEvent)
+		ResetEvent(abortEvent);
+}
+
+BOOLEAN vigem_target_is_waitable_add_supported(PVIGEM_TARGET target)
+{
+	//
+	// Safety check to make people use the older functions and not cause issues
+	// Should never pass in an invalid target but doesn't hurt to check.
+	//
+	if (!target)
+		return FALSE;
+
+	// TODO: Replace all this with a more robust version check system
+	return !target->IsWaitReadyUnsupported;
+}
+
+PVIGEM_TARGET vigem_target_x360_alloc(void)
+{
+	const auto target = VIGEM_TARGET_ALLOC_INIT(Xbox360Wired);
+
+	if (!target)
+		return nullptr;
+
+	target->VendorId = 0x045E;
+	target->ProductId = 0x028E;
+
+	return target;
+}
+
+PVIGEM_TARGET vigem_target_ds4_alloc(void)
+{
+	const auto target = VIGEM_TARGET_ALLOC_INIT(DualShock4Wired);
+
+	if (!target)
+		return nullptr;
+
+	target->VendorId = 0x054C;
+	target->ProductId = 0x05C4;
+
+	return target;
+}
+
+PVIGEM_TARGET vigem_target_x360_alloc_pooled(PVIGEM_CLIENT vigem)
+{
+	const auto target = VIGEM_TARGET_POOL_ALLOC_INIT(vigem, Xbox360Wired);
+
+	if (!target)
+		return nullptr;
+
+	target->VendorId = 0x045E;
+	target->ProductId = 0x028E;
+
+	return target;
+}
+
+PVIGEM_TARGET vigem_target_ds4_alloc_pooled(PVIGEM_CLIENT vigem)
+{
+	const auto target = VIGEM_TARGET_POOL_ALLOC_INIT(vigem, DualShock4Wired);
+
+	if (!target)
+		return nullptr;
+
+	target->VendorId = 0x054C;
+	target->ProductId = 0x05C4;
+
+	return target;
+}
+
+void vigem_target_free(PVIGEM_TARGET target)
+{
+	if (target)
+	{
+		const PVIGEM_TARGET_COLD cold = target->Cold;
+
+		if (cold)
+		{
+			if (cold->Ds4CachedOutputReportUpdateAvailable)
+			{
+				CloseHandle(cold->Ds4CachedOutputReportUpdateAvailable);
+				DeleteCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
+			}
+
+			vigem_internal_free(cold);
+		}
+
+		vigem_internal_free(target->Stats);
+
+		// keeps its submission event for the next use
+		if (target->Pool)
+		{
+			vigem_internal_target_pool_push(target);
+			return;
+		}
+
+		if (target->SubmitEvent)
+			CloseHandle(target->SubmitEvent);
+
+		vigem_internal_free(target);
+	}
+}
+
+static VIGEM_ERROR vigem_internal_target_add(PVIGEM_CLIENT vigem, PVIGEM_CLIENT owner, PVIGEM_TARGET target)
+{
+	VIGEM_TRACE_SCOPE("target_add", 0);
+
+	VIGEM_ERROR error = VIGEM_ERROR_NO_FREE_SLOT;
+	DWORD transferred = 0;
+	VIGEM_PLUGIN_TARGET plugin;
+	VIGEM_WAIT_DEVICE_READY devReady;
+	OVERLAPPED olPlugIn = { 0 };
+	olPlugIn.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	OVERLAPPED olWait = { 0 };
+	olWait.hEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
 	do
 	{
@@ -559,6 +1036,8 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 			plugin.VendorId = target->VendorId;
 			plugin.ProductId = target->ProductId;
 
+			VIGEM_TRACE_SCOPE("plugin", target->SerialNo);
+
 			/*
 			 * Request plugin of device. This is an inherently asynchronous operation,
 			 * which is addressed differently through the history of the driver design.
@@ -572,8 +1051,8 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 			 * perfect and can cause other functions to fail if called too soon but
 			 * hopefully the applications will just ignore these errors and retry ;)
 			 */
-			DeviceIoControl(
-				vigem->hBusDevice,
+			vigem_internal_io_control(
+				vigem,
 				IOCTL_VIGEM_PLUGIN_TARGET,
 				&plugin,
 				plugin.Size,
@@ -586,8 +1065,13 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 			//
 			// This should return fairly immediately >=v1.17
 			// 
-			if (GetOverlappedResult(vigem->hBusDevice, &olPlugIn, &transferred, TRUE) != 0)
+			if (vigem_internal_get_overlapped_result(vigem, &olPlugIn, &transferred, TRUE) != 0)
 			{
+				// balanced by the unplug, also if waiting fails below
+				InterlockedIncrement(&vigem->TargetCount);
+
+				vigem_internal_bus_own(vigem, target, owner);
+
 				/*
 				 * This function is announced to be blocking/synchronous, a concept that
 				 * doesn't reflect the way the bus driver/PNP manager bring child devices
@@ -597,10 +1081,12 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 				 * supported on drivers v1.17 or higher, so gracefully cause errors
 				 * of this call as a potential success and keep the device plugged in.
 				 */
+				VIGEM_TRACE_SCOPE("wait_device_ready", plugin.SerialNo);
+
 				VIGEM_WAIT_DEVICE_READY_INIT(&devReady, plugin.SerialNo);
 
-				DeviceIoControl(
-					vigem->hBusDevice,
+				vigem_internal_io_control(
+					vigem,
 					IOCTL_VIGEM_WAIT_DEVICE_READY,
 					&devReady,
 					devReady.Size,
@@ -610,7 +1096,7 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 					&olWait
 				);
 
-				if (GetOverlappedResult(vigem->hBusDevice, &olWait, &transferred, TRUE) != 0)
+				if (vigem_internal_get_overlapped_result(vigem, &olWait, &transferred, TRUE) != 0)
 				{
 					target->State = VIGEM_TARGET_CONNECTED;
 
@@ -634,6 +1120,7 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 				// Don't leave device connected if the wait call failed
 				// 
 				error = vigem_target_remove(vigem, target);
+				vigem_internal_bus_own(vigem, target, nullptr);
 				break;
 			}
 		}
@@ -653,6 +1140,219 @@ VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 	return error;
 }
 
+VIGEM_ERROR vigem_target_add(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	return vigem_internal_stats_call(vigem, target, VIGEM_STATS_TARGET_ADD, [=]
+	{
+		if (!vigem || !vigem->Buses)
+			return vigem_internal_target_add(vigem, vigem, target);
+
+		const PVIGEM_CLIENT bus = vigem_internal_bus_reserve(vigem);
+		const VIGEM_ERROR error = vigem_internal_target_add(bus, vigem, target);
+
+		vigem_internal_bus_release(bus, target, VIGEM_SUCCESS(error));
+
+		return error;
+	});
+}
+
+//
+// Arguments of a thread started for a target, freed by the thread once it
+// copied them.
+// 
+typedef struct _VIGEM_TARGET_THREAD_ARGS
+{
+	PVIGEM_TARGET Target;
+	PVIGEM_CLIENT Client;
+	PVIGEM_CLIENT Owner;
+	LPVOID UserData;
+	PFN_VIGEM_TARGET_ADD_RESULT AddResult;
+} VIGEM_TARGET_THREAD_ARGS, *PVIGEM_TARGET_THREAD_ARGS;
+
+//
+// Starts a detached thread for a target, its arguments come from the
+// library's allocator.
+// 
+static VIGEM_ERROR vigem_internal_target_thread_start(
+	LPTHREAD_START_ROUTINE Routine,
+	PVIGEM_TARGET Target,
+	PVIGEM_CLIENT Client,
+	PVIGEM_CLIENT Owner,
+	LPVOID UserData,
+	PFN_VIGEM_TARGET_ADD_RESULT AddResult
+)
+{
+	const auto args = static_cast<PVIGEM_TARGET_THREAD_ARGS>(vigem_internal_alloc(sizeof(VIGEM_TARGET_THREAD_ARGS)));
+
+	if (!args)
+		return VIGEM_ERROR_WINAPI;
+
+	args->Target = Target;
+	args->Client = Client;
+	args->Owner = Owner;
+	args->UserData = UserData;
+	args->AddResult = AddResult;
+
+	const HANDLE thread = CreateThread(nullptr, 0, Routine, args, 0, nullptr);
+
+	if (!thread)
+	{
+		vigem_internal_free(args);
+		return VIGEM_ERROR_WINAPI;
+	}
+
+	CloseHandle(thread);
+
+	return VIGEM_ERROR_NONE;
+}
+
+//
+// Runs a deprecated vigem_target_add_async on a thread of its own.
+// 
+static DWORD WINAPI vigem_internal_target_add_async_thread(LPVOID Parameter)
+{
+	const auto args = static_cast<PVIGEM_TARGET_THREAD_ARGS>(Parameter);
+	const PVIGEM_TARGET target = args->Target;
+	const PVIGEM_CLIENT vigem = args->Client;
+	const PFN_VIGEM_TARGET_ADD_RESULT result = args->AddResult;
+
+	vigem_internal_free(args);
+
+	const auto error = vigem_target_add(vigem, target);
+
+	result(vigem, target, error);
+
+	return 0;
+}
+
+//
+// Relays X360 notifications to the registered callback until the target is
+// unplugged or the callback is unregistered.
+// 
+static DWORD WINAPI vigem_internal_x360_notification_thread(LPVOID Parameter)
+{
+	const auto args = static_cast<PVIGEM_TARGET_THREAD_ARGS>(Parameter);
+	const PVIGEM_TARGET target = args->Target;
+	const PVIGEM_CLIENT vigem = args->Client;
+	const PVIGEM_CLIENT owner = args->Owner;
+	const LPVOID userData = args->UserData;
+
+	vigem_internal_free(args);
+
+	DEVICE_IO_CONTROL_BEGIN;
+
+	XUSB_REQUEST_NOTIFICATION xrn;
+	XUSB_REQUEST_NOTIFICATION_INIT(&xrn, target->SerialNo);
+
+	VIGEM_TRACE_THREAD_NAME("X360 notification");
+
+	vigem_internal_thread_start(&owner->ThreadConfigs[VIGEM_THREAD_NOTIFICATION], owner, VIGEM_THREAD_NOTIFICATION);
+
+	do
+	{
+		vigem_internal_io_control(
+			vigem,
+			IOCTL_XUSB_REQUEST_NOTIFICATION,
+			&xrn,
+			xrn.Size,
+			&xrn,
+			xrn.Size,
+			&transferred,
+			&lOverlapped
+		);
+
+		if (vigem_internal_get_overlapped_result(vigem, &lOverlapped, &transferred, TRUE) != 0)
+		{
+			if (target->Cold->Notification == nullptr)
+			{
+				DEVICE_IO_CONTROL_END;
+				return 0;
+			}
+
+			{
+				VIGEM_TRACE_SCOPE("x360_notification_callback", target->SerialNo);
+
+				reinterpret_cast<PFN_VIGEM_X360_NOTIFICATION>(target->Cold->Notification)(
+					owner, target, xrn.LargeMotor, xrn.SmallMotor, xrn.LedNumber, userData
+				);
+			}
+
+			continue;
+		}
+
+		if (GetLastError() == ERROR_ACCESS_DENIED || GetLastError() == ERROR_OPERATION_ABORTED)
+		{
+			DEVICE_IO_CONTROL_END;
+			return 0;
+		}
+	} while (TRUE);
+}
+
+//
+// Relays DS4 notifications to the registered callback until the target is
+// unplugged or the callback is unregistered.
+// 
+static DWORD WINAPI vigem_internal_ds4_notification_thread(LPVOID Parameter)
+{
+	const auto args = static_cast<PVIGEM_TARGET_THREAD_ARGS>(Parameter);
+	const PVIGEM_TARGET target = args->Target;
+	const PVIGEM_CLIENT vigem = args->Client;
+	const PVIGEM_CLIENT owner = args->Owner;
+	const LPVOID userData = args->UserData;
+
+	vigem_internal_free(args);
+
+	DEVICE_IO_CONTROL_BEGIN;
+
+	DS4_REQUEST_NOTIFICATION ds4rn;
+	DS4_REQUEST_NOTIFICATION_INIT(&ds4rn, target->SerialNo);
+
+	VIGEM_TRACE_THREAD_NAME("DS4 notification");
+
+	vigem_internal_thread_start(&owner->ThreadConfigs[VIGEM_THREAD_NOTIFICATION], owner, VIGEM_THREAD_NOTIFICATION);
+
+	do
+	{
+		vigem_internal_io_control(
+			vigem,
+			IOCTL_DS4_REQUEST_NOTIFICATION,
+			&ds4rn,
+			ds4rn.Size,
+			&ds4rn,
+			ds4rn.Size,
+			&transferred,
+			&lOverlapped
+		);
+
+		if (vigem_internal_get_overlapped_result(vigem, &lOverlapped, &transferred, TRUE) != 0)
+		{
+			if (target->Cold->Notification == nullptr)
+			{
+				DEVICE_IO_CONTROL_END;
+				return 0;
+			}
+
+			{
+				VIGEM_TRACE_SCOPE("ds4_notification_callback", target->SerialNo);
+
+				reinterpret_cast<PFN_VIGEM_DS4_NOTIFICATION>(target->Cold->Notification)(
+					owner, target, ds4rn.Report.LargeMotor,
+					ds4rn.Report.SmallMotor,
+					ds4rn.Report.LightbarColor, userData
+				);
+			}
+
+			continue;
+		}
+
+		if (GetLastError() == ERROR_ACCESS_DENIED || GetLastError() == ERROR_OPERATION_ABORTED)
+		{
+			DEVICE_IO_CONTROL_END;
+			return 0;
+		}
+	} while (TRUE);
+}
+
 VIGEM_ERROR vigem_target_add_async(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, PFN_VIGEM_TARGET_ADD_RESULT result)
 {
 	if (!vigem)
@@ -670,25 +1370,10 @@ VIGEM_ERROR vigem_target_add_async(PVIGEM_CLIENT vigem, PVIGEM_TARGET target, PF
 	if (target->State == VIGEM_TARGET_CONNECTED)
 		return VIGEM_ERROR_ALREADY_CONNECTED;
 
-	std::thread _async{
-		[](
-		PVIGEM_TARGET _Target,
-		PVIGEM_CLIENT _Client,
-		PFN_VIGEM_TARGET_ADD_RESULT _Result)
-		{
-			const auto error = vigem_target_add(_Client, _Target);
-
-			_Result(_Client, _Target, error);
-		},
-		target, vigem, result
-	};
-
-	_async.detach();
-
-	return VIGEM_ERROR_NONE;
+	return vigem_internal_target_thread_start(vigem_internal_target_add_async_thread, target, vigem, vigem, nullptr, result);
 }
 
-VIGEM_ERROR vigem_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+static VIGEM_ERROR vigem_internal_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 {
 	if (!vigem)
 		return VIGEM_ERROR_BUS_INVALID_HANDLE;
@@ -705,13 +1390,15 @@ VIGEM_ERROR vigem_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 	if (target->State != VIGEM_TARGET_CONNECTED)
 		return VIGEM_ERROR_TARGET_NOT_PLUGGED_IN;
 
+	VIGEM_TRACE_SCOPE("unplug", target->SerialNo);
+
 	VIGEM_UNPLUG_TARGET unplug;
 	DEVICE_IO_CONTROL_BEGIN;
 
 	VIGEM_UNPLUG_TARGET_INIT(&unplug, target->SerialNo);
 
-	DeviceIoControl(
-		vigem->hBusDevice,
+	vigem_internal_io_control(
+		vigem,
 		IOCTL_VIGEM_UNPLUG_TARGET,
 		&unplug,
 		unplug.Size,
@@ -721,21 +1408,37 @@ VIGEM_ERROR vigem_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 		&lOverlapped
 	);
 
-	if (GetOverlappedResult(vigem->hBusDevice, &lOverlapped, &transferred, TRUE) != 0)
+	if (vigem_internal_get_overlapped_result(vigem, &lOverlapped, &transferred, TRUE) != 0)
 	{
 		if (target->Type == DualShock4Wired)
 		{
-			EnterCriticalSection(&target->Ds4CachedOutputReportUpdateLock);
-			{
-				target->IsDisposing = TRUE;
-				vigem->pTargetsList[target->SerialNo] = nullptr;
+			//
+			// An awaiter allocating the cold block after this either sees
+			// the flag or is waited for below
+			// 
+			target->IsDisposing = TRUE;
+			MemoryBarrier();
 
-			}
-			LeaveCriticalSection(&target->Ds4CachedOutputReportUpdateLock);
+			const PVIGEM_TARGET_COLD cold = target->Cold;
+
+			if (cold)
+				EnterCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
+
+			vigem->pTargetsList[target->SerialNo] = nullptr;
+
+			if (cold)
+				LeaveCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
+
+			vigem_internal_async_target_removed(vigem, target);
 		}
 
 		target->State = VIGEM_TARGET_DISCONNECTED;
 
+		if (vigem->Owners)
+			vigem->Owners[target->SerialNo] = nullptr;
+
+		InterlockedDecrement(&vigem->TargetCount);
+
 		DEVICE_IO_CONTROL_END;
 
 		return VIGEM_ERROR_NONE;
@@ -746,6 +1449,14 @@ VIGEM_ERROR vigem_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
 	return VIGEM_ERROR_REMOVAL_FAILED;
 }
 
+VIGEM_ERROR vigem_target_remove(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	return vigem_internal_stats_call(vigem, target, VIGEM_STATS_TARGET_REMOVE, [=]
+	{
+		return vigem_internal_target_remove(vigem_internal_bus(vigem, target), target);
+	});
+}
+
 VIGEM_ERROR vigem_target_x360_register_notification(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
@@ -753,6 +1464,9 @@ VIGEM_ERROR vigem_target_x360_register_notification(
 	LPVOID userData
 )
 {
+	const PVIGEM_CLIENT owner = vigem;
+	vigem = vigem_internal_bus(vigem, target);
+
 	if (!vigem)
 		return VIGEM_ERROR_BUS_INVALID_HANDLE;
 
@@ -765,368 +1479,554 @@ VIGEM_ERROR vigem_target_x360_register_notification(
 	if (target->SerialNo == 0 || notification == nullptr)
 		return VIGEM_ERROR_INVALID_TARGET;
 
-	if (target->Notification == reinterpret_cast<FARPROC>(notification))
+	const PVIGEM_TARGET_COLD cold = vigem_internal_target_cold(target);
+
+	if (!cold)
+		return VIGEM_ERROR_WINAPI;
+
+	if (cold->Notification == reinterpret_cast<FARPROC>(notification))
 		return VIGEM_ERROR_CALLBACK_ALREADY_REGISTERED;
 
-	target->Notification = reinterpret_cast<FARPROC>(notification);
-	target->NotificationUserData = userData;
+	cold->Notification = reinterpret_cast<FARPROC>(notification);
+	cold->NotificationUserData = userData;
 
-	if (target->CancelNotificationThreadEvent == nullptr)
-		target->CancelNotificationThreadEvent = CreateEvent(
+	if (cold->CancelNotificationThreadEvent == nullptr)
+		cold->CancelNotificationThreadEvent = CreateEvent(
 			nullptr,
 			TRUE,
 			FALSE,
 			nullptr
 		);
 	else
-		ResetEvent(target->CancelNotificationThreadEvent);
+		ResetEvent(cold->CancelNotificationThreadEvent);
 
-	std::thread _async{
-		[](
-		PVIGEM_TARGET _Target,
-		PVIGEM_CLIENT _Client,
-		LPVOID _UserData)
-		{
-			DEVICE_IO_CONTROL_BEGIN;
+	const VIGEM_ERROR error = vigem_internal_target_thread_start(vigem_internal_x360_notification_thread, target, vigem, owner, userData, nullptr);
 
-			XUSB_REQUEST_NOTIFICATION xrn;
-			XUSB_REQUEST_NOTIFICATION_INIT(&xrn, _Target->SerialNo);
+	if (!VIGEM_SUCCESS(error))
+		cold->Notification = nullptr;
 
-			do
-			{
-				DeviceIoControl(
-					_Client->hBusDevice,
-					IOCTL_XUSB_REQUEST_NOTIFICATION,
-					&xrn,
-					xrn.Size,
-					&xrn,
-					xrn.Size,
-					&transferred,
-					&lOverlapped
-				);
+	return error;
+}
 
-				if (GetOverlappedResult(_Client->hBusDevice, &lOverlapped, &transferred, TRUE) != 0)
-				{
-					if (_Target->Notification == nullptr)
-					{
-						DEVICE_IO_CONTROL_END;
-						return;
-					}
+VIGEM_ERROR vigem_target_ds4_register_notification(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PFN_VIGEM_DS4_NOTIFICATION notification,
+	LPVOID userData
+)
+{
+	const PVIGEM_CLIENT owner = vigem;
+	vigem = vigem_internal_bus(vigem, target);
 
-					reinterpret_cast<PFN_VIGEM_X360_NOTIFICATION>(_Target->Notification)(
-						_Client, _Target, xrn.LargeMotor, xrn.SmallMotor, xrn.LedNumber, _UserData
-					);
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
 
-					continue;
-				}
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
 
-				if (GetLastError() == ERROR_ACCESS_DENIED || GetLastError() == ERROR_OPERATION_ABORTED)
-				{
-					DEVICE_IO_CONTROL_END;
-					return;
-				}
-			} while (TRUE);
-		},
-		target, vigem, userData
-	};
+	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_NOT_FOUND;
+
+	if (target->SerialNo == 0 || notification == nullptr)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	const PVIGEM_TARGET_COLD cold = vigem_internal_target_cold(target);
 
-	_async.detach();
+	if (!cold)
+		return VIGEM_ERROR_WINAPI;
+
+	if (cold->Notification == reinterpret_cast<FARPROC>(notification))
+		return VIGEM_ERROR_CALLBACK_ALREADY_REGISTERED;
+
+	cold->Notification = reinterpret_cast<FARPROC>(notification);
+	cold->NotificationUserData = userData;
+
+	if (cold->CancelNotificationThreadEvent == nullptr)
+		cold->CancelNotificationThreadEvent = CreateEvent(
+			nullptr,
+			TRUE,
+			FALSE,
+			nullptr
+		);
+	else
+		ResetEvent(cold->CancelNotificationThreadEvent);
+
+	const VIGEM_ERROR error = vigem_internal_target_thread_start(vigem_internal_ds4_notification_thread, target, vigem, owner, userData, nullptr);
+
+	if (!VIGEM_SUCCESS(error))
+		cold->Notification = nullptr;
+
+	return error;
+}
+
+void vigem_target_x360_unregister_notification(PVIGEM_TARGET target)
+{
+	const PVIGEM_TARGET_COLD cold = target->Cold;
+
+	// never registered
+	if (!cold)
+		return;
+
+	if (cold->CancelNotificationThreadEvent != nullptr)
+		SetEvent(cold->CancelNotificationThreadEvent);
+
+	if (cold->CancelNotificationThreadEvent != nullptr)
+	{
+		CloseHandle(cold->CancelNotificationThreadEvent);
+		cold->CancelNotificationThreadEvent = nullptr;
+	}
+
+	cold->Notification = nullptr;
+	cold->NotificationUserData = nullptr;
+}
+
+void vigem_target_ds4_unregister_notification(PVIGEM_TARGET target)
+{
+	vigem_target_x360_unregister_notification(target); // The same x360_unregister handler works for DS4_unregister also
+}
+
+void vigem_target_set_vid(PVIGEM_TARGET target, USHORT vid)
+{
+	target->VendorId = vid;
+}
+
+void vigem_target_set_pid(PVIGEM_TARGET target, USHORT pid)
+{
+	target->ProductId = pid;
+}
+
+USHORT vigem_target_get_vid(PVIGEM_TARGET target)
+{
+	return target->VendorId;
+}
+
+USHORT vigem_target_get_pid(PVIGEM_TARGET target)
+{
+	return target->ProductId;
+}
+
+//
+// Checks shared by all report submissions
+// 
+static FORCEINLINE VIGEM_ERROR vigem_internal_target_check(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	if (!vigem)
+		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+
+	if (!target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
+		return VIGEM_ERROR_BUS_NOT_FOUND;
+
+	if (target->SerialNo == 0)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	return VIGEM_ERROR_NONE;
+}
+
+//
+// The wait event of the target's submissions, created on first use and
+// kept until the target is freed. Targets are externally synchronized, so
+// updates and pinned commits share it.
+// 
+static FORCEINLINE HANDLE vigem_internal_target_submit_event(PVIGEM_TARGET target)
+{
+	if (!target->SubmitEvent)
+		target->SubmitEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 
-	return VIGEM_ERROR_NONE;
+	return target->SubmitEvent;
 }
 
-VIGEM_ERROR vigem_target_ds4_register_notification(
+//
+// Sends a prepared submit structure of any format described by
+// VIGEM_TARGET_TRAITS, waiting on the event of the caller's overlapped.
+// 
+template <typename TReport>
+static FORCEINLINE VIGEM_ERROR vigem_internal_target_send(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
-	PFN_VIGEM_DS4_NOTIFICATION notification,
-	LPVOID userData
+	const typename VIGEM_TARGET_TRAITS<TReport>::SubmitReport& submit,
+	LPOVERLAPPED overlapped
 )
 {
-	if (!vigem)
-		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+	using Traits = VIGEM_TARGET_TRAITS<TReport>;
 
-	if (!target)
-		return VIGEM_ERROR_INVALID_TARGET;
+	VIGEM_TRACE_SCOPE(Traits::TraceName, target->SerialNo);
 
-	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
-		return VIGEM_ERROR_BUS_NOT_FOUND;
+	//
+	// Only timestamp reports while a recording is active
+	// 
+	const PVIGEM_CLIENT owner = vigem_internal_owner(vigem, target);
+	const BOOLEAN recording = (owner->Recorder != nullptr);
+	LARGE_INTEGER submitted = { 0 };
 
-	if (target->SerialNo == 0 || notification == nullptr)
-		return VIGEM_ERROR_INVALID_TARGET;
+	if (recording)
+		QueryPerformanceCounter(&submitted);
 
-	if (target->Notification == reinterpret_cast<FARPROC>(notification))
-		return VIGEM_ERROR_CALLBACK_ALREADY_REGISTERED;
+	DWORD transferred = 0;
+	BOOL completed;
 
-	target->Notification = reinterpret_cast<FARPROC>(notification);
-	target->NotificationUserData = userData;
+	{
+		VIGEM_TRACE_SCOPE("submit_ioctl", target->SerialNo);
 
-	if (target->CancelNotificationThreadEvent == nullptr)
-		target->CancelNotificationThreadEvent = CreateEvent(
+		vigem_internal_io_control(
+			vigem,
+			Traits::IoControlCode,
+			const_cast<typename Traits::SubmitReport*>(&submit),
+			submit.Size,
 			nullptr,
-			TRUE,
-			FALSE,
-			nullptr
+			0,
+			&transferred,
+			overlapped
 		);
-	else
-		ResetEvent(target->CancelNotificationThreadEvent);
 
-	std::thread _async{
-		[](
-		PVIGEM_TARGET _Target,
-		PVIGEM_CLIENT _Client,
-		LPVOID _UserData)
-		{
-			DEVICE_IO_CONTROL_BEGIN;
+		completed = vigem_internal_get_overlapped_result(vigem, overlapped, &transferred, TRUE);
+	}
 
-			DS4_REQUEST_NOTIFICATION ds4rn;
-			DS4_REQUEST_NOTIFICATION_INIT(&ds4rn, _Target->SerialNo);
+	VIGEM_ERROR error = VIGEM_ERROR_NONE;
 
-			do
-			{
-				DeviceIoControl(
-					_Client->hBusDevice,
-					IOCTL_DS4_REQUEST_NOTIFICATION,
-					&ds4rn,
-					ds4rn.Size,
-					&ds4rn,
-					ds4rn.Size,
-					&transferred,
-					&lOverlapped
-				);
+	if (completed == 0)
+	{
+		error = Traits::MapError(GetLastError());
+	}
+	else if (recording)
+	{
+		vigem_internal_record(
+			owner,
+			Traits::RecordType,
+			target->SerialNo,
+			submitted.QuadPart,
+			&submit.Report,
+			sizeof(TReport)
+		);
+	}
 
-				if (GetOverlappedResult(_Client->hBusDevice, &lOverlapped, &transferred, TRUE) != 0)
-				{
-					if (_Target->Notification == nullptr)
-					{
-						DEVICE_IO_CONTROL_END;
-						return;
-					}
-
-					reinterpret_cast<PFN_VIGEM_DS4_NOTIFICATION>(_Target->Notification)(
-						_Client, _Target, ds4rn.Report.LargeMotor,
-						ds4rn.Report.SmallMotor,
-						ds4rn.Report.LightbarColor, _UserData
-					);
-
-					continue;
-				}
+	return error;
+}
 
-				if (GetLastError() == ERROR_ACCESS_DENIED || GetLastError() == ERROR_OPERATION_ABORTED)
-				{
-					DEVICE_IO_CONTROL_END;
-					return;
-				}
-			} while (TRUE);
-		},
-		target, vigem, userData
-	};
+//
+// Validates the target and submits a copy of the report.
+// 
+template <typename TReport>
+static FORCEINLINE VIGEM_ERROR vigem_internal_target_submit(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	const TReport& report,
+	LPOVERLAPPED overlapped
+)
+{
+	using Traits = VIGEM_TARGET_TRAITS<TReport>;
 
-	_async.detach();
+	const VIGEM_ERROR error = vigem_internal_target_check(vigem, target);
 
-	return VIGEM_ERROR_NONE;
+	if (!VIGEM_SUCCESS(error))
+		return error;
+
+	typename Traits::SubmitReport submit;
+	Traits::Init(&submit, target->SerialNo);
+
+	submit.Report = report;
+
+	return vigem_internal_target_send<TReport>(vigem, target, submit, overlapped);
 }
 
-void vigem_target_x360_unregister_notification(PVIGEM_TARGET target)
+//
+// Submits reports in order until one fails, shared by all
+// vigem_target_*_update functions. Every report is accounted as a call of
+// its own, all of them wait on the target's submit event.
+// 
+template <typename TReport>
+static FORCEINLINE VIGEM_ERROR vigem_internal_target_update(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	VIGEM_STATS_FUNCTION function,
+	const TReport* reports,
+	ULONG count
+)
 {
-	if (target->CancelNotificationThreadEvent != nullptr)
-		SetEvent(target->CancelNotificationThreadEvent);
+	if (!reports && count)
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	if (target && !vigem_internal_target_submit_event(target))
+		return VIGEM_ERROR_WINAPI;
+
+	const PVIGEM_CLIENT bus = vigem_internal_bus(vigem, target);
+	OVERLAPPED lOverlapped = { 0 };
+	lOverlapped.hEvent = target ? target->SubmitEvent : nullptr;
+
+	VIGEM_ERROR error = VIGEM_ERROR_NONE;
 
-	if (target->CancelNotificationThreadEvent != nullptr)
+	for (ULONG index = 0; index < count && error == VIGEM_ERROR_NONE; index++)
 	{
-		CloseHandle(target->CancelNotificationThreadEvent);
-		target->CancelNotificationThreadEvent = nullptr;
+		error = vigem_internal_stats_call(vigem, target, function, [&]
+		{
+			return vigem_internal_target_submit(bus, target, reports[index], &lOverlapped);
+		});
 	}
 
-	target->Notification = nullptr;
-	target->NotificationUserData = nullptr;
+	return error;
 }
 
-void vigem_target_ds4_unregister_notification(PVIGEM_TARGET target)
+VIGEM_ERROR vigem_target_x360_update(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	XUSB_REPORT report
+)
 {
-	vigem_target_x360_unregister_notification(target); // The same x360_unregister handler works for DS4_unregister also
+	return vigem_internal_target_update(vigem, target, VIGEM_STATS_X360_UPDATE, &report, 1);
 }
 
-void vigem_target_set_vid(PVIGEM_TARGET target, USHORT vid)
+VIGEM_ERROR vigem_target_x360_update_batch(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	const XUSB_REPORT* reports,
+	ULONG count
+)
 {
-	target->VendorId = vid;
+	return vigem_internal_target_update(vigem, target, VIGEM_STATS_X360_UPDATE, reports, count);
 }
 
-void vigem_target_set_pid(PVIGEM_TARGET target, USHORT pid)
+VIGEM_ERROR vigem_target_ds4_update(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	DS4_REPORT report
+)
 {
-	target->ProductId = pid;
+	return vigem_internal_target_update(vigem, target, VIGEM_STATS_DS4_UPDATE, &report, 1);
 }
 
-USHORT vigem_target_get_vid(PVIGEM_TARGET target)
+VIGEM_ERROR vigem_target_ds4_update_batch(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	const DS4_REPORT* reports,
+	ULONG count
+)
 {
-	return target->VendorId;
+	return vigem_internal_target_update(vigem, target, VIGEM_STATS_DS4_UPDATE, reports, count);
 }
 
-USHORT vigem_target_get_pid(PVIGEM_TARGET target)
+VIGEM_ERROR vigem_target_ds4_update_ex(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	DS4_REPORT_EX report
+)
 {
-	return target->ProductId;
+	return vigem_internal_target_update(vigem, target, VIGEM_STATS_DS4_UPDATE_EX, &report, 1);
 }
 
-VIGEM_ERROR vigem_target_x360_update(
+VIGEM_ERROR vigem_target_ds4_update_ex_batch(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
-	XUSB_REPORT report
+	const DS4_REPORT_EX* reports,
+	ULONG count
 )
 {
-	if (!vigem)
-		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+	return vigem_internal_target_update(vigem, target, VIGEM_STATS_DS4_UPDATE_EX, reports, count);
+}
 
-	if (!target)
-		return VIGEM_ERROR_INVALID_TARGET;
+VIGEM_ERROR vigem_target_prepare(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PVIGEM_PREPARED_TARGET* prepared
+)
+{
+	if (!prepared)
+		return VIGEM_ERROR_INVALID_PARAMETER;
 
-	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
-		return VIGEM_ERROR_BUS_NOT_FOUND;
+	*prepared = nullptr;
 
-	if (target->SerialNo == 0)
-		return VIGEM_ERROR_INVALID_TARGET;
+	const VIGEM_ERROR error = vigem_internal_target_check(vigem, target);
 
-	DEVICE_IO_CONTROL_BEGIN;
+	if (!VIGEM_SUCCESS(error))
+		return error;
 
-	XUSB_SUBMIT_REPORT xsr;
-	XUSB_SUBMIT_REPORT_INIT(&xsr, target->SerialNo);
+	if (target->State != VIGEM_TARGET_CONNECTED)
+		return VIGEM_ERROR_TARGET_NOT_PLUGGED_IN;
 
-	xsr.Report = report;
+	const PVIGEM_CLIENT bus = vigem_internal_bus(vigem, target);
 
-	DeviceIoControl(
-		vigem->hBusDevice,
-		IOCTL_XUSB_SUBMIT_REPORT,
-		&xsr,
-		xsr.Size,
-		nullptr,
-		0,
-		&transferred,
-		&lOverlapped
-	);
+	// added to another driver object
+	if (bus->pTargetsList[target->SerialNo] != target)
+		return VIGEM_ERROR_INVALID_TARGET;
+
+	const auto handle = static_cast<PVIGEM_PREPARED_TARGET>(vigem_internal_alloc(sizeof(VIGEM_PREPARED_TARGET)));
 
-	if (GetOverlappedResult(vigem->hBusDevice, &lOverlapped, &transferred, TRUE) == 0)
+	if (!handle)
+		return VIGEM_ERROR_WINAPI;
+
+	handle->Event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	if (!handle->Event)
 	{
-		if (GetLastError() == ERROR_ACCESS_DENIED)
-		{
-			DEVICE_IO_CONTROL_END;
-			return VIGEM_ERROR_INVALID_TARGET;
-		}
+		vigem_internal_free(handle);
+		return VIGEM_ERROR_WINAPI;
 	}
 
-	DEVICE_IO_CONTROL_END;
+	handle->Client = vigem;
+	handle->Bus = bus;
+	handle->Target = target;
+	handle->SerialNo = target->SerialNo;
+
+	*prepared = handle;
 
 	return VIGEM_ERROR_NONE;
 }
 
-VIGEM_ERROR vigem_target_ds4_update(
-	PVIGEM_CLIENT vigem,
-	PVIGEM_TARGET target,
-	DS4_REPORT report
-)
+void vigem_prepared_target_free(PVIGEM_PREPARED_TARGET prepared)
 {
-	if (!vigem)
-		return VIGEM_ERROR_BUS_INVALID_HANDLE;
+	if (!prepared)
+		return;
 
-	if (!target)
-		return VIGEM_ERROR_INVALID_TARGET;
+	CloseHandle(prepared->Event);
+	vigem_internal_free(prepared);
+}
 
-	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
-		return VIGEM_ERROR_BUS_NOT_FOUND;
+//
+// Submits a copy of the report to a prepared target. Everything checked by
+// vigem_target_prepare is only asserted, a target of the wrong type is
+// still rejected by the bus.
+// 
+template <typename TReport>
+static FORCEINLINE VIGEM_ERROR vigem_internal_prepared_update(
+	PVIGEM_PREPARED_TARGET prepared,
+	VIGEM_STATS_FUNCTION function,
+	const TReport& report
+)
+{
+	using Traits = VIGEM_TARGET_TRAITS<TReport>;
 
-	if (target->SerialNo == 0)
-		return VIGEM_ERROR_INVALID_TARGET;
+	assert(prepared != nullptr);
+	assert(prepared->Target->State == VIGEM_TARGET_CONNECTED);
+	assert(prepared->Target->SerialNo == prepared->SerialNo);
+	assert(prepared->Target->Type == Traits::Type);
+	assert(prepared->Bus->hBusDevice != INVALID_HANDLE_VALUE);
 
-	DEVICE_IO_CONTROL_BEGIN;
+	const PVIGEM_TARGET target = prepared->Target;
 
-	DS4_SUBMIT_REPORT dsr;
-	DS4_SUBMIT_REPORT_INIT(&dsr, target->SerialNo);
+	return vigem_internal_stats_call(prepared->Client, target, function, [&]
+	{
+		typename Traits::SubmitReport submit;
+		Traits::Init(&submit, prepared->SerialNo);
 
-	dsr.Report = report;
+		submit.Report = report;
 
-	DeviceIoControl(
-		vigem->hBusDevice,
-		IOCTL_DS4_SUBMIT_REPORT,
-		&dsr,
-		dsr.Size,
-		nullptr,
-		0,
-		&transferred,
-		&lOverlapped
-	);
+		OVERLAPPED overlapped = { 0 };
+		overlapped.hEvent = prepared->Event;
 
-	if (GetOverlappedResult(vigem->hBusDevice, &lOverlapped, &transferred, TRUE) == 0)
-	{
-		if (GetLastError() == ERROR_ACCESS_DENIED)
-		{
-			DEVICE_IO_CONTROL_END;
-			return VIGEM_ERROR_INVALID_TARGET;
-		}
-	}
+		return vigem_internal_target_send<TReport>(prepared->Bus, target, submit, &overlapped);
+	});
+}
 
-	DEVICE_IO_CONTROL_END;
+VIGEM_ERROR vigem_target_x360_update_prepared(PVIGEM_PREPARED_TARGET prepared, XUSB_REPORT report)
+{
+	return vigem_internal_prepared_update(prepared, VIGEM_STATS_X360_UPDATE, report);
+}
 
-	return VIGEM_ERROR_NONE;
+VIGEM_ERROR vigem_target_ds4_update_prepared(PVIGEM_PREPARED_TARGET prepared, DS4_REPORT report)
+{
+	return vigem_internal_prepared_update(prepared, VIGEM_STATS_DS4_UPDATE, report);
 }
 
-VIGEM_ERROR vigem_target_ds4_update_ex(
+VIGEM_ERROR vigem_target_ds4_update_ex_prepared(PVIGEM_PREPARED_TARGET prepared, DS4_REPORT_EX report)
+{
+	return vigem_internal_prepared_update(prepared, VIGEM_STATS_DS4_UPDATE_EX, report);
+}
+
+//
+// Sets up the target's pinned submission buffer for the format on first use,
+// its serial number is only filled in on commit.
+// 
+template <typename TReport>
+static VIGEM_ERROR vigem_internal_target_get_report_buffer(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
-	DS4_REPORT_EX report
+	TReport** report
 )
 {
+	using Traits = VIGEM_TARGET_TRAITS<TReport>;
+
 	if (!vigem)
 		return VIGEM_ERROR_BUS_INVALID_HANDLE;
 
-	if (!target)
+	if (!target || target->Type != Traits::Type)
 		return VIGEM_ERROR_INVALID_TARGET;
 
-	if (vigem->hBusDevice == INVALID_HANDLE_VALUE)
-		return VIGEM_ERROR_BUS_NOT_FOUND;
+	if (!report)
+		return VIGEM_ERROR_INVALID_PARAMETER;
 
-	if (target->SerialNo == 0)
-		return VIGEM_ERROR_INVALID_TARGET;
+	const auto submit = Traits::Pinned(target);
 
-	DEVICE_IO_CONTROL_BEGIN;
+	if (!vigem_internal_target_submit_event(target))
+		return VIGEM_ERROR_WINAPI;
 
-	DS4_SUBMIT_REPORT_EX dsr;
-	DS4_SUBMIT_REPORT_EX_INIT(&dsr, target->SerialNo);
+	if (submit->Size != sizeof(typename Traits::SubmitReport))
+		Traits::Init(submit, target->SerialNo);
 
-	dsr.Report = report;
+	*report = &submit->Report;
 
-	DeviceIoControl(
-		vigem->hBusDevice,
-		IOCTL_DS4_SUBMIT_REPORT, // Same IOCTL, just different size
-		&dsr,
-		dsr.Size,
-		nullptr,
-		0,
-		&transferred,
-		&lOverlapped
-	);
+	return VIGEM_ERROR_NONE;
+}
 
-	if (GetOverlappedResult(vigem->hBusDevice, &lOverlapped, &transferred, TRUE) == 0)
-	{
-		if (GetLastError() == ERROR_ACCESS_DENIED)
-		{
-			DEVICE_IO_CONTROL_END;
-			return VIGEM_ERROR_INVALID_TARGET;
-		}
+//
+// Sends the pinned submission buffer as is, only the serial number is
+// refreshed in case the target was added again since.
+// 
+template <typename TReport>
+static FORCEINLINE VIGEM_ERROR vigem_internal_target_commit_report(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	using Traits = VIGEM_TARGET_TRAITS<TReport>;
 
-		/*
-		 * NOTE: this will not happen on v1.16 due to NTSTATUS accidentally been set
-		 * as STATUS_SUCCESS when the submitted buffer size wasn't the expected one.
-		 * For backwards compatibility this function will silently fail (not cause
-		 * report updates) when run with the v1.16 driver. This API was introduced
-		 * with v1.17 so it won't affect existing applications built before.
-		 */
-		if (GetLastError() == ERROR_INVALID_PARAMETER)
-		{
-			DEVICE_IO_CONTROL_END;
-			return VIGEM_ERROR_NOT_SUPPORTED;
-		}
-	}
+	const VIGEM_ERROR error = vigem_internal_target_check(vigem, target);
 
-	DEVICE_IO_CONTROL_END;
+	if (!VIGEM_SUCCESS(error))
+		return error;
 
-	return VIGEM_ERROR_NONE;
+	const auto submit = Traits::Pinned(target);
+
+	if (submit->Size != sizeof(typename Traits::SubmitReport))
+		return VIGEM_ERROR_INVALID_PARAMETER;
+
+	submit->SerialNo = target->SerialNo;
+
+	OVERLAPPED overlapped = { 0 };
+	overlapped.hEvent = target->SubmitEvent;
+
+	return vigem_internal_target_send<TReport>(vigem, target, *submit, &overlapped);
+}
+
+VIGEM_ERROR vigem_target_x360_get_report_buffer(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PXUSB_REPORT* report
+)
+{
+	return vigem_internal_target_get_report_buffer(vigem, target, report);
+}
+
+VIGEM_ERROR vigem_target_x360_commit_report(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	return vigem_internal_stats_call(vigem, target, VIGEM_STATS_X360_UPDATE, [=]
+	{
+		return vigem_internal_target_commit_report<XUSB_REPORT>(vigem_internal_bus(vigem, target), target);
+	});
+}
+
+VIGEM_ERROR vigem_target_ds4_get_report_ex_buffer(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PDS4_REPORT_EX* report
+)
+{
+	return vigem_internal_target_get_report_buffer(vigem, target, report);
+}
+
+VIGEM_ERROR vigem_target_ds4_commit_report_ex(PVIGEM_CLIENT vigem, PVIGEM_TARGET target)
+{
+	return vigem_internal_stats_call(vigem, target, VIGEM_STATS_DS4_UPDATE_EX, [=]
+	{
+		return vigem_internal_target_commit_report<DS4_REPORT_EX>(vigem_internal_bus(vigem, target), target);
+	});
 }
 
 ULONG vigem_target_get_index(PVIGEM_TARGET target)
@@ -1144,7 +2044,7 @@ BOOL vigem_target_is_attached(PVIGEM_TARGET target)
 	return (target->State == VIGEM_TARGET_CONNECTED);
 }
 
-VIGEM_ERROR vigem_target_x360_get_user_index(
+static VIGEM_ERROR vigem_internal_x360_get_user_index(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
 	PULONG index
@@ -1170,8 +2070,8 @@ VIGEM_ERROR vigem_target_x360_get_user_index(
 	XUSB_GET_USER_INDEX gui;
 	XUSB_GET_USER_INDEX_INIT(&gui, target->SerialNo);
 
-	DeviceIoControl(
-		vigem->hBusDevice,
+	vigem_internal_io_control(
+		vigem,
 		IOCTL_XUSB_GET_USER_INDEX,
 		&gui,
 		gui.Size,
@@ -1181,7 +2081,7 @@ VIGEM_ERROR vigem_target_x360_get_user_index(
 		&lOverlapped
 	);
 
-	if (GetOverlappedResult(vigem->hBusDevice, &lOverlapped, &transferred, TRUE) == 0)
+	if (vigem_internal_get_overlapped_result(vigem, &lOverlapped, &transferred, TRUE) == 0)
 	{
 		const auto error = GetLastError();
 
@@ -1205,6 +2105,18 @@ VIGEM_ERROR vigem_target_x360_get_user_index(
 	return VIGEM_ERROR_NONE;
 }
 
+VIGEM_ERROR vigem_target_x360_get_user_index(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	PULONG index
+)
+{
+	return vigem_internal_stats_call(vigem, target, VIGEM_STATS_X360_GET_USER_INDEX, [=]
+	{
+		return vigem_internal_x360_get_user_index(vigem_internal_bus(vigem, target), target, index);
+	});
+}
+
 VIGEM_ERROR vigem_target_ds4_await_output_report(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
@@ -1214,7 +2126,7 @@ VIGEM_ERROR vigem_target_ds4_await_output_report(
 	return vigem_target_ds4_await_output_report_timeout(vigem, target, INFINITE, buffer);
 }
 
-VIGEM_ERROR vigem_target_ds4_await_output_report_timeout(
+static VIGEM_ERROR vigem_internal_ds4_await_output_report(
 	PVIGEM_CLIENT vigem,
 	PVIGEM_TARGET target,
 	DWORD milliseconds,
@@ -1236,13 +2148,20 @@ VIGEM_ERROR vigem_target_ds4_await_output_report_timeout(
 	if (!buffer)
 		return VIGEM_ERROR_INVALID_PARAMETER;
 
+	VIGEM_TRACE_SCOPE("ds4_await_output_report", target->SerialNo);
+
+	const PVIGEM_TARGET_COLD cold = vigem_internal_target_cold(target);
+
+	if (!cold)
+		return VIGEM_ERROR_WINAPI;
+
 	VIGEM_ERROR error = VIGEM_ERROR_NONE;
 
-	EnterCriticalSection(&target->Ds4CachedOutputReportUpdateLock);
+	EnterCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
 	{
 		if (!target->IsDisposing)
 		{
-			const DWORD status = WaitForSingleObject(target->Ds4CachedOutputReportUpdateAvailable, milliseconds);
+			const DWORD status = WaitForSingleObject(cold->Ds4CachedOutputReportUpdateAvailable, milliseconds);
 
 			if (status == WAIT_TIMEOUT)
 			{
@@ -1250,15 +2169,9 @@ VIGEM_ERROR vigem_target_ds4_await_output_report_timeout(
 			}
 			else
 			{
-#if defined(VIGEM_VERBOSE_LOGGING_ENABLED)
-				DBGPRINT(L"Dumping buffer for %d", target->SerialNo);
-
-				const PCHAR dumpBuffer = (PCHAR)calloc(sizeof(DS4_OUTPUT_BUFFER), 3);
-				to_hex(target->Ds4CachedOutputReport.Buffer, sizeof(DS4_OUTPUT_BUFFER), dumpBuffer, sizeof(DS4_OUTPUT_BUFFER) * 3);
-				OutputDebugStringA(dumpBuffer);
-#endif
+				VIGEM_LOG_DS4_OUTPUT(target->SerialNo, cold->Ds4CachedOutputReport.Buffer);
 
-				RtlCopyMemory(buffer, &target->Ds4CachedOutputReport, sizeof(DS4_OUTPUT_BUFFER));
+				RtlCopyMemory(buffer, &cold->Ds4CachedOutputReport, sizeof(DS4_OUTPUT_BUFFER));
 			}
 		}
 		else
@@ -1266,7 +2179,20 @@ VIGEM_ERROR vigem_target_ds4_await_output_report_timeout(
 			error = VIGEM_ERROR_IS_DISPOSING;
 		}
 	}
-	LeaveCriticalSection(&target->Ds4CachedOutputReportUpdateLock);
+	LeaveCriticalSection(&cold->Ds4CachedOutputReportUpdateLock);
 
 	return error;
 }
+
+VIGEM_ERROR vigem_target_ds4_await_output_report_timeout(
+	PVIGEM_CLIENT vigem,
+	PVIGEM_TARGET target,
+	DWORD milliseconds,
+	PDS4_OUTPUT_BUFFER buffer
+)
+{
+	return vigem_internal_stats_call(vigem, target, VIGEM_STATS_DS4_AWAIT_OUTPUT_REPORT, [=]
+	{
+		return vigem_internal_ds4_await_output_report(vigem, target, milliseconds, buffer);
+	});
+}
@@ -0,0 +1,314 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Analog.h"
+
+//
+// STL
+//
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+//
+// Not a multiple of four, so the SSE2 groups and the scalar remainder both run
+//
+static const ULONG g_AnalogPads = 259;
+
+//
+// Processes every trigger value once per trigger and stores the result
+//
+static bool vigem_test_analog_triggers(
+	const VIGEM_ANALOG_CONFIG* Config,
+	std::vector<XUSB_REPORT>& Reports,
+	std::vector<DS4_REPORT>& Ds4Reports
+)
+{
+	const auto pipeline = vigem_analog_alloc(g_AnalogPads);
+
+	if (!pipeline)
+		return false;
+
+	Reports.assign(g_AnalogPads, XUSB_REPORT());
+	Ds4Reports.assign(g_AnalogPads, DS4_REPORT());
+
+	for (ULONG i = 0; i < g_AnalogPads; i++)
+	{
+		XUSB_REPORT_INIT(&Reports[i]);
+		Reports[i].bLeftTrigger = static_cast<BYTE>(i);
+		Reports[i].bRightTrigger = static_cast<BYTE>(255 - i);
+		DS4_REPORT_INIT(&Ds4Reports[i]);
+	}
+
+	const bool result = VIGEM_SUCCESS(vigem_analog_set_config(pipeline, Config))
+		&& VIGEM_SUCCESS(vigem_analog_load_xusb(pipeline, Reports.data(), g_AnalogPads))
+		&& VIGEM_SUCCESS(vigem_analog_process(pipeline, g_AnalogPads, 0.001f))
+		&& VIGEM_SUCCESS(vigem_analog_store_xusb(pipeline, Reports.data(), g_AnalogPads))
+		&& VIGEM_SUCCESS(vigem_analog_store_ds4(pipeline, Ds4Reports.data(), g_AnalogPads));
+
+	vigem_analog_free(pipeline);
+
+	return result;
+}
+
+VIGEM_TEST("analog/trigger/identity", analog_trigger_identity)
+{
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+
+	std::vector<XUSB_REPORT> reports;
+	std::vector<DS4_REPORT> ds4;
+	TEST_CHECK(vigem_test_analog_triggers(&config, reports, ds4));
+
+	for (ULONG i = 0; i < g_AnalogPads; i++)
+	{
+		const BYTE left = static_cast<BYTE>(i);
+
+		TEST_CHECK(reports[i].bLeftTrigger == left);
+		TEST_CHECK(reports[i].bRightTrigger == static_cast<BYTE>(255 - left));
+		TEST_CHECK(ds4[i].bTriggerL == left);
+		TEST_CHECK(((ds4[i].wButtons & DS4_BUTTON_TRIGGER_LEFT) != 0) == (left != 0));
+	}
+}
+
+//
+// Curve points beyond 0 - 1 must saturate instead of wrapping the BYTE
+//
+VIGEM_TEST("analog/trigger/clamp", analog_trigger_clamp)
+{
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+
+	for (int i = 0; i < VIGEM_ANALOG_CURVE_POINTS; i++)
+		config.TriggerCurve[i] = -0.5f + 2.0f * i / (VIGEM_ANALOG_CURVE_POINTS - 1);
+
+	std::vector<XUSB_REPORT> reports;
+	std::vector<DS4_REPORT> ds4;
+	TEST_CHECK(vigem_test_analog_triggers(&config, reports, ds4));
+
+	for (ULONG i = 0; i < g_AnalogPads; i++)
+	{
+		const FLOAT input = static_cast<BYTE>(i) / 255.0f;
+		const FLOAT curve = -0.5f + 2.0f * input;
+		const LONG expected = std::lrint((curve < 0.0f ? 0.0f : (curve > 1.0f ? 1.0f : curve)) * 255.0f);
+
+		TEST_CHECK(std::labs(reports[i].bLeftTrigger - expected) <= 1);
+		TEST_CHECK(std::labs(ds4[i].bTriggerL - expected) <= 1);
+	}
+
+	// the ends of the range saturate exactly
+	TEST_CHECK(reports[0].bLeftTrigger == 0);
+	TEST_CHECK(reports[255].bLeftTrigger == 255);
+	TEST_CHECK(reports[0].bRightTrigger == 255);
+	TEST_CHECK(reports[255].bRightTrigger == 0);
+}
+
+VIGEM_TEST("analog/trigger/deadzone", analog_trigger_deadzone)
+{
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+	config.TriggerInnerDeadzone = 0.25f;
+	config.TriggerOuterDeadzone = 0.75f;
+
+	std::vector<XUSB_REPORT> reports;
+	std::vector<DS4_REPORT> ds4;
+	TEST_CHECK(vigem_test_analog_triggers(&config, reports, ds4));
+
+	for (ULONG i = 0; i < g_AnalogPads; i++)
+	{
+		const FLOAT input = static_cast<BYTE>(i) / 255.0f;
+
+		if (input <= 0.25f)
+			TEST_CHECK(reports[i].bLeftTrigger == 0);
+		else if (input >= 0.75f)
+			TEST_CHECK(reports[i].bLeftTrigger == 255);
+		else
+			TEST_CHECK(std::labs(reports[i].bLeftTrigger - std::lrint((input - 0.25f) * 2.0f * 255.0f)) <= 1);
+	}
+}
+
+VIGEM_TEST("analog/config/non_finite", analog_config_non_finite)
+{
+	const auto pipeline = vigem_analog_alloc(4);
+	TEST_CHECK(pipeline != nullptr);
+
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+
+	const FLOAT nan = std::numeric_limits<FLOAT>::quiet_NaN();
+	const FLOAT infinity = std::numeric_limits<FLOAT>::infinity();
+	FLOAT* const fields[] =
+	{
+		&config.StickCurve[0], &config.StickCurve[VIGEM_ANALOG_CURVE_POINTS - 1],
+		&config.TriggerCurve[17], &config.StickInnerDeadzone, &config.TriggerOuterDeadzone,
+		&config.EmaAlpha, &config.OneEuroBeta
+	};
+	bool rejected = true;
+
+	for (FLOAT* field : fields)
+	{
+		for (const FLOAT value : { nan, infinity, -infinity })
+		{
+			const FLOAT saved = *field;
+
+			*field = value;
+			rejected = rejected && vigem_analog_set_config(pipeline, &config) == VIGEM_ERROR_INVALID_PARAMETER;
+			*field = saved;
+		}
+	}
+
+	// the pipeline keeps the defaults: identity triggers
+	XUSB_REPORT report;
+	XUSB_REPORT_INIT(&report);
+	report.bLeftTrigger = 100;
+
+	const bool processed = VIGEM_SUCCESS(vigem_analog_load_xusb(pipeline, &report, 1))
+		&& VIGEM_SUCCESS(vigem_analog_process(pipeline, 1, 0.001f))
+		&& VIGEM_SUCCESS(vigem_analog_store_xusb(pipeline, &report, 1));
+
+	vigem_analog_free(pipeline);
+
+	TEST_CHECK(rejected);
+	TEST_CHECK(processed);
+	TEST_CHECK(report.bLeftTrigger == 100);
+}
+
+VIGEM_TEST("analog/stick/deadzone", analog_stick_deadzone)
+{
+	const auto pipeline = vigem_analog_alloc(4);
+	TEST_CHECK(pipeline != nullptr);
+
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+	config.StickInnerDeadzone = 0.2f;
+	config.StickOuterDeadzone = 0.9f;
+
+	XUSB_REPORT reports[4];
+	for (auto& report : reports)
+		XUSB_REPORT_INIT(&report);
+
+	// inside the inner radius, beyond the outer one (diagonal), half way, full left
+	reports[0].sThumbLX = 3000;
+	reports[0].sThumbLY = -3000;
+	reports[1].sThumbLX = 30000;
+	reports[1].sThumbLY = 30000;
+	reports[2].sThumbRX = static_cast<SHORT>(0.55f * 32767.0f);
+	reports[3].sThumbRY = -32768;
+
+	const bool processed = VIGEM_SUCCESS(vigem_analog_set_config(pipeline, &config))
+		&& VIGEM_SUCCESS(vigem_analog_load_xusb(pipeline, reports, 4))
+		&& VIGEM_SUCCESS(vigem_analog_process(pipeline, 4, 0.001f))
+		&& VIGEM_SUCCESS(vigem_analog_store_xusb(pipeline, reports, 4));
+
+	vigem_analog_free(pipeline);
+
+	TEST_CHECK(processed);
+	TEST_CHECK(reports[0].sThumbLX == 0 && reports[0].sThumbLY == 0);
+	// the direction is kept, the magnitude saturates at 1
+	TEST_CHECK(std::labs(reports[1].sThumbLX - 23170) <= 2);
+	TEST_CHECK(std::labs(reports[1].sThumbLY - 23170) <= 2);
+	TEST_CHECK(std::labs(reports[2].sThumbRX - 16384) <= 8);
+	TEST_CHECK(reports[3].sThumbRY == -32767);
+}
+
+//
+// The SSE2 groups and the scalar remainder must agree: the last pads repeat
+// the inputs of the first ones
+//
+VIGEM_TEST("analog/paths", analog_paths)
+{
+	const ULONG pads = 4 * 64 + 3;
+	const auto pipeline = vigem_analog_alloc(pads);
+	TEST_CHECK(pipeline != nullptr);
+
+	VIGEM_ANALOG_CONFIG config;
+	VIGEM_ANALOG_CONFIG_INIT(&config);
+	config.StickInnerDeadzone = 0.1f;
+	config.TriggerInnerDeadzone = 0.05f;
+
+	for (int i = 0; i < VIGEM_ANALOG_CURVE_POINTS; i++)
+	{
+		const FLOAT x = static_cast<FLOAT>(i) / (VIGEM_ANALOG_CURVE_POINTS - 1);
+		config.StickCurve[i] = x * x;
+		config.TriggerCurve[i] = 1.2f * std::sqrt(x);
+	}
+
+	std::vector<XUSB_REPORT> reports(pads);
+	ULONG seed = 7;
+
+	for (ULONG i = 0; i < pads - 3; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		XUSB_REPORT_INIT(&reports[i]);
+		reports[i].sThumbLX = static_cast<SHORT>(seed >> 8);
+		reports[i].sThumbLY = static_cast<SHORT>(seed >> 16);
+		reports[i].sThumbRX = static_cast<SHORT>(seed * 3);
+		reports[i].sThumbRY = static_cast<SHORT>(i == 1 ? -32768 : seed >> 12);
+		reports[i].bLeftTrigger = static_cast<BYTE>(seed >> 24);
+		reports[i].bRightTrigger = static_cast<BYTE>(seed >> 4);
+	}
+
+	for (ULONG i = 0; i < 3; i++)
+		reports[pads - 3 + i] = reports[i];
+
+	const bool processed = VIGEM_SUCCESS(vigem_analog_set_config(pipeline, &config))
+		&& VIGEM_SUCCESS(vigem_analog_load_xusb(pipeline, reports.data(), pads))
+		&& VIGEM_SUCCESS(vigem_analog_process(pipeline, pads, 0.001f))
+		&& VIGEM_SUCCESS(vigem_analog_store_xusb(pipeline, reports.data(), pads));
+
+	vigem_analog_free(pipeline);
+
+	TEST_CHECK(processed);
+
+	for (ULONG i = 0; i < 3; i++)
+	{
+		const XUSB_REPORT& vector = reports[i];
+		const XUSB_REPORT& scalar = reports[pads - 3 + i];
+
+		TEST_CHECK(std::labs(vector.sThumbLX - scalar.sThumbLX) <= 1);
+		TEST_CHECK(std::labs(vector.sThumbLY - scalar.sThumbLY) <= 1);
+		TEST_CHECK(std::labs(vector.sThumbRX - scalar.sThumbRX) <= 1);
+		TEST_CHECK(std::labs(vector.sThumbRY - scalar.sThumbRY) <= 1);
+		TEST_CHECK(std::labs(vector.bLeftTrigger - scalar.bLeftTrigger) <= 1);
+		TEST_CHECK(std::labs(vector.bRightTrigger - scalar.bRightTrigger) <= 1);
+	}
+}
@@ -0,0 +1,368 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.hpp"
+
+//
+// STL
+//
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+#if defined(__cpp_impl_coroutine)
+
+//
+// Coroutine started eagerly and destroyed once it finished, nothing awaits it
+//
+struct VIGEM_TEST_TASK
+{
+	struct promise_type
+	{
+		VIGEM_TEST_TASK get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { abort(); }
+	};
+};
+
+//
+// A few threads resuming every awaiter of the tests
+//
+class VIGEM_TEST_POOL
+{
+	std::mutex Lock;
+	std::condition_variable Wake;
+	std::deque<std::coroutine_handle<>> Queue;
+	std::vector<std::thread> Threads;
+	bool Stopping = false;
+
+	void Run()
+	{
+		for (;;)
+		{
+			std::coroutine_handle<> handle;
+
+			{
+				std::unique_lock<std::mutex> lock(Lock);
+				Wake.wait(lock, [this] { return Stopping || !Queue.empty(); });
+
+				if (Queue.empty())
+					return;
+
+				handle = Queue.front();
+				Queue.pop_front();
+			}
+
+			handle.resume();
+		}
+	}
+
+public:
+	explicit VIGEM_TEST_POOL(ULONG Count)
+	{
+		for (ULONG index = 0; index < Count; index++)
+			Threads.emplace_back([this] { Run(); });
+	}
+
+	~VIGEM_TEST_POOL()
+	{
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Stopping = true;
+		}
+
+		Wake.notify_all();
+
+		for (auto& thread : Threads)
+			thread.join();
+	}
+
+	void Post(std::coroutine_handle<> Handle)
+	{
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			Queue.push_back(Handle);
+		}
+
+		Wake.notify_one();
+	}
+};
+
+struct VIGEM_TEST_POOL_EXECUTOR
+{
+	VIGEM_TEST_POOL* Pool;
+
+	void operator()(std::coroutine_handle<> Handle) const { Pool->Post(Handle); }
+};
+
+//
+// Counts the awaiters whose operation was started, an output report only
+// reaches awaiters registered before it was injected
+//
+template <typename TAwaitable>
+struct VIGEM_TEST_ARMED
+{
+	TAwaitable Inner;
+	volatile LONG* Armed;
+
+	bool await_ready() const noexcept { return false; }
+
+	bool await_suspend(std::coroutine_handle<> Handle)
+	{
+		// the awaiter may be resumed and gone before await_suspend returned
+		volatile LONG* armed = Armed;
+		const bool suspended = Inner.await_suspend(Handle);
+
+		InterlockedIncrement(armed);
+		return suspended;
+	}
+
+	auto await_resume() const { return Inner.await_resume(); }
+};
+
+typedef struct _VIGEM_TEST_ASYNC
+{
+	volatile LONG Armed;
+	volatile LONG Resumed;
+	volatile LONG Finished;
+	volatile LONG Mismatched;
+	volatile LONG Disposed;
+	volatile LONG Failed;
+} VIGEM_TEST_ASYNC;
+
+static VIGEM_TEST_TASK vigem_test_async_add(
+	const vigem::Client& Client,
+	vigem::Ds4Target& Target,
+	VIGEM_TEST_POOL_EXECUTOR Executor,
+	VIGEM_TEST_ASYNC& State
+)
+{
+	const VIGEM_ERROR error = co_await Client.add(Target, Executor);
+
+	if (error != VIGEM_ERROR_NONE)
+		InterlockedIncrement(&State.Failed);
+
+	InterlockedIncrement(&State.Finished);
+}
+
+//
+// Awaits output reports until an error, the report of every round carries
+// the index of the target and the round
+//
+static VIGEM_TEST_TASK vigem_test_async_output_awaiter(
+	const vigem::Ds4Target& Target,
+	UCHAR TargetIndex,
+	VIGEM_TEST_POOL_EXECUTOR Executor,
+	VIGEM_TEST_ASYNC& State
+)
+{
+	for (UCHAR round = 0;; round++)
+	{
+		VIGEM_TEST_ARMED<decltype(Target.next_output_report(Executor))> next = {
+			Target.next_output_report(Executor), &State.Armed };
+
+		const auto report = co_await next;
+
+		if (report.Error == VIGEM_ERROR_IS_DISPOSING)
+		{
+			InterlockedIncrement(&State.Disposed);
+			break;
+		}
+
+		if (report.Error != VIGEM_ERROR_NONE)
+		{
+			InterlockedIncrement(&State.Failed);
+			break;
+		}
+
+		if (report.Value.Buffer[4] != TargetIndex || report.Value.Buffer[5] != round)
+			InterlockedIncrement(&State.Mismatched);
+
+		InterlockedIncrement(&State.Resumed);
+	}
+
+	InterlockedIncrement(&State.Finished);
+}
+
+static VIGEM_TEST_TASK vigem_test_async_notification_awaiter(
+	const vigem::X360Target& Target,
+	VIGEM_TEST_POOL_EXECUTOR Executor,
+	VIGEM_TEST_ASYNC& State
+)
+{
+	const auto notification = co_await Target.notifications(Executor).next();
+
+	if (notification.Error == VIGEM_ERROR_IS_DISPOSING)
+		InterlockedIncrement(&State.Disposed);
+	else
+		InterlockedIncrement(&State.Failed);
+
+	InterlockedIncrement(&State.Finished);
+}
+
+static BOOLEAN vigem_test_async_wait(const volatile LONG& Counter, LONG Count)
+{
+	for (ULONG waited = 0; Counter < Count && waited < 10000; waited++)
+		Sleep(1);
+
+	return Counter == Count;
+}
+
+static const ULONG VIGEM_TEST_ASYNC_THREADS = 4;
+static const ULONG VIGEM_TEST_ASYNC_TARGETS = 16;
+static const LONG VIGEM_TEST_ASYNC_AWAITERS = 4096;
+static const UCHAR VIGEM_TEST_ASYNC_ROUNDS = 8;
+
+//
+// Thousands of output report awaiters on a few threads: every round resumes
+// each of them with the report injected into its own target, then removing
+// half of the targets and disconnecting ends the rest as disposing
+//
+VIGEM_TEST("async/ds4_output/awaiters", async_ds4_output_awaiters)
+{
+	VIGEM_TEST_ASYNC state = {};
+	BOOLEAN added = FALSE, armed = TRUE, resumed = FALSE, removed = FALSE, finished = FALSE;
+	LONG disposedOnRemove = 0;
+
+	{
+		VIGEM_TEST_POOL pool(VIGEM_TEST_ASYNC_THREADS);
+		const VIGEM_TEST_POOL_EXECUTOR executor = { &pool };
+
+		vigem::Client client;
+		TEST_CHECK(client);
+		TEST_CHECK_SUCCESS(client.connect_simulated());
+
+		std::vector<vigem::Ds4Target> targets(VIGEM_TEST_ASYNC_TARGETS);
+
+		for (auto& target : targets)
+			vigem_test_async_add(client, target, executor, state);
+
+		added = vigem_test_async_wait(state.Finished, VIGEM_TEST_ASYNC_TARGETS) && state.Failed == 0;
+
+		if (added)
+		{
+			state.Finished = 0;
+
+			for (LONG index = 0; index < VIGEM_TEST_ASYNC_AWAITERS; index++)
+			{
+				const ULONG target = index % VIGEM_TEST_ASYNC_TARGETS;
+				vigem_test_async_output_awaiter(targets[target], static_cast<UCHAR>(target), executor, state);
+			}
+
+			DS4_OUTPUT_BUFFER output = {};
+			output.Buffer[0] = 0x05;
+
+			for (UCHAR round = 0; round < VIGEM_TEST_ASYNC_ROUNDS && armed; round++)
+			{
+				armed = vigem_test_async_wait(state.Armed, VIGEM_TEST_ASYNC_AWAITERS * (round + 1));
+
+				for (ULONG target = 0; target < VIGEM_TEST_ASYNC_TARGETS && armed; target++)
+				{
+					output.Buffer[4] = static_cast<UCHAR>(target);
+					output.Buffer[5] = round;
+					vigem_sim_ds4_output(client.get(), targets[target].get(), &output);
+				}
+			}
+
+			resumed = vigem_test_async_wait(state.Resumed, VIGEM_TEST_ASYNC_AWAITERS * VIGEM_TEST_ASYNC_ROUNDS);
+
+			// every awaiter is pending again, half of them on the removed targets
+			if (resumed && vigem_test_async_wait(state.Armed, VIGEM_TEST_ASYNC_AWAITERS * (VIGEM_TEST_ASYNC_ROUNDS + 1)))
+			{
+				for (ULONG target = 0; target < VIGEM_TEST_ASYNC_TARGETS / 2; target++)
+					targets[target].remove();
+
+				removed = vigem_test_async_wait(state.Finished, VIGEM_TEST_ASYNC_AWAITERS / 2);
+				disposedOnRemove = state.Disposed;
+			}
+		}
+
+		client.disconnect();
+		finished = vigem_test_async_wait(state.Finished, added ? VIGEM_TEST_ASYNC_AWAITERS : 0);
+
+		targets.clear();
+	}
+
+	TEST_CHECK(added);
+	TEST_CHECK(armed);
+	TEST_CHECK(resumed);
+	TEST_CHECK(state.Failed == 0);
+	TEST_CHECK(state.Mismatched == 0);
+	TEST_CHECK(removed);
+	TEST_CHECK(disposedOnRemove == VIGEM_TEST_ASYNC_AWAITERS / 2);
+	TEST_CHECK(finished);
+	TEST_CHECK(state.Disposed == VIGEM_TEST_ASYNC_AWAITERS);
+}
+
+//
+// Disconnecting ends pending notification awaiters as disposing
+//
+VIGEM_TEST("async/x360_notification/disconnect", async_x360_notification_disconnect)
+{
+	VIGEM_TEST_ASYNC state = {};
+	BOOLEAN finished = FALSE;
+
+	{
+		VIGEM_TEST_POOL pool(VIGEM_TEST_ASYNC_THREADS);
+		const VIGEM_TEST_POOL_EXECUTOR executor = { &pool };
+
+		vigem::Client client;
+		TEST_CHECK(client);
+		TEST_CHECK_SUCCESS(client.connect_simulated());
+
+		vigem::X360Target target;
+		TEST_CHECK_SUCCESS(target.add(client));
+
+		for (ULONG index = 0; index < VIGEM_TEST_ASYNC_TARGETS; index++)
+			vigem_test_async_notification_awaiter(target, executor, state);
+
+		client.disconnect();
+		finished = vigem_test_async_wait(state.Finished, VIGEM_TEST_ASYNC_TARGETS);
+	}
+
+	TEST_CHECK(finished);
+	TEST_CHECK(state.Failed == 0);
+	TEST_CHECK(state.Disposed == static_cast<LONG>(VIGEM_TEST_ASYNC_TARGETS));
+}
+
+#endif
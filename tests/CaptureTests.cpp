@@ -0,0 +1,309 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/km/BusShared.h"
+#include "ViGEm/Client.h"
+#include "ViGEm/Async.h"
+#include "ViGEm/Capture.h"
+#include "ViGEm/Sim.h"
+
+//
+// STL
+//
+#include <cstring>
+#include <cwchar>
+#include <vector>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+#define PCAPNG_ENHANCED_PACKET_BLOCK    0x00000006
+
+//
+// Builds a path in the temp directory, FALSE if it doesn't fit
+//
+static BOOLEAN vigem_test_capture_path(LPWSTR Path, LPCWSTR Name)
+{
+	const DWORD length = GetTempPathW(MAX_PATH, Path);
+
+	if (!length || length + wcslen(Name) >= MAX_PATH)
+		return FALSE;
+
+	wcscat_s(Path, MAX_PATH, Name);
+	return TRUE;
+}
+
+//
+// Reads back the packet headers of every Enhanced Packet Block in a capture
+//
+static BOOLEAN vigem_test_capture_read(LPCWSTR Path, std::vector<VIGEM_CAPTURE_PACKET>& Packets)
+{
+	const HANDLE file = CreateFileW(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return FALSE;
+
+	LARGE_INTEGER size;
+	std::vector<UCHAR> data;
+	DWORD read = 0;
+
+	BOOLEAN result = GetFileSizeEx(file, &size);
+
+	if (result)
+	{
+		data.resize(static_cast<size_t>(size.QuadPart));
+		result = data.empty() || (ReadFile(file, data.data(), static_cast<DWORD>(data.size()), &read, nullptr) && read == data.size());
+	}
+
+	CloseHandle(file);
+
+	//
+	// Type, length, interface and timestamp come before the captured length
+	//
+	const size_t header = 5 * sizeof(ULONG);
+
+	for (size_t offset = 0; result && offset + 2 * sizeof(ULONG) <= data.size();)
+	{
+		ULONG type, length;
+
+		memcpy(&type, &data[offset], sizeof(ULONG));
+		memcpy(&length, &data[offset + sizeof(ULONG)], sizeof(ULONG));
+
+		if (length < 3 * sizeof(ULONG) || offset + length > data.size())
+			return FALSE;
+
+		if (type == PCAPNG_ENHANCED_PACKET_BLOCK)
+		{
+			VIGEM_CAPTURE_PACKET packet;
+
+			if (length < header + sizeof(ULONG) * 2 + sizeof(packet))
+				return FALSE;
+
+			memcpy(&packet, &data[offset + header + 2 * sizeof(ULONG)], sizeof(packet));
+			Packets.push_back(packet);
+		}
+
+		offset += length;
+	}
+
+	return result;
+}
+
+//
+// Completion or cancellation captured for a request, nullptr if there is none
+//
+static const VIGEM_CAPTURE_PACKET* vigem_test_capture_outcome(
+	const std::vector<VIGEM_CAPTURE_PACKET>& Packets,
+	const VIGEM_CAPTURE_PACKET& Request
+)
+{
+	for (const auto& packet : Packets)
+	{
+		if (packet.Event != VIGEM_CAPTURE_REQUEST && packet.RequestId == Request.RequestId)
+			return &packet;
+	}
+
+	return nullptr;
+}
+
+//
+// Requests expected to have completed once the test is done. The output
+// report pickup of the connection stays pending until it disconnects.
+//
+static BOOLEAN vigem_test_capture_answered(const VIGEM_CAPTURE_PACKET& Packet)
+{
+	return Packet.Event == VIGEM_CAPTURE_REQUEST && Packet.IoControlCode != IOCTL_DS4_AWAIT_OUTPUT_AVAILABLE;
+}
+
+static ULONG vigem_test_capture_count(const std::vector<VIGEM_CAPTURE_PACKET>& Packets, UCHAR Event, ULONG IoControlCode)
+{
+	ULONG count = 0;
+
+	for (const auto& packet : Packets)
+	{
+		if (packet.Event == Event && packet.IoControlCode == IoControlCode)
+			count++;
+	}
+
+	return count;
+}
+
+//
+// Result of an asynchronous operation, signalled once it's set
+//
+typedef struct _VIGEM_TEST_ASYNC_RESULT
+{
+	HANDLE hDone;
+	VIGEM_ERROR Error;
+} VIGEM_TEST_ASYNC_RESULT;
+
+static VOID CALLBACK vigem_test_capture_async_done(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	VIGEM_ERROR Error,
+	LPVOID Context
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+
+	const auto result = static_cast<VIGEM_TEST_ASYNC_RESULT*>(Context);
+
+	result->Error = Error;
+	SetEvent(result->hDone);
+}
+
+static VIGEM_ERROR vigem_test_capture_wait(VIGEM_TEST_ASYNC_RESULT& Result)
+{
+	if (WaitForSingleObject(Result.hDone, 5000) != WAIT_OBJECT_0)
+		return VIGEM_ERROR_TIMED_OUT;
+
+	return Result.Error;
+}
+
+//
+// Requests the blocking API issues complete on the calling thread
+//
+VIGEM_TEST("capture/sync", capture_sync)
+{
+	WCHAR path[MAX_PATH];
+	TEST_CHECK(vigem_test_capture_path(path, L"ViGEmTests-sync.pcapng"));
+
+	const PVIGEM_CLIENT client = vigem_alloc();
+	const PVIGEM_TARGET x360 = vigem_target_x360_alloc();
+	XUSB_REPORT report = {};
+	std::vector<VIGEM_CAPTURE_PACKET> packets;
+
+	TEST_CHECK(client && x360);
+	TEST_CHECK_SUCCESS(vigem_connect_simulated(client));
+	TEST_CHECK_SUCCESS(vigem_capture_start(client, path));
+	TEST_CHECK_SUCCESS(vigem_target_add(client, x360));
+
+	for (USHORT buttons = 1; buttons <= 8; buttons++)
+	{
+		report.wButtons = buttons;
+		TEST_CHECK_SUCCESS(vigem_target_x360_update(client, x360, report));
+	}
+
+	TEST_CHECK_SUCCESS(vigem_target_remove(client, x360));
+
+	vigem_capture_stop(client);
+	vigem_disconnect(client);
+	vigem_target_free(x360);
+	vigem_free(client);
+
+	TEST_CHECK(vigem_test_capture_read(path, packets));
+	DeleteFileW(path);
+
+	TEST_CHECK(vigem_test_capture_count(packets, VIGEM_CAPTURE_REQUEST, IOCTL_XUSB_SUBMIT_REPORT) == 8);
+
+	for (const auto& packet : packets)
+	{
+		if (vigem_test_capture_answered(packet))
+			TEST_CHECK(vigem_test_capture_outcome(packets, packet) != nullptr);
+	}
+}
+
+//
+// Asynchronous requests are issued on the calling thread but completed on
+// thread pool threads, their completions must be captured all the same
+//
+VIGEM_TEST("capture/async", capture_async)
+{
+	WCHAR path[MAX_PATH];
+	TEST_CHECK(vigem_test_capture_path(path, L"ViGEmTests-async.pcapng"));
+
+	const PVIGEM_CLIENT client = vigem_alloc();
+	const PVIGEM_TARGET x360 = vigem_target_x360_alloc();
+	VIGEM_X360_NOTIFICATION notification = {};
+	std::vector<VIGEM_CAPTURE_PACKET> packets;
+
+	TEST_CHECK(client && x360);
+	TEST_CHECK_SUCCESS(vigem_connect_simulated(client));
+	TEST_CHECK_SUCCESS(vigem_capture_start(client, path));
+
+	VIGEM_TEST_ASYNC_RESULT result = {};
+	result.hDone = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	TEST_CHECK(result.hDone != nullptr);
+
+	TEST_CHECK_SUCCESS(vigem_target_add_async_ex(client, x360, vigem_test_capture_async_done, &result));
+	TEST_CHECK_SUCCESS(vigem_test_capture_wait(result));
+
+	for (UCHAR led = 1; led <= 4; led++)
+	{
+		TEST_CHECK_SUCCESS(vigem_target_x360_await_notification_async(
+			client,
+			x360,
+			&notification,
+			vigem_test_capture_async_done,
+			&result
+		));
+		TEST_CHECK_SUCCESS(vigem_sim_x360_notify(client, x360, 0x10, 0x20, led));
+		TEST_CHECK_SUCCESS(vigem_test_capture_wait(result));
+		TEST_CHECK(notification.LedNumber == led);
+	}
+
+	vigem_capture_stop(client);
+	vigem_target_remove(client, x360);
+	vigem_disconnect(client);
+	vigem_target_free(x360);
+	vigem_free(client);
+	CloseHandle(result.hDone);
+
+	TEST_CHECK(vigem_test_capture_read(path, packets));
+	DeleteFileW(path);
+
+	TEST_CHECK(vigem_test_capture_count(packets, VIGEM_CAPTURE_REQUEST, IOCTL_VIGEM_PLUGIN_TARGET) == 1);
+	TEST_CHECK(vigem_test_capture_count(packets, VIGEM_CAPTURE_REQUEST, IOCTL_XUSB_REQUEST_NOTIFICATION) == 4);
+	TEST_CHECK(vigem_test_capture_count(packets, VIGEM_CAPTURE_COMPLETION, IOCTL_VIGEM_PLUGIN_TARGET) == 1);
+	TEST_CHECK(vigem_test_capture_count(packets, VIGEM_CAPTURE_COMPLETION, IOCTL_XUSB_REQUEST_NOTIFICATION) == 4);
+
+	for (const auto& packet : packets)
+	{
+		if (!vigem_test_capture_answered(packet))
+			continue;
+
+		const VIGEM_CAPTURE_PACKET* outcome = vigem_test_capture_outcome(packets, packet);
+
+		TEST_CHECK(outcome != nullptr);
+		TEST_CHECK(outcome->Event == VIGEM_CAPTURE_COMPLETION);
+		TEST_CHECK(outcome->IoControlCode == packet.IoControlCode);
+		TEST_CHECK(outcome->SerialNo == packet.SerialNo);
+		TEST_CHECK(outcome->Status == ERROR_SUCCESS);
+	}
+}
@@ -0,0 +1,112 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+//
+// Counts the threads started with a configuration
+//
+typedef struct _VIGEM_TEST_THREAD_STARTS
+{
+	volatile LONG Count;
+	volatile LONG OtherKinds;
+} VIGEM_TEST_THREAD_STARTS;
+
+static VOID CALLBACK vigem_test_client_thread_start(PVIGEM_CLIENT Client, VIGEM_THREAD_KIND Kind, LPVOID Context)
+{
+	UNREFERENCED_PARAMETER(Client);
+
+	const auto starts = static_cast<VIGEM_TEST_THREAD_STARTS*>(Context);
+
+	if (Kind == VIGEM_THREAD_OUTPUT_REPORT_PICKUP)
+		InterlockedIncrement(&starts->Count);
+	else
+		InterlockedIncrement(&starts->OtherKinds);
+}
+
+//
+// Waits for the pickup thread of a connection to have started
+//
+static BOOLEAN vigem_test_client_wait_starts(const VIGEM_TEST_THREAD_STARTS& Starts, LONG Count)
+{
+	for (ULONG waited = 0; Starts.Count < Count && waited < 5000; waited++)
+		Sleep(1);
+
+	return Starts.Count == Count;
+}
+
+//
+// Thread configurations are set up once and apply to every connection
+//
+VIGEM_TEST("client/thread_config/reconnect", client_thread_config_reconnect)
+{
+	const PVIGEM_CLIENT client = vigem_alloc();
+	VIGEM_TEST_THREAD_STARTS starts = {};
+	VIGEM_THREAD_CONFIG config;
+
+	TEST_CHECK(client != nullptr);
+
+	VIGEM_THREAD_CONFIG_INIT(&config);
+	config.OnStart = vigem_test_client_thread_start;
+	config.Context = &starts;
+
+	TEST_CHECK_SUCCESS(vigem_set_thread_config(client, VIGEM_THREAD_OUTPUT_REPORT_PICKUP, &config));
+
+	TEST_CHECK_SUCCESS(vigem_connect_simulated(client));
+	TEST_CHECK(vigem_test_client_wait_starts(starts, 1));
+	vigem_disconnect(client);
+
+	TEST_CHECK_SUCCESS(vigem_connect_simulated(client));
+	TEST_CHECK(vigem_test_client_wait_starts(starts, 2));
+	vigem_disconnect(client);
+
+	//
+	// Restoring the default applies to the next connection
+	//
+	TEST_CHECK_SUCCESS(vigem_set_thread_config(client, VIGEM_THREAD_OUTPUT_REPORT_PICKUP, nullptr));
+	TEST_CHECK_SUCCESS(vigem_connect_simulated(client));
+	vigem_disconnect(client);
+	vigem_free(client);
+
+	TEST_CHECK(starts.Count == 2);
+	TEST_CHECK(starts.OtherKinds == 0);
+}
@@ -0,0 +1,152 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+#include "ViGEm/Log.h"
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+//
+// What the log callback saw, and what it got back from the calls it made
+//
+typedef struct _VIGEM_TEST_LOG_STATE
+{
+	volatile LONG Messages;
+	BOOLEAN Reenter;
+	VIGEM_ERROR FlushResult;
+	VIGEM_ERROR SetCallbackResult;
+	VIGEM_ERROR ShutdownResult;
+} VIGEM_TEST_LOG_STATE;
+
+static VOID CALLBACK vigem_test_log_callback(VIGEM_LOG_LEVEL Level, LPCWSTR Message, LPVOID UserData)
+{
+	UNREFERENCED_PARAMETER(Level);
+	UNREFERENCED_PARAMETER(Message);
+
+	const auto state = static_cast<VIGEM_TEST_LOG_STATE*>(UserData);
+
+	InterlockedIncrement(&state->Messages);
+
+	if (state->Reenter)
+	{
+		state->Reenter = FALSE;
+		state->FlushResult = vigem_log_flush();
+		state->SetCallbackResult = vigem_log_set_callback(vigem_test_log_callback, state);
+		state->ShutdownResult = vigem_log_shutdown();
+	}
+}
+
+//
+// Logs a few messages through the library: the pickup thread of a
+// connection reports it started
+//
+static BOOLEAN vigem_test_log_produce()
+{
+	const PVIGEM_CLIENT client = vigem_alloc();
+
+	if (!client)
+		return FALSE;
+
+	const BOOLEAN connected = VIGEM_SUCCESS(vigem_connect_simulated(client));
+
+	vigem_disconnect(client);
+	vigem_free(client);
+
+	return connected;
+}
+
+//
+// The callback runs without the library's locks held, calling back into
+// the logging functions must not deadlock
+//
+VIGEM_TEST("logging/callback/reenter", log_callback_reenter)
+{
+	VIGEM_TEST_LOG_STATE state = {};
+	state.Reenter = TRUE;
+	state.ShutdownResult = VIGEM_ERROR_NONE;
+
+	TEST_CHECK_SUCCESS(vigem_log_set_callback(vigem_test_log_callback, &state));
+	TEST_CHECK_SUCCESS(vigem_log_set_level(VIGEM_LOG_LEVEL_VERBOSE));
+
+	const BOOLEAN produced = vigem_test_log_produce();
+
+	TEST_CHECK_SUCCESS(vigem_log_flush());
+	TEST_CHECK_SUCCESS(vigem_log_set_level(VIGEM_LOG_LEVEL_NONE));
+	TEST_CHECK_SUCCESS(vigem_log_shutdown());
+	TEST_CHECK_SUCCESS(vigem_log_set_callback(nullptr, nullptr));
+
+	TEST_CHECK(produced);
+	TEST_CHECK(state.Messages > 0);
+	TEST_CHECK(!state.Reenter);
+	TEST_CHECK(state.FlushResult == VIGEM_ERROR_NONE);
+	TEST_CHECK(state.SetCallbackResult == VIGEM_ERROR_NONE);
+
+	// the drain the callback runs in can't be waited for
+	TEST_CHECK(state.ShutdownResult == VIGEM_ERROR_NOT_SUPPORTED);
+}
+
+//
+// Shutting down sinks what is pending, logging afterwards starts over
+//
+VIGEM_TEST("logging/shutdown", log_shutdown)
+{
+	VIGEM_TEST_LOG_STATE state = {};
+
+	TEST_CHECK_SUCCESS(vigem_log_set_callback(vigem_test_log_callback, &state));
+	TEST_CHECK_SUCCESS(vigem_log_set_level(VIGEM_LOG_LEVEL_VERBOSE));
+
+	for (ULONG round = 0; round < 3; round++)
+	{
+		const LONG before = state.Messages;
+
+		TEST_CHECK(vigem_test_log_produce());
+		TEST_CHECK_SUCCESS(vigem_log_shutdown());
+		TEST_CHECK(state.Messages > before);
+
+		// nothing left for a flush
+		const LONG after = state.Messages;
+		TEST_CHECK_SUCCESS(vigem_log_flush());
+		TEST_CHECK(state.Messages == after);
+	}
+
+	TEST_CHECK_SUCCESS(vigem_log_set_level(VIGEM_LOG_LEVEL_NONE));
+	TEST_CHECK_SUCCESS(vigem_log_shutdown());
+	TEST_CHECK_SUCCESS(vigem_log_set_callback(nullptr, nullptr));
+}
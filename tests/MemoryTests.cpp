@@ -0,0 +1,661 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+#include "ViGEm/Stats.h"
+#include "ViGEm/Memory.h"
+#include "ViGEm/Async.h"
+
+//
+// STL
+//
+#include <cstring>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+//
+// Counting allocator, installed for the duration of each test
+//
+static volatile LONG g_MemoryAllocations = 0;
+static volatile LONG g_MemoryFrees = 0;
+
+static PVOID CALLBACK vigem_test_memory_alloc(SIZE_T Size, SIZE_T Alignment, LPVOID Context)
+{
+	UNREFERENCED_PARAMETER(Context);
+
+	InterlockedIncrement(&g_MemoryAllocations);
+
+	return _aligned_malloc(Size, Alignment);
+}
+
+static VOID CALLBACK vigem_test_memory_free(PVOID Memory, LPVOID Context)
+{
+	UNREFERENCED_PARAMETER(Context);
+
+	InterlockedIncrement(&g_MemoryFrees);
+
+	_aligned_free(Memory);
+}
+
+//
+// Counts the kernel objects the library creates and closes on the test's
+// thread, by patching the import address table of the module it is linked
+// into. Threads left over by earlier tests may still be closing theirs.
+//
+static volatile LONG g_MemoryKernelCalls = 0;
+static DWORD g_MemoryKernelThread = 0;
+
+static decltype(&CreateEventA) g_MemoryCreateEventA = nullptr;
+static decltype(&CreateEventW) g_MemoryCreateEventW = nullptr;
+static decltype(&CloseHandle) g_MemoryCloseHandle = nullptr;
+
+static HANDLE WINAPI vigem_test_memory_create_event_a(
+	LPSECURITY_ATTRIBUTES Attributes,
+	BOOL ManualReset,
+	BOOL InitialState,
+	LPCSTR Name
+)
+{
+	if (GetCurrentThreadId() == g_MemoryKernelThread)
+		InterlockedIncrement(&g_MemoryKernelCalls);
+
+	return g_MemoryCreateEventA(Attributes, ManualReset, InitialState, Name);
+}
+
+static HANDLE WINAPI vigem_test_memory_create_event_w(
+	LPSECURITY_ATTRIBUTES Attributes,
+	BOOL ManualReset,
+	BOOL InitialState,
+	LPCWSTR Name
+)
+{
+	if (GetCurrentThreadId() == g_MemoryKernelThread)
+		InterlockedIncrement(&g_MemoryKernelCalls);
+
+	return g_MemoryCreateEventW(Attributes, ManualReset, InitialState, Name);
+}
+
+static BOOL WINAPI vigem_test_memory_close_handle(HANDLE Object)
+{
+	if (GetCurrentThreadId() == g_MemoryKernelThread)
+		InterlockedIncrement(&g_MemoryKernelCalls);
+
+	return g_MemoryCloseHandle(Object);
+}
+
+//
+// Swaps the import of the named function for Hook and returns the previous
+// one, NULL if the module doesn't import it by name
+//
+static PVOID vigem_test_memory_patch_import(LPCSTR Name, PVOID Hook)
+{
+	HMODULE module;
+
+	if (!GetModuleHandleExW(
+		GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+		reinterpret_cast<LPCWSTR>(&vigem_alloc),
+		&module
+	))
+		return nullptr;
+
+	const auto base = reinterpret_cast<PUCHAR>(module);
+	const auto dos = reinterpret_cast<PIMAGE_DOS_HEADER>(base);
+	const auto nt = reinterpret_cast<PIMAGE_NT_HEADERS>(base + dos->e_lfanew);
+	const IMAGE_DATA_DIRECTORY imports = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+
+	if (!imports.VirtualAddress)
+		return nullptr;
+
+	for (auto descriptor = reinterpret_cast<PIMAGE_IMPORT_DESCRIPTOR>(base + imports.VirtualAddress); descriptor->Name; descriptor++)
+	{
+		if (!descriptor->OriginalFirstThunk)
+			continue;
+
+		auto names = reinterpret_cast<PIMAGE_THUNK_DATA>(base + descriptor->OriginalFirstThunk);
+		auto slots = reinterpret_cast<PIMAGE_THUNK_DATA>(base + descriptor->FirstThunk);
+
+		for (; names->u1.AddressOfData; names++, slots++)
+		{
+			if (IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal))
+				continue;
+
+			const auto import = reinterpret_cast<PIMAGE_IMPORT_BY_NAME>(base + names->u1.AddressOfData);
+
+			if (strcmp(reinterpret_cast<LPCSTR>(import->Name), Name) != 0)
+				continue;
+
+			DWORD protect;
+
+			if (!VirtualProtect(&slots->u1.Function, sizeof(slots->u1.Function), PAGE_READWRITE, &protect))
+				return nullptr;
+
+			const auto previous = reinterpret_cast<PVOID>(slots->u1.Function);
+			slots->u1.Function = reinterpret_cast<ULONG_PTR>(Hook);
+
+			VirtualProtect(&slots->u1.Function, sizeof(slots->u1.Function), protect, &protect);
+
+			return previous;
+		}
+	}
+
+	return nullptr;
+}
+
+//
+// The library calls CreateEvent, which is either of both depending on the
+// character set it was built with
+//
+static BOOLEAN vigem_test_memory_hook_kernel()
+{
+	g_MemoryKernelThread = GetCurrentThreadId();
+
+	g_MemoryCreateEventA = reinterpret_cast<decltype(&CreateEventA)>(
+		vigem_test_memory_patch_import("CreateEventA", reinterpret_cast<PVOID>(&vigem_test_memory_create_event_a)));
+	g_MemoryCreateEventW = reinterpret_cast<decltype(&CreateEventW)>(
+		vigem_test_memory_patch_import("CreateEventW", reinterpret_cast<PVOID>(&vigem_test_memory_create_event_w)));
+	g_MemoryCloseHandle = reinterpret_cast<decltype(&CloseHandle)>(
+		vigem_test_memory_patch_import("CloseHandle", reinterpret_cast<PVOID>(&vigem_test_memory_close_handle)));
+
+	return (g_MemoryCreateEventA || g_MemoryCreateEventW) && g_MemoryCloseHandle;
+}
+
+static VOID vigem_test_memory_unhook_kernel()
+{
+	if (g_MemoryCreateEventA)
+		vigem_test_memory_patch_import("CreateEventA", reinterpret_cast<PVOID>(g_MemoryCreateEventA));
+
+	if (g_MemoryCreateEventW)
+		vigem_test_memory_patch_import("CreateEventW", reinterpret_cast<PVOID>(g_MemoryCreateEventW));
+
+	if (g_MemoryCloseHandle)
+		vigem_test_memory_patch_import("CloseHandle", reinterpret_cast<PVOID>(g_MemoryCloseHandle));
+}
+
+//
+// Runs Body Iterations times after a warm-up that lets first uses allocate
+// and counts the allocations and kernel object calls made meanwhile. FALSE
+// if a call of Body failed.
+//
+template <typename TBody>
+static BOOLEAN vigem_test_memory_count(ULONG Iterations, LONG& Allocations, LONG& KernelCalls, TBody Body)
+{
+	for (ULONG i = 0; i < Iterations / 10 + 1; i++)
+	{
+		if (!Body(i))
+			return FALSE;
+	}
+
+	const LONG allocations = g_MemoryAllocations;
+	const LONG kernelCalls = g_MemoryKernelCalls;
+
+	for (ULONG i = 0; i < Iterations; i++)
+	{
+		if (!Body(i))
+			return FALSE;
+	}
+
+	Allocations = g_MemoryAllocations - allocations;
+	KernelCalls = g_MemoryKernelCalls - kernelCalls;
+
+	return TRUE;
+}
+
+template <typename TBody>
+static BOOLEAN vigem_test_memory_count(ULONG Iterations, LONG& Allocations, TBody Body)
+{
+	LONG kernelCalls;
+
+	return vigem_test_memory_count(Iterations, Allocations, kernelCalls, Body);
+}
+
+//
+// A simulated connection with an X360 and a DS4 target, statistics on so
+// their per-thread and per-target blocks are covered too
+//
+typedef struct _VIGEM_TEST_MEMORY_SETUP
+{
+	PVIGEM_CLIENT Client;
+	PVIGEM_TARGET X360;
+	PVIGEM_TARGET Ds4;
+} VIGEM_TEST_MEMORY_SETUP;
+
+static VIGEM_ERROR vigem_test_memory_begin(VIGEM_TEST_MEMORY_SETUP& Setup)
+{
+	VIGEM_ALLOCATOR allocator;
+	VIGEM_ALLOCATOR_INIT(&allocator, vigem_test_memory_alloc, vigem_test_memory_free, nullptr);
+
+	RtlZeroMemory(&Setup, sizeof(Setup));
+
+	VIGEM_ERROR error = vigem_set_allocator(&allocator);
+
+	if (!VIGEM_SUCCESS(error))
+		return error;
+
+	Setup.Client = vigem_alloc();
+	Setup.X360 = vigem_target_x360_alloc();
+	Setup.Ds4 = vigem_target_ds4_alloc();
+
+	if (!Setup.Client || !Setup.X360 || !Setup.Ds4)
+		return VIGEM_ERROR_WINAPI;
+
+	error = vigem_connect_simulated(Setup.Client);
+
+	if (VIGEM_SUCCESS(error))
+		error = vigem_target_add(Setup.Client, Setup.X360);
+
+	if (VIGEM_SUCCESS(error))
+		error = vigem_target_add(Setup.Client, Setup.Ds4);
+
+	if (VIGEM_SUCCESS(error))
+		error = vigem_stats_enable(Setup.Client, TRUE);
+
+	return error;
+}
+
+//
+// Frees everything and restores the CRT heap, which fails if the library
+// still holds memory of the counting allocator
+//
+static VIGEM_ERROR vigem_test_memory_end(VIGEM_TEST_MEMORY_SETUP& Setup)
+{
+	if (Setup.Client)
+	{
+		vigem_target_remove(Setup.Client, Setup.X360);
+		vigem_target_remove(Setup.Client, Setup.Ds4);
+		vigem_disconnect(Setup.Client);
+	}
+
+	vigem_target_free(Setup.X360);
+	vigem_target_free(Setup.Ds4);
+	vigem_free(Setup.Client);
+
+	return vigem_set_allocator(nullptr);
+}
+
+//
+// Callbacks of notifications and asynchronous awaits run so far
+//
+static volatile LONG g_MemoryCallbacks = 0;
+
+static VOID CALLBACK vigem_test_memory_x360_notification(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	UCHAR LargeMotor,
+	UCHAR SmallMotor,
+	UCHAR LedNumber,
+	LPVOID UserData
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(LargeMotor);
+	UNREFERENCED_PARAMETER(SmallMotor);
+	UNREFERENCED_PARAMETER(LedNumber);
+	UNREFERENCED_PARAMETER(UserData);
+
+	InterlockedIncrement(&g_MemoryCallbacks);
+}
+
+static VOID CALLBACK vigem_test_memory_ds4_notification(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	UCHAR LargeMotor,
+	UCHAR SmallMotor,
+	DS4_LIGHTBAR_COLOR LightbarColor,
+	LPVOID UserData
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(LargeMotor);
+	UNREFERENCED_PARAMETER(SmallMotor);
+	UNREFERENCED_PARAMETER(LightbarColor);
+	UNREFERENCED_PARAMETER(UserData);
+
+	InterlockedIncrement(&g_MemoryCallbacks);
+}
+
+static VOID CALLBACK vigem_test_memory_async_completion(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	VIGEM_ERROR Error,
+	LPVOID Context
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(Context);
+
+	if (Error == VIGEM_ERROR_NONE)
+		InterlockedIncrement(&g_MemoryCallbacks);
+}
+
+//
+// Waits until the callbacks ran Count times in total
+//
+static BOOLEAN vigem_test_memory_await_callbacks(LONG Count)
+{
+	for (ULONG waited = 0; g_MemoryCallbacks < Count && waited < 5000; waited++)
+		Sleep(1);
+
+	return g_MemoryCallbacks >= Count;
+}
+
+VIGEM_TEST("memory/update", memory_update)
+{
+	VIGEM_TEST_MEMORY_SETUP setup;
+	TEST_CHECK_SUCCESS(vigem_test_memory_begin(setup));
+
+	const PVIGEM_CLIENT client = setup.Client;
+	XUSB_REPORT xusb = {};
+	XUSB_REPORT batch[8] = {};
+	DS4_REPORT report;
+	DS4_REPORT_INIT(&report);
+	DS4_REPORT_EX reportEx = {};
+	LONG allocations = -1;
+
+	TEST_CHECK(vigem_test_memory_count(1000, allocations, [&](ULONG i)
+	{
+		xusb.sThumbLX = static_cast<SHORT>(i);
+		return VIGEM_SUCCESS(vigem_target_x360_update(client, setup.X360, xusb));
+	}));
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK(vigem_test_memory_count(100, allocations, [&](ULONG i)
+	{
+		batch[i % 8].sThumbLX = static_cast<SHORT>(i);
+		return VIGEM_SUCCESS(vigem_target_x360_update_batch(client, setup.X360, batch, 8));
+	}));
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK(vigem_test_memory_count(1000, allocations, [&](ULONG i)
+	{
+		report.bThumbLX = static_cast<BYTE>(i);
+		return VIGEM_SUCCESS(vigem_target_ds4_update(client, setup.Ds4, report));
+	}));
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK(vigem_test_memory_count(1000, allocations, [&](ULONG i)
+	{
+		reportEx.Report.bThumbLX = static_cast<BYTE>(i);
+		return VIGEM_SUCCESS(vigem_target_ds4_update_ex(client, setup.Ds4, reportEx));
+	}));
+	TEST_CHECK(allocations == 0);
+
+	PXUSB_REPORT pinned;
+	TEST_CHECK_SUCCESS(vigem_target_x360_get_report_buffer(client, setup.X360, &pinned));
+
+	TEST_CHECK(vigem_test_memory_count(1000, allocations, [&](ULONG i)
+	{
+		pinned->sThumbLX = static_cast<SHORT>(i);
+		return VIGEM_SUCCESS(vigem_target_x360_commit_report(client, setup.X360));
+	}));
+	TEST_CHECK(allocations == 0);
+
+	PVIGEM_PREPARED_TARGET prepared;
+	TEST_CHECK_SUCCESS(vigem_target_prepare(client, setup.X360, &prepared));
+
+	const BOOLEAN updated = vigem_test_memory_count(1000, allocations, [&](ULONG i)
+	{
+		xusb.sThumbLX = static_cast<SHORT>(i);
+		return VIGEM_SUCCESS(vigem_target_x360_update_prepared(prepared, xusb));
+	});
+
+	vigem_prepared_target_free(prepared);
+
+	TEST_CHECK(updated);
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK_SUCCESS(vigem_test_memory_end(setup));
+}
+
+//
+// Updates of every kind wait on an event the target keeps, they neither
+// allocate nor create or close kernel objects once set up
+//
+VIGEM_TEST("memory/kernel_objects", memory_kernel_objects)
+{
+	VIGEM_TEST_MEMORY_SETUP setup;
+	TEST_CHECK_SUCCESS(vigem_test_memory_begin(setup));
+
+	const PVIGEM_CLIENT client = setup.Client;
+	XUSB_REPORT xusb = {};
+	XUSB_REPORT batch[8] = {};
+	DS4_REPORT report;
+	DS4_REPORT_INIT(&report);
+	DS4_REPORT_EX reportEx[4] = {};
+	PXUSB_REPORT pinned;
+	PVIGEM_PREPARED_TARGET prepared;
+	LONG allocations[6] = { -1, -1, -1, -1, -1, -1 };
+	LONG kernelCalls[6] = { -1, -1, -1, -1, -1, -1 };
+
+	TEST_CHECK_SUCCESS(vigem_target_x360_get_report_buffer(client, setup.X360, &pinned));
+	TEST_CHECK_SUCCESS(vigem_target_prepare(client, setup.X360, &prepared));
+
+	const BOOLEAN hooked = vigem_test_memory_hook_kernel();
+
+	const BOOLEAN updated = hooked
+		&& vigem_test_memory_count(1000, allocations[0], kernelCalls[0], [&](ULONG i)
+		{
+			xusb.sThumbLX = static_cast<SHORT>(i);
+			return VIGEM_SUCCESS(vigem_target_x360_update(client, setup.X360, xusb));
+		})
+		&& vigem_test_memory_count(100, allocations[1], kernelCalls[1], [&](ULONG i)
+		{
+			batch[i % 8].sThumbLX = static_cast<SHORT>(i);
+			return VIGEM_SUCCESS(vigem_target_x360_update_batch(client, setup.X360, batch, 8));
+		})
+		&& vigem_test_memory_count(1000, allocations[2], kernelCalls[2], [&](ULONG i)
+		{
+			report.bThumbLX = static_cast<BYTE>(i);
+			return VIGEM_SUCCESS(vigem_target_ds4_update(client, setup.Ds4, report));
+		})
+		&& vigem_test_memory_count(100, allocations[3], kernelCalls[3], [&](ULONG i)
+		{
+			reportEx[i % 4].Report.bThumbLX = static_cast<BYTE>(i);
+			return VIGEM_SUCCESS(vigem_target_ds4_update_ex_batch(client, setup.Ds4, reportEx, 4));
+		})
+		&& vigem_test_memory_count(1000, allocations[4], kernelCalls[4], [&](ULONG i)
+		{
+			pinned->sThumbLX = static_cast<SHORT>(i);
+			return VIGEM_SUCCESS(vigem_target_x360_commit_report(client, setup.X360));
+		})
+		&& vigem_test_memory_count(1000, allocations[5], kernelCalls[5], [&](ULONG i)
+		{
+			xusb.sThumbLX = static_cast<SHORT>(i);
+			return VIGEM_SUCCESS(vigem_target_x360_update_prepared(prepared, xusb));
+		});
+
+	vigem_test_memory_unhook_kernel();
+	vigem_prepared_target_free(prepared);
+
+	TEST_CHECK_SUCCESS(vigem_test_memory_end(setup));
+	TEST_CHECK(hooked);
+	TEST_CHECK(updated);
+
+	for (ULONG index = 0; index < 6; index++)
+	{
+		TEST_CHECK(allocations[index] == 0);
+		TEST_CHECK(kernelCalls[index] == 0);
+	}
+}
+
+VIGEM_TEST("memory/output_pickup", memory_output_pickup)
+{
+	VIGEM_TEST_MEMORY_SETUP setup;
+	TEST_CHECK_SUCCESS(vigem_test_memory_begin(setup));
+
+	DS4_OUTPUT_BUFFER output = {};
+	DS4_OUTPUT_BUFFER received;
+	LONG allocations = -1;
+
+	output.Buffer[0] = 0x05;
+
+	TEST_CHECK(vigem_test_memory_count(200, allocations, [&](ULONG i)
+	{
+		output.Buffer[4] = static_cast<UCHAR>(i);
+
+		return VIGEM_SUCCESS(vigem_sim_ds4_output(setup.Client, setup.Ds4, &output))
+			&& VIGEM_SUCCESS(vigem_target_ds4_await_output_report_timeout(setup.Client, setup.Ds4, 1000, &received));
+	}));
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK_SUCCESS(vigem_test_memory_end(setup));
+}
+
+VIGEM_TEST("memory/notification", memory_notification)
+{
+	VIGEM_TEST_MEMORY_SETUP setup;
+	TEST_CHECK_SUCCESS(vigem_test_memory_begin(setup));
+
+	const PVIGEM_CLIENT client = setup.Client;
+	DS4_OUTPUT_BUFFER output = {};
+	LONG allocations = -1;
+
+	output.Buffer[0] = 0x05;
+
+	TEST_CHECK_SUCCESS(vigem_target_x360_register_notification(client, setup.X360, vigem_test_memory_x360_notification, nullptr));
+
+	const BOOLEAN x360 = vigem_test_memory_count(200, allocations, [&](ULONG i)
+	{
+		const LONG expected = g_MemoryCallbacks + 1;
+
+		return VIGEM_SUCCESS(vigem_sim_x360_notify(client, setup.X360, static_cast<UCHAR>(i), 0, 0))
+			&& vigem_test_memory_await_callbacks(expected);
+	});
+
+	vigem_target_x360_unregister_notification(setup.X360);
+
+	// the notification thread takes this one and exits
+	vigem_sim_x360_notify(client, setup.X360, 0, 0, 0);
+
+	TEST_CHECK(x360);
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK_SUCCESS(vigem_target_ds4_register_notification(client, setup.Ds4, vigem_test_memory_ds4_notification, nullptr));
+
+	const BOOLEAN ds4 = vigem_test_memory_count(200, allocations, [&](ULONG i)
+	{
+		const LONG expected = g_MemoryCallbacks + 1;
+		output.Buffer[4] = static_cast<UCHAR>(i);
+
+		return VIGEM_SUCCESS(vigem_sim_ds4_output(client, setup.Ds4, &output))
+			&& vigem_test_memory_await_callbacks(expected);
+	});
+
+	vigem_target_ds4_unregister_notification(setup.Ds4);
+	vigem_sim_ds4_output(client, setup.Ds4, &output);
+
+	TEST_CHECK(ds4);
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK_SUCCESS(vigem_test_memory_end(setup));
+}
+
+//
+// Finished operations are kept by the connection for the next await
+//
+VIGEM_TEST("memory/async", memory_async)
+{
+	VIGEM_TEST_MEMORY_SETUP setup;
+	TEST_CHECK_SUCCESS(vigem_test_memory_begin(setup));
+
+	const PVIGEM_CLIENT client = setup.Client;
+	VIGEM_X360_NOTIFICATION notification;
+	DS4_OUTPUT_BUFFER output = {};
+	DS4_OUTPUT_BUFFER received;
+	LONG allocations = -1;
+
+	output.Buffer[0] = 0x05;
+
+	TEST_CHECK(vigem_test_memory_count(200, allocations, [&](ULONG i)
+	{
+		const LONG expected = g_MemoryCallbacks + 1;
+
+		return VIGEM_SUCCESS(vigem_target_x360_await_notification_async(
+				client,
+				setup.X360,
+				&notification,
+				vigem_test_memory_async_completion,
+				nullptr
+			))
+			&& VIGEM_SUCCESS(vigem_sim_x360_notify(client, setup.X360, static_cast<UCHAR>(i), 0, 0))
+			&& vigem_test_memory_await_callbacks(expected);
+	}));
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK(vigem_test_memory_count(200, allocations, [&](ULONG i)
+	{
+		const LONG expected = g_MemoryCallbacks + 1;
+		output.Buffer[4] = static_cast<UCHAR>(i);
+
+		return VIGEM_SUCCESS(vigem_target_ds4_await_output_report_async(
+				client,
+				setup.Ds4,
+				&received,
+				vigem_test_memory_async_completion,
+				nullptr
+			))
+			&& VIGEM_SUCCESS(vigem_sim_ds4_output(client, setup.Ds4, &output))
+			&& vigem_test_memory_await_callbacks(expected);
+	}));
+	TEST_CHECK(allocations == 0);
+
+	TEST_CHECK_SUCCESS(vigem_test_memory_end(setup));
+}
+
+//
+// Every block of a connection's lifetime is returned to the allocator it
+// came from
+//
+VIGEM_TEST("memory/balanced", memory_balanced)
+{
+	VIGEM_TEST_MEMORY_SETUP setup;
+
+	const LONG allocationsBefore = g_MemoryAllocations;
+	const LONG freesBefore = g_MemoryFrees;
+
+	TEST_CHECK_SUCCESS(vigem_test_memory_begin(setup));
+	TEST_CHECK_SUCCESS(vigem_target_x360_update(setup.Client, setup.X360, XUSB_REPORT{}));
+	TEST_CHECK_SUCCESS(vigem_test_memory_end(setup));
+
+	TEST_CHECK(g_MemoryAllocations != allocationsBefore);
+	TEST_CHECK(g_MemoryAllocations - allocationsBefore == g_MemoryFrees - freesBefore);
+}
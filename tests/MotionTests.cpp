@@ -0,0 +1,292 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Motion.h"
+
+//
+// STL
+//
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+#define VIGEM_TEST_PI 3.14159265358979
+
+//
+// Four pads take the SSE2 path, the fifth the scalar one
+//
+static const ULONG g_MotionPads = 5;
+
+static VIGEM_MOTION_SAMPLE vigem_test_motion_sample(ULONGLONG Timestamp, int Axis, double Degrees)
+{
+	VIGEM_MOTION_SAMPLE sample;
+	memset(&sample, 0, sizeof(sample));
+
+	const double half = Degrees * VIGEM_TEST_PI / 360.0;
+
+	sample.Timestamp = Timestamp;
+	sample.Orientation[0] = static_cast<FLOAT>(std::cos(half));
+	sample.Orientation[1 + Axis] = static_cast<FLOAT>(std::sin(half));
+
+	return sample;
+}
+
+//
+// Feeds the samples to every pad and synthesizes them at Timestamp. Fails
+// unless all pads, vectorized or not, produce the same report.
+//
+static bool vigem_test_motion(
+	const VIGEM_MOTION_SAMPLE* First,
+	const VIGEM_MOTION_SAMPLE* Second,
+	ULONGLONG Timestamp,
+	PDS4_REPORT_EX Report
+)
+{
+	const auto engine = vigem_motion_alloc(g_MotionPads);
+
+	if (!engine)
+		return false;
+
+	DS4_REPORT_EX reports[g_MotionPads];
+	memset(reports, 0, sizeof(reports));
+
+	bool result = true;
+
+	for (ULONG pad = 0; pad < g_MotionPads; pad++)
+	{
+		result = result && VIGEM_SUCCESS(vigem_motion_push(engine, pad, First));
+
+		if (Second)
+			result = result && VIGEM_SUCCESS(vigem_motion_push(engine, pad, Second));
+	}
+
+	result = result && VIGEM_SUCCESS(vigem_motion_synthesize(engine, Timestamp, reports, g_MotionPads));
+
+	vigem_motion_free(engine);
+
+	for (ULONG pad = 1; pad < g_MotionPads; pad++)
+		result = result && memcmp(&reports[0], &reports[pad], sizeof(DS4_REPORT_EX)) == 0;
+
+	*Report = reports[0];
+
+	return result;
+}
+
+static bool vigem_test_motion_near(SHORT Value, double Expected, double Tolerance)
+{
+	return std::fabs(Value - Expected) <= Tolerance;
+}
+
+//
+// Gravity is world up (+Y) seen from the device, in g
+//
+VIGEM_TEST("motion/gravity", motion_gravity)
+{
+	const struct
+	{
+		int Axis;
+		double Degrees;
+		double Gravity[3];
+	} cases[] =
+	{
+		{ 0, 0.0, { 0.0, 1.0, 0.0 } },
+		{ 0, 90.0, { 0.0, 0.0, -1.0 } },
+		{ 0, -90.0, { 0.0, 0.0, 1.0 } },
+		{ 0, 180.0, { 0.0, -1.0, 0.0 } },
+		{ 2, 90.0, { 1.0, 0.0, 0.0 } },
+		{ 2, -90.0, { -1.0, 0.0, 0.0 } },
+		// turning around the up axis leaves gravity alone
+		{ 1, 135.0, { 0.0, 1.0, 0.0 } },
+	};
+
+	for (const auto& entry : cases)
+	{
+		const VIGEM_MOTION_SAMPLE sample = vigem_test_motion_sample(0, entry.Axis, entry.Degrees);
+		DS4_REPORT_EX report;
+
+		TEST_CHECK(vigem_test_motion(&sample, nullptr, 1000, &report));
+		TEST_CHECK(vigem_test_motion_near(report.Report.wAccelX, entry.Gravity[0] * VIGEM_MOTION_ACCEL_RESOLUTION, 1.0));
+		TEST_CHECK(vigem_test_motion_near(report.Report.wAccelY, entry.Gravity[1] * VIGEM_MOTION_ACCEL_RESOLUTION, 1.0));
+		TEST_CHECK(vigem_test_motion_near(report.Report.wAccelZ, entry.Gravity[2] * VIGEM_MOTION_ACCEL_RESOLUTION, 1.0));
+	}
+
+	// linear acceleration adds to gravity
+	VIGEM_MOTION_SAMPLE moving = vigem_test_motion_sample(0, 0, 0.0);
+	moving.Acceleration[0] = 0.5f;
+	moving.Acceleration[1] = -0.25f;
+
+	DS4_REPORT_EX report;
+	TEST_CHECK(vigem_test_motion(&moving, nullptr, 1000, &report));
+	TEST_CHECK(report.Report.wAccelX == 4096);
+	TEST_CHECK(report.Report.wAccelY == 6144);
+	TEST_CHECK(report.Report.wAccelZ == 0);
+}
+
+//
+// Normalized linear interpolation follows the closed form of nlerp exactly
+// and stays close to the constant speed rotation (slerp) for tracking steps
+//
+VIGEM_TEST("motion/nlerp", motion_nlerp)
+{
+	for (const double step : { 90.0, 20.0 })
+	{
+		const VIGEM_MOTION_SAMPLE first = vigem_test_motion_sample(1000, 0, 0.0);
+		const VIGEM_MOTION_SAMPLE second = vigem_test_motion_sample(9000, 0, step);
+
+		for (int eighth = 0; eighth <= 8; eighth++)
+		{
+			const double t = eighth / 8.0;
+			const double half = step * VIGEM_TEST_PI / 360.0;
+			const double nlerp = 2.0 * std::atan2(t * std::sin(half), (1.0 - t) + t * std::cos(half));
+			const double slerp = t * step * VIGEM_TEST_PI / 180.0;
+			DS4_REPORT_EX report;
+
+			TEST_CHECK(vigem_test_motion(&first, &second, 1000 + eighth * 1000, &report));
+
+			// pitching up by the angle moves gravity from +Y towards -Z
+			TEST_CHECK(vigem_test_motion_near(report.Report.wAccelY, std::cos(nlerp) * VIGEM_MOTION_ACCEL_RESOLUTION, 1.0));
+			TEST_CHECK(vigem_test_motion_near(report.Report.wAccelZ, -std::sin(nlerp) * VIGEM_MOTION_ACCEL_RESOLUTION, 1.0));
+			TEST_CHECK(report.Report.wAccelX == 0);
+
+			// nlerp deviates from slerp by 0.01 degrees at most for a 20 degree step
+			if (step <= 20.0)
+			{
+				const double tolerance = 0.01 * VIGEM_TEST_PI / 180.0 * VIGEM_MOTION_ACCEL_RESOLUTION + 1.0;
+
+				TEST_CHECK(vigem_test_motion_near(report.Report.wAccelY, std::cos(slerp) * VIGEM_MOTION_ACCEL_RESOLUTION, tolerance));
+				TEST_CHECK(vigem_test_motion_near(report.Report.wAccelZ, -std::sin(slerp) * VIGEM_MOTION_ACCEL_RESOLUTION, tolerance));
+			}
+		}
+	}
+
+	// q and -q are the same orientation, the blend must take the short arc
+	const VIGEM_MOTION_SAMPLE first = vigem_test_motion_sample(0, 0, 10.0);
+	VIGEM_MOTION_SAMPLE second = vigem_test_motion_sample(1000, 0, 30.0);
+
+	for (auto& component : second.Orientation)
+		component = -component;
+
+	DS4_REPORT_EX report;
+	TEST_CHECK(vigem_test_motion(&first, &second, 500, &report));
+	TEST_CHECK(vigem_test_motion_near(report.Report.wAccelY, std::cos(20.0 * VIGEM_TEST_PI / 180.0) * VIGEM_MOTION_ACCEL_RESOLUTION, 2.0));
+	TEST_CHECK(vigem_test_motion_near(report.Report.wAccelZ, -std::sin(20.0 * VIGEM_TEST_PI / 180.0) * VIGEM_MOTION_ACCEL_RESOLUTION, 2.0));
+}
+
+VIGEM_TEST("motion/gyro", motion_gyro)
+{
+	VIGEM_MOTION_SAMPLE first = vigem_test_motion_sample(0, 0, 0.0);
+	VIGEM_MOTION_SAMPLE second = vigem_test_motion_sample(1000, 0, 0.0);
+	second.AngularVelocity[0] = 1.0f;
+	second.AngularVelocity[1] = -2.0f;
+	second.AngularVelocity[2] = static_cast<FLOAT>(VIGEM_TEST_PI);
+
+	const double perRadian = VIGEM_MOTION_GYRO_RESOLUTION * 180.0 / VIGEM_TEST_PI;
+	DS4_REPORT_EX report;
+
+	// angular velocity is interpolated linearly
+	TEST_CHECK(vigem_test_motion(&first, &second, 250, &report));
+	TEST_CHECK(vigem_test_motion_near(report.Report.wGyroX, 0.25 * perRadian, 1.0));
+	TEST_CHECK(vigem_test_motion_near(report.Report.wGyroY, -0.5 * perRadian, 1.0));
+	TEST_CHECK(vigem_test_motion_near(report.Report.wGyroZ, 0.25 * 180.0 * VIGEM_MOTION_GYRO_RESOLUTION, 1.0));
+
+	// times past the newest sample hold it, times before the older one hold that
+	TEST_CHECK(vigem_test_motion(&first, &second, 5000, &report));
+	TEST_CHECK(report.Report.wGyroZ == 180 * VIGEM_MOTION_GYRO_RESOLUTION);
+	first.Timestamp = 100;
+	TEST_CHECK(vigem_test_motion(&first, &second, 50, &report));
+	TEST_CHECK(report.Report.wGyroZ == 0);
+}
+
+//
+// Raw values saturate at the SHORT range instead of wrapping
+//
+VIGEM_TEST("motion/clamp", motion_clamp)
+{
+	VIGEM_MOTION_SAMPLE sample = vigem_test_motion_sample(0, 0, 0.0);
+	sample.AngularVelocity[0] = 100.0f;
+	sample.AngularVelocity[1] = -100.0f;
+	sample.AngularVelocity[2] = 35.0f;
+	sample.Acceleration[0] = 10.0f;
+	sample.Acceleration[1] = -10.0f;
+	sample.Acceleration[2] = 3.0f;
+
+	DS4_REPORT_EX report;
+	TEST_CHECK(vigem_test_motion(&sample, nullptr, 0, &report));
+
+	TEST_CHECK(report.Report.wGyroX == 32767);
+	TEST_CHECK(report.Report.wGyroY == -32768);
+	TEST_CHECK(report.Report.wGyroZ == 32086);
+	TEST_CHECK(report.Report.wAccelX == 32767);
+	TEST_CHECK(report.Report.wAccelY == -32768);
+	TEST_CHECK(report.Report.wAccelZ == 24576);
+}
+
+//
+// wTimestamp counts in units of 16/3 microseconds (5.33 us) and wraps at 16 bit
+//
+VIGEM_TEST("motion/timestamp", motion_timestamp)
+{
+	const struct
+	{
+		ULONGLONG Microseconds;
+		USHORT Timestamp;
+	} cases[] =
+	{
+		{ 0, 0 },
+		{ 5, 0 },
+		{ 6, 1 },
+		{ 16, 3 },
+		{ 5333, 999 },
+		{ 1000000, static_cast<USHORT>(187500) },
+		{ 349525, 65535 },
+		{ 349526, 0 },
+	};
+
+	const VIGEM_MOTION_SAMPLE sample = vigem_test_motion_sample(0, 0, 0.0);
+
+	for (const auto& entry : cases)
+	{
+		DS4_REPORT_EX report;
+
+		TEST_CHECK(vigem_test_motion(&sample, nullptr, entry.Microseconds, &report));
+		TEST_CHECK(report.Report.wTimestamp == entry.Timestamp);
+	}
+}
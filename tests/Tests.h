@@ -0,0 +1,31 @@
+#pragma once
+
+//
+// Minimal self-registering test harness shared by the files in tests/.
+// A test is a function registered with VIGEM_TEST; the TEST_* checks record
+// the first failing condition and leave the test.
+//
+
+typedef void (*PFN_VIGEM_TEST)();
+
+class VIGEM_TEST_REGISTRATION
+{
+public:
+    VIGEM_TEST_REGISTRATION(const char* Name, PFN_VIGEM_TEST Routine);
+};
+
+void vigem_test_fail(const char* File, int Line, const char* Condition);
+
+//
+// Defines and registers a test, Name groups tests by slashes (e.g. "util/...")
+//
+#define VIGEM_TEST(_name_, _routine_) \
+    static void _routine_(); \
+    static const VIGEM_TEST_REGISTRATION _routine_##_registration(_name_, _routine_); \
+    static void _routine_()
+
+#define TEST_CHECK(_condition_) \
+    do { if (!(_condition_)) { vigem_test_fail(__FILE__, __LINE__, #_condition_); return; } } while (0)
+
+#define TEST_CHECK_SUCCESS(_call_) \
+    TEST_CHECK(VIGEM_SUCCESS(_call_))
@@ -0,0 +1,52 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// Compiled as C to keep ViGEm/Util.h usable from C code. The functions are
+// called by the util tests to compare the C build of the helpers with C++.
+//
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Util.h"
+
+
+VOID vigem_test_c_xusb_to_ds4_batch(const XUSB_REPORT* Input, PDS4_REPORT Output, SIZE_T Count)
+{
+	XUSB_TO_DS4_REPORT_BATCH(Input, Output, Count);
+}
+
+VOID vigem_test_c_ds4_to_xusb_batch(const DS4_REPORT* Input, PXUSB_REPORT Output, SIZE_T Count)
+{
+	DS4_TO_XUSB_REPORT_BATCH(Input, Output, Count);
+}
@@ -0,0 +1,663 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Util.h"
+#include "ViGEm/Remap.h"
+
+//
+// STL
+//
+#include <cstring>
+#include <vector>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+//
+// Implemented in UtilC.c, built from the same header as C
+//
+extern "C" VOID vigem_test_c_xusb_to_ds4_batch(const XUSB_REPORT* Input, PDS4_REPORT Output, SIZE_T Count);
+extern "C" VOID vigem_test_c_ds4_to_xusb_batch(const DS4_REPORT* Input, PXUSB_REPORT Output, SIZE_T Count);
+
+static const SHORT g_AxisEdges[] = { -32768, -32767, -32766, -257, -256, -129, -128, -1, 0, 1, 2, 127, 128, 255, 256, 32765, 32766, 32767 };
+static const BYTE g_TriggerEdges[] = { 0, 1, 2, 127, 128, 254, 255 };
+
+//
+// Every button mask, every trigger value, every value of each axis and
+// combinations of the axis and trigger edges
+//
+static std::vector<XUSB_REPORT> vigem_test_xusb_reports()
+{
+	std::vector<XUSB_REPORT> reports;
+	XUSB_REPORT report;
+
+	for (ULONG mask = 0; mask <= 0xFFFF; mask++)
+	{
+		XUSB_REPORT_INIT(&report);
+		report.wButtons = static_cast<USHORT>(mask);
+		report.bLeftTrigger = static_cast<BYTE>(mask);
+		report.bRightTrigger = static_cast<BYTE>(mask >> 8);
+		report.sThumbLX = static_cast<SHORT>(mask * 7);
+		report.sThumbLY = static_cast<SHORT>(mask);
+		report.sThumbRX = static_cast<SHORT>(mask * 13);
+		report.sThumbRY = static_cast<SHORT>(~mask);
+		reports.push_back(report);
+	}
+
+	for (LONG value = -32768; value <= 32767; value++)
+	{
+		XUSB_REPORT_INIT(&report);
+		report.sThumbLX = report.sThumbLY = report.sThumbRX = report.sThumbRY = static_cast<SHORT>(value);
+		reports.push_back(report);
+	}
+
+	for (const SHORT x : g_AxisEdges)
+	{
+		for (const SHORT y : g_AxisEdges)
+		{
+			for (const BYTE trigger : g_TriggerEdges)
+			{
+				XUSB_REPORT_INIT(&report);
+				report.bLeftTrigger = trigger;
+				report.bRightTrigger = static_cast<BYTE>(255 - trigger);
+				report.sThumbLX = report.sThumbRY = x;
+				report.sThumbLY = report.sThumbRX = y;
+				report.wButtons = XUSB_GAMEPAD_DPAD_UP | XUSB_GAMEPAD_A;
+				reports.push_back(report);
+			}
+		}
+	}
+
+	return reports;
+}
+
+static std::vector<DS4_REPORT> vigem_test_ds4_reference(const std::vector<XUSB_REPORT>& Input)
+{
+	std::vector<DS4_REPORT> reference(Input.size());
+
+	for (size_t i = 0; i < Input.size(); i++)
+	{
+		// the legacy helper takes a non-const report
+		XUSB_REPORT input = Input[i];
+
+		DS4_REPORT_INIT(&reference[i]);
+		XUSB_TO_DS4_REPORT(&input, &reference[i]);
+	}
+
+	return reference;
+}
+
+//
+// Runs a batch conversion on a buffer of garbage and compares it in full, at
+// every count up to 9 to cover the remainder loops and on the whole input
+//
+static bool vigem_test_xusb_to_ds4_batch_matches(
+	VOID (*Batch)(const XUSB_REPORT*, PDS4_REPORT, SIZE_T),
+	const std::vector<XUSB_REPORT>& Input,
+	const std::vector<DS4_REPORT>& Reference
+)
+{
+	std::vector<DS4_REPORT> output(Input.size());
+
+	for (size_t count = 1; count <= 9; count++)
+	{
+		for (size_t offset = 0; offset < 4; offset++)
+		{
+			memset(output.data(), 0xCD, (count + 1) * sizeof(DS4_REPORT));
+			Batch(&Input[offset], output.data(), count);
+
+			if (memcmp(output.data(), &Reference[offset], count * sizeof(DS4_REPORT)) != 0)
+				return false;
+
+			// nothing past Count is touched
+			const auto* past = reinterpret_cast<const UCHAR*>(&output[count]);
+			for (size_t b = 0; b < sizeof(DS4_REPORT); b++)
+			{
+				if (past[b] != 0xCD)
+					return false;
+			}
+		}
+	}
+
+	memset(output.data(), 0xCD, output.size() * sizeof(DS4_REPORT));
+	Batch(Input.data(), output.data(), Input.size());
+
+	return memcmp(output.data(), Reference.data(), output.size() * sizeof(DS4_REPORT)) == 0;
+}
+
+static VOID vigem_test_xusb_to_ds4_fast(const XUSB_REPORT* Input, PDS4_REPORT Output, SIZE_T Count)
+{
+	for (SIZE_T i = 0; i < Count; i++)
+		XUSB_TO_DS4_REPORT_FAST(&Input[i], &Output[i]);
+}
+
+static VOID vigem_test_xusb_to_ds4_batch(const XUSB_REPORT* Input, PDS4_REPORT Output, SIZE_T Count)
+{
+	XUSB_TO_DS4_REPORT_BATCH(Input, Output, Count);
+}
+
+VIGEM_TEST("util/xusb_to_ds4/scalar", util_xusb_to_ds4_scalar)
+{
+	const auto input = vigem_test_xusb_reports();
+	const auto reference = vigem_test_ds4_reference(input);
+
+	TEST_CHECK(vigem_test_xusb_to_ds4_batch_matches(vigem_test_xusb_to_ds4_fast, input, reference));
+}
+
+VIGEM_TEST("util/xusb_to_ds4/batch", util_xusb_to_ds4_batch)
+{
+	const auto input = vigem_test_xusb_reports();
+	const auto reference = vigem_test_ds4_reference(input);
+
+	TEST_CHECK(vigem_test_xusb_to_ds4_batch_matches(vigem_test_xusb_to_ds4_batch, input, reference));
+}
+
+#if defined(VIGEM_UTIL_SSE2)
+VIGEM_TEST("util/xusb_to_ds4/sse2", util_xusb_to_ds4_sse2)
+{
+	const auto input = vigem_test_xusb_reports();
+	const auto reference = vigem_test_ds4_reference(input);
+
+	TEST_CHECK(vigem_test_xusb_to_ds4_batch_matches(XUSB_TO_DS4_REPORT_BATCH_SSE2, input, reference));
+}
+#endif
+
+#if defined(VIGEM_UTIL_AVX2)
+VIGEM_TEST("util/xusb_to_ds4/avx2", util_xusb_to_ds4_avx2)
+{
+	// passes trivially on CPUs without AVX2, the batch test covers their path
+	if (!(VIGEM_UTIL_CPU_FEATURES() & VIGEM_UTIL_CPU_AVX2))
+		return;
+
+	const auto input = vigem_test_xusb_reports();
+	const auto reference = vigem_test_ds4_reference(input);
+
+	TEST_CHECK(vigem_test_xusb_to_ds4_batch_matches(XUSB_TO_DS4_REPORT_BATCH_AVX2, input, reference));
+}
+#endif
+
+VIGEM_TEST("util/xusb_to_ds4/c", util_xusb_to_ds4_c)
+{
+	const auto input = vigem_test_xusb_reports();
+	const auto reference = vigem_test_ds4_reference(input);
+
+	TEST_CHECK(vigem_test_xusb_to_ds4_batch_matches(vigem_test_c_xusb_to_ds4_batch, input, reference));
+}
+
+//
+// Pins the legacy XUSB_TO_DS4_REPORT mapping all variants have to reproduce
+//
+VIGEM_TEST("util/xusb_to_ds4/axis_edges", util_xusb_to_ds4_axis_edges)
+{
+	XUSB_REPORT input;
+	DS4_REPORT output;
+
+	XUSB_REPORT_INIT(&input);
+	input.sThumbLX = input.sThumbLY = input.sThumbRX = input.sThumbRY = -32768;
+	XUSB_TO_DS4_REPORT_FAST(&input, &output);
+
+	// X maps left to 0, Y is inverted (XUSB up is positive, DS4 up is 0)
+	TEST_CHECK(output.bThumbLX == 0x00);
+	TEST_CHECK(output.bThumbLY == 0xFF);
+	TEST_CHECK(output.bThumbRX == 0x00);
+	TEST_CHECK(output.bThumbRY == 0xFF);
+
+	input.sThumbLX = input.sThumbLY = input.sThumbRX = input.sThumbRY = 0;
+	XUSB_TO_DS4_REPORT_FAST(&input, &output);
+
+	// the division by 257 centers X one step low and Y one step high
+	TEST_CHECK(output.bThumbLX == 0x7F);
+	TEST_CHECK(output.bThumbLY == 0x81);
+	TEST_CHECK(output.bThumbRX == 0x7F);
+	TEST_CHECK(output.bThumbRY == 0x81);
+
+	input.sThumbLX = input.sThumbLY = input.sThumbRX = input.sThumbRY = 32767;
+	XUSB_TO_DS4_REPORT_FAST(&input, &output);
+
+	// Y never reaches 0, LY stops one step earlier due to its bias
+	TEST_CHECK(output.bThumbLX == 0xFF);
+	TEST_CHECK(output.bThumbLY == 0x02);
+	TEST_CHECK(output.bThumbRX == 0xFF);
+	TEST_CHECK(output.bThumbRY == 0x01);
+}
+
+VIGEM_TEST("util/xusb_to_ds4/trigger_edges", util_xusb_to_ds4_trigger_edges)
+{
+	XUSB_REPORT input;
+	DS4_REPORT output;
+
+	for (const BYTE trigger : g_TriggerEdges)
+	{
+		XUSB_REPORT_INIT(&input);
+		input.bLeftTrigger = trigger;
+		input.bRightTrigger = static_cast<BYTE>(255 - trigger);
+		XUSB_TO_DS4_REPORT_FAST(&input, &output);
+
+		// analog values pass through, the digital L2/R2 bits follow any non-zero value
+		TEST_CHECK(output.bTriggerL == trigger);
+		TEST_CHECK(output.bTriggerR == 255 - trigger);
+		TEST_CHECK(((output.wButtons & DS4_BUTTON_TRIGGER_LEFT) != 0) == (trigger != 0));
+		TEST_CHECK(((output.wButtons & DS4_BUTTON_TRIGGER_RIGHT) != 0) == (trigger != 255));
+	}
+}
+
+//
+// Every button mask with the other fields derived from it
+//
+static std::vector<DS4_REPORT> vigem_test_ds4_reports()
+{
+	std::vector<DS4_REPORT> reports;
+	DS4_REPORT report;
+
+	for (ULONG mask = 0; mask <= 0xFFFF; mask++)
+	{
+		DS4_REPORT_INIT(&report);
+		report.wButtons = static_cast<USHORT>(mask);
+		report.bSpecial = static_cast<BYTE>(mask >> 13);
+		report.bThumbLX = static_cast<BYTE>(mask);
+		report.bThumbLY = static_cast<BYTE>(mask >> 8);
+		report.bThumbRX = static_cast<BYTE>(~mask);
+		report.bThumbRY = static_cast<BYTE>(mask * 3);
+		report.bTriggerL = static_cast<BYTE>(mask >> 3);
+		report.bTriggerR = static_cast<BYTE>(mask >> 5);
+		reports.push_back(report);
+	}
+
+	return reports;
+}
+
+VIGEM_TEST("util/ds4_to_xusb/batch", util_ds4_to_xusb_batch)
+{
+	const auto input = vigem_test_ds4_reports();
+	std::vector<DS4_REPORT_EX> inputEx(input.size());
+	std::vector<XUSB_REPORT> reference(input.size());
+
+	for (size_t i = 0; i < input.size(); i++)
+	{
+		DS4_TO_XUSB_REPORT(&input[i], &reference[i]);
+
+		memset(&inputEx[i], 0, sizeof(DS4_REPORT_EX));
+		memcpy(&inputEx[i], &input[i], sizeof(DS4_REPORT));
+	}
+
+	// odd counts exercise the remainder of the pairwise loops
+	for (const size_t count : { static_cast<size_t>(1), static_cast<size_t>(3), input.size() })
+	{
+		std::vector<XUSB_REPORT> output(count);
+
+		memset(output.data(), 0xCD, count * sizeof(XUSB_REPORT));
+		DS4_TO_XUSB_REPORT_BATCH(input.data(), output.data(), count);
+		TEST_CHECK(memcmp(output.data(), reference.data(), count * sizeof(XUSB_REPORT)) == 0);
+
+		memset(output.data(), 0xCD, count * sizeof(XUSB_REPORT));
+		DS4_REPORT_EX_TO_XUSB_REPORT_BATCH(inputEx.data(), output.data(), count);
+		TEST_CHECK(memcmp(output.data(), reference.data(), count * sizeof(XUSB_REPORT)) == 0);
+
+		memset(output.data(), 0xCD, count * sizeof(XUSB_REPORT));
+		vigem_test_c_ds4_to_xusb_batch(input.data(), output.data(), count);
+		TEST_CHECK(memcmp(output.data(), reference.data(), count * sizeof(XUSB_REPORT)) == 0);
+	}
+}
+
+VIGEM_TEST("util/ds4_to_xusb/axis", util_ds4_to_xusb_axis)
+{
+	TEST_CHECK(DS4_TO_XUSB_AXIS(0x00) == -32768);
+	TEST_CHECK(DS4_TO_XUSB_AXIS(0x80) == 128);
+	TEST_CHECK(DS4_TO_XUSB_AXIS(0xFF) == 32767);
+
+	TEST_CHECK(DS4_TO_XUSB_AXIS_INVERTED(0x00) == 32767);
+	TEST_CHECK(DS4_TO_XUSB_AXIS_INVERTED(0x80) == -129);
+	TEST_CHECK(DS4_TO_XUSB_AXIS_INVERTED(0xFF) == -32768);
+}
+
+//
+// DS4 -> XUSB -> DS4, see the round trip notes of DS4_TO_XUSB_REPORT_FIELDS
+//
+VIGEM_TEST("util/ds4_to_xusb/round_trip/axes", util_ds4_to_xusb_round_trip_axes)
+{
+	for (ULONG value = 0; value <= 0xFF; value++)
+	{
+		DS4_REPORT report;
+		DS4_REPORT_INIT(&report);
+		report.bThumbLX = report.bThumbLY = report.bThumbRX = report.bThumbRY = static_cast<BYTE>(value);
+
+		XUSB_REPORT xusb;
+		DS4_TO_XUSB_REPORT(&report, &xusb);
+
+		DS4_REPORT back;
+		XUSB_TO_DS4_REPORT_FAST(&xusb, &back);
+
+		// X is exact, 0x80 -> 0x80 and 0x00 -> 0x00 included
+		TEST_CHECK(back.bThumbLX == value);
+		TEST_CHECK(back.bThumbRX == value);
+
+		// Y comes back one step down (RY) or two (LY, its extra XUSB_TO_DS4 bias)
+		TEST_CHECK(back.bThumbRY == (value >= 0xFE ? 0xFF : value + 1));
+		TEST_CHECK(back.bThumbLY == (value >= 0xFD ? 0xFF : value + 2));
+	}
+}
+
+//
+// XUSB -> DS4 -> XUSB on the X axes rounds down to the biased multiple of 257
+//
+VIGEM_TEST("util/ds4_to_xusb/round_trip/xusb", util_ds4_to_xusb_round_trip_xusb)
+{
+	for (LONG value = -32768; value <= 32767; value++)
+	{
+		XUSB_REPORT report;
+		XUSB_REPORT_INIT(&report);
+		report.sThumbLX = report.sThumbRX = static_cast<SHORT>(value);
+
+		DS4_REPORT ds4;
+		XUSB_TO_DS4_REPORT_FAST(&report, &ds4);
+
+		XUSB_REPORT back;
+		DS4_TO_XUSB_REPORT(&ds4, &back);
+
+		const LONG expected = (value + 32768) / 257 * 257 - 32768;
+		TEST_CHECK(back.sThumbLX == expected);
+		TEST_CHECK(back.sThumbRX == expected);
+	}
+}
+
+VIGEM_TEST("util/ds4_to_xusb/round_trip/buttons", util_ds4_to_xusb_round_trip_buttons)
+{
+	for (USHORT hat = DS4_BUTTON_DPAD_NORTH; hat <= DS4_BUTTON_DPAD_NONE; hat++)
+	{
+		for (ULONG buttons = 0; buttons < 0x1000; buttons++)
+		{
+			DS4_REPORT report;
+			DS4_REPORT_INIT(&report);
+
+			// the digital trigger bits are re-derived from the analog values on the way back
+			report.wButtons = static_cast<USHORT>(((buttons << 4) | hat) & ~(DS4_BUTTON_TRIGGER_LEFT | DS4_BUTTON_TRIGGER_RIGHT));
+			report.bSpecial = static_cast<BYTE>(buttons & DS4_SPECIAL_BUTTON_PS);
+
+			XUSB_REPORT xusb;
+			DS4_TO_XUSB_REPORT(&report, &xusb);
+
+			DS4_REPORT back;
+			XUSB_TO_DS4_REPORT_FAST(&xusb, &back);
+
+			TEST_CHECK(back.wButtons == report.wButtons);
+			TEST_CHECK(back.bSpecial == report.bSpecial);
+		}
+	}
+}
+
+//
+// Evaluates the remapping rules bit by bit, the documented semantics of
+// VIGEM_BUTTON_REMAP_TABLE_BUILD
+//
+static USHORT vigem_test_remap_reference(
+	const VIGEM_BUTTON_MAPPING* Mappings,
+	SIZE_T Count,
+	USHORT Buttons,
+	BOOLEAN PreserveDpad
+)
+{
+	USHORT result = PreserveDpad ? static_cast<USHORT>(Buttons & 0xF) : 0;
+
+	for (int bit = (PreserveDpad ? 4 : 0); bit < 16; bit++)
+	{
+		if (!(Buttons & (1 << bit)))
+			continue;
+
+		USHORT image = static_cast<USHORT>(1 << bit);
+
+		// the last rule naming the button wins
+		for (SIZE_T i = 0; i < Count; i++)
+		{
+			if (Mappings[i].From & (1 << bit))
+				image = static_cast<USHORT>(Mappings[i].To & (PreserveDpad ? 0xFFF0 : 0xFFFF));
+		}
+
+		result |= image;
+	}
+
+	return result;
+}
+
+static const VIGEM_BUTTON_MAPPING g_RemapRules[] =
+{
+	{ XUSB_GAMEPAD_A, XUSB_GAMEPAD_B },
+	{ XUSB_GAMEPAD_B, XUSB_GAMEPAD_A },
+	{ XUSB_GAMEPAD_X, 0 },
+	{ XUSB_GAMEPAD_Y, XUSB_GAMEPAD_LEFT_SHOULDER | XUSB_GAMEPAD_RIGHT_SHOULDER },
+	{ XUSB_GAMEPAD_DPAD_UP | XUSB_GAMEPAD_DPAD_DOWN, XUSB_GAMEPAD_GUIDE },
+	{ XUSB_GAMEPAD_A, XUSB_GAMEPAD_START },
+};
+
+//
+// Built at compile time, must equal the table built at runtime
+//
+static constexpr VIGEM_BUTTON_REMAP_TABLE g_RemapTable = VIGEM_XUSB_BUTTON_REMAP_TABLE(g_RemapRules);
+
+VIGEM_TEST("util/remap/table", util_remap_table)
+{
+	const SIZE_T count = sizeof(g_RemapRules) / sizeof(g_RemapRules[0]);
+	const VIGEM_BUTTON_REMAP_TABLE xusb = VIGEM_BUTTON_REMAP_TABLE_BUILD(g_RemapRules, count, FALSE);
+	const VIGEM_BUTTON_REMAP_TABLE ds4 = VIGEM_BUTTON_REMAP_TABLE_BUILD(g_RemapRules, count, TRUE);
+
+	TEST_CHECK(memcmp(&xusb, &g_RemapTable, sizeof(VIGEM_BUTTON_REMAP_TABLE)) == 0);
+
+	for (ULONG mask = 0; mask <= 0xFFFF; mask++)
+	{
+		const USHORT buttons = static_cast<USHORT>(mask);
+
+		TEST_CHECK(VIGEM_BUTTON_REMAP(xusb, buttons) == vigem_test_remap_reference(g_RemapRules, count, buttons, FALSE));
+		TEST_CHECK(VIGEM_BUTTON_REMAP(ds4, buttons) == vigem_test_remap_reference(g_RemapRules, count, buttons, TRUE));
+	}
+}
+
+VIGEM_TEST("util/remap/batch", util_remap_batch)
+{
+	std::vector<USHORT> buttons(0x10000 + 5);
+	std::vector<XUSB_REPORT> reports(buttons.size());
+
+	for (size_t i = 0; i < buttons.size(); i++)
+	{
+		buttons[i] = static_cast<USHORT>(i);
+		XUSB_REPORT_INIT(&reports[i]);
+		reports[i].wButtons = static_cast<USHORT>(i);
+		reports[i].sThumbLX = static_cast<SHORT>(i);
+	}
+
+	VIGEM_BUTTON_REMAP_BATCH(g_RemapTable, buttons.data(), buttons.size());
+	XUSB_REPORT_REMAP_BATCH(g_RemapTable, reports.data(), reports.size());
+
+	for (size_t i = 0; i < buttons.size(); i++)
+	{
+		const USHORT expected = VIGEM_BUTTON_REMAP(g_RemapTable, static_cast<USHORT>(i));
+
+		TEST_CHECK(buttons[i] == expected);
+		TEST_CHECK(reports[i].wButtons == expected);
+		// only the buttons are touched
+		TEST_CHECK(reports[i].sThumbLX == static_cast<SHORT>(i));
+	}
+}
+
+#if defined(VIGEM_UTIL_SSSE3)
+VIGEM_TEST("util/remap/ssse3", util_remap_ssse3)
+{
+	// passes trivially on CPUs without SSSE3, the batch test covers their path
+	if (!(VIGEM_UTIL_CPU_FEATURES() & VIGEM_UTIL_CPU_SSSE3))
+		return;
+
+	std::vector<USHORT> buttons(0x10000 + 5);
+
+	for (size_t i = 0; i < buttons.size(); i++)
+		buttons[i] = static_cast<USHORT>(i);
+
+	TEST_CHECK(VIGEM_BUTTON_REMAP_BATCH_SSSE3(g_RemapTable, buttons.data(), buttons.size()) == 0x10000);
+
+	for (size_t i = 0; i < buttons.size(); i++)
+	{
+		const USHORT expected = (i < 0x10000)
+			? VIGEM_BUTTON_REMAP(g_RemapTable, static_cast<USHORT>(i))
+			: static_cast<USHORT>(i);
+
+		TEST_CHECK(buttons[i] == expected);
+	}
+}
+#endif
+
+static ULONG vigem_test_touch_encode(USHORT X, USHORT Y, BYTE TrackingNum, BOOLEAN IsDown)
+{
+	DS4_TOUCH_POINT point = {};
+	point.X = X;
+	point.Y = Y;
+	point.TrackingNum = TrackingNum;
+	point.IsDown = IsDown;
+
+	return DS4_TOUCH_POINT_ENCODE(&point);
+}
+
+VIGEM_TEST("util/touch/point", util_touch_point)
+{
+	// bIsUpTrackingNum, then X (12 bit) and Y (12 bit) little-endian
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 0, TRUE) == 0x00000000);
+	TEST_CHECK(vigem_test_touch_encode(1919, 942, 5, TRUE) == 0x3AE77F05);
+
+	DS4_TOUCH_POINT point;
+	DS4_TOUCH_POINT_DECODE(0x3AE77F05, &point);
+	TEST_CHECK(point.X == 1919);
+	TEST_CHECK(point.Y == 942);
+	TEST_CHECK(point.TrackingNum == 5);
+	TEST_CHECK(point.IsDown == TRUE);
+
+	DS4_TOUCH_POINT_DECODE(0x00000000, &point);
+	TEST_CHECK(point.X == 0);
+	TEST_CHECK(point.Y == 0);
+	TEST_CHECK(point.TrackingNum == 0);
+	TEST_CHECK(point.IsDown == TRUE);
+}
+
+VIGEM_TEST("util/touch/clamp", util_touch_clamp)
+{
+	const ULONG edge = vigem_test_touch_encode(DS4_TOUCHPAD_WIDTH - 1, DS4_TOUCHPAD_HEIGHT - 1, 0, TRUE);
+
+	TEST_CHECK(vigem_test_touch_encode(DS4_TOUCHPAD_WIDTH, DS4_TOUCHPAD_HEIGHT, 0, TRUE) == edge);
+	TEST_CHECK(vigem_test_touch_encode(0xFFFF, 0xFFFF, 0, TRUE) == edge);
+	TEST_CHECK(vigem_test_touch_encode(5000, 0, 0, TRUE) == vigem_test_touch_encode(1919, 0, 0, TRUE));
+	TEST_CHECK(vigem_test_touch_encode(0, 5000, 0, TRUE) == vigem_test_touch_encode(0, 942, 0, TRUE));
+}
+
+VIGEM_TEST("util/touch/tracking_wrap", util_touch_tracking_wrap)
+{
+	// tracking numbers are 7 bit, bit 7 must never leak into the up flag
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 127, TRUE) == 0x7F);
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 128, TRUE) == 0x00);
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 200, TRUE) == 72);
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 255, FALSE) == 0xFF);
+}
+
+VIGEM_TEST("util/touch/active_low", util_touch_active_low)
+{
+	// the flag is set while the finger is up, any non-zero IsDown counts as down
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 3, TRUE) == 0x03);
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 3, 2) == 0x03);
+	TEST_CHECK(vigem_test_touch_encode(0, 0, 3, FALSE) == 0x83);
+
+	DS4_TOUCH_POINT point;
+	DS4_TOUCH_POINT_DECODE(0x83, &point);
+	TEST_CHECK(point.IsDown == FALSE);
+	TEST_CHECK(point.TrackingNum == 3);
+}
+
+VIGEM_TEST("util/touch/batch", util_touch_batch)
+{
+	const SIZE_T count = 4099;
+	std::vector<DS4_TOUCH_POINT> points(count * 2);
+	std::vector<DS4_TOUCH> touches(count);
+	std::vector<DS4_TOUCH> reference(count);
+	ULONG seed = 1;
+
+	for (auto& point : points)
+	{
+		seed = seed * 1103515245 + 12345;
+		point.X = static_cast<USHORT>(seed >> 4);
+		point.Y = static_cast<USHORT>((seed >> 16) & 0x7FF);
+		point.TrackingNum = static_cast<BYTE>(seed >> 8);
+		point.IsDown = static_cast<BOOLEAN>((seed >> 24) % 3);
+		// ignored by the encoders
+		point.Reserved = static_cast<USHORT>(seed);
+	}
+
+	// packet counters wrap around
+	for (SIZE_T i = 0; i < count; i++)
+		DS4_TOUCH_SET(&reference[i], static_cast<BYTE>(250 + i), &points[i * 2], &points[i * 2 + 1]);
+
+	memset(touches.data(), 0xCD, count * sizeof(DS4_TOUCH));
+	DS4_TOUCH_ENCODE_BATCH(points.data(), touches.data(), count, 250);
+	TEST_CHECK(memcmp(touches.data(), reference.data(), count * sizeof(DS4_TOUCH)) == 0);
+
+	std::vector<DS4_TOUCH_POINT> decoded(count * 2);
+	DS4_TOUCH_DECODE_BATCH(touches.data(), decoded.data(), count);
+
+	for (SIZE_T i = 0; i < count; i++)
+	{
+		DS4_TOUCH_POINT first;
+		DS4_TOUCH_POINT second;
+		DS4_TOUCH_GET(&reference[i], &first, &second);
+
+		TEST_CHECK(memcmp(&decoded[i * 2], &first, sizeof(DS4_TOUCH_POINT)) == 0);
+		TEST_CHECK(memcmp(&decoded[i * 2 + 1], &second, sizeof(DS4_TOUCH_POINT)) == 0);
+	}
+
+	// decoding arbitrary packets, Y beyond the pad included
+	for (SIZE_T i = 0; i < count; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		memcpy(&touches[i].bIsUpTrackingNum1, &seed, sizeof(ULONG));
+		seed = seed * 1103515245 + 12345;
+		memcpy(&touches[i].bIsUpTrackingNum2, &seed, sizeof(ULONG));
+	}
+
+	memset(decoded.data(), 0xCD, decoded.size() * sizeof(DS4_TOUCH_POINT));
+	DS4_TOUCH_DECODE_BATCH(touches.data(), decoded.data(), count);
+
+	for (SIZE_T i = 0; i < count; i++)
+	{
+		DS4_TOUCH_POINT first;
+		DS4_TOUCH_POINT second;
+		DS4_TOUCH_GET(&touches[i], &first, &second);
+
+		TEST_CHECK(memcmp(&decoded[i * 2], &first, sizeof(DS4_TOUCH_POINT)) == 0);
+		TEST_CHECK(memcmp(&decoded[i * 2 + 1], &second, sizeof(DS4_TOUCH_POINT)) == 0);
+	}
+}
@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+//
+// Unit tests of the client library, run against the simulated bus so no
+// driver is required. Registered with CTest one group at a time:
+//
+//   ViGEmTests [--filter <substring>]
+//
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// STL
+//
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//
+// Tests
+//
+#include "Tests.h"
+
+
+typedef struct _VIGEM_TEST_ENTRY
+{
+	const char* Name;
+	PFN_VIGEM_TEST Routine;
+} VIGEM_TEST_ENTRY;
+
+//
+// Function local so registrations from other translation units find it constructed
+//
+static std::vector<VIGEM_TEST_ENTRY>& vigem_test_registry()
+{
+	static std::vector<VIGEM_TEST_ENTRY> registry;
+	return registry;
+}
+
+static ULONG g_Failures = 0;
+
+VIGEM_TEST_REGISTRATION::VIGEM_TEST_REGISTRATION(const char* Name, PFN_VIGEM_TEST Routine)
+{
+	vigem_test_registry().push_back({ Name, Routine });
+}
+
+void vigem_test_fail(const char* File, int Line, const char* Condition)
+{
+	fprintf(stderr, "%s(%d): check failed: %s\n", File, Line, Condition);
+	g_Failures++;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* filter = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			filter = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: %s [--filter <substring>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	ULONG run = 0;
+	ULONG failed = 0;
+
+	for (const auto& entry : vigem_test_registry())
+	{
+		if (filter && !strstr(entry.Name, filter))
+			continue;
+
+		const ULONG failuresBefore = g_Failures;
+
+		entry.Routine();
+		run++;
+
+		if (g_Failures != failuresBefore)
+		{
+			printf("FAIL %s\n", entry.Name);
+			failed++;
+		}
+		else
+			printf("ok   %s\n", entry.Name);
+	}
+
+	printf("%lu tests, %lu failed\n", static_cast<unsigned long>(run), static_cast<unsigned long>(failed));
+
+	// a filter matching nothing is a misconfigured test run
+	return (failed != 0 || run == 0) ? 1 : 0;
+}
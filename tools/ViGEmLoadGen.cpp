@@ -0,0 +1,726 @@
+/*
+MIT License
+
+Copyright (c) 2017-2019 Nefarius Software Solutions e.U. and Contributors
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+//
+// Load generator: plugs a mix of targets, feeds every one of them at a fixed
+// rate from one or more threads and reports sustained throughput, CPU time
+// per report and submit latency percentiles as JSON.
+//
+//   ViGEmLoadGen [--sim] [--x360 <n>] [--ds4 <n>] [--ds4-ex <n>]
+//                [--rate <hz>] [--duration <seconds>] [--threads <n>]
+//                [--pattern static|sweep|random] [--consume-output]
+//                [--notifications] [--output-rate <hz>] [--out <file>]
+//
+// --sim runs against the simulated bus instead of the driver; there, host
+// output for --consume-output and --notifications is injected at
+// --output-rate per pad.
+//
+
+
+//
+// WinAPI
+//
+#include <Windows.h>
+
+//
+// ViGEm
+//
+#include "ViGEm/Client.h"
+#include "ViGEm/Sim.h"
+#include "ViGEm/Stats.h"
+#include "ViGEm/Util.h"
+
+//
+// STL
+//
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+#if defined(_MSC_VER)
+// DS4 notifications are only available through the deprecated callback API
+#pragma warning(disable: 4996)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION   0x00000002
+#endif
+
+
+typedef enum _LOADGEN_PATTERN
+{
+	//
+	// Same neutral report over and over
+	//
+	LoadGenPatternStatic,
+	//
+	// Sticks circling once per second, triggers ramping, buttons cycling
+	//
+	LoadGenPatternSweep,
+	//
+	// Pseudo-random state every report
+	//
+	LoadGenPatternRandom
+} LOADGEN_PATTERN;
+
+typedef struct _LOADGEN_CONFIG
+{
+	BOOLEAN Simulated;
+	ULONG X360Count;
+	ULONG Ds4Count;
+	ULONG Ds4ExCount;
+	DOUBLE Rate;
+	DOUBLE Duration;
+	ULONG Threads;
+	LOADGEN_PATTERN Pattern;
+	BOOLEAN ConsumeOutput;
+	BOOLEAN Notifications;
+	DOUBLE OutputRate;
+	const char* OutPath;
+} LOADGEN_CONFIG;
+
+typedef enum _LOADGEN_PAD_KIND
+{
+	LoadGenPadX360,
+	LoadGenPadDs4,
+	LoadGenPadDs4Ex
+} LOADGEN_PAD_KIND;
+
+typedef struct _LOADGEN_PAD
+{
+	PVIGEM_TARGET Target;
+	LOADGEN_PAD_KIND Kind;
+	ULONG Seed;
+} LOADGEN_PAD;
+
+//
+// Counters of one feeding thread, padded so threads don't share a line
+//
+typedef struct alignas(64) _LOADGEN_WORKER
+{
+	HANDLE hThread;
+	ULONG Index;
+	ULONGLONG Ticks;
+	ULONGLONG MissedTicks;
+	ULONGLONG Submitted;
+	ULONGLONG Failed;
+} LOADGEN_WORKER;
+
+static LOADGEN_CONFIG g_Config;
+static PVIGEM_CLIENT g_Client;
+static std::vector<LOADGEN_PAD> g_Pads;
+static LONGLONG g_Frequency;
+static LONGLONG g_StartTicks;
+static LONGLONG g_StopTicks;
+static volatile LONG g_Stop;
+static volatile LONGLONG g_Notifications;
+static volatile LONGLONG g_OutputReports;
+
+static FORCEINLINE LONGLONG loadgen_now()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+//
+// Sleeps on a high resolution timer until shortly before the deadline and
+// spins the rest of the way
+//
+static void loadgen_wait_until(HANDLE Timer, LONGLONG Deadline)
+{
+	const LONGLONG spinTicks = g_Frequency / 10000;
+	const LONGLONG sleepTicks = Deadline - loadgen_now() - spinTicks;
+
+	if (sleepTicks > 0)
+	{
+		LARGE_INTEGER dueTime;
+		// relative due time in 100ns units
+		dueTime.QuadPart = -static_cast<LONGLONG>(static_cast<DOUBLE>(sleepTicks) * 10000000.0 / g_Frequency);
+
+		if (Timer && SetWaitableTimer(Timer, &dueTime, 0, nullptr, nullptr, FALSE))
+			WaitForSingleObject(Timer, INFINITE);
+		else
+			Sleep(static_cast<DWORD>(sleepTicks * 1000 / g_Frequency));
+	}
+
+	while (loadgen_now() < Deadline)
+		YieldProcessor();
+}
+
+static HANDLE loadgen_create_timer()
+{
+	HANDLE timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	// high resolution timers need Windows 10 1803
+	if (!timer)
+		timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+
+	return timer;
+}
+
+static FORCEINLINE ULONG loadgen_random(ULONG& Seed)
+{
+	// xorshift32
+	Seed ^= Seed << 13;
+	Seed ^= Seed >> 17;
+	Seed ^= Seed << 5;
+	return Seed;
+}
+
+//
+// Builds the state of a pad for a tick according to the pattern
+//
+static void loadgen_build_report(LOADGEN_PAD& Pad, ULONG PadIndex, ULONGLONG Tick, XUSB_REPORT& Report)
+{
+	switch (g_Config.Pattern)
+	{
+	case LoadGenPatternSweep:
+	{
+		const DOUBLE angle = 6.283185307179586 * (static_cast<DOUBLE>(Tick) / g_Config.Rate + PadIndex / 16.0);
+		const ULONG ramp = static_cast<ULONG>(Tick % 512);
+
+		Report.sThumbLX = static_cast<SHORT>(32767.0 * cos(angle));
+		Report.sThumbLY = static_cast<SHORT>(32767.0 * sin(angle));
+		Report.sThumbRX = static_cast<SHORT>(-Report.sThumbLX);
+		Report.sThumbRY = static_cast<SHORT>(-Report.sThumbLY);
+		Report.bLeftTrigger = static_cast<BYTE>(ramp < 256 ? ramp : 511 - ramp);
+		Report.bRightTrigger = static_cast<BYTE>(255 - Report.bLeftTrigger);
+		Report.wButtons = static_cast<USHORT>(1 << ((Tick / 16) % 16));
+		break;
+	}
+	case LoadGenPatternRandom:
+	{
+		const ULONG a = loadgen_random(Pad.Seed);
+		const ULONG b = loadgen_random(Pad.Seed);
+		const ULONG c = loadgen_random(Pad.Seed);
+
+		Report.sThumbLX = static_cast<SHORT>(a);
+		Report.sThumbLY = static_cast<SHORT>(a >> 16);
+		Report.sThumbRX = static_cast<SHORT>(b);
+		Report.sThumbRY = static_cast<SHORT>(b >> 16);
+		Report.bLeftTrigger = static_cast<BYTE>(c);
+		Report.bRightTrigger = static_cast<BYTE>(c >> 8);
+		Report.wButtons = static_cast<USHORT>(c >> 16);
+		break;
+	}
+	default:
+		RtlZeroMemory(&Report, sizeof(XUSB_REPORT));
+		break;
+	}
+}
+
+static VIGEM_ERROR loadgen_submit(LOADGEN_PAD& Pad, const XUSB_REPORT& State)
+{
+	switch (Pad.Kind)
+	{
+	case LoadGenPadX360:
+		return vigem_target_x360_update(g_Client, Pad.Target, State);
+	case LoadGenPadDs4:
+	{
+		DS4_REPORT report;
+		XUSB_TO_DS4_REPORT_FAST(&State, &report);
+		return vigem_target_ds4_update(g_Client, Pad.Target, report);
+	}
+	default:
+	{
+		DS4_REPORT report;
+		XUSB_TO_DS4_REPORT_FAST(&State, &report);
+
+		DS4_REPORT_EX reportEx = {};
+		reportEx.Report.bThumbLX = report.bThumbLX;
+		reportEx.Report.bThumbLY = report.bThumbLY;
+		reportEx.Report.bThumbRX = report.bThumbRX;
+		reportEx.Report.bThumbRY = report.bThumbRY;
+		reportEx.Report.wButtons = report.wButtons;
+		reportEx.Report.bSpecial = report.bSpecial;
+		reportEx.Report.bTriggerL = report.bTriggerL;
+		reportEx.Report.bTriggerR = report.bTriggerR;
+		return vigem_target_ds4_update_ex(g_Client, Pad.Target, reportEx);
+	}
+	}
+}
+
+//
+// Feeds every pad whose index maps to this worker once per tick
+//
+static DWORD WINAPI loadgen_worker(LPVOID Parameter)
+{
+	LOADGEN_WORKER& worker = *static_cast<LOADGEN_WORKER*>(Parameter);
+	const HANDLE timer = loadgen_create_timer();
+	const LONGLONG period = static_cast<LONGLONG>(g_Frequency / g_Config.Rate);
+	LONGLONG deadline = g_StartTicks;
+	XUSB_REPORT state = {};
+
+	while (!g_Stop && deadline < g_StopTicks)
+	{
+		for (ULONG index = worker.Index; index < g_Pads.size(); index += g_Config.Threads)
+		{
+			loadgen_build_report(g_Pads[index], index, worker.Ticks, state);
+
+			if (loadgen_submit(g_Pads[index], state) == VIGEM_ERROR_NONE)
+				worker.Submitted++;
+			else
+				worker.Failed++;
+		}
+
+		worker.Ticks++;
+		deadline += period;
+
+		//
+		// Ticks that couldn't be served in time are dropped rather than
+		// caught up on, like a game loop would
+		//
+		const LONGLONG now = loadgen_now();
+
+		while (deadline + period <= now)
+		{
+			deadline += period;
+			worker.MissedTicks++;
+		}
+
+		loadgen_wait_until(timer, deadline);
+	}
+
+	if (timer)
+		CloseHandle(timer);
+
+	return 0;
+}
+
+//
+// Drains pending DS4 output reports of all DS4 pads
+//
+static DWORD WINAPI loadgen_output_consumer(LPVOID Parameter)
+{
+	UNREFERENCED_PARAMETER(Parameter);
+
+	DS4_OUTPUT_BUFFER buffer;
+
+	while (!g_Stop)
+	{
+		BOOLEAN received = FALSE;
+
+		for (auto& pad : g_Pads)
+		{
+			if (pad.Kind == LoadGenPadX360)
+				continue;
+
+			if (vigem_target_ds4_await_output_report_timeout(g_Client, pad.Target, 0, &buffer) == VIGEM_ERROR_NONE)
+			{
+				InterlockedIncrement64(&g_OutputReports);
+				received = TRUE;
+			}
+		}
+
+		if (!received)
+			Sleep(1);
+	}
+
+	return 0;
+}
+
+//
+// Plays the host: sends rumble/LED state to every pad of the simulated bus
+//
+static DWORD WINAPI loadgen_output_injector(LPVOID Parameter)
+{
+	UNREFERENCED_PARAMETER(Parameter);
+
+	const HANDLE timer = loadgen_create_timer();
+	const LONGLONG period = static_cast<LONGLONG>(g_Frequency / g_Config.OutputRate);
+	LONGLONG deadline = g_StartTicks;
+	DS4_OUTPUT_BUFFER output = {};
+	UCHAR value = 0;
+
+	output.Buffer[0] = 0x05;
+
+	while (!g_Stop && deadline < g_StopTicks)
+	{
+		value++;
+
+		for (auto& pad : g_Pads)
+		{
+			if (pad.Kind == LoadGenPadX360)
+			{
+				vigem_sim_x360_notify(g_Client, pad.Target, value, value, 0);
+			}
+			else
+			{
+				output.Buffer[4] = value;
+				output.Buffer[5] = value;
+				vigem_sim_ds4_output(g_Client, pad.Target, &output);
+			}
+		}
+
+		deadline += period;
+		loadgen_wait_until(timer, deadline);
+	}
+
+	if (timer)
+		CloseHandle(timer);
+
+	return 0;
+}
+
+static VOID CALLBACK loadgen_x360_notification(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	UCHAR LargeMotor,
+	UCHAR SmallMotor,
+	UCHAR LedNumber,
+	LPVOID UserData
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(LargeMotor);
+	UNREFERENCED_PARAMETER(SmallMotor);
+	UNREFERENCED_PARAMETER(LedNumber);
+	UNREFERENCED_PARAMETER(UserData);
+
+	InterlockedIncrement64(&g_Notifications);
+}
+
+static VOID CALLBACK loadgen_ds4_notification(
+	PVIGEM_CLIENT Client,
+	PVIGEM_TARGET Target,
+	UCHAR LargeMotor,
+	UCHAR SmallMotor,
+	DS4_LIGHTBAR_COLOR LightbarColor,
+	LPVOID UserData
+)
+{
+	UNREFERENCED_PARAMETER(Client);
+	UNREFERENCED_PARAMETER(Target);
+	UNREFERENCED_PARAMETER(LargeMotor);
+	UNREFERENCED_PARAMETER(SmallMotor);
+	UNREFERENCED_PARAMETER(LightbarColor);
+	UNREFERENCED_PARAMETER(UserData);
+
+	InterlockedIncrement64(&g_Notifications);
+}
+
+static ULONGLONG loadgen_cpu_time_100ns()
+{
+	FILETIME creation, exit, kernel, user;
+
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+		return 0;
+
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+
+	return k.QuadPart + u.QuadPart;
+}
+
+static void loadgen_write_latency(FILE* Out, const char* Name, const VIGEM_STATS_ENTRY& Entry, bool Last)
+{
+	fprintf(Out, "    \"%s\": { \"calls\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu }%s\n",
+		Name,
+		Entry.Calls,
+		Entry.Calls ? static_cast<DOUBLE>(Entry.TotalNanoseconds) / Entry.Calls : 0.0,
+		VIGEM_STATS_PERCENTILE(&Entry, 0.5),
+		VIGEM_STATS_PERCENTILE(&Entry, 0.99),
+		VIGEM_STATS_PERCENTILE(&Entry, 0.999),
+		Entry.MaxNanoseconds,
+		Last ? "" : ","
+	);
+}
+
+static bool loadgen_parse(int argc, char* argv[])
+{
+	g_Config.Rate = 250.0;
+	g_Config.Duration = 10.0;
+	g_Config.Threads = 1;
+	g_Config.Pattern = LoadGenPatternSweep;
+	g_Config.OutputRate = 50.0;
+
+	for (int index = 1; index < argc; index++)
+	{
+		const char* arg = argv[index];
+		const char* value = (index + 1 < argc) ? argv[index + 1] : nullptr;
+
+		if (strcmp(arg, "--sim") == 0)
+			g_Config.Simulated = TRUE;
+		else if (strcmp(arg, "--consume-output") == 0)
+			g_Config.ConsumeOutput = TRUE;
+		else if (strcmp(arg, "--notifications") == 0)
+			g_Config.Notifications = TRUE;
+		else if (!value)
+			return false;
+		else if (strcmp(arg, "--x360") == 0)
+			g_Config.X360Count = strtoul(argv[++index], nullptr, 10);
+		else if (strcmp(arg, "--ds4") == 0)
+			g_Config.Ds4Count = strtoul(argv[++index], nullptr, 10);
+		else if (strcmp(arg, "--ds4-ex") == 0)
+			g_Config.Ds4ExCount = strtoul(argv[++index], nullptr, 10);
+		else if (strcmp(arg, "--rate") == 0)
+			g_Config.Rate = atof(argv[++index]);
+		else if (strcmp(arg, "--duration") == 0)
+			g_Config.Duration = atof(argv[++index]);
+		else if (strcmp(arg, "--threads") == 0)
+			g_Config.Threads = strtoul(argv[++index], nullptr, 10);
+		else if (strcmp(arg, "--output-rate") == 0)
+			g_Config.OutputRate = atof(argv[++index]);
+		else if (strcmp(arg, "--out") == 0)
+			g_Config.OutPath = argv[++index];
+		else if (strcmp(arg, "--pattern") == 0)
+		{
+			index++;
+
+			if (strcmp(value, "static") == 0)
+				g_Config.Pattern = LoadGenPatternStatic;
+			else if (strcmp(value, "sweep") == 0)
+				g_Config.Pattern = LoadGenPatternSweep;
+			else if (strcmp(value, "random") == 0)
+				g_Config.Pattern = LoadGenPatternRandom;
+			else
+				return false;
+		}
+		else
+			return false;
+	}
+
+	// four Xbox 360 pads unless told otherwise
+	if (g_Config.X360Count + g_Config.Ds4Count + g_Config.Ds4ExCount == 0)
+		g_Config.X360Count = 4;
+
+	return g_Config.Rate > 0.0
+		&& g_Config.Duration > 0.0
+		&& g_Config.Threads > 0
+		&& g_Config.OutputRate > 0.0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (!loadgen_parse(argc, argv))
+	{
+		fprintf(stderr,
+			"usage: %s [--sim] [--x360 <n>] [--ds4 <n>] [--ds4-ex <n>] [--rate <hz>]\n"
+			"       [--duration <seconds>] [--threads <n>] [--pattern static|sweep|random]\n"
+			"       [--consume-output] [--notifications] [--output-rate <hz>] [--out <file>]\n",
+			argv[0]
+		);
+		return 2;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	g_Frequency = frequency.QuadPart;
+
+	g_Client = vigem_alloc();
+
+	if (!g_Client)
+		return 1;
+
+	const VIGEM_ERROR connected = g_Config.Simulated ? vigem_connect_simulated(g_Client) : vigem_connect(g_Client);
+
+	if (connected != VIGEM_ERROR_NONE)
+	{
+		fprintf(stderr, "connecting to the bus failed: 0x%X\n", static_cast<unsigned>(connected));
+		vigem_free(g_Client);
+		return 1;
+	}
+
+	//
+	// Plug in all pads, types interleaved so every worker gets a mix
+	//
+	const ULONG total = g_Config.X360Count + g_Config.Ds4Count + g_Config.Ds4ExCount;
+	ULONG remaining[3] = { g_Config.X360Count, g_Config.Ds4Count, g_Config.Ds4ExCount };
+
+	for (ULONG index = 0, kind = 0; index < total; kind = (kind + 1) % 3)
+	{
+		if (!remaining[kind])
+			continue;
+
+		remaining[kind]--;
+
+		LOADGEN_PAD pad = {};
+		pad.Kind = static_cast<LOADGEN_PAD_KIND>(kind);
+		pad.Target = (pad.Kind == LoadGenPadX360) ? vigem_target_x360_alloc() : vigem_target_ds4_alloc();
+		pad.Seed = 0x9E3779B9u * (index + 1);
+
+		const VIGEM_ERROR added = vigem_target_add(g_Client, pad.Target);
+
+		if (added != VIGEM_ERROR_NONE)
+		{
+			fprintf(stderr, "adding target %lu failed: 0x%X\n", static_cast<unsigned long>(index), static_cast<unsigned>(added));
+			vigem_target_free(pad.Target);
+			break;
+		}
+
+		if (g_Config.Notifications)
+		{
+			if (pad.Kind == LoadGenPadX360)
+				vigem_target_x360_register_notification(g_Client, pad.Target, loadgen_x360_notification, nullptr);
+			else
+				vigem_target_ds4_register_notification(g_Client, pad.Target, loadgen_ds4_notification, nullptr);
+		}
+
+		g_Pads.push_back(pad);
+		index++;
+	}
+
+	vigem_stats_enable(g_Client, TRUE);
+
+	const ULONGLONG cpuStart = loadgen_cpu_time_100ns();
+	g_StartTicks = loadgen_now() + g_Frequency / 100;
+	g_StopTicks = g_StartTicks + static_cast<LONGLONG>(g_Config.Duration * g_Frequency);
+
+	std::vector<LOADGEN_WORKER> workers(g_Config.Threads);
+	std::vector<HANDLE> helpers;
+
+	for (ULONG index = 0; index < g_Config.Threads; index++)
+	{
+		workers[index] = LOADGEN_WORKER();
+		workers[index].Index = index;
+		workers[index].hThread = CreateThread(nullptr, 0, loadgen_worker, &workers[index], 0, nullptr);
+	}
+
+	if (g_Config.ConsumeOutput)
+		helpers.push_back(CreateThread(nullptr, 0, loadgen_output_consumer, nullptr, 0, nullptr));
+
+	if (g_Config.Simulated && (g_Config.ConsumeOutput || g_Config.Notifications))
+		helpers.push_back(CreateThread(nullptr, 0, loadgen_output_injector, nullptr, 0, nullptr));
+
+	for (auto& worker : workers)
+	{
+		if (worker.hThread)
+		{
+			WaitForSingleObject(worker.hThread, INFINITE);
+			CloseHandle(worker.hThread);
+		}
+	}
+
+	const LONGLONG stopped = loadgen_now();
+	const ULONGLONG cpuStop = loadgen_cpu_time_100ns();
+
+	InterlockedExchange(&g_Stop, 1);
+
+	for (const auto helper : helpers)
+	{
+		if (helper)
+		{
+			WaitForSingleObject(helper, INFINITE);
+			CloseHandle(helper);
+		}
+	}
+
+	VIGEM_STATS stats;
+	VIGEM_STATS_INIT(&stats);
+	vigem_get_stats(g_Client, &stats);
+
+	VIGEM_STATS_ENTRY all = {};
+	const VIGEM_STATS_FUNCTION updates[] = { VIGEM_STATS_X360_UPDATE, VIGEM_STATS_DS4_UPDATE, VIGEM_STATS_DS4_UPDATE_EX };
+
+	for (const auto function : updates)
+	{
+		const VIGEM_STATS_ENTRY& entry = stats.Functions[function];
+
+		all.Calls += entry.Calls;
+		all.TotalNanoseconds += entry.TotalNanoseconds;
+		all.MaxNanoseconds = (entry.MaxNanoseconds > all.MaxNanoseconds) ? entry.MaxNanoseconds : all.MaxNanoseconds;
+
+		for (ULONG bucket = 0; bucket < VIGEM_STATS_BUCKETS; bucket++)
+			all.Buckets[bucket] += entry.Buckets[bucket];
+	}
+
+	ULONGLONG ticks = 0, missed = 0, submitted = 0, failed = 0;
+
+	for (const auto& worker : workers)
+	{
+		ticks += worker.Ticks;
+		missed += worker.MissedTicks;
+		submitted += worker.Submitted;
+		failed += worker.Failed;
+	}
+
+	const DOUBLE elapsed = static_cast<DOUBLE>(stopped - g_StartTicks) / g_Frequency;
+
+	FILE* out = stdout;
+
+	if (g_Config.OutPath && fopen_s(&out, g_Config.OutPath, "w") != 0)
+	{
+		fprintf(stderr, "cannot open %s\n", g_Config.OutPath);
+		out = stdout;
+	}
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"transport\": \"%s\",\n", g_Config.Simulated ? "simulated" : "bus");
+	fprintf(out, "  \"pads\": { \"x360\": %lu, \"ds4\": %lu, \"ds4_ex\": %lu, \"plugged\": %lu },\n",
+		static_cast<unsigned long>(g_Config.X360Count),
+		static_cast<unsigned long>(g_Config.Ds4Count),
+		static_cast<unsigned long>(g_Config.Ds4ExCount),
+		static_cast<unsigned long>(g_Pads.size())
+	);
+	fprintf(out, "  \"rate_hz\": %.1f,\n", g_Config.Rate);
+	fprintf(out, "  \"threads\": %lu,\n", static_cast<unsigned long>(g_Config.Threads));
+	fprintf(out, "  \"elapsed_s\": %.3f,\n", elapsed);
+	fprintf(out, "  \"target_reports_per_sec\": %.1f,\n", g_Pads.size() * g_Config.Rate);
+	fprintf(out, "  \"reports_per_sec\": %.1f,\n", elapsed > 0.0 ? submitted / elapsed : 0.0);
+	fprintf(out, "  \"submitted\": %llu,\n", submitted);
+	fprintf(out, "  \"failed\": %llu,\n", failed);
+	fprintf(out, "  \"ticks\": %llu,\n", ticks);
+	fprintf(out, "  \"missed_ticks\": %llu,\n", missed);
+	fprintf(out, "  \"cpu_ns_per_report\": %.1f,\n", submitted ? (cpuStop - cpuStart) * 100.0 / submitted : 0.0);
+	fprintf(out, "  \"notifications\": %lld,\n", g_Notifications);
+	fprintf(out, "  \"output_reports\": %lld,\n", g_OutputReports);
+	fprintf(out, "  \"submit_latency\": {\n");
+	loadgen_write_latency(out, "all", all, false);
+	loadgen_write_latency(out, "x360", stats.Functions[VIGEM_STATS_X360_UPDATE], false);
+	loadgen_write_latency(out, "ds4", stats.Functions[VIGEM_STATS_DS4_UPDATE], false);
+	loadgen_write_latency(out, "ds4_ex", stats.Functions[VIGEM_STATS_DS4_UPDATE_EX], true);
+	fprintf(out, "  }\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+
+	for (auto& pad : g_Pads)
+	{
+		if (g_Config.Notifications)
+		{
+			if (pad.Kind == LoadGenPadX360)
+				vigem_target_x360_unregister_notification(pad.Target);
+			else
+				vigem_target_ds4_unregister_notification(pad.Target);
+		}
+
+		vigem_target_remove(g_Client, pad.Target);
+		vigem_target_free(pad.Target);
+	}
+
+	vigem_disconnect(g_Client);
+	vigem_free(g_Client);
+
+	return (failed == 0) ? 0 : 3;
+}
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""
+Dissects bus traffic captures written by vigem_capture_start.
+
+A capture is a pcapng file with one interface of link type 147 (USER0) whose
+packets start with a VIGEM_CAPTURE_PACKET header, see include/ViGEm/Capture.h.
+Only the standard library is used, so this runs wherever Python 3 does.
+
+    vigem_capture.py capture.pcapng
+    vigem_capture.py --serial 1 --ioctl xusb_submit capture.pcapng
+    vigem_capture.py --summary capture.pcapng
+"""
+
+import argparse
+import os
+import struct
+import sys
+from collections import Counter
+
+LINKTYPE_VIGEM = 147
+
+BLOCK_SECTION_HEADER = 0x0A0D0D0A
+BLOCK_INTERFACE = 0x00000001
+BLOCK_INTERFACE_STATISTICS = 0x00000005
+BLOCK_ENHANCED_PACKET = 0x00000006
+
+OPT_IF_TSRESOL = 9
+OPT_ISB_IFDROP = 5
+
+PACKET_HEADER = struct.Struct("<BBHIIIII")
+
+EVENTS = {0: "request", 1: "complete", 2: "cancel"}
+
+# function index of the control code, bits 2..13
+IOCTLS = {
+    0x801: "plugin",
+    0x802: "unplug",
+    0x803: "check_version",
+    0x804: "wait_ready",
+    0xA01: "xusb_notification",
+    0xA02: "xusb_submit",
+    0xA03: "ds4_submit",
+    0xA04: "ds4_notification",
+    0xA07: "xusb_user_index",
+    0xA08: "ds4_await_output",
+}
+
+TARGET_TYPES = {0: "X360", 2: "DS4"}
+
+WIN32_ERRORS = {
+    0: "SUCCESS",
+    2: "FILE_NOT_FOUND",
+    6: "INVALID_HANDLE",
+    21: "NOT_READY",
+    31: "GEN_FAILURE",
+    50: "NOT_SUPPORTED",
+    87: "INVALID_PARAMETER",
+    122: "INSUFFICIENT_BUFFER",
+    183: "ALREADY_EXISTS",
+    995: "OPERATION_ABORTED",
+    996: "IO_INCOMPLETE",
+    997: "IO_PENDING",
+    1167: "DEVICE_NOT_CONNECTED",
+    1460: "TIMEOUT",
+}
+
+# sizes of the Size/SerialNo headed structures of BusShared.h
+DS4_SUBMIT_REPORT_SIZE = 17
+DS4_SUBMIT_REPORT_EX_SIZE = 71
+
+
+class CaptureError(Exception):
+    pass
+
+
+def ioctl_name(code):
+    return IOCTLS.get((code >> 2) & 0xFFF, "0x%08X" % code)
+
+
+def status_name(status):
+    return WIN32_ERRORS.get(status, str(status))
+
+
+def read_pcapng(stream):
+    """Yields ("packet", timestamp_ns, data) and ("drops", count) tuples."""
+    endian = "<"
+    interfaces = []
+
+    while True:
+        head = stream.read(8)
+        if not head:
+            return
+        if len(head) < 8:
+            raise CaptureError("truncated block header")
+
+        block_type = struct.unpack("<I", head[:4])[0]
+        if block_type == BLOCK_SECTION_HEADER:
+            magic = stream.read(4)
+            endian = "<" if magic == b"\x4d\x3c\x2b\x1a" else ">"
+            length = struct.unpack(endian + "I", head[4:])[0]
+            body = magic + stream.read(length - 12)
+            interfaces = []
+        else:
+            block_type, length = struct.unpack(endian + "II", head)
+            body = stream.read(length - 8)
+            block_type &= 0xFFFFFFFF
+
+        if len(body) < length - 8:
+            raise CaptureError("truncated block")
+
+        body = body[:-4]
+
+        if block_type == BLOCK_INTERFACE:
+            linktype = struct.unpack_from(endian + "H", body, 0)[0]
+            resolution = 6
+            for code, value in read_options(body[8:], endian):
+                if code == OPT_IF_TSRESOL:
+                    resolution = value[0]
+            if resolution & 0x80:
+                raise CaptureError("binary timestamp resolution not supported")
+            interfaces.append((linktype, resolution))
+
+        elif block_type == BLOCK_ENHANCED_PACKET:
+            interface, high, low, captured, _ = struct.unpack_from(endian + "IIIII", body, 0)
+            linktype, resolution = interfaces[interface]
+            if linktype != LINKTYPE_VIGEM:
+                continue
+            timestamp = ((high << 32) | low) * 10 ** (9 - resolution)
+            yield "packet", timestamp, body[20:20 + captured]
+
+        elif block_type == BLOCK_INTERFACE_STATISTICS:
+            for code, value in read_options(body[12:], endian):
+                if code == OPT_ISB_IFDROP:
+                    yield "drops", struct.unpack(endian + "Q", value)[0]
+
+
+def read_options(data, endian):
+    offset = 0
+    while offset + 4 <= len(data):
+        code, length = struct.unpack_from(endian + "HH", data, offset)
+        if code == 0:
+            return
+        yield code, data[offset + 4:offset + 4 + length]
+        offset += 4 + ((length + 3) & ~3)
+
+
+def describe_payload(event, ioctl, payload):
+    """Decodes the interesting fields of the structures in BusShared.h."""
+    if ioctl == "check_version" and event == 0 and len(payload) >= 8:
+        return "version=%d" % struct.unpack_from("<I", payload, 4)
+
+    if ioctl == "plugin" and event == 0 and len(payload) >= 16:
+        target, vid, pid = struct.unpack_from("<IHH", payload, 8)
+        return "type=%s vid=0x%04X pid=0x%04X" % (TARGET_TYPES.get(target, target), vid, pid)
+
+    if ioctl == "xusb_submit" and event == 0 and len(payload) >= 20:
+        buttons, lt, rt, lx, ly, rx, ry = struct.unpack_from("<HBBhhhh", payload, 8)
+        return "buttons=0x%04X lt=%d rt=%d lx=%d ly=%d rx=%d ry=%d" % (buttons, lt, rt, lx, ly, rx, ry)
+
+    if ioctl == "ds4_submit" and event == 0 and len(payload) >= DS4_SUBMIT_REPORT_SIZE:
+        kind = "ex " if len(payload) >= DS4_SUBMIT_REPORT_EX_SIZE else ""
+        lx, ly, rx, ry, buttons, special, lt, rt = struct.unpack_from("<BBBBHBBB", payload, 8)
+        return "%sbuttons=0x%04X special=0x%02X lt=%d rt=%d lx=%d ly=%d rx=%d ry=%d" % (
+            kind, buttons, special, lt, rt, lx, ly, rx, ry)
+
+    if ioctl == "xusb_notification" and event == 1 and len(payload) >= 11:
+        large, small, led = struct.unpack_from("<BBB", payload, 8)
+        return "large=%d small=%d led=%d" % (large, small, led)
+
+    if ioctl == "ds4_notification" and event == 1 and len(payload) >= 13:
+        small, large, r, g, b = struct.unpack_from("<BBBBB", payload, 8)
+        return "small=%d large=%d lightbar=#%02X%02X%02X" % (small, large, r, g, b)
+
+    if ioctl == "xusb_user_index" and event == 1 and len(payload) >= 12:
+        return "user_index=%d" % struct.unpack_from("<I", payload, 8)
+
+    if ioctl == "ds4_await_output" and event == 1 and len(payload) > 8:
+        return "report=%s" % payload[8:8 + 16].hex()
+
+    return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument("capture", help="pcapng file written by vigem_capture_start")
+    parser.add_argument("--serial", type=int, help="only packets of this target serial number")
+    parser.add_argument("--ioctl", action="append", choices=sorted(IOCTLS.values()),
+                        help="only packets of this request type, may be repeated")
+    parser.add_argument("--event", action="append", choices=sorted(EVENTS.values()),
+                        help="only packets of this event, may be repeated")
+    parser.add_argument("--errors", action="store_true", help="only completions that failed")
+    parser.add_argument("--hex", action="store_true", help="dump the captured payload")
+    parser.add_argument("--summary", action="store_true", help="print counts instead of packets")
+    args = parser.parse_args()
+
+    counts = Counter()
+    first = None
+    drops = 0
+
+    try:
+        with open(args.capture, "rb") as stream:
+            for record in read_pcapng(stream):
+                if record[0] == "drops":
+                    drops += record[1]
+                    continue
+
+                _, timestamp, data = record
+                if len(data) < PACKET_HEADER.size:
+                    continue
+
+                event, simulated, _, request, code, serial, status, length = PACKET_HEADER.unpack_from(data)
+                payload = data[PACKET_HEADER.size:]
+                ioctl = ioctl_name(code)
+                event_name = EVENTS.get(event, str(event))
+
+                if args.serial is not None and serial != args.serial:
+                    continue
+                if args.ioctl and ioctl not in args.ioctl:
+                    continue
+                if args.event and event_name not in args.event:
+                    continue
+                if args.errors and (event != 1 or status == 0):
+                    continue
+
+                if first is None:
+                    first = timestamp
+
+                if args.summary:
+                    counts[(ioctl, event_name, status_name(status) if event == 1 else "")] += 1
+                    continue
+
+                line = "%12.6f %6d %-8s %-18s serial=%-3d len=%-4d" % (
+                    (timestamp - first) / 1e9, request, event_name, ioctl, serial, length)
+                if event == 1:
+                    line += " status=%s" % status_name(status)
+                if simulated:
+                    line += " sim"
+                details = describe_payload(event, ioctl, payload)
+                if details:
+                    line += " " + details
+                print(line)
+
+                if args.hex and payload:
+                    print(" " * 13 + payload.hex())
+    except (CaptureError, IndexError, struct.error) as error:
+        print("%s: malformed capture: %s" % (args.capture, error), file=sys.stderr)
+        return 1
+    except BrokenPipeError:
+        # output piped into head and the like
+        sys.stdout = open(os.devnull, "w")
+        return 0
+    except OSError as error:
+        print(error, file=sys.stderr)
+        return 1
+
+    if args.summary:
+        for (ioctl, event_name, status), count in sorted(counts.items()):
+            print("%-18s %-8s %-20s %d" % (ioctl, event_name, status, count))
+
+    if drops:
+        print("%d packets dropped while capturing" % drops, file=sys.stderr)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())